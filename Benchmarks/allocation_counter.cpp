@@ -0,0 +1,69 @@
+#include "allocation_counter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+/**
+ * Allocations made through the global operator new, see the replacements below.
+ */
+static std::atomic<UINT64> allocation_count( 0 );
+static std::atomic<UINT64> allocation_bytes( 0 );
+
+void*
+operator new( std::size_t size )
+{
+	allocation_count.fetch_add( 1, std::memory_order_relaxed );
+	allocation_bytes.fetch_add( size, std::memory_order_relaxed );
+
+	void* memory = std::malloc( size != 0 ? size : 1 );
+	if ( memory == nullptr )
+	{
+		throw std::bad_alloc();
+	}
+	return memory;
+}
+
+void*
+operator new[]( std::size_t size )
+{
+	return operator new( size );
+}
+
+void
+operator delete( void* memory ) noexcept
+{
+	std::free( memory );
+}
+
+void
+operator delete[]( void* memory ) noexcept
+{
+	operator delete( memory );
+}
+
+void
+operator delete( void* memory, std::size_t ) noexcept
+{
+	operator delete( memory );
+}
+
+void
+operator delete[]( void* memory, std::size_t ) noexcept
+{
+	operator delete( memory );
+}
+
+
+UINT64
+AllocationCount()
+{
+	return allocation_count.load();
+}
+
+
+UINT64
+AllocatedBytes()
+{
+	return allocation_bytes.load();
+}
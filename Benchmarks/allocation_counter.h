@@ -0,0 +1,25 @@
+
+#ifndef _ALLOCATION_COUNTER_H_
+#define _ALLOCATION_COUNTER_H_
+
+/**
+ * @file allocation_counter.h
+ * File containing the counters of the global operator new used by the benchmarks.
+ * Linking allocation_counter.cpp into a program replaces the global operator new and delete.
+ * They are kept in their own translation unit, so the compiler never sees malloc paired with
+ * free in the code that calls new and delete.
+ */
+
+#include "platform.h"
+
+/**
+ * @return number of allocations made through the global operator new.
+ */
+UINT64 AllocationCount();
+
+/**
+ * @return bytes requested through the global operator new.
+ */
+UINT64 AllocatedBytes();
+
+#endif
@@ -0,0 +1,60 @@
+
+/**
+ * @file generate_config.cpp
+ * Writes a synthetic configuration file, see GenerateConfig.
+ *
+ * @code
+ * generate_config <path> [--size 64M] [--sections 16] [--keys 64] [--value-min 4] [--value-max 32]
+ *                        [--comments 0.1] [--auto-keys 0.05] [--seed 1]
+ * @endcode
+ */
+
+#include <cstdio>
+#include <string>
+
+#include "synthetic_config.h"
+
+int
+main( int argc, char** argv )
+{
+	SyntheticConfig config;
+	std::string path;
+
+	for ( int i = 1; i < argc; ++i )
+	{
+		const std::string arg( argv[i] );
+		if ( arg.compare( 0, 2, "--" ) != 0 )
+		{
+			path = arg;
+		}
+		else if ( i + 1 >= argc || !ParseSyntheticOption( arg, argv[i + 1], config ) )
+		{
+			std::fprintf( stderr, "invalid option %s\n", arg.c_str() );
+			return 2;
+		}
+		else
+		{
+			++i;
+		}
+	}
+
+	if ( path.empty() )
+	{
+		std::fprintf( stderr, "usage: %s <path> [--size 64M] [--sections N] [--keys N] [--value-min N] [--value-max N] "
+							  "[--comments RATIO] [--auto-keys RATIO] [--seed N]\n", argv[0] );
+		return 2;
+	}
+
+	SyntheticStats stats;
+	if ( !GenerateConfig( path, config, stats ) )
+	{
+		std::fprintf( stderr, "could not generate %s, sizes must be between 1K and 1G\n", path.c_str() );
+		return 1;
+	}
+
+	std::printf( "%s: %llu bytes, %llu lines, %llu sections, %llu entries (%llu automatic keys), %llu comments\n",
+				 path.c_str(), static_cast<unsigned long long>( stats.bytes ), static_cast<unsigned long long>( stats.lines ),
+				 static_cast<unsigned long long>( stats.sections ), static_cast<unsigned long long>( stats.entries ),
+				 static_cast<unsigned long long>( stats.auto_keys ), static_cast<unsigned long long>( stats.comments ) );
+	return 0;
+}
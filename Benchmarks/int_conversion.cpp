@@ -0,0 +1,214 @@
+
+/**
+ * @file int_conversion.cpp
+ * Benchmark of the util integer conversions against the strtol and floating point
+ * implementations they replaced.
+ * Numbers of several widths are formatted and parsed repeatedly, the time per conversion is printed.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "utility.h"
+
+/**
+ * Implementations the util conversions replaced, kept for comparison.
+ */
+namespace legacy
+{
+
+/**
+ * Former util::Int64ToString, with its writes kept inside of the string and the sign fixed
+ * so its results can be compared.
+ * @note the floating point division is only exact for values well below 2^53.
+ */
+TSTRING
+Int64ToString( const INT64 num )
+{
+	INT64 i = 0;
+	INT64 p_num = num;
+
+	int neg = 0;
+	int digits = 0;
+
+	TSTRING str( TEXT("0") );
+
+	if ( num < 0 )
+	{
+		neg = 1;
+		p_num = -num;
+	}
+
+	for ( i = 1; i <= p_num; i *= 10 )
+	{
+		digits += 1;
+	}
+
+	if ( digits > 0 )
+	{
+		str.resize( digits + neg );
+
+		if ( neg ) str[0] = '-';
+
+		for ( ; p_num > 0; digits -= 1 )
+		{
+			str[digits + neg - 1] = '0' + ( p_num % 10 );
+			p_num = (INT64) ( p_num * 0.1 );
+		}
+	}
+
+	return str;
+}
+
+
+/**
+ * Former util::StringToInt64.
+ * @note strtol returns long, values over 32 bits are truncated on LLP64 targets.
+ */
+INT64
+StringToInt64( const TSTRING& str, const int base = 0 )
+{
+	TCHAR* end;
+	return strtol_t( str.c_str(), &end, base );
+}
+
+}
+
+typedef std::chrono::steady_clock Clock;
+
+/** Number of times every value is converted. */
+static const int ROUNDS = 50;
+
+/**
+ * @param start time the run started.
+ * @param count number of conversions in the run.
+ * @return nanoseconds per conversion.
+ */
+static double
+NanosecondsPer( const Clock::time_point start, const size_t count )
+{
+	return std::chrono::duration<double, std::nano>( Clock::now() - start ).count() / static_cast<double>( count );
+}
+
+
+/**
+ * Times formatting and parsing of a set of values.
+ * @param name description of the values.
+ * @param values values to convert.
+ * @return false if the implementations disagree on any value.
+ */
+static bool
+Run( const char* name, const std::vector<INT64>& values )
+{
+	std::vector<TSTRING> strings;
+	strings.reserve( values.size() );
+	for ( size_t i = 0; i < values.size(); ++i )
+	{
+		strings.push_back( util::Int64ToString( values[i] ) );
+		INT64 parsed = 0;
+		if ( strings[i] != legacy::Int64ToString( values[i] ) || !util::ParseInt64( strings[i], parsed, 10 ) || parsed != values[i] )
+		{
+			std::printf( "%s: implementations disagree on %s\n", name, strings[i].c_str() );
+			return false;
+		}
+	}
+
+	const size_t count = values.size() * ROUNDS;
+	size_t sink = 0;
+
+	Clock::time_point start = Clock::now();
+	for ( int r = 0; r < ROUNDS; ++r )
+	{
+		for ( size_t i = 0; i < values.size(); ++i )
+		{
+			sink += legacy::Int64ToString( values[i] ).size();
+		}
+	}
+	const double legacyFormat = NanosecondsPer( start, count );
+
+	start = Clock::now();
+	for ( int r = 0; r < ROUNDS; ++r )
+	{
+		for ( size_t i = 0; i < values.size(); ++i )
+		{
+			sink += util::Int64ToString( values[i] ).size();
+		}
+	}
+	const double format = NanosecondsPer( start, count );
+
+	start = Clock::now();
+	for ( int r = 0; r < ROUNDS; ++r )
+	{
+		for ( size_t i = 0; i < values.size(); ++i )
+		{
+			TCHAR buffer[util::INT64_MAX_CHARS];
+			sink += util::FormatInt64( values[i], buffer );
+		}
+	}
+	const double formatBuffer = NanosecondsPer( start, count );
+
+	start = Clock::now();
+	for ( int r = 0; r < ROUNDS; ++r )
+	{
+		for ( size_t i = 0; i < strings.size(); ++i )
+		{
+			sink += static_cast<size_t>( legacy::StringToInt64( strings[i], 10 ) );
+		}
+	}
+	const double legacyParse = NanosecondsPer( start, count );
+
+	start = Clock::now();
+	for ( int r = 0; r < ROUNDS; ++r )
+	{
+		for ( size_t i = 0; i < strings.size(); ++i )
+		{
+			INT64 value = 0;
+			util::ParseInt64( strings[i], value, 10 );
+			sink += static_cast<size_t>( value );
+		}
+	}
+	const double parse = NanosecondsPer( start, count );
+
+	std::printf( "%-12s format %7.2f -> %6.2f ns (buffer %6.2f ns, %5.1fx)   parse %7.2f -> %6.2f ns (%5.1fx)   [%zu]\n",
+				 name, legacyFormat, format, formatBuffer, legacyFormat / format,
+				 legacyParse, parse, legacyParse / parse, sink & 0xF );
+	return true;
+}
+
+
+int
+main()
+{
+	const size_t count = 100000;
+	std::mt19937_64 random( 12345 );
+
+	struct Width
+	{
+		const char* name;
+		INT64 limit;
+	};
+
+	const Width widths[] = {
+		{ "1-2 digits", 100 },
+		{ "3-4 digits", 10000 },
+		{ "5-9 digits", 1000000000 },
+		{ "10-15 digits", INT64( 1000000000000000 ) },
+	};
+
+	bool agreed = true;
+	for ( size_t w = 0; w < sizeof( widths ) / sizeof( widths[0] ); ++w )
+	{
+		std::vector<INT64> values;
+		values.reserve( count );
+		for ( size_t i = 0; i < count; ++i )
+		{
+			INT64 value = static_cast<INT64>( random() % static_cast<UINT64>( widths[w].limit ) );
+			values.push_back( ( random() & 1 ) ? -value : value );
+		}
+		agreed = Run( widths[w].name, values ) && agreed;
+	}
+
+	return agreed ? 0 : 1;
+}
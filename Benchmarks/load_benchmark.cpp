@@ -0,0 +1,475 @@
+
+/**
+ * @file load_benchmark.cpp
+ * Load throughput benchmark.
+ * Generates synthetic configuration files of several sizes and times opening them, attaching
+ * a DefaultParser to every section and closing them, with every load mode.
+ * Each phase reports MB/s, lines/s, allocations and peak resident memory, results are printed
+ * as a table and optionally written as JSON.
+ *
+ * @code
+ * load_benchmark [--sizes 1M,16M,256M] [--repeat 5] [--dir /tmp/] [--json results.json] [--keep]
+ *                [generator options, see generate_config]
+ * @endcode
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "config_loader.h"
+#include "synthetic_config.h"
+#include "allocation_counter.h"
+
+#ifdef _WIN32
+#include <psapi.h>
+#endif
+
+/**
+ * Resets the peak resident memory so the next PeakResident only covers what follows.
+ * Only supported by Linux, elsewhere the peak is for the whole process.
+ */
+static void
+ResetPeakResident()
+{
+#ifdef __linux__
+	FILE* file = std::fopen( "/proc/self/clear_refs", "w" );
+	if ( file != nullptr )
+	{
+		std::fputs( "5", file );
+		std::fclose( file );
+	}
+#endif
+}
+
+
+/**
+ * @return peak resident memory of the process in bytes, 0 if unknown.
+ */
+static UINT64
+PeakResident()
+{
+#if defined( _WIN32 )
+	PROCESS_MEMORY_COUNTERS counters;
+	if ( GetProcessMemoryInfo( GetCurrentProcess(), &counters, sizeof( counters ) ) )
+	{
+		return counters.PeakWorkingSetSize;
+	}
+#elif defined( __linux__ )
+	FILE* file = std::fopen( "/proc/self/status", "r" );
+	if ( file != nullptr )
+	{
+		char line[256];
+		unsigned long long kilobytes = 0;
+		while ( std::fgets( line, sizeof( line ), file ) != nullptr )
+		{
+			if ( std::sscanf( line, "VmHWM: %llu kB", &kilobytes ) == 1 )
+			{
+				break;
+			}
+		}
+		std::fclose( file );
+		return kilobytes * 1024;
+	}
+#endif
+	return 0;
+}
+
+
+typedef std::chrono::steady_clock Clock;
+
+/**
+ * Measurements of one phase of a load.
+ */
+struct Phase
+{
+	double seconds; /**< wall time. */
+	UINT64 allocations; /**< calls to operator new. */
+	UINT64 allocated_bytes; /**< bytes requested from operator new. */
+	UINT64 peak_resident; /**< peak resident memory during the phase, see ResetPeakResident. */
+};
+
+/**
+ * Times a phase.
+ */
+class PhaseTimer
+{
+public:
+	/**
+	 * Constructor, starts the phase.
+	 * @param phase measurements to fill in when Stop is called.
+	 */
+	explicit PhaseTimer( Phase& phase )
+		: phase( phase )
+	{
+		ResetPeakResident();
+		count = AllocationCount();
+		bytes = AllocatedBytes();
+		start = Clock::now();
+	}
+
+	/**
+	 * Ends the phase.
+	 */
+	void Stop()
+	{
+		phase.seconds = std::chrono::duration<double>( Clock::now() - start ).count();
+		phase.allocations = AllocationCount() - count;
+		phase.allocated_bytes = AllocatedBytes() - bytes;
+		phase.peak_resident = PeakResident();
+	}
+
+private:
+	Phase& phase;
+	Clock::time_point start;
+	UINT64 count;
+	UINT64 bytes;
+};
+
+/** Number of phases of a load. */
+static const size_t PHASE_COUNT = 3;
+
+/** Names of the phases, in order. */
+static const char* const PHASE_NAMES[PHASE_COUNT] = { "open", "attach", "close" };
+
+/**
+ * Load modes that are compared.
+ */
+struct Mode
+{
+	const char* name; /**< name in the results. */
+	int flags; /**< ConfigFlags to open with. */
+	bool image; /**< compile an image of the file before opening it. */
+};
+
+static const Mode MODES[] = {
+	{ "eager", CONFIG_EAGER, false },
+	{ "lazy", CONFIG_LAZY, false },
+	{ "mapped", CONFIG_LAZY | CONFIG_MAPPED, false },
+#ifndef _UNICODE
+	/* images are only supported by narrow charactor builds, they are compiled last as an
+	 * image also replaces the text file for the other modes. */
+	{ "image", CONFIG_LAZY, true },
+#endif
+};
+
+/**
+ * Result of loading one file with one mode, the median of every repeat.
+ */
+struct Result
+{
+	UINT64 size; /**< requested size. */
+	const Mode* mode; /**< mode used. */
+	SyntheticStats stats; /**< contents of the file. */
+	Phase phases[PHASE_COUNT]; /**< measurements of each phase. */
+};
+
+/**
+ * @param text a narrow string.
+ * @return the string as a TSTRING.
+ */
+static TSTRING
+ToTString( const std::string& text )
+{
+	return TSTRING( text.begin(), text.end() );
+}
+
+
+/**
+ * Opens, attaches every section of and closes a generated file once.
+ * @param dir directory of the file.
+ * @param name file name.
+ * @param config shape of the file, for the section names.
+ * @param mode mode to load with.
+ * @param phases set to the measurements of each phase.
+ * @return false if the file could not be opened or a section could not be attached.
+ */
+static bool
+LoadOnce( const std::string& dir, const std::string& name, const SyntheticConfig& config, const Mode& mode, Phase* phases )
+{
+	bool attached = true;
+
+	PhaseTimer open( phases[0] );
+	CONFIGHANDLE handle = OPEN_CONFIG( ToTString( name ), ToTString( dir ), mode.flags );
+	open.Stop();
+
+	/* names are built before timing so the phase only covers the loader. */
+	std::vector<TSTRING> names;
+	names.reserve( config.sections );
+	for ( size_t s = 0; s < config.sections; ++s )
+	{
+		names.push_back( ToTString( SyntheticSectionName( s ) ) );
+	}
+
+	PhaseTimer attach( phases[1] );
+	for ( size_t s = 0; s < names.size(); ++s )
+	{
+		DefaultParser* parser = new DefaultParser( names[s] );
+		if ( !handle->AddSection( parser ) )
+		{
+			delete parser;
+			attached = false;
+		}
+	}
+	attach.Stop();
+
+	PhaseTimer close( phases[2] );
+	handle.reset();
+	close.Stop();
+
+	return attached;
+}
+
+
+/**
+ * @param phases measurements of every repeat of a phase.
+ * @return the measurements of the repeat with the median time.
+ */
+static Phase
+Median( std::vector<Phase> phases )
+{
+	std::sort( phases.begin(), phases.end(), []( const Phase& a, const Phase& b ) { return a.seconds < b.seconds; } );
+	return phases[phases.size() / 2];
+}
+
+
+/**
+ * @param amount amount processed.
+ * @param seconds time taken.
+ * @return amount per second, 0 if no time was measured.
+ */
+static double
+PerSecond( const double amount, const double seconds )
+{
+	return ( seconds > 0.0 ) ? amount / seconds : 0.0;
+}
+
+
+/**
+ * Writes the results as JSON.
+ * @param file file to write to.
+ * @param config generator options.
+ * @param repeat repeats of every load.
+ * @param results results to write.
+ */
+static void
+WriteJson( FILE* file, const SyntheticConfig& config, const int repeat, const std::vector<Result>& results )
+{
+	std::fprintf( file, "{\n  \"benchmark\": \"load\",\n  \"version\": 1,\n" );
+	std::fprintf( file, "  \"generator\": { \"sections\": %zu, \"value_min\": %zu, \"value_max\": %zu, "
+						"\"comment_ratio\": %g, \"auto_key_ratio\": %g, \"seed\": %llu },\n",
+				  config.sections, config.value_min, config.value_max, config.comment_ratio, config.auto_key_ratio,
+				  static_cast<unsigned long long>( config.seed ) );
+	std::fprintf( file, "  \"repeat\": %d,\n  \"results\": [", repeat );
+
+	for ( size_t r = 0; r < results.size(); ++r )
+	{
+		const Result& result = results[r];
+		std::fprintf( file, "%s\n    {\n      \"size\": %llu, \"mode\": \"%s\", \"bytes\": %llu, \"lines\": %llu, "
+							"\"sections\": %llu, \"entries\": %llu,\n      \"phases\": {",
+					  ( r == 0 ) ? "" : ",",
+					  static_cast<unsigned long long>( result.size ), result.mode->name,
+					  static_cast<unsigned long long>( result.stats.bytes ), static_cast<unsigned long long>( result.stats.lines ),
+					  static_cast<unsigned long long>( result.stats.sections ), static_cast<unsigned long long>( result.stats.entries ) );
+
+		for ( size_t p = 0; p < PHASE_COUNT; ++p )
+		{
+			const Phase& phase = result.phases[p];
+			std::fprintf( file, "%s\n        \"%s\": { \"seconds\": %.9f, \"mb_per_s\": %.3f, \"lines_per_s\": %.1f, "
+								"\"allocations\": %llu, \"allocated_bytes\": %llu, \"peak_rss_bytes\": %llu }",
+						  ( p == 0 ) ? "" : ",", PHASE_NAMES[p], phase.seconds,
+						  PerSecond( static_cast<double>( result.stats.bytes ) / ( 1024.0 * 1024.0 ), phase.seconds ),
+						  PerSecond( static_cast<double>( result.stats.lines ), phase.seconds ),
+						  static_cast<unsigned long long>( phase.allocations ),
+						  static_cast<unsigned long long>( phase.allocated_bytes ),
+						  static_cast<unsigned long long>( phase.peak_resident ) );
+		}
+		std::fprintf( file, "\n      }\n    }" );
+	}
+	std::fprintf( file, "\n  ]\n}\n" );
+}
+
+
+/**
+ * Prints the results as a table.
+ * @param results results to print.
+ */
+static void
+PrintTable( const std::vector<Result>& results )
+{
+	std::printf( "%12s %6s %7s %10s %14s %12s %14s\n", "size", "mode", "phase", "MB/s", "lines/s", "allocations", "peak RSS KB" );
+	for ( size_t r = 0; r < results.size(); ++r )
+	{
+		const Result& result = results[r];
+		for ( size_t p = 0; p < PHASE_COUNT; ++p )
+		{
+			const Phase& phase = result.phases[p];
+			std::printf( "%12llu %6s %7s %10.1f %14.0f %12llu %14llu\n",
+						 static_cast<unsigned long long>( result.stats.bytes ), result.mode->name, PHASE_NAMES[p],
+						 PerSecond( static_cast<double>( result.stats.bytes ) / ( 1024.0 * 1024.0 ), phase.seconds ),
+						 PerSecond( static_cast<double>( result.stats.lines ), phase.seconds ),
+						 static_cast<unsigned long long>( phase.allocations ),
+						 static_cast<unsigned long long>( phase.peak_resident / 1024 ) );
+		}
+	}
+}
+
+
+int
+main( int argc, char** argv )
+{
+	SyntheticConfig config;
+	std::vector<UINT64> sizes;
+	std::string dir;
+	std::string json;
+	int repeat = 5;
+	bool keep = false;
+
+	for ( int i = 1; i < argc; ++i )
+	{
+		const std::string arg( argv[i] );
+		const std::string value( ( i + 1 < argc ) ? argv[i + 1] : "" );
+		bool valid = ( i + 1 < argc );
+
+		if ( arg == "--keep" )
+		{
+			keep = true;
+			continue;
+		}
+		else if ( arg == "--sizes" )
+		{
+			for ( size_t start = 0; valid && start <= value.size(); )
+			{
+				size_t end = value.find( ',', start );
+				end = ( end == std::string::npos ) ? value.size() : end;
+				UINT64 size = 0;
+				valid = ParseSyntheticSize( value.substr( start, end - start ), size );
+				sizes.push_back( size );
+				start = end + 1;
+			}
+		}
+		else if ( arg == "--repeat" )
+		{
+			repeat = std::atoi( value.c_str() );
+			valid = valid && repeat > 0;
+		}
+		else if ( arg == "--dir" )
+		{
+			dir = value;
+		}
+		else if ( arg == "--json" )
+		{
+			json = value;
+		}
+		else
+		{
+			valid = valid && ParseSyntheticOption( arg, value, config );
+		}
+
+		if ( !valid )
+		{
+			std::fprintf( stderr, "invalid option %s\n", arg.c_str() );
+			return 2;
+		}
+		++i;
+	}
+
+	if ( sizes.empty() )
+	{
+		sizes.push_back( ( config.size != 0 ) ? config.size : 1024 * 1024 );
+	}
+
+	/* the loader expects the path to end with a separator. */
+	if ( !dir.empty() && dir[dir.size() - 1] != '/' && dir[dir.size() - 1] != '\\' )
+	{
+		dir += '/';
+	}
+
+	std::vector<Result> results;
+	bool success = true;
+
+	for ( size_t s = 0; s < sizes.size() && success; ++s )
+	{
+		char name[64];
+		std::snprintf( name, sizeof( name ), "load_benchmark_%llu.ini", static_cast<unsigned long long>( sizes[s] ) );
+		const std::string path = dir + name;
+
+		SyntheticConfig sized( config );
+		sized.size = sizes[s];
+
+		SyntheticStats stats;
+		if ( !GenerateConfig( path, sized, stats ) )
+		{
+			std::fprintf( stderr, "could not generate %s, sizes must be between 1K and 1G\n", path.c_str() );
+			success = false;
+			break;
+		}
+
+		for ( size_t m = 0; m < sizeof( MODES ) / sizeof( MODES[0] ) && success; ++m )
+		{
+			const Mode& mode = MODES[m];
+			if ( mode.image && !ConfigImage::Compile( ToTString( path ), ConfigImage::ImagePath( ToTString( path ) ) ) )
+			{
+				std::fprintf( stderr, "could not compile an image of %s\n", path.c_str() );
+				continue;
+			}
+
+			std::vector<Phase> phases[PHASE_COUNT];
+			for ( int r = 0; r < repeat && success; ++r )
+			{
+				Phase run[PHASE_COUNT];
+				if ( !LoadOnce( dir, name, sized, mode, run ) )
+				{
+					std::fprintf( stderr, "could not load every section of %s\n", path.c_str() );
+					success = false;
+				}
+				for ( size_t p = 0; p < PHASE_COUNT; ++p )
+				{
+					phases[p].push_back( run[p] );
+				}
+			}
+
+			Result result;
+			result.size = sizes[s];
+			result.mode = &mode;
+			result.stats = stats;
+			for ( size_t p = 0; p < PHASE_COUNT; ++p )
+			{
+				result.phases[p] = Median( phases[p] );
+			}
+			results.push_back( result );
+
+			if ( mode.image && !keep )
+			{
+				std::remove( std::string( path + ".bin" ).c_str() );
+			}
+		}
+
+		if ( !keep )
+		{
+			std::remove( path.c_str() );
+		}
+	}
+
+	PrintTable( results );
+
+	if ( !json.empty() )
+	{
+		FILE* file = ( json == "-" ) ? stdout : std::fopen( json.c_str(), "w" );
+		if ( file == nullptr )
+		{
+			std::fprintf( stderr, "could not write %s\n", json.c_str() );
+			return 1;
+		}
+		WriteJson( file, config, repeat, results );
+		if ( file != stdout )
+		{
+			std::fclose( file );
+		}
+	}
+
+	return success ? 0 : 1;
+}
@@ -0,0 +1,860 @@
+
+/**
+ * @file lookup_benchmark.cpp
+ * Lookup latency and contention benchmark.
+ * Generates a synthetic configuration file, attaches a DefaultParser to every section and then
+ * looks keys up from an increasing number of threads, optionally while another thread reloads
+ * the file or opens and closes configs. Every lookup is timed, the latencies are reported as
+ * percentiles and histograms along with the total operations per second, as a table and optionally JSON.
+ *
+ * Operations, each ends with one of the DefaultParser getters:
+ * - parser: the parser is found once up front, only the getter is timed.
+ * - section: ConfigLoader::GetSection then the getter.
+ * - file: ConfigLoader::GetFileSection then the getter.
+ *
+ * Key distributions:
+ * - uniform: every key of every section equally often.
+ * - zipf: a few keys very often, Zipfian with an exponent of 0.99 over every key.
+ * - miss: nine in ten lookups are for keys that do not exist and return the default.
+ *
+ * @code
+ * lookup_benchmark [--threads 1,2,4,8] [--ops 200000] [--distribution uniform|zipf|miss|all]
+ *                  [--operation parser|section|file|all] [--churn none|reload|open-close]
+ *                  [--churn-interval 1000] [--dir /tmp/] [--json results.json]
+ *                  [--sections 16] [--keys 64] [generator options, see generate_config]
+ * @endcode
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "config_loader.h"
+#include "synthetic_config.h"
+
+typedef std::chrono::steady_clock Clock;
+
+/**
+ * Histogram of latencies in nanoseconds.
+ * Buckets are exact below 16ns, above that every power of two is split into 16 buckets so
+ * any value is within about 6% of its bucket.
+ */
+class LatencyHistogram
+{
+public:
+	static const size_t SUB_BUCKETS = 16; /**< buckets per power of two. */
+	static const size_t BUCKETS = SUB_BUCKETS + ( 64 - 4 ) * SUB_BUCKETS; /**< buckets covering every UINT64. */
+
+	/**
+	 * Constructor, creates an empty histogram.
+	 */
+	LatencyHistogram()
+		: counts( BUCKETS, 0 ), total( 0 ), maximum( 0 ) {}
+
+	/**
+	 * Adds a latency.
+	 * @param nanoseconds latency to add.
+	 */
+	void Add( const UINT64 nanoseconds )
+	{
+		counts[Bucket( nanoseconds )] += 1;
+		total += 1;
+		maximum = std::max( maximum, nanoseconds );
+	}
+
+	/**
+	 * Adds every latency of another histogram.
+	 * @param other histogram to add.
+	 */
+	void Merge( const LatencyHistogram& other )
+	{
+		for ( size_t i = 0; i < BUCKETS; ++i )
+		{
+			counts[i] += other.counts[i];
+		}
+		total += other.total;
+		maximum = std::max( maximum, other.maximum );
+	}
+
+	/**
+	 * @param fraction fraction of the latencies, in [0, 1].
+	 * @return upper bound of the bucket holding that fraction of the latencies, 0 if empty.
+	 */
+	UINT64 Percentile( const double fraction ) const
+	{
+		const UINT64 rank = static_cast<UINT64>( std::ceil( fraction * static_cast<double>( total ) ) );
+		UINT64 seen = 0;
+		for ( size_t i = 0; i < BUCKETS; ++i )
+		{
+			seen += counts[i];
+			if ( seen >= rank && seen > 0 )
+			{
+				return std::min( UpperBound( i ), maximum );
+			}
+		}
+		return maximum;
+	}
+
+	/**
+	 * @return number of latencies added.
+	 */
+	UINT64 Total() const
+	{
+		return total;
+	}
+
+	/**
+	 * @return largest latency added.
+	 */
+	UINT64 Maximum() const
+	{
+		return maximum;
+	}
+
+	/**
+	 * @param index a bucket.
+	 * @return number of latencies in the bucket.
+	 */
+	UINT64 Count( const size_t index ) const
+	{
+		return counts[index];
+	}
+
+	/**
+	 * @param index a bucket.
+	 * @return largest latency that falls in the bucket.
+	 */
+	static UINT64 UpperBound( const size_t index )
+	{
+		if ( index < SUB_BUCKETS )
+		{
+			return index;
+		}
+		const size_t shift = ( index - SUB_BUCKETS ) / SUB_BUCKETS;
+		const UINT64 sub = ( index - SUB_BUCKETS ) % SUB_BUCKETS;
+		return ( ( SUB_BUCKETS + sub + 1 ) << shift ) - 1;
+	}
+
+private:
+	/**
+	 * @param nanoseconds a latency.
+	 * @return bucket of the latency.
+	 */
+	static size_t Bucket( const UINT64 nanoseconds )
+	{
+		if ( nanoseconds < SUB_BUCKETS )
+		{
+			return static_cast<size_t>( nanoseconds );
+		}
+		size_t top = 63;
+		while ( ( nanoseconds >> top ) == 0 )
+		{
+			--top;
+		}
+		const size_t shift = top - 4;
+		return SUB_BUCKETS + shift * SUB_BUCKETS + static_cast<size_t>( ( nanoseconds >> shift ) & ( SUB_BUCKETS - 1 ) );
+	}
+
+	std::vector<UINT64> counts; /**< latencies in each bucket. */
+	UINT64 total; /**< latencies added. */
+	UINT64 maximum; /**< largest latency added. */
+};
+
+/**
+ * Operations that are timed.
+ */
+enum Operation
+{
+	OP_PARSER,
+	OP_SECTION,
+	OP_FILE,
+	OP_COUNT
+};
+
+static const char* const OPERATION_NAMES[OP_COUNT] = { "parser", "section", "file" };
+
+/**
+ * Key distributions.
+ */
+enum Distribution
+{
+	DIST_UNIFORM,
+	DIST_ZIPF,
+	DIST_MISS,
+	DIST_COUNT
+};
+
+static const char* const DISTRIBUTION_NAMES[DIST_COUNT] = { "uniform", "zipf", "miss" };
+
+/**
+ * Background work done while the lookups run.
+ */
+enum Churn
+{
+	CHURN_NONE,
+	CHURN_RELOAD,
+	CHURN_OPEN_CLOSE,
+	CHURN_COUNT
+};
+
+static const char* const CHURN_NAMES[CHURN_COUNT] = { "none", "reload", "open-close" };
+
+/** Number of requests generated per thread, threads cycle through them. */
+static const size_t REQUESTS = 1 << 16;
+
+/** Fraction of lookups of the miss distribution that find their key. */
+static const double MISS_HIT_RATIO = 0.1;
+
+/**
+ * Single lookup.
+ */
+struct Request
+{
+	UINT32 section; /**< index of the section. */
+	UINT32 key; /**< index of the key in Workload::keys. */
+	UINT32 getter; /**< which DefaultParser getter to call. */
+};
+
+/**
+ * Everything the lookup threads share.
+ */
+struct Workload
+{
+	TSTRING file; /**< file name as it was opened. */
+	std::vector<TSTRING> section_names; /**< names of the sections. */
+	std::vector<TSTRING> key_names; /**< keys that exist followed by keys that do not. */
+	std::vector<KeyView> sections; /**< views of section_names. */
+	std::vector<KeyView> keys; /**< views of key_names. */
+	size_t hit_keys; /**< keys at the start of keys that exist. */
+	std::vector<DefaultParser*> parsers; /**< parser of each section, for OP_PARSER. */
+	CONFIGHANDLE* handle; /**< the open config. */
+	bool guard; /**< take a ConfigLoader::ReadGuard around every lookup. */
+};
+
+/**
+ * SplitMix64, the same stream on every platform.
+ * @param state generator state.
+ * @return next 64 bit value.
+ */
+static UINT64
+NextRandom( UINT64& state )
+{
+	UINT64 z = ( state += 0x9E3779B97F4A7C15ull );
+	z = ( z ^ ( z >> 30 ) ) * 0xBF58476D1CE4E5B9ull;
+	z = ( z ^ ( z >> 27 ) ) * 0x94D049BB133111EBull;
+	return z ^ ( z >> 31 );
+}
+
+
+/**
+ * Generates the requests of one thread.
+ * Zipfian ranks are spread over the keys by a fixed shuffle so the popular keys are not all in the first section.
+ * @param workload keys and sections.
+ * @param keysPerSection keys that exist in each section.
+ * @param distribution key distribution.
+ * @param seed seed of the thread.
+ * @return requests to cycle through.
+ */
+static std::vector<Request>
+GenerateRequests( const Workload& workload, const size_t keysPerSection, const Distribution distribution, UINT64 seed )
+{
+	const size_t sectionCount = workload.sections.size();
+	const size_t keyCount = sectionCount * keysPerSection;
+
+	std::vector<double> cdf;
+	std::vector<UINT32> shuffle;
+	if ( distribution == DIST_ZIPF )
+	{
+		double sum = 0.0;
+		cdf.reserve( keyCount );
+		for ( size_t rank = 1; rank <= keyCount; ++rank )
+		{
+			sum += 1.0 / std::pow( static_cast<double>( rank ), 0.99 );
+			cdf.push_back( sum );
+		}
+
+		UINT64 shuffleState = 0x5EED;
+		for ( size_t i = 0; i < keyCount; ++i )
+		{
+			shuffle.push_back( static_cast<UINT32>( i ) );
+		}
+		for ( size_t i = keyCount; i > 1; --i )
+		{
+			std::swap( shuffle[i - 1], shuffle[NextRandom( shuffleState ) % i] );
+		}
+	}
+
+	std::vector<Request> requests( REQUESTS );
+	for ( size_t r = 0; r < REQUESTS; ++r )
+	{
+		Request& request = requests[r];
+		const UINT64 random = NextRandom( seed );
+		request.getter = static_cast<UINT32>( random >> 62 );
+
+		size_t index = static_cast<size_t>( NextRandom( seed ) % keyCount );
+		if ( distribution == DIST_ZIPF )
+		{
+			const double target = static_cast<double>( NextRandom( seed ) >> 11 ) * ( 1.0 / 9007199254740992.0 ) * cdf.back();
+			index = shuffle[std::lower_bound( cdf.begin(), cdf.end(), target ) - cdf.begin()];
+		}
+
+		request.section = static_cast<UINT32>( index / keysPerSection );
+		request.key = static_cast<UINT32>( index % keysPerSection );
+
+		if ( distribution == DIST_MISS &&
+			 static_cast<double>( NextRandom( seed ) >> 11 ) * ( 1.0 / 9007199254740992.0 ) >= MISS_HIT_RATIO )
+		{
+			request.key = static_cast<UINT32>( workload.hit_keys + NextRandom( seed ) % ( workload.keys.size() - workload.hit_keys ) );
+		}
+	}
+	return requests;
+}
+
+
+/**
+ * Calls one of the getters.
+ * @param parser parser to read from, may be nullptr.
+ * @param key key to look up.
+ * @param getter which getter to call.
+ * @return something derived from the result so the call is not removed.
+ */
+static UINT64
+Get( const DefaultParser* parser, const KeyView& key, const UINT32 getter )
+{
+	if ( parser == nullptr )
+	{
+		return 0;
+	}
+
+	switch ( getter )
+	{
+		case 0: return parser->getString( key, TSTRING() ).size();
+		case 1: return parser->getStringView( key ).size();
+		case 2: return static_cast<UINT64>( parser->getInt64( key, -1 ) );
+		default: return static_cast<UINT64>( parser->getDouble( key, 0.5 ) * 8.0 );
+	}
+}
+
+
+/**
+ * Performs one lookup.
+ * @param workload shared keys and sections.
+ * @param request lookup to perform.
+ * @param operation how the parser is found.
+ * @return something derived from the result so the call is not removed.
+ */
+static UINT64
+Lookup( const Workload& workload, const Request& request, const Operation operation )
+{
+	const KeyView& key = workload.keys[request.key];
+	switch ( operation )
+	{
+		case OP_SECTION:
+			return Get( static_cast<DefaultParser*>( ( *workload.handle )->GetSection( workload.sections[request.section] ) ), key, request.getter );
+		case OP_FILE:
+			return Get( static_cast<DefaultParser*>( ConfigLoader::GetFileSection( workload.file, workload.sections[request.section] ) ), key, request.getter );
+		default:
+			return Get( workload.parsers[request.section], key, request.getter );
+	}
+}
+
+
+/**
+ * Performs and times lookups on one thread.
+ * @param workload shared keys and sections.
+ * @param requests requests of the thread.
+ * @param operation operation to time.
+ * @param ops number of lookups to perform.
+ * @param start set by the main thread once every thread is ready.
+ * @param histogram latencies of the thread.
+ * @param sink set to a value derived from every result.
+ */
+static void
+LookupThread( const Workload& workload, const std::vector<Request>& requests, const Operation operation, const size_t ops,
+			  const std::atomic<bool>& start, LatencyHistogram& histogram, UINT64& sink )
+{
+	UINT64 result = 0;
+
+	while ( !start.load( std::memory_order_acquire ) )
+	{
+		std::this_thread::yield();
+	}
+
+	for ( size_t i = 0; i < ops; ++i )
+	{
+		const Request& request = requests[i % requests.size()];
+
+		const Clock::time_point before = Clock::now();
+		if ( workload.guard )
+		{
+			ConfigLoader::ReadGuard guard;
+			result += Lookup( workload, request, operation );
+		}
+		else
+		{
+			result += Lookup( workload, request, operation );
+		}
+		const Clock::time_point after = Clock::now();
+
+		histogram.Add( static_cast<UINT64>( std::chrono::duration_cast<std::chrono::nanoseconds>( after - before ).count() ) );
+	}
+
+	sink = result;
+}
+
+
+/**
+ * Background work done while the lookups run.
+ */
+class ChurnThread
+{
+public:
+	/**
+	 * Constructor, starts the thread.
+	 * @param churn work to do, nothing for CHURN_NONE.
+	 * @param dir directory of the config.
+	 * @param name file name of the config.
+	 * @param handle the open config.
+	 * @param interval microseconds to wait between each reload or open.
+	 */
+	ChurnThread( const Churn churn, const std::string& dir, const std::string& name, CONFIGHANDLE& handle, const int interval )
+		: stop( false ), iterations( 0 )
+	{
+		if ( churn == CHURN_RELOAD )
+		{
+			FILE* file = std::fopen( ( dir + name ).c_str(), "rb" );
+			if ( file != nullptr )
+			{
+				char buffer[4096];
+				size_t read;
+				while ( ( read = std::fread( buffer, 1, sizeof( buffer ), file ) ) > 0 )
+				{
+					contents.append( buffer, read );
+				}
+				std::fclose( file );
+			}
+			thread = std::thread( &ChurnThread::Reload, this, dir + name, std::ref( handle ), interval );
+		}
+		else if ( churn == CHURN_OPEN_CLOSE )
+		{
+			thread = std::thread( &ChurnThread::OpenClose, this, dir, name, interval );
+		}
+	}
+
+	/**
+	 * Destructor, stops the thread.
+	 */
+	~ChurnThread()
+	{
+		stop.store( true );
+		if ( thread.joinable() )
+		{
+			thread.join();
+		}
+	}
+
+	/**
+	 * @return reloads or opens done so far.
+	 */
+	UINT64 Iterations() const
+	{
+		return iterations.load();
+	}
+
+private:
+	/**
+	 * Rewrites section_0 with a new value and reloads, until stopped.
+	 * The file is replaced by renaming so a reload never sees it half written.
+	 */
+	void Reload( const std::string path, CONFIGHANDLE& handle, const int interval )
+	{
+		const std::string temporary = path + ".tmp";
+		while ( !stop.load() )
+		{
+			FILE* file = std::fopen( temporary.c_str(), "wb" );
+			if ( file != nullptr )
+			{
+				/* repeated headers are merged, so this changes a key of section_0 */
+				std::fprintf( file, "%s\n[section_0]\nchurn = %llu\n", contents.c_str(), static_cast<unsigned long long>( iterations.load() ) );
+				std::fclose( file );
+#ifdef _WIN32
+				MoveFileExA( temporary.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING );
+#else
+				std::rename( temporary.c_str(), path.c_str() );
+#endif
+			}
+
+			handle->Reload();
+			iterations.fetch_add( 1 );
+			std::this_thread::sleep_for( std::chrono::microseconds( interval ) );
+		}
+		std::remove( temporary.c_str() );
+	}
+
+	/**
+	 * Opens and closes a second config, and takes and drops references to the benchmarked one, until stopped.
+	 */
+	void OpenClose( const std::string dir, const std::string name, const int interval )
+	{
+		const std::string other = "churn_" + name;
+		FILE* file = std::fopen( ( dir + other ).c_str(), "wb" );
+		if ( file != nullptr )
+		{
+			std::fputs( "[churn]\nkey = value\n", file );
+			std::fclose( file );
+		}
+
+		while ( !stop.load() )
+		{
+			{
+				CONFIGHANDLE same = OPEN_CONFIG( TSTRING( name.begin(), name.end() ), TSTRING( dir.begin(), dir.end() ) );
+				CONFIGHANDLE opened = OPEN_CONFIG( TSTRING( other.begin(), other.end() ), TSTRING( dir.begin(), dir.end() ) );
+			}
+			iterations.fetch_add( 1 );
+			std::this_thread::sleep_for( std::chrono::microseconds( interval ) );
+		}
+		std::remove( ( dir + other ).c_str() );
+	}
+
+	std::atomic<bool> stop; /**< set to stop the thread. */
+	std::atomic<UINT64> iterations; /**< reloads or opens done. */
+	std::string contents; /**< original contents of the file, for CHURN_RELOAD. */
+	std::thread thread; /**< the background thread. */
+};
+
+/**
+ * Result of one operation, distribution and thread count.
+ */
+struct Result
+{
+	Operation operation;
+	Distribution distribution;
+	size_t threads; /**< lookup threads. */
+	double seconds; /**< wall time from the start of the first thread to the end of the last. */
+	UINT64 churn; /**< reloads or opens done by the churn thread meanwhile. */
+	LatencyHistogram histogram; /**< latencies of every thread. */
+};
+
+/**
+ * Runs the lookups of one operation and distribution on a number of threads.
+ */
+static Result
+Run( const Workload& workload, const size_t keysPerSection, const Operation operation, const Distribution distribution,
+	 const size_t threads, const size_t ops, const ChurnThread& churn )
+{
+	Result result;
+	result.operation = operation;
+	result.distribution = distribution;
+	result.threads = threads;
+
+	std::vector<std::vector<Request>> requests;
+	for ( size_t t = 0; t < threads; ++t )
+	{
+		requests.push_back( GenerateRequests( workload, keysPerSection, distribution, 1 + t ) );
+	}
+
+	std::vector<LatencyHistogram> histograms( threads );
+	std::vector<UINT64> sinks( threads );
+	std::vector<std::thread> workers;
+	std::atomic<bool> start( false );
+
+	for ( size_t t = 0; t < threads; ++t )
+	{
+		workers.push_back( std::thread( LookupThread, std::cref( workload ), std::cref( requests[t] ), operation, ops,
+										std::cref( start ), std::ref( histograms[t] ), std::ref( sinks[t] ) ) );
+	}
+
+	const UINT64 churnBefore = churn.Iterations();
+	const Clock::time_point begin = Clock::now();
+	start.store( true, std::memory_order_release );
+	for ( size_t t = 0; t < threads; ++t )
+	{
+		workers[t].join();
+		result.histogram.Merge( histograms[t] );
+	}
+	result.seconds = std::chrono::duration<double>( Clock::now() - begin ).count();
+	result.churn = churn.Iterations() - churnBefore;
+
+	return result;
+}
+
+
+/**
+ * @return typical cost in nanoseconds of the pair of clock reads around every lookup.
+ */
+static UINT64
+TimerOverhead()
+{
+	LatencyHistogram histogram;
+	for ( int i = 0; i < 100000; ++i )
+	{
+		const Clock::time_point before = Clock::now();
+		const Clock::time_point after = Clock::now();
+		histogram.Add( static_cast<UINT64>( std::chrono::duration_cast<std::chrono::nanoseconds>( after - before ).count() ) );
+	}
+	return histogram.Percentile( 0.5 );
+}
+
+
+/**
+ * Parses a comma separated list of positive numbers.
+ * @param value text to parse.
+ * @param numbers set to the numbers.
+ * @return false if any of them is not a positive number.
+ */
+static bool
+ParseList( const std::string& value, std::vector<size_t>& numbers )
+{
+	numbers.clear();
+	for ( size_t start = 0; start <= value.size(); )
+	{
+		size_t end = value.find( ',', start );
+		end = ( end == std::string::npos ) ? value.size() : end;
+		const long number = std::atol( value.substr( start, end - start ).c_str() );
+		if ( number <= 0 )
+		{
+			return false;
+		}
+		numbers.push_back( static_cast<size_t>( number ) );
+		start = end + 1;
+	}
+	return true;
+}
+
+
+/**
+ * Looks a name up in a table of names.
+ * @param names table of names.
+ * @param count number of names.
+ * @param value name to find, or "all".
+ * @param selected set to count for "all", otherwise the index of the name.
+ * @return false if the name is not in the table.
+ */
+static bool
+ParseName( const char* const* names, const size_t count, const std::string& value, size_t& selected )
+{
+	if ( value == "all" )
+	{
+		selected = count;
+		return true;
+	}
+	for ( size_t i = 0; i < count; ++i )
+	{
+		if ( value == names[i] )
+		{
+			selected = i;
+			return true;
+		}
+	}
+	return false;
+}
+
+
+/**
+ * Writes the results as JSON.
+ */
+static void
+WriteJson( FILE* file, const SyntheticConfig& config, const Churn churn, const int interval, const size_t ops,
+		   const UINT64 overhead, const std::vector<Result>& results )
+{
+	std::fprintf( file, "{\n  \"benchmark\": \"lookup\",\n  \"version\": 1,\n" );
+	std::fprintf( file, "  \"generator\": { \"sections\": %zu, \"keys_per_section\": %zu, \"value_min\": %zu, \"value_max\": %zu, "
+						"\"comment_ratio\": %g, \"seed\": %llu },\n",
+				  config.sections, config.keys_per_section, config.value_min, config.value_max, config.comment_ratio,
+				  static_cast<unsigned long long>( config.seed ) );
+	std::fprintf( file, "  \"churn\": \"%s\",\n  \"churn_interval_us\": %d,\n  \"ops_per_thread\": %zu,\n  \"timer_overhead_ns\": %llu,\n  \"results\": [",
+				  CHURN_NAMES[churn], interval, ops, static_cast<unsigned long long>( overhead ) );
+
+	for ( size_t r = 0; r < results.size(); ++r )
+	{
+		const Result& result = results[r];
+		const double total = static_cast<double>( result.histogram.Total() );
+		std::fprintf( file, "%s\n    {\n      \"operation\": \"%s\", \"distribution\": \"%s\", \"threads\": %zu, \"ops\": %llu, "
+							"\"seconds\": %.6f, \"ops_per_s\": %.0f, \"ops_per_s_per_thread\": %.0f, \"churn_iterations\": %llu,\n"
+							"      \"latency_ns\": { \"p50\": %llu, \"p99\": %llu, \"p999\": %llu, \"max\": %llu },\n"
+							"      \"histogram\": [",
+					  ( r == 0 ) ? "" : ",", OPERATION_NAMES[result.operation], DISTRIBUTION_NAMES[result.distribution], result.threads,
+					  static_cast<unsigned long long>( result.histogram.Total() ), result.seconds,
+					  total / result.seconds, total / result.seconds / static_cast<double>( result.threads ),
+					  static_cast<unsigned long long>( result.churn ),
+					  static_cast<unsigned long long>( result.histogram.Percentile( 0.5 ) ),
+					  static_cast<unsigned long long>( result.histogram.Percentile( 0.99 ) ),
+					  static_cast<unsigned long long>( result.histogram.Percentile( 0.999 ) ),
+					  static_cast<unsigned long long>( result.histogram.Maximum() ) );
+
+		/* only the buckets in use, as [largest latency in the bucket, count] */
+		bool first = true;
+		for ( size_t b = 0; b < LatencyHistogram::BUCKETS; ++b )
+		{
+			if ( result.histogram.Count( b ) != 0 )
+			{
+				std::fprintf( file, "%s[%llu, %llu]", first ? "" : ", ",
+							  static_cast<unsigned long long>( LatencyHistogram::UpperBound( b ) ),
+							  static_cast<unsigned long long>( result.histogram.Count( b ) ) );
+				first = false;
+			}
+		}
+		std::fprintf( file, "]\n    }" );
+	}
+	std::fprintf( file, "\n  ]\n}\n" );
+}
+
+
+int
+main( int argc, char** argv )
+{
+	SyntheticConfig config;
+	config.auto_key_ratio = 0.0;
+
+	std::vector<size_t> threadCounts;
+	for ( size_t t = 1; t <= std::max( 1u, std::thread::hardware_concurrency() ); t *= 2 )
+	{
+		threadCounts.push_back( t );
+	}
+
+	size_t ops = 200000;
+	size_t distribution = DIST_COUNT;
+	size_t operation = OP_COUNT;
+	size_t churn = CHURN_NONE;
+	int interval = 1000;
+	std::string dir;
+	std::string json;
+
+	for ( int i = 1; i < argc; i += 2 )
+	{
+		const std::string arg( argv[i] );
+		const std::string value( ( i + 1 < argc ) ? argv[i + 1] : "" );
+		bool valid = ( i + 1 < argc );
+
+		if ( arg == "--threads" ) valid = valid && ParseList( value, threadCounts );
+		else if ( arg == "--ops" ) valid = valid && ( ops = static_cast<size_t>( std::atol( value.c_str() ) ) ) > 0;
+		else if ( arg == "--distribution" ) valid = valid && ParseName( DISTRIBUTION_NAMES, DIST_COUNT, value, distribution );
+		else if ( arg == "--operation" ) valid = valid && ParseName( OPERATION_NAMES, OP_COUNT, value, operation );
+		else if ( arg == "--churn" ) valid = valid && ParseName( CHURN_NAMES, CHURN_COUNT, value, churn ) && churn != CHURN_COUNT;
+		else if ( arg == "--churn-interval" ) valid = valid && ( interval = std::atoi( value.c_str() ) ) >= 0;
+		else if ( arg == "--dir" ) dir = value;
+		else if ( arg == "--json" ) json = value;
+		else valid = valid && arg != "--size" && ParseSyntheticOption( arg, value, config );
+
+		if ( !valid )
+		{
+			std::fprintf( stderr, "invalid option %s\n", arg.c_str() );
+			return 2;
+		}
+	}
+
+	/* the loader expects the path to end with a separator. */
+	if ( !dir.empty() && dir[dir.size() - 1] != '/' && dir[dir.size() - 1] != '\\' )
+	{
+		dir += '/';
+	}
+
+	const std::string name = "lookup_benchmark.ini";
+	SyntheticStats stats;
+	if ( !GenerateConfig( dir + name, config, stats ) )
+	{
+		std::fprintf( stderr, "could not generate %s%s\n", dir.c_str(), name.c_str() );
+		return 1;
+	}
+
+	Workload workload;
+	workload.file = TSTRING( name.begin(), name.end() );
+	workload.guard = ( churn == CHURN_RELOAD );
+
+	for ( size_t s = 0; s < config.sections; ++s )
+	{
+		const std::string section = SyntheticSectionName( s );
+		workload.section_names.push_back( TSTRING( section.begin(), section.end() ) );
+	}
+	for ( size_t k = 0; k < config.keys_per_section * 2; ++k )
+	{
+		char key[32];
+		std::snprintf( key, sizeof( key ), ( k < config.keys_per_section ) ? "key_%zu" : "missing_%zu", k );
+		workload.key_names.push_back( TSTRING( key, key + std::strlen( key ) ) );
+	}
+	workload.hit_keys = config.keys_per_section;
+
+	/* views point into the names, which no longer move. */
+	workload.sections.assign( workload.section_names.begin(), workload.section_names.end() );
+	workload.keys.assign( workload.key_names.begin(), workload.key_names.end() );
+
+	CONFIGHANDLE handle = OPEN_CONFIG( workload.file, TSTRING( dir.begin(), dir.end() ), ( churn == CHURN_RELOAD ) ? CONFIG_RELOAD : CONFIG_EAGER );
+	workload.handle = &handle;
+	for ( size_t s = 0; s < config.sections; ++s )
+	{
+		DefaultParser* parser = new DefaultParser( workload.section_names[s] );
+		if ( !handle->AddSection( parser ) )
+		{
+			delete parser;
+			std::fprintf( stderr, "could not add %s\n", SyntheticSectionName( s ).c_str() );
+			return 1;
+		}
+		workload.parsers.push_back( parser );
+	}
+
+	const UINT64 overhead = TimerOverhead();
+	std::vector<Result> results;
+
+	{
+		ChurnThread background( static_cast<Churn>( churn ), dir, name, handle, interval );
+
+		for ( size_t d = 0; d < DIST_COUNT; ++d )
+		{
+			for ( size_t o = 0; o < OP_COUNT; ++o )
+			{
+				/* a reload may replace the parsers found up front. */
+				if ( ( distribution != DIST_COUNT && d != distribution ) || ( operation != OP_COUNT && o != operation ) ||
+					 ( o == OP_PARSER && churn == CHURN_RELOAD ) )
+				{
+					continue;
+				}
+				for ( size_t t = 0; t < threadCounts.size(); ++t )
+				{
+					results.push_back( Run( workload, config.keys_per_section, static_cast<Operation>( o ), static_cast<Distribution>( d ),
+											threadCounts[t], ops, background ) );
+				}
+			}
+		}
+	}
+
+	std::printf( "churn %s, timer overhead %llu ns\n", CHURN_NAMES[churn], static_cast<unsigned long long>( overhead ) );
+	std::printf( "%8s %8s %8s %14s %14s %8s %8s %8s %10s\n", "op", "keys", "threads", "ops/s", "ops/s/thread", "p50 ns", "p99 ns", "p99.9 ns", "max ns" );
+	for ( size_t r = 0; r < results.size(); ++r )
+	{
+		const Result& result = results[r];
+		const double total = static_cast<double>( result.histogram.Total() );
+		std::printf( "%8s %8s %8zu %14.0f %14.0f %8llu %8llu %8llu %10llu\n",
+					 OPERATION_NAMES[result.operation], DISTRIBUTION_NAMES[result.distribution], result.threads,
+					 total / result.seconds, total / result.seconds / static_cast<double>( result.threads ),
+					 static_cast<unsigned long long>( result.histogram.Percentile( 0.5 ) ),
+					 static_cast<unsigned long long>( result.histogram.Percentile( 0.99 ) ),
+					 static_cast<unsigned long long>( result.histogram.Percentile( 0.999 ) ),
+					 static_cast<unsigned long long>( result.histogram.Maximum() ) );
+	}
+
+	if ( !json.empty() )
+	{
+		FILE* file = ( json == "-" ) ? stdout : std::fopen( json.c_str(), "w" );
+		if ( file == nullptr )
+		{
+			std::fprintf( stderr, "could not write %s\n", json.c_str() );
+			return 1;
+		}
+		WriteJson( file, config, static_cast<Churn>( churn ), interval, ops, overhead, results );
+		if ( file != stdout )
+		{
+			std::fclose( file );
+		}
+	}
+
+	handle.reset();
+	std::remove( ( dir + name ).c_str() );
+	return 0;
+}
@@ -0,0 +1,288 @@
+
+/**
+ * @file synthetic_config.cpp
+ * Generator of synthetic configuration files used by the benchmarks.
+ */
+
+#include "synthetic_config.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+/**
+ * SplitMix64 generator, small and the same on every platform unlike the std distributions.
+ */
+class SplitMix64
+{
+public:
+	/**
+	 * Constructor.
+	 * @param seed initial state.
+	 */
+	explicit SplitMix64( const UINT64 seed ) : state( seed ) {}
+
+	/**
+	 * @return next 64 bit value.
+	 */
+	UINT64 Next()
+	{
+		UINT64 z = ( state += 0x9E3779B97F4A7C15ull );
+		z = ( z ^ ( z >> 30 ) ) * 0xBF58476D1CE4E5B9ull;
+		z = ( z ^ ( z >> 27 ) ) * 0x94D049BB133111EBull;
+		return z ^ ( z >> 31 );
+	}
+
+	/**
+	 * @param low smallest value.
+	 * @param high largest value.
+	 * @return value in [low, high].
+	 */
+	size_t Between( const size_t low, const size_t high )
+	{
+		return low + static_cast<size_t>( Next() % ( static_cast<UINT64>( high - low ) + 1 ) );
+	}
+
+	/**
+	 * @param probability chance of returning true, in [0, 1].
+	 * @return true with the given probability.
+	 */
+	bool Chance( const double probability )
+	{
+		return static_cast<double>( Next() >> 11 ) * ( 1.0 / 9007199254740992.0 ) < probability;
+	}
+
+private:
+	UINT64 state; /**< generator state. */
+};
+
+
+/**
+ * Charactors used in generated values, never a comment, section or '=' charactor.
+ */
+static const char VALUE_CHARS[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_-./:, ";
+
+/**
+ * Writes a value of random length, an integer, a decimal or a string.
+ * @param random generator.
+ * @param config shape of the file.
+ * @param line line to append the value to.
+ */
+static void
+AppendValue( SplitMix64& random, const SyntheticConfig& config, std::string& line )
+{
+	char number[32];
+	switch ( random.Next() % 8 )
+	{
+		case 0:
+			std::snprintf( number, sizeof( number ), "%lld", static_cast<long long>( random.Next() % 2000001 ) - 1000000 );
+			line += number;
+			return;
+		case 1:
+			std::snprintf( number, sizeof( number ), "%.6g", static_cast<double>( random.Next() % 1000000 ) / 1024.0 );
+			line += number;
+			return;
+		default:
+			break;
+	}
+
+	const size_t length = random.Between( config.value_min, config.value_max );
+	const size_t start = line.size();
+	for ( size_t i = 0; i < length; ++i )
+	{
+		line += VALUE_CHARS[random.Next() % ( sizeof( VALUE_CHARS ) - 1 )];
+	}
+
+	/* values are trimmed when loaded, keep the generated ones free of edge spaces. */
+	if ( length > 0 && line[start] == ' ' )
+	{
+		line[start] = 'v';
+	}
+	if ( length > 0 && line[line.size() - 1] == ' ' )
+	{
+		line[line.size() - 1] = 'v';
+	}
+}
+
+
+std::string
+SyntheticSectionName( const size_t index )
+{
+	char name[32];
+	std::snprintf( name, sizeof( name ), "section_%zu", index );
+	return name;
+}
+
+
+bool
+ParseSyntheticSize( const std::string& value, UINT64& size )
+{
+	if ( value.empty() )
+	{
+		return false;
+	}
+
+	char* end = nullptr;
+	const unsigned long long number = std::strtoull( value.c_str(), &end, 10 );
+	if ( end == value.c_str() )
+	{
+		return false;
+	}
+
+	UINT64 scale = 1;
+	switch ( *end )
+	{
+		case '\0': break;
+		case 'k': case 'K': scale = 1024ull; ++end; break;
+		case 'm': case 'M': scale = 1024ull * 1024; ++end; break;
+		case 'g': case 'G': scale = 1024ull * 1024 * 1024; ++end; break;
+		default: return false;
+	}
+
+	/* allow KB, MB and GB as well as K, M and G. */
+	if ( scale > 1 && ( *end == 'b' || *end == 'B' ) )
+	{
+		++end;
+	}
+
+	if ( *end != '\0' || number > ~0ull / scale )
+	{
+		return false;
+	}
+
+	size = number * scale;
+	return true;
+}
+
+
+bool
+ParseSyntheticOption( const std::string& name, const std::string& value, SyntheticConfig& config )
+{
+	char* end = nullptr;
+
+	if ( name == "--size" )
+	{
+		return ParseSyntheticSize( value, config.size );
+	}
+	if ( name == "--comments" || name == "--auto-keys" )
+	{
+		const double ratio = std::strtod( value.c_str(), &end );
+		if ( end == value.c_str() || *end != '\0' || !( ratio >= 0.0 && ratio <= 1.0 ) )
+		{
+			return false;
+		}
+		( name == "--comments" ? config.comment_ratio : config.auto_key_ratio ) = ratio;
+		return true;
+	}
+
+	const unsigned long long number = std::strtoull( value.c_str(), &end, 10 );
+	if ( value.empty() || end == value.c_str() || *end != '\0' )
+	{
+		return false;
+	}
+
+	if ( name == "--seed" ) config.seed = number;
+	else if ( name == "--sections" ) config.sections = static_cast<size_t>( number );
+	else if ( name == "--keys" ) config.keys_per_section = static_cast<size_t>( number );
+	else if ( name == "--value-min" ) config.value_min = static_cast<size_t>( number );
+	else if ( name == "--value-max" ) config.value_max = static_cast<size_t>( number );
+	else return false;
+
+	return true;
+}
+
+
+bool
+GenerateConfig( const std::string& path, const SyntheticConfig& config, SyntheticStats& stats )
+{
+	stats = SyntheticStats();
+
+	if ( config.sections == 0 || config.value_min > config.value_max ||
+		 ( config.size != 0 && ( config.size < SyntheticConfig::MIN_SIZE || config.size > SyntheticConfig::MAX_SIZE ) ) ||
+		 ( config.size == 0 && config.keys_per_section == 0 ) )
+	{
+		return false;
+	}
+
+	FILE* file = std::fopen( path.c_str(), "wb" );
+	if ( file == nullptr )
+	{
+		return false;
+	}
+
+	std::vector<char> buffer( 1 << 20 );
+	std::setvbuf( file, buffer.data(), _IOFBF, buffer.size() );
+
+	SplitMix64 random( config.seed );
+	std::string line;
+	line.reserve( 256 );
+	bool written = true;
+
+	for ( size_t s = 0; s < config.sections && written; ++s )
+	{
+		/* with a size, every section is given an equal share of it instead of a key count. */
+		const UINT64 sectionEnd = config.size * ( s + 1 ) / config.sections;
+
+		line = "[" + SyntheticSectionName( s ) + "]\n";
+		written = std::fwrite( line.data(), 1, line.size(), file ) == line.size();
+		stats.bytes += line.size();
+		stats.lines += 1;
+		stats.sections += 1;
+
+		for ( size_t k = 0; written && ( config.size != 0 || k < config.keys_per_section ); )
+		{
+			line.clear();
+			bool comment = false;
+			bool autoKey = false;
+
+			if ( random.Chance( config.comment_ratio ) )
+			{
+				line = "; comment ";
+				AppendValue( random, config, line );
+				comment = true;
+			}
+			else if ( random.Chance( config.auto_key_ratio ) )
+			{
+				AppendValue( random, config, line );
+				if ( line.empty() )
+				{
+					line = "value";
+				}
+				autoKey = true;
+			}
+			else
+			{
+				char key[32];
+				std::snprintf( key, sizeof( key ), "key_%zu = ", k );
+				line = key;
+				AppendValue( random, config, line );
+			}
+			line += '\n';
+
+			/* leave room for the blank line closing the section. */
+			if ( config.size != 0 && stats.bytes + line.size() + 1 > sectionEnd )
+			{
+				break;
+			}
+
+			written = std::fwrite( line.data(), 1, line.size(), file ) == line.size();
+			stats.bytes += line.size();
+			stats.lines += 1;
+			if ( comment )
+			{
+				stats.comments += 1;
+				continue;
+			}
+			stats.entries += 1;
+			stats.auto_keys += autoKey ? 1 : 0;
+			++k;
+		}
+
+		written = written && std::fputc( '\n', file ) != EOF;
+		stats.bytes += 1;
+		stats.lines += 1;
+	}
+
+	written = ( std::fclose( file ) == 0 ) && written;
+	return written;
+}
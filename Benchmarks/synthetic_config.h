@@ -0,0 +1,89 @@
+
+#ifndef _SYNTHETIC_CONFIG_H_
+#define _SYNTHETIC_CONFIG_H_
+
+/**
+ * @file synthetic_config.h
+ * File containing the generator of synthetic configuration files used by the benchmarks.
+ */
+
+#include <string>
+
+#include "platform.h"
+
+/**
+ * Shape of a generated configuration file.
+ * The same options and seed always generate the same file.
+ */
+struct SyntheticConfig
+{
+	static const UINT64 MIN_SIZE = 1024; /**< smallest size that can be requested, 1 KB. */
+	static const UINT64 MAX_SIZE = 1024ull * 1024 * 1024; /**< largest size that can be requested, 1 GB. */
+
+	UINT64 size; /**< size of the file in bytes, 0 to write every key of every section. */
+	size_t sections; /**< number of sections, named "section_0" onwards. */
+	size_t keys_per_section; /**< entries in each section, ignored when size is set. */
+	size_t value_min; /**< shortest value in charactors. */
+	size_t value_max; /**< longest value in charactors. */
+	double comment_ratio; /**< fraction of lines that are comments. */
+	double auto_key_ratio; /**< fraction of entries that are bare values, which are given automatic keys. */
+	UINT64 seed; /**< seed of the generator. */
+
+	/**
+	 * Constructor, a small file with a few comments and automatic keys.
+	 */
+	SyntheticConfig()
+		: size( 0 ), sections( 16 ), keys_per_section( 64 ), value_min( 4 ), value_max( 32 ),
+		  comment_ratio( 0.1 ), auto_key_ratio( 0.05 ), seed( 1 ) {}
+};
+
+/**
+ * Counts of what was written to a generated file.
+ */
+struct SyntheticStats
+{
+	UINT64 bytes; /**< size of the file. */
+	UINT64 lines; /**< lines of every kind, including blank lines. */
+	UINT64 sections; /**< section headers. */
+	UINT64 entries; /**< key, value lines and bare values. */
+	UINT64 comments; /**< comment lines. */
+	UINT64 auto_keys; /**< bare values. */
+};
+
+/**
+ * @param index index of a section.
+ * @return name of the section as written by GenerateConfig.
+ */
+std::string SyntheticSectionName( const size_t index );
+
+/**
+ * Applies a command line option to a configuration.
+ * Sizes accept a K, M or G suffix.
+ * @param name option name, one of --size, --sections, --keys, --value-min, --value-max,
+ * --comments, --auto-keys or --seed.
+ * @param value option value.
+ * @param config configuration to change.
+ * @return false if the option is unknown or the value is not valid.
+ */
+bool ParseSyntheticOption( const std::string& name, const std::string& value, SyntheticConfig& config );
+
+/**
+ * Parses a size with an optional K, M or G suffix.
+ * @param value text to parse.
+ * @param size set to the size in bytes.
+ * @return false if the value is not a size.
+ */
+bool ParseSyntheticSize( const std::string& value, UINT64& size );
+
+/**
+ * Writes a configuration file.
+ * When a size is given every section is filled with entries up to an equal share of it
+ * in place of keys_per_section, so the file is at most size bytes.
+ * @param path path of the file to write.
+ * @param config shape of the file.
+ * @param stats set to the counts of what was written.
+ * @return false if the configuration is not valid or the file could not be written.
+ */
+bool GenerateConfig( const std::string& path, const SyntheticConfig& config, SyntheticStats& stats );
+
+#endif
@@ -0,0 +1,57 @@
+
+#include "arena.h"
+
+#include <cstdlib>
+
+void*
+Arena::AllocateChunk( const size_t size, const size_t align )
+{
+	/* room for the header and worst case alignment padding */
+	const size_t header = sizeof( Chunk ) + align;
+	const bool dedicated = ( size > chunk_size / 4 );
+	const size_t bytes = header + ( dedicated ? size : chunk_size );
+
+	Chunk* chunk = static_cast<Chunk*>( std::malloc( bytes ) );
+	if ( chunk == nullptr )
+	{
+		throw std::bad_alloc();
+	}
+	reserved += bytes;
+
+	char* start = reinterpret_cast<char*>( chunk + 1 );
+	char* aligned = reinterpret_cast<char*>(
+		( reinterpret_cast<std::uintptr_t>( start ) + align - 1 ) & ~static_cast<std::uintptr_t>( align - 1 ) );
+
+	if ( dedicated && head != nullptr )
+	{
+		/* keep allocating from the current chunk, the dedicated chunk is only linked for release */
+		chunk->next = head->next;
+		head->next = chunk;
+	}
+	else
+	{
+		chunk->next = head;
+		head = chunk;
+		limit = reinterpret_cast<char*>( chunk ) + bytes;
+		cursor = aligned + size;
+	}
+
+	return aligned;
+}
+
+
+void
+Arena::Release()
+{
+	Chunk* next;
+	while ( head != nullptr )
+	{
+		next = head->next;
+		std::free( head );
+		head = next;
+	}
+
+	cursor = nullptr;
+	limit = nullptr;
+	reserved = 0;
+}
@@ -0,0 +1,168 @@
+
+#ifndef _ARENA_H_
+#define _ARENA_H_
+
+/**
+ * @file arena.h
+ * File containing the bump allocator used to store a configuration file's entries.
+ */
+
+#include <new>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+/**
+ * Bump allocator that hands out memory from large chunks.
+ * Individual allocations are never freed, all of the memory is released at once
+ * when the arena is destroyed, so releasing a config costs one free per chunk.
+ *
+ * @warning Not thread safe, an arena belongs to a single ConfigLoader.
+ */
+class Arena
+{
+public:
+	/**
+	 * Constructor, no memory is reserved until the first allocation.
+	 * @param chunkSize size in bytes of each chunk requested from the heap.
+	 */
+	explicit Arena( const size_t chunkSize = 64 * 1024 )
+		: head( nullptr ), cursor( nullptr ), limit( nullptr ), chunk_size( chunkSize ), reserved( 0 ) {}
+
+	/**
+	 * Allocates memory from the arena.
+	 * @param size number of bytes to allocate.
+	 * @param align alignment of the allocation, must be a power of two.
+	 * @return pointer to the allocated memory.
+	 */
+	void* Allocate( const size_t size, const size_t align = alignof( std::max_align_t ) )
+	{
+		if ( cursor != nullptr )
+		{
+			std::uintptr_t aligned = ( reinterpret_cast<std::uintptr_t>( cursor ) + align - 1 ) & ~static_cast<std::uintptr_t>( align - 1 );
+			std::uintptr_t end = reinterpret_cast<std::uintptr_t>( limit );
+			if ( aligned <= end && size <= static_cast<size_t>( end - aligned ) )
+			{
+				cursor = reinterpret_cast<char*>( aligned + size );
+				return reinterpret_cast<void*>( aligned );
+			}
+		}
+		return AllocateChunk( size, align );
+	}
+
+	/**
+	 * Frees every chunk, all memory handed out by the arena becomes invalid.
+	 */
+	void Release();
+
+	/**
+	 * @return number of bytes requested from the heap by this arena.
+	 */
+	size_t Reserved() const
+	{
+		return reserved;
+	}
+
+	/**
+	 * Destructor, frees every chunk.
+	 */
+	~Arena()
+	{
+		Release();
+	}
+
+private:
+	/* chunks can not be shared between arenas */
+	Arena( const Arena& );
+	Arena& operator=( const Arena& );
+
+	/**
+	 * Slow path of Allocate, starts a new chunk.
+	 * Allocations larger than a quarter of the chunk size are given a chunk of their own
+	 * so the remainder of the current chunk is not wasted.
+	 * @param size number of bytes to allocate.
+	 * @param align alignment of the allocation.
+	 * @return pointer to the allocated memory.
+	 */
+	void* AllocateChunk( const size_t size, const size_t align );
+
+	/**
+	 * Header at the start of every chunk.
+	 */
+	struct Chunk
+	{
+		Chunk* next; /**< previously allocated chunk. */
+	};
+
+	Chunk* head; /**< most recently allocated chunk. */
+	char* cursor; /**< next free byte in the current chunk. */
+	char* limit; /**< end of the current chunk. */
+	size_t chunk_size; /**< size of a standard chunk. */
+	size_t reserved; /**< total bytes requested from the heap. */
+};
+
+/**
+ * Standard library allocator that takes its memory from an Arena.
+ * Deallocation does nothing, the memory is returned when the arena is released.
+ * An allocator without an arena falls back to the heap, so containers using it work
+ * before they are given to a ConfigLoader.
+ *
+ * @tparam T type being allocated.
+ */
+template <class T>
+class ArenaAllocator
+{
+public:
+	typedef T value_type;
+	typedef std::true_type propagate_on_container_copy_assignment;
+	typedef std::true_type propagate_on_container_move_assignment;
+	typedef std::true_type propagate_on_container_swap;
+
+	/**
+	 * Constructor
+	 * @param memory arena to allocate from, nullptr to use the heap.
+	 */
+	ArenaAllocator( Arena* memory = nullptr )
+		: arena( memory ) {}
+
+	/**
+	 * Converting constructor, used by containers to allocate their internal nodes.
+	 * @param other allocator to share the arena of.
+	 */
+	template <class U>
+	ArenaAllocator( const ArenaAllocator<U>& other )
+		: arena( other.arena ) {}
+
+	T* allocate( const size_t count )
+	{
+		if ( arena == nullptr )
+		{
+			return static_cast<T*>( ::operator new( count * sizeof( T ) ) );
+		}
+		return static_cast<T*>( arena->Allocate( count * sizeof( T ), alignof( T ) ) );
+	}
+
+	void deallocate( T* ptr, const size_t )
+	{
+		if ( arena == nullptr )
+		{
+			::operator delete( ptr );
+		}
+	}
+
+	template <class U>
+	bool operator==( const ArenaAllocator<U>& rhs ) const
+	{
+		return arena == rhs.arena;
+	}
+
+	template <class U>
+	bool operator!=( const ArenaAllocator<U>& rhs ) const
+	{
+		return arena != rhs.arena;
+	}
+
+	Arena* arena; /**< arena to allocate from, nullptr to use the heap. */
+};
+
+#endif
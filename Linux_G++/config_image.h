@@ -0,0 +1,388 @@
+
+#ifndef _CONFIG_IMAGE_H_
+#define _CONFIG_IMAGE_H_
+
+/**
+ * @file config_image.h
+ * File containing the compiled binary form of a configuration file.
+ */
+
+#include "platform.h"
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "unicode_defines.h"
+#include "string_view.h"
+#include "mapped_file.h"
+#include "shared_segment.h"
+#include "config_key.h"
+
+/**
+ * Compiled, memory mappable image of a configuration file.
+ * The image holds the file already split into sections and trimmed keys and values, with hash
+ * indexes over the section names and each section's keys. Everything is stored as offsets from
+ * the start of the image so it is used directly from the mapping, opening an image costs
+ * little more than mapping it.\n
+ * Images record the size and modification time of the text file they were compiled from,
+ * an image is only opened while the text file is unchanged.\n
+ * Images can also be published in shared memory by one process, see ImagePublisher, and attached
+ * to by the others on the host with Attach, so the file is parsed once rather than by every process.
+ *
+ * Layout, all offsets are in bytes from the start of the image unless stated:
+ * @code
+ * Header | SectionRecord[section_count] | EntryRecord[entry_count]
+ *        | UINT32 section_index[section_index_size] | UINT32 entry_index[entry_index_size] | TCHAR strings[strings_size]
+ * @endcode
+ *
+ * @note Images are only supported by narrow charactor builds, unicode builds always load the text file.
+ */
+class ConfigImage
+{
+public:
+	static const UINT32 VERSION = 1; /**< format version written by Compile, images of other versions are rejected. */
+
+	/**
+	 * Start of every image.
+	 */
+	struct Header
+	{
+		char magic[8]; /**< "SCFGIMG" followed by a null. */
+		UINT32 version; /**< VERSION of the writer. */
+		UINT32 char_size; /**< sizeof( TCHAR ) of the writer. */
+		UINT64 source_size; /**< size of the text file when compiled. */
+		UINT64 source_time; /**< modification time of the text file when compiled. */
+		UINT64 checksum; /**< 64 bit FNV-1a of every byte after the header. */
+		UINT64 image_size; /**< size of the whole image in bytes. */
+		UINT64 sections_offset; /**< offset of the section records. */
+		UINT64 entries_offset; /**< offset of the entry records. */
+		UINT64 section_index_offset; /**< offset of the section name hash index. */
+		UINT64 entry_index_offset; /**< offset of the hash indexes of every section's keys. */
+		UINT64 strings_offset; /**< offset of the charactors of every name, key and value. */
+		UINT64 strings_size; /**< number of charactors in strings. */
+		UINT32 section_count; /**< number of section records. */
+		UINT32 entry_count; /**< number of entry records. */
+		UINT32 section_index_size; /**< number of slots in the section index, a power of two. */
+		UINT32 entry_index_size; /**< number of slots in all of the key indexes. */
+	};
+
+	/**
+	 * Section of the file, repeated headers of the same section are merged into one record.
+	 */
+	struct SectionRecord
+	{
+		UINT32 name; /**< charactor offset of the upper case name in strings. */
+		UINT32 name_length; /**< number of charactors in the name. */
+		UINT32 hash; /**< util::HashStringFolded of the name. */
+		UINT32 first_entry; /**< index of the section's first entry record. */
+		UINT32 entry_count; /**< number of entries, in file order. */
+		UINT32 index_first; /**< first slot of the section's key index in entry_index. */
+		UINT32 index_size; /**< number of slots in the key index, a power of two or zero. */
+		UINT32 reserved; /**< padding, always zero. */
+	};
+
+	/**
+	 * Single key, value line of a section.
+	 */
+	struct EntryRecord
+	{
+		UINT32 key; /**< charactor offset of the trimmed key in strings. */
+		UINT32 key_length; /**< number of charactors in the key. */
+		UINT32 value; /**< charactor offset of the trimmed value in strings. */
+		UINT32 value_length; /**< number of charactors in the value. */
+		UINT32 hash; /**< util::HashString of the key. */
+		UINT32 flags; /**< ENTRY_HAS_VALUE when the line had a '=', otherwise the key is a bare value. */
+	};
+
+	static const UINT32 ENTRY_HAS_VALUE = 1; /**< EntryRecord flag, see ScannedLine::HasValue. */
+
+	/**
+	 * Start of the control segment of a shared image, see ImagePublisher.
+	 */
+	struct SharedControl
+	{
+		char magic[8]; /**< "SCFGPUB" followed by a null, written once generation is set up. */
+		std::atomic<UINT64> generation; /**< generation of the newest published image, zero until one is published. */
+	};
+
+	/**
+	 * Compiles a text configuration file into an image held in memory.
+	 * @param source full path to the text file.
+	 * @param image set to the bytes of the image.
+	 * @return success or failure.
+	 */
+	static bool Build( const TSTRING& source, std::vector<char>& image );
+
+	/**
+	 * Compiles a text configuration file into an image.
+	 * @param source full path to the text file.
+	 * @param image full path to write the image to.
+	 * @return success or failure.
+	 */
+	static bool Compile( const TSTRING& source, const TSTRING& image );
+
+	/**
+	 * @param source full path to a text configuration file.
+	 * @return path of the image compiled from source.
+	 */
+	static TSTRING ImagePath( const TSTRING& source )
+	{
+		return source + TEXT(".bin");
+	}
+
+	/**
+	 * @param source full path to a text configuration file.
+	 * @return name of the control segment of the images of source published in shared memory.
+	 */
+	static TSTRING SharedName( const TSTRING& source );
+
+	/**
+	 * @param name name of a control segment.
+	 * @param generation generation of a published image.
+	 * @return name of the segment holding the image.
+	 */
+	static TSTRING SegmentName( const TSTRING& name, const UINT64 generation );
+
+	/**
+	 * Constructor, does nothing.
+	 */
+	ConfigImage();
+
+	/**
+	 * Opens and maps an image if it is valid and up to date with its text file.
+	 * The section records are bounds checked, entries are checked as they are read.
+	 * @param image full path to the image.
+	 * @param source full path to the text file, the image is used without checking if it does not exist.
+	 * @param verify also check the checksum, this reads the whole image.
+	 * @return true if the image can be used in place of the text file.
+	 */
+	bool Open( const TSTRING& image, const TSTRING& source, const bool verify = false );
+
+	/**
+	 * Maps the newest image published in shared memory, read only, if it is valid and up to date with its text file.
+	 * @param name name of the control segment, see SharedName.
+	 * @param source full path to the text file, the image is used without checking if it does not exist.
+	 * @param verify also check the checksum, this reads the whole image.
+	 * @return true if the image can be used in place of the text file.
+	 */
+	bool Attach( const TSTRING& name, const TSTRING& source, const bool verify = false );
+
+	/**
+	 * Closes the image.
+	 */
+	void Close();
+
+	/**
+	 * Exchanges the open images of two ConfigImages, views into either image remain valid.
+	 * @param other image to swap with.
+	 */
+	void Swap( ConfigImage& other );
+
+	/**
+	 * @return true if the open image was attached from shared memory.
+	 */
+	bool IsShared() const
+	{
+		return generation != 0;
+	}
+
+	/**
+	 * @return generation of the attached image, zero unless shared.
+	 */
+	UINT64 Generation() const
+	{
+		return generation;
+	}
+
+	/**
+	 * Reads the generation of the newest image published, without attaching to it.
+	 * @return the newest generation, or the generation of the attached image if it is not shared.
+	 */
+	UINT64 LatestGeneration() const;
+
+	/**
+	 * @return true if an image is open.
+	 */
+	bool IsOpen() const
+	{
+		return header != nullptr;
+	}
+
+	/**
+	 * @return size of the image in bytes, 0 when closed.
+	 */
+	UINT64 Size() const
+	{
+		return ( header != nullptr ) ? header->image_size : 0;
+	}
+
+	/**
+	 * @return number of sections in the image.
+	 */
+	size_t SectionCount() const
+	{
+		return ( header != nullptr ) ? header->section_count : 0;
+	}
+
+	/**
+	 * @param index index of the section, must be less than SectionCount.
+	 * @return the section record.
+	 */
+	const SectionRecord& Section( const size_t index ) const
+	{
+		return sections[index];
+	}
+
+	/**
+	 * Finds a section, names are compared ignoring case.
+	 * @param name name of the section.
+	 * @return the section record, or nullptr if the section is not in the image.
+	 */
+	const SectionRecord* FindSection( const KeyView& name ) const;
+
+	/**
+	 * @param section section to get the entries of.
+	 * @return first of the section's entry_count entries.
+	 */
+	const EntryRecord* Entries( const SectionRecord& section ) const
+	{
+		return entries + section.first_entry;
+	}
+
+	/**
+	 * Finds the first entry of a section with a key, using the section's key index.
+	 * @param section section to search.
+	 * @param key key to look for.
+	 * @return the entry, or nullptr if the key is not in the section.
+	 */
+	const EntryRecord* FindEntry( const SectionRecord& section, const KeyView& key ) const;
+
+	/**
+	 * @param section a section record.
+	 * @return view of the section name.
+	 */
+	StringView Name( const SectionRecord& section ) const
+	{
+		return String( section.name, section.name_length );
+	}
+
+	/**
+	 * @param entry an entry record.
+	 * @return view of the entry key.
+	 */
+	StringView Key( const EntryRecord& entry ) const
+	{
+		return String( entry.key, entry.key_length );
+	}
+
+	/**
+	 * @param entry an entry record.
+	 * @return view of the entry value.
+	 */
+	StringView Value( const EntryRecord& entry ) const
+	{
+		return String( entry.value, entry.value_length );
+	}
+
+private:
+	ConfigImage( const ConfigImage& );
+	ConfigImage& operator=( const ConfigImage& );
+
+	/**
+	 * @param offset charactor offset in strings.
+	 * @param length number of charactors.
+	 * @return view of the charactors, empty if they are outside of the image.
+	 */
+	StringView String( const UINT32 offset, const UINT32 length ) const
+	{
+		if ( static_cast<UINT64>( offset ) + length > header->strings_size )
+		{
+			return StringView();
+		}
+		return StringView( strings + offset, length );
+	}
+
+	/**
+	 * Checks an image that has been mapped and sets up the tables.
+	 * @param contents the mapped image.
+	 * @param source full path to the text file, the image is used without checking if it does not exist.
+	 * @param verify also check the checksum.
+	 * @param exact the image must fill contents, shared segments may be rounded up to a whole page.
+	 * @return true if the image can be used, otherwise the caller must Close.
+	 */
+	bool Map( const StringView& contents, const TSTRING& source, const bool verify, const bool exact );
+
+	/**
+	 * Checks that every table of the image is inside of it.
+	 * @param size size of the image in bytes.
+	 * @return true if the image is safe to read.
+	 */
+	bool Validate( const UINT64 size ) const;
+
+	MappedFile File; /**< mapping of the image, when opened from a file. */
+	SharedSegment Control; /**< control segment, when attached from shared memory. */
+	SharedSegment Shared; /**< mapping of the image, when attached from shared memory. */
+	UINT64 generation; /**< generation of the attached image, zero unless shared. */
+	const Header* header; /**< header of the open image, nullptr when closed. */
+	const SectionRecord* sections; /**< section records. */
+	const EntryRecord* entries; /**< entry records. */
+	const UINT32* section_index; /**< section name index, slots hold a section index plus one. */
+	const UINT32* entry_index; /**< key indexes, slots hold an entry index within the section plus one. */
+	const TCHAR* strings; /**< charactors of every name, key and value. */
+};
+
+/**
+ * Publishes images of a configuration file in shared memory, so other processes on the host attach
+ * to them with ConfigImage::Attach rather than each parsing the file, see CONFIG_PUBLISH.\n
+ * The control segment holds the generation of the newest image, each image is a segment of its own
+ * named after its generation. Publishing writes the new image in full before raising the generation,
+ * then removes the previous image, processes still attached to it keep their mapping until they
+ * attach to the newer one.\n
+ * Only one process should publish each file. The segments are removed when the publisher is closed.
+ */
+class ImagePublisher
+{
+public:
+	/**
+	 * Constructor, does nothing.
+	 */
+	ImagePublisher();
+
+	/**
+	 * Compiles a text configuration file and publishes it as the next generation.
+	 * @param source full path to the text file.
+	 * @param name name of the control segment, see ConfigImage::SharedName.
+	 * @return success or failure, the previous image stays published on failure.
+	 */
+	bool Publish( const TSTRING& source, const TSTRING& name );
+
+	/**
+	 * Removes the published image and the control segment.
+	 */
+	void Close();
+
+	/**
+	 * @return generation of the newest image published, zero if none.
+	 */
+	UINT64 Generation() const
+	{
+		return generation;
+	}
+
+	/**
+	 * Destructor, removes the published image.
+	 */
+	~ImagePublisher();
+
+private:
+	ImagePublisher( const ImagePublisher& );
+	ImagePublisher& operator=( const ImagePublisher& );
+
+	SharedSegment Control; /**< control segment, mapped for writing. */
+	SharedSegment Current; /**< newest published image, kept mapped as Windows removes segments nobody has open. */
+	TSTRING name; /**< name of the control segment, empty until published. */
+	UINT64 generation; /**< generation of Current. */
+};
+
+#endif
@@ -0,0 +1,117 @@
+
+#ifndef _CONFIG_KEY_H_
+#define _CONFIG_KEY_H_
+
+/**
+ * @file config_key.h
+ * File containing the key type used for parser lookups.
+ */
+
+#include "platform.h"
+
+#include <string>
+#include <type_traits>
+
+#include "unicode_defines.h"
+#include "string_view.h"
+#include "utility.h"
+
+/**
+ * Key used to look up entries in a parser without building a string.
+ * Implicitly constructed from literals, strings and views so getters can be called with any of them.
+ *
+ * Keys made with CFG_KEY carry hashes computed at compile time, so a lookup with one
+ * only probes the dictionary and compares the key.
+ *
+ * @note The key only refers to the charactors, they must outlive the lookup.
+ */
+class KeyView
+{
+public:
+	/**
+	 * Constructor
+	 * @param key null terminated key.
+	 */
+	KeyView( const TCHAR* key )
+		: name( key ), hash( 0 ), folded_hash( 0 ), hashed( false ) {}
+
+	/**
+	 * Constructor
+	 * @param key key string.
+	 */
+	KeyView( const TSTRING& key )
+		: name( key ), hash( 0 ), folded_hash( 0 ), hashed( false ) {}
+
+	/**
+	 * Constructor
+	 * @param key view of the key.
+	 */
+	KeyView( const StringView& key )
+		: name( key ), hash( 0 ), folded_hash( 0 ), hashed( false ) {}
+
+	/**
+	 * Constructor for a key with precomputed hashes, use CFG_KEY rather than calling directly.
+	 * @param key first charactor of the key.
+	 * @param size number of charactors in the key.
+	 * @param keyHash util::HashString of the key.
+	 * @param foldedHash util::HashStringFolded of the key.
+	 */
+	constexpr KeyView( const TCHAR* key, const size_t size, const UINT32 keyHash, const UINT32 foldedHash )
+		: name( key, size ), hash( keyHash ), folded_hash( foldedHash ), hashed( true ) {}
+
+	/**
+	 * @return view of the key charactors.
+	 */
+	constexpr const StringView& View() const
+	{
+		return name;
+	}
+
+	/**
+	 * @return hash of the key, as used by parser dictionaries.
+	 */
+	UINT32 Hash() const
+	{
+		return hashed ? hash : util::HashString( name.data(), name.size() );
+	}
+
+	/**
+	 * @return case insensitive hash of the key, as used for section names.
+	 */
+	UINT32 FoldedHash() const
+	{
+		return hashed ? folded_hash : util::HashStringFolded( name.data(), name.size() );
+	}
+
+	/**
+	 * Makes a key for names only known at run time with both hashes computed once, so it can be
+	 * kept and used for lookups in the same way as a key made with CFG_KEY.
+	 * @return copy of the key with its hashes computed.
+	 */
+	KeyView Prehash() const
+	{
+		return KeyView( name.data(), name.size(), Hash(), FoldedHash() );
+	}
+
+private:
+	StringView name; /**< charactors of the key. */
+	UINT32 hash; /**< precomputed hash, valid when hashed is set. */
+	UINT32 folded_hash; /**< precomputed case insensitive hash, valid when hashed is set. */
+	bool hashed; /**< true if the hashes were computed when the key was made. */
+};
+
+/** Number of charactors in a string literal, excluding the terminator. */
+#define CFG_LITERAL_LENGTH( str ) ( sizeof( TEXT( str ) ) / sizeof( TCHAR ) - 1 )
+
+/**
+ * Makes a KeyView from a string literal with both hashes computed at compile time.
+ * The result can be passed to any getter or GetSection, or stored in a constexpr KeyView.
+ * @code
+ * static constexpr KeyView MaxConnections = CFG_KEY( "max_connections" );
+ * @endcode
+ */
+#define CFG_KEY( str ) KeyView( TEXT( str ), CFG_LITERAL_LENGTH( str ), \
+	std::integral_constant<UINT32, util::HashLiteral( TEXT( str ), CFG_LITERAL_LENGTH( str ) )>::value, \
+	std::integral_constant<UINT32, util::HashLiteralFolded( TEXT( str ), CFG_LITERAL_LENGTH( str ) )>::value )
+
+#endif
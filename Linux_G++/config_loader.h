@@ -14,47 +14,147 @@
 /** MSVC Command to stop VC complaining about the usage of swprintf */
 #define _CRT_NON_CONFORMING_SWPRINTFS
 
-#include <queue>
+#include <map>
+#include <mutex>
+#include <functional>
+#include <atomic>
 #include <memory>
 #include <string>
+#include <vector>
+#include <typeinfo>
 #include <unordered_map>
 
 /** Make sure windows doesn't include winsock and other un-nessisary headers */
-#define WIN32_LEAN_AND_MEAN
-#include <Windows.h>
-#undef WIN32_LEAN_AND_MEAN
+#include "platform.h"
 
 #include "unicode_defines.h"
+#include "string_view.h"
+#include "mapped_file.h"
+#include "line_scanner.h"
+#include "arena.h"
 #include "config_types.h"
+#include "config_registry.h"
+#include "file_watcher.h"
+#include "config_image.h"
+#include "diagnostics.h"
+#include "config_stats.h"
+#include "key_profile.h"
+#include "config_schema.h"
+#include "static_config.h"
 
 /**
  * Acts as a default configuration file parser.
- * Includes String, Short, Int, Long and Double config entries.
+ * Includes String, Short, Int, Long and Double config entries.\n
+ * Keys and values are copied into the arena of the ConfigLoader the parser is added to,
+ * so closing the file releases them without visiting each entry.\n
+ * A fallback layer of read only defaults, such as an EmbeddedConfig section, can be set with
+ * SetFallback, keys missing from the section are then read from it.
+ *
+ * @tparam Storage TreeStorage or FlatStorage, see DefaultParser and FlatDefaultParser.
  */
-class DefaultParser : public Parser<TSTRING>
+template <class Storage>
+class BasicDefaultParser : public Parser<ArenaString, Storage>
 {
+protected:
+	typedef Parser<ArenaString, Storage> BaseType;
+
+	using BaseType::Configuration;
+	using BaseType::message;
+
 public:
+	using BaseType::GetItem;
+	using BaseType::FindItem;
+
 	/**
 	 * Constructor, does nothing except call base constructor.
 	 * @param sectionName name of section in config file to wrap this parser around.
 	 */
-	DefaultParser( const TSTRING& sectionName )
-		: Parser( sectionName ) {};
+	BasicDefaultParser( const TSTRING& sectionName )
+		: BaseType( sectionName ), fallback( nullptr ) {};
+
+	/**
+	 * Creates an empty parser for the same section and fallback, used when the file is reloaded.
+	 * Classes deriving from this parser must override Create to be reloaded, otherwise their section keeps
+	 * its entries and DIAG_RELOAD_UNSUPPORTED is reported.
+	 * @return new parser, owned by the caller, nullptr when called on a derived class.
+	 */
+	ParserBase* Create() const
+	{
+		/* a parser of the base type would silently drop the behaviour of the derived class */
+		if ( typeid( *this ) != typeid( BasicDefaultParser ) )
+		{
+			return nullptr;
+		}
+
+		BasicDefaultParser* parser = new BasicDefaultParser( this->section_name );
+		parser->fallback = fallback;
+		return parser;
+	}
+
+	/**
+	 * Sets the defaults read when a key is not in the section, or is empty when read as a number.
+	 * The Default given to a getter is only returned when the key is in neither.
+	 * @param defaults read only entries, usually EmbeddedConfig::Section, which must outlive the parser, nullptr for none.
+	 */
+	void SetFallback( const StaticParser* defaults )
+	{
+		fallback = defaults;
+	}
 
 	/**
-	 * Add a key, value pair to this parsers dictionary.
-	 * @param key config file key to use for lookup.
-	 * @param value to store in lookup keys bucket.
+	 * @return the defaults read when a key is not in the section, nullptr if there are none.
+	 */
+	const StaticParser* Fallback() const
+	{
+		return fallback;
+	}
+
+	/**
+	 * Resolves a key once into a handle that reads the converted value without a lookup, see KeyHandle.
+	 * The value is read as the getter of its type reads it, including the fallback, and is
+	 * converted again only when the section is reloaded.
+	 * @code
+	 * KeyHandle<INT32> threads = parser->Resolve<INT32>( CFG_KEY( "threads" ), 4 );
+	 * @endcode
+	 * @tparam T INT16, INT32, INT64, double or TSTRING.
+	 * @param key key to use when looking for a value in the dictionary.
+	 * @param Default value read when the key is in neither the section nor the fallback.
+	 * @return handle holding the converted value.
+	 */
+	template <class T = TSTRING>
+	KeyHandle<T> Resolve( const KeyView& key, const T& Default = T() ) const
+	{
+		return KeyHandle<T>( this, key, Default, &BasicDefaultParser::template ResolveValue<T> );
+	}
+
+	using ParserBase::Parse;
+
+	/**
+	 * Copies an entry into the dictionary.
+	 * @param key key to be used for lookups.
+	 * @param value value to be stored in the dictionary.
 	 */
 	void Parse( const TSTRING& key, const TSTRING& value )
 	{
-		if ( Configuration.count( key ) == 0 )
+		this->Store( this->MakeString( key ), this->MakeString( value ) );
+	}
+
+	/**
+	 * Copies an entry from the loaded file straight into the dictionary.
+	 * Entries of classes deriving from this parser go through the const TSTRING version of Parse,
+	 * so parsers overriding it still see every entry.
+	 * @param key key to be used for lookups.
+	 * @param value value to be stored in the dictionary.
+	 */
+	void Parse( const StringView& key, const StringView& value )
+	{
+		if ( typeid( *this ) == typeid( BasicDefaultParser ) )
 		{
-			Configuration[key] = value;
+			this->Store( this->MakeString( key ), this->MakeString( value ) );
 		}
 		else
 		{
-			message = TEXT("Duplicate Configuration Key: ") + key;
+			ParserBase::Parse( key, value );
 		}
 	}
 
@@ -64,9 +164,30 @@ public:
 	 * @param Default value to return when the key lookup fails.
 	 * @return string which is either value returned from lookup or Default.
 	 */
-	TSTRING getString( const TSTRING& key, const TSTRING& Default )
+	TSTRING getString( const KeyView& key, const TSTRING& Default ) const
+	{
+		const ArenaString* item = FindItem( key );
+		if ( item != nullptr )
+		{
+			return StringView( *item ).str();
+		}
+		return ( fallback != nullptr ) ? fallback->getString( key, Default ) : Default;
+	}
+
+	/**
+	 * Gets a view of a string in the dictionary, without copying it.
+	 * @param key key to use when looking for a value in the dictionary.
+	 * @param Default value to return when the key lookup fails.
+	 * @return view of either the stored value or Default, valid while the parser is unchanged.
+	 */
+	StringView getStringView( const KeyView& key, const StringView& Default = StringView() ) const
 	{
-		return GetItem( key, Default );
+		const ArenaString* item = FindItem( key );
+		if ( item != nullptr )
+		{
+			return StringView( *item );
+		}
+		return ( fallback != nullptr ) ? fallback->getStringView( key, Default ) : Default;
 	}
 
 	/**
@@ -75,10 +196,14 @@ public:
 	 * @param Default value to return when the key lookup fails.
 	 * @return Int16 which is either value returned from lookup or Default.
 	 */
-	INT16 getInt16( const TSTRING& key, const INT16 Default )
+	INT16 getInt16( const KeyView& key, const INT16 Default ) const
 	{
-		TSTRING item = GetItem( key, TEXT("") );
-		return ( item != TEXT("") ) ? util::StringToInt16( item ) : Default;
+		const ArenaString* item = FindNumber( key );
+		if ( item != nullptr )
+		{
+			return util::StringToInt16( *item );
+		}
+		return ( fallback != nullptr ) ? fallback->getInt16( key, Default ) : Default;
 	}
 	
 	/**
@@ -87,10 +212,14 @@ public:
 	 * @param Default value to return when the key lookup fails.
 	 * @return Int32 which is either value returned from lookup or Default.
 	 */
-	INT32 getInt32( const TSTRING& key, const INT32 Default )
+	INT32 getInt32( const KeyView& key, const INT32 Default ) const
 	{
-		TSTRING item = GetItem( key, TEXT("") );
-		return ( item != TEXT("") ) ? util::StringToInt32( item ) : Default;
+		const ArenaString* item = FindNumber( key );
+		if ( item != nullptr )
+		{
+			return util::StringToInt32( *item );
+		}
+		return ( fallback != nullptr ) ? fallback->getInt32( key, Default ) : Default;
 	}
 	
 	/**
@@ -99,10 +228,14 @@ public:
 	 * @param Default value to return when the key lookup fails.
 	 * @return Int64 which is either value returned from lookup or Default.
 	 */
-	INT64 getInt64( const TSTRING& key, const INT64 Default )
+	INT64 getInt64( const KeyView& key, const INT64 Default ) const
 	{
-		TSTRING item = GetItem( key, TEXT("") );
-		return ( item != TEXT("") ) ? util::StringToInt64( item ) : Default;
+		const ArenaString* item = FindNumber( key );
+		if ( item != nullptr )
+		{
+			return util::StringToInt64( *item );
+		}
+		return ( fallback != nullptr ) ? fallback->getInt64( key, Default ) : Default;
 	}
 
 	/**
@@ -111,15 +244,117 @@ public:
 	 * @param Default value to return when the key lookup fails.
 	 * @return Double which is either value returned from lookup or Default.
 	 */
-	double getDouble( const TSTRING& key, const double Default )
+	double getDouble( const KeyView& key, const double Default ) const
 	{
-		TSTRING item = GetItem( key, TEXT("") );
-		return ( item != TEXT("") ) ? util::StringToDouble( item ) : Default;
+		const ArenaString* item = FindNumber( key );
+		if ( item != nullptr )
+		{
+			return util::StringToDouble( *item );
+		}
+		return ( fallback != nullptr ) ? fallback->getDouble( key, Default ) : Default;
+	}
+
+private:
+	/**
+	 * Reads a value for a KeyHandle with the getter of its type.
+	 * @param parser parser hooked into the section, of this type.
+	 * @param key key to use when looking for a value in the dictionary.
+	 * @param Default value to return when the key lookup fails.
+	 * @return the converted value, or Default.
+	 */
+	template <class T>
+	static T ResolveValue( const ParserBase* parser, const KeyView& key, const T& Default )
+	{
+		const BasicDefaultParser* typed = dynamic_cast<const BasicDefaultParser*>( parser );
+		return ( typed != nullptr ) ? typed->GetValue( key, Default ) : Default;
+	}
+
+	INT16 GetValue( const KeyView& key, const INT16 Default ) const { return getInt16( key, Default ); }
+	INT32 GetValue( const KeyView& key, const INT32 Default ) const { return getInt32( key, Default ); }
+	INT64 GetValue( const KeyView& key, const INT64 Default ) const { return getInt64( key, Default ); }
+	double GetValue( const KeyView& key, const double Default ) const { return getDouble( key, Default ); }
+	TSTRING GetValue( const KeyView& key, const TSTRING& Default ) const { return getString( key, Default ); }
+
+	/**
+	 * Finds a value that will be converted to a number, and counts the conversion.
+	 * @param key key to use when looking for a value in the dictionary.
+	 * @return the value, or nullptr if the key was not found or the value is empty.
+	 */
+	const ArenaString* FindNumber( const KeyView& key ) const
+	{
+		const ArenaString* item = this->FindItem( key );
+		if ( item == nullptr || item->empty() )
+		{
+			return nullptr;
+		}
+		if ( this->count_lookups )
+		{
+			this->stats.Add( PARSER_CONVERSIONS );
+		}
+		return item;
 	}
+
+	const StaticParser* fallback; /**< defaults read when a key is not in the section, nullptr for none. */
+};
+
+/**
+ * Flags that change how a configuration file is loaded.
+ */
+enum ConfigFlags
+{
+	CONFIG_EAGER = 0, /**< every line of the file is scanned when the file is opened. */
+	CONFIG_LAZY = 1, /**< only section headers are indexed when opened, a section's lines are scanned when it is first added. */
+	CONFIG_RELOAD = 2, /**< the file is watched and reloaded when it changes, see ConfigLoader::ReadGuard. */
+	CONFIG_VERIFY_IMAGE = 4, /**< check the checksum of a compiled image before using it, see ConfigImage. */
+	CONFIG_PROFILE = 8, /**< count reads of each key to find hot and dead keys, see ConfigLoader::ProfileReport. */
+	CONFIG_PUBLISH = 16, /**< publish a compiled image of the file in shared memory for other processes, see ImagePublisher. */
+	CONFIG_SHARED = 32, /**< use the image published by another process in place of the file if there is one when opened, see ConfigLoader::Reload. */
+	CONFIG_MAPPED = 64, /**< map the file rather than reading it into a buffer, it must not be rewritten in place while open, see MappedFile. */
+	CONFIG_LOOKUP_STATS = 128 /**< count section and key lookups in the statistics, see ConfigLoader::Statistics. */
+};
+
+/**
+ * Kinds of change reported when a configuration file is reloaded.
+ */
+enum ChangeType
+{
+	CHANGE_ADDED = 0, /**< present in the new file but not the old. */
+	CHANGE_REMOVED = 1, /**< present in the old file but not the new. */
+	CHANGE_MODIFIED = 2 /**< present in both files with different contents. */
 };
 
+/**
+ * Change to a single key of a section.
+ */
+struct KeyChange
+{
+	ChangeType type; /**< how the key changed. */
+	TSTRING key; /**< key that changed, bare values use their auto-key. */
+	TSTRING old_value; /**< value before the reload, empty when added. */
+	TSTRING new_value; /**< value after the reload, empty when removed. */
+};
+
+/**
+ * Change to a section of a configuration file.
+ */
+struct SectionChange
+{
+	ChangeType type; /**< how the section changed. */
+	TSTRING section; /**< upper case name of the section. */
+	bool reparsed; /**< true if a parser was hooked into the section and has been rebuilt. */
+	std::vector<KeyChange> keys; /**< changed keys, in key order. */
+};
+
+/**
+ * Function called with every change found by a reload, see ConfigLoader::Subscribe.
+ */
+typedef std::function<void( const std::vector<SectionChange>& )> ChangeCallback;
+
+typedef BasicDefaultParser<TreeStorage> DefaultParser; /**< Default parser, entries ordered by key. */
+typedef BasicDefaultParser<FlatStorage> FlatDefaultParser; /**< Default parser with contiguous storage, entries in file order. */
+
 class ConfigHandle; /**< Forward delceration just for the header file */
-typedef std::auto_ptr<ConfigHandle> CONFIGHANDLE;
+typedef std::unique_ptr<ConfigHandle> CONFIGHANDLE;
 
 /**
  * Global Configuration File Handler.
@@ -131,47 +366,102 @@ typedef std::auto_ptr<ConfigHandle> CONFIGHANDLE;
  */
 class ConfigLoader
 {
+public:
+	static const size_t MAX_MESSAGES = 256; /**< diagnostics held until they are polled, later ones are dropped and counted. */
 
 protected:
 
 	/**
-	 * @param key Name of Configuration File.
-	 * @param value Vector of strings corresponding to lines in the Configuration file.
+	 * Half open range of scanned lines or file charactors.
 	 */
-	typedef std::unordered_map<TSTRING, std::vector<TSTRING>> FileMapping;
+	struct Range
+	{
+		size_t first; /**< index of the first item in the range. */
+		size_t last; /**< index one past the last item in the range. */
+	};
 
 	/**
-	 * @param key name of the section to hook a parser to.
-	 * @param value parser to hook into the config file section.
+	 * Location of a section in the file, a section may appear more than once in a file.
+	 */
+	struct SectionRanges
+	{
+		std::vector<Range> bytes; /**< charactors of the section body, excluding the header. */
+		std::vector<Range> lines; /**< scanned lines of the section, empty until the section is scanned. */
+		bool scanned; /**< true once the lines of the section have been scanned. */
+	};
+
+	/**
+	 * @param key Name of the Section.
+	 * @param value Location of the Section in the file.
 	 */
-	typedef std::unordered_map<TSTRING, ParserBase*> StorageMap;
+	typedef std::unordered_map<TSTRING, SectionRanges, std::hash<TSTRING>, std::equal_to<TSTRING>,
+								ArenaAllocator<std::pair<const TSTRING, SectionRanges>>> FileMapping;
 
 	/**
-	 * @param key name of the configuration file.
-	 * @param value config loader class hooked into the configuration file.
+	 * Keys are compared ignoring case, so GetSection can search without upper casing the name.
+	 * @param key name of the section to hook a parser to.
+	 * @param value parser to hook into the config file section.
 	 */
-	typedef std::unordered_map<TSTRING, ConfigLoader*> ConfigMap;
+	typedef FlatMap<TSTRING, ParserBase*, FoldedHash, FoldedEqual> StorageMap;
+
+	std::atomic<int> references; /**< number of instances of this class that are currently in use, zero once closing. */
+	int flags; /**< ConfigFlags the file was opened with. */
 
-	int references; /**< number of instances of this class that are currently in use. */
+	Arena Memory; /**< Storage for the section maps and parser entries, released in one go when the ConfigLoader closes. */
 
+	MappedFile File; /**< Contents of the config file, kept open for the life of the ConfigLoader. */
+	std::vector<ScannedLine> Lines; /**< Section headers and entries found in the file, entries of lazy sections are appended when scanned. */
 	FileMapping FileMap; /**< Map of the file that this ConfigLoader is hooked into. */
 	StorageMap Sections; /**< Sections in the config file that have a parser hooked into them. */
+	std::atomic<const StorageMap*> Published; /**< Sections seen by readers, a copy of Sections swapped in whole when sections are added or reloaded. */
+	std::mutex Writer; /**< Held while sections are added or the file is reloaded. */
+	std::atomic<UINT64> Generation; /**< changed after a parser is added or replaced, see KeyHandle. */
+	FileWatcher Watcher; /**< Watches the file when opened with CONFIG_RELOAD. */
+	ConfigImage Image; /**< Compiled image of the file, used in place of File when one is open. */
+	ImagePublisher Publisher; /**< Publishes the file in shared memory when opened with CONFIG_PUBLISH. */
 
-	static ConfigMap OpenConfigs; /**< Stores instances for all open config files, avaliable to all config loaders. */
+	static ConfigRegistry OpenConfigs; /**< Stores instances for all open config files, avaliable to all config loaders and threads. */
 
 	TSTRING fileName; /**< name of the file to use for this ConfigLoader. */
 	TSTRING fileType; /**< file type associated with the config file. */
 	TSTRING filePath; /**< path to the config file. */
 
-	int max_messages; /**< Maximum number of messages allowed in the message queue. */
-	std::queue<TSTRING> message_queue; /**< queue of messages used for errors and reports. */
+	TSTRING fullPath; /**< filePath followed by fileName, referenced by the diagnostics. */
+
+	DiagnosticRing Messages; /**< diagnostics used for errors and reports, added by loading and reload threads. */
+	LoadStatCounters Stats; /**< load and section lookup counters, see Statistics. */
+	std::atomic<UINT64> reported_drops; /**< dropped diagnostics already reported by PollMessages. */
+
+	int next_subscriber; /**< id given to the next subscriber. */
+	std::vector<std::pair<int, ChangeCallback>> subscribers; /**< callbacks told about the changes found by reloads. */
+	std::mutex subscriber_lock; /**< protects subscribers. */
 
 	/**
 	 * Constructor
 	 * @param filename name of the config file to hook into with this config loader.
 	 * @param path location of the config file.
+	 * @param flags ConfigFlags controlling how the file is loaded.
+	 */
+	ConfigLoader( const TSTRING& filename, const TSTRING& path = TEXT("\\"), const int flags = CONFIG_EAGER );
+
+	/**
+	 * Takes a reference to this ConfigLoader unless it is already being closed.
+	 * @return true if a reference was taken.
+	 */
+	bool Acquire();
+
+	/**
+	 * Drops a reference to this ConfigLoader.
+	 * @param force drop every reference.
+	 * @return true if the caller dropped the last reference and must Retire the ConfigLoader.
 	 */
-	ConfigLoader( const TSTRING& filename, const TSTRING& path = TEXT("\\") );
+	bool Release( const bool force );
+
+	/**
+	 * Removes a ConfigLoader from OpenConfigs and deletes it once no reader can still be using it.
+	 * @param config ConfigLoader whose last reference has been dropped.
+	 */
+	static void Retire( ConfigLoader* config );
 
 	/**
 	 * Removes file extentions from the file name.
@@ -181,17 +471,159 @@ protected:
 	static TSTRING RemoveExtension( const TSTRING& filename );
 
 	/**
-	 * Loads the file into the ConfigLoader class and reads it into memory.
+	 * Works out the type of the file and, for relative paths, the full path using the exe location.
 	 */
-	void LoadFile();
+	void ResolvePath();
 
 	/**
-	 * Adds a message to the message queue.
-	 * If the max queue size has been reached will increment "other messages" counter.
-	 * @param message template string to be added to queue.
-	 * @param ... arguments to be used in the message template.
+	 * Loads the file into the ConfigLoader class.
+	 * Lines are scanned in place and recorded as offsets into the contents rather than being copied,
+	 * when opened with CONFIG_LAZY only the section headers are found.\n
+	 * If an up to date compiled image of the file exists it is mapped instead and nothing is scanned.\n
+	 * The file is read into a buffer unless opened with CONFIG_MAPPED, a mapped file that is written in place
+	 * would change under sections that are not parsed yet. Files opened with CONFIG_RELOAD, and every reload,
+	 * are always buffered as the contents are kept to compare with the next load.
+	 * @param useImage allow a compiled image to be used, false when reloading.
+	 * @return false if the file could not be opened.
 	 */
-	void AddMessage( TSTRING message, ... );
+	bool LoadFile( const bool useImage = true );
+
+	/**
+	 * Scans the lines of a section that was indexed by a lazy load.
+	 * @param section location of the section to scan.
+	 */
+	void ScanSection( SectionRanges& section );
+
+	/**
+	 * Parses the lines of a section in the file into a parser.
+	 * @param name upper case name of the section.
+	 * @param section parser to add the entries to.
+	 * @param arena arena to keep the entries in, nullptr for the heap.
+	 * @return false if the section is not in the file.
+	 */
+	bool ParseSection( const TSTRING& name, ParserBase* section, Arena* arena );
+
+	/**
+	 * Parses a section of the compiled image into a parser.
+	 * @param name upper case name of the section.
+	 * @param section parser to add the entries to.
+	 * @param arena arena to keep the entries in, nullptr for the heap.
+	 * @return false if the section is not in the image.
+	 */
+	bool ParseImageSection( const TSTRING& name, ParserBase* section, Arena* arena );
+
+	/**
+	 * Passes a single entry to a parser, generating an auto-key for bare values.
+	 * @param section parser to add the entry to.
+	 * @param key trimmed key, or the bare value when there is no '='.
+	 * @param value trimmed value.
+	 * @param hasValue true if the line had a '='.
+	 */
+	static void ParseEntry( ParserBase* section, const StringView& key, const StringView& value, const bool hasValue );
+
+	/**
+	 * Compares every section of the previous load of the file with the current load.
+	 * Sections are compared by a hash of their contents, keys are only compared for changed sections.
+	 * @param previous contents of the previous load.
+	 * @param previousMap sections of the previous load.
+	 * @param comparable false if the previous contents may have changed since they were loaded,
+	 *		every section is then reported as modified without comparing its keys.
+	 * @param changes vector to append the changed sections to.
+	 * @param compareKeys fill in the changed keys of each section.
+	 */
+	void DiffSections( const StringView& previous, const FileMapping& previousMap, const bool comparable,
+						std::vector<SectionChange>& changes, const bool compareKeys ) const;
+
+	/**
+	 * Compares every section of the previously attached shared image with the current image.
+	 * @param previous image attached before the reload.
+	 * @param changes vector to append the changed sections to.
+	 * @param compareKeys fill in the changed keys of each section.
+	 */
+	void DiffImages( const ConfigImage& previous, std::vector<SectionChange>& changes, const bool compareKeys ) const;
+
+	/**
+	 * Hashes the entries of a section of an image.
+	 * @param image image holding the section.
+	 * @param section the section, nullptr if the section is not present.
+	 * @return hash of the section entries.
+	 */
+	static UINT64 HashImageSection( const ConfigImage& image, const ConfigImage::SectionRecord* section );
+
+	/**
+	 * Collects the entries of a section of an image as a parser would see them, the first of any duplicate key is kept.
+	 * @param image image holding the section.
+	 * @param section the section, nullptr if the section is not present.
+	 * @param entries map to add the entries to.
+	 */
+	static void CollectImageEntries( const ConfigImage& image, const ConfigImage::SectionRecord* section, std::map<TSTRING, TSTRING>& entries );
+
+	/**
+	 * Hashes the body of a section.
+	 * @param contents contents of the file.
+	 * @param bytes ranges of the section body, nullptr if the section is not present.
+	 * @return hash of the section body.
+	 */
+	static UINT64 HashSection( const StringView& contents, const std::vector<Range>* bytes );
+
+	/**
+	 * Collects the entries of a section as a parser would see them, the first of any duplicate key is kept.
+	 * @param contents contents of the file.
+	 * @param bytes ranges of the section body, nullptr if the section is not present.
+	 * @param entries map to add the entries to.
+	 */
+	static void CollectEntries( const StringView& contents, const std::vector<Range>* bytes, std::map<TSTRING, TSTRING>& entries );
+
+	/**
+	 * Compares the entries of a section between two loads of the file.
+	 * @param previous contents of the previous load.
+	 * @param previousBytes section body in the previous load, nullptr if it was not present.
+	 * @param current contents of the current load.
+	 * @param currentBytes section body in the current load, nullptr if it is not present.
+	 * @param keys vector to append the changed keys to.
+	 */
+	static void DiffKeys( const StringView& previous, const std::vector<Range>* previousBytes,
+							const StringView& current, const std::vector<Range>* currentBytes,
+							std::vector<KeyChange>& keys );
+
+	/**
+	 * Compares the entries of a section before and after a reload.
+	 * @param before entries of the previous load.
+	 * @param after entries of the current load.
+	 * @param keys vector to append the changed keys to.
+	 */
+	static void CompareEntries( const std::map<TSTRING, TSTRING>& before, const std::map<TSTRING, TSTRING>& after,
+								std::vector<KeyChange>& keys );
+
+	/**
+	 * Checks if a newer image has been published than the attached one, polled by the watcher.
+	 * @return true if the file is attached to a shared image and a newer generation is published.
+	 */
+	bool SharedImageChanged();
+
+	/**
+	 * Copies Sections into a map on the heap.
+	 * @return new map, owned by the caller.
+	 */
+	StorageMap* CopySections() const;
+
+	/**
+	 * Publishes a copy of Sections for readers and frees the previous copy once no reader holds it.
+	 * Must not be called inside a ReadGuard.
+	 */
+	void PublishSections();
+
+	/**
+	 * Adds a diagnostic, the message is only formatted if it is polled.
+	 * If the ring is full the diagnostic is dropped and counted.
+	 * @param code kind of diagnostic.
+	 * @param section name of the section the diagnostic is about.
+	 * @param argument value specific to the code.
+	 * @param offset byte offset of the line in the file.
+	 * @param line line number in the file.
+	 */
+	void AddMessage( const DiagnosticCode code, const StringView& section = StringView(), const INT64 argument = 0,
+					 const UINT64 offset = Diagnostic::NO_OFFSET, const UINT32 line = 0 );
 
 	/**
 	 * Virtual Destructor.
@@ -203,11 +635,32 @@ public:
 
 	/**
 	 * Function to either create a new ConfigLoader or return an existing one.
+	 * Safe to call from multiple threads, a file opened by several threads at once is only loaded once.
 	 * @param filename name of the config file to hook into.
 	 * @param path location of the config file.
+	 * @param flags ConfigFlags controlling how the file is loaded, ignored if the file is already open.
 	 * @return pointer to either a new or existing ConfigLoader.
 	 */
-	static CONFIGHANDLE InitialiseConfig(const TSTRING& filename, const TSTRING& path = TEXT("\\") );
+	static CONFIGHANDLE InitialiseConfig(const TSTRING& filename, const TSTRING& path = TEXT("\\"), const int flags = CONFIG_EAGER );
+
+	/**
+	 * Read side critical section for GetSection, needed whenever another thread may add sections or
+	 * reload the file, which is always the case for configs opened with CONFIG_RELOAD.
+	 * Parsers returned by GetSection remain valid until the guard is destroyed, even if the file
+	 * is reloaded in the mean time, and they never change while they are in use.
+	 * Guards are cheap, never block, and may be nested.
+	 *
+	 * @warning Configs must not be opened, closed, reloaded, or have sections added inside a guard.
+	 */
+	class ReadGuard
+	{
+	public:
+		ReadGuard()
+			: guard( OpenConfigs ) {}
+
+	private:
+		ConfigRegistry::ReadGuard guard; /**< configs share the grace periods of the registry. */
+	};
 
 	/**
 	 * Adds a section to the ConfigLoader.
@@ -216,12 +669,55 @@ public:
 	 */
 	bool AddSection(ParserBase* section);
 
+	/**
+	 * Reloads the file and re-parses the sections that changed into new parsers, see ParserBase::Create.
+	 * Parsers of unchanged sections are kept as they are. The new sections are published all at once,
+	 * readers see either the old or new sections, then subscribers are told what changed.\n
+	 * Called automatically when the file changes if it was opened with CONFIG_RELOAD.\n
+	 * A file attached to a shared image with CONFIG_SHARED is not read again, the newest published image
+	 * is attached instead, and nothing is done if the generation has not changed since it was attached.
+	 * With CONFIG_RELOAD the generation is also polled, so a newer image is attached once it is published.
+	 * A file that was loaded as text when opened is always reloaded as text.\n
+	 * Replaced parsers are freed once no ReadGuard can see them, in every mode, so parsers returned by
+	 * GetSection before a reload must only be used inside a guard.
+	 * @return false if the file could not be opened, the existing sections are kept.
+	 */
+	bool Reload();
+
+	/**
+	 * Registers a callback that is given every change found by a reload, in a single batch per reload.
+	 * The callback runs on the thread that reloaded, after the new sections are published,
+	 * and is not called if nothing changed.
+	 * @param callback function to call with the changed sections.
+	 * @return id to pass to Unsubscribe.
+	 */
+	int Subscribe( const ChangeCallback& callback );
+
+	/**
+	 * Removes a callback registered with Subscribe.
+	 * @param id id returned by Subscribe.
+	 */
+	void Unsubscribe( const int id );
+
 	/**
 	 * Returns the parser hooked into a section, should be cast from base to actual.
+	 * Section names are case insensitive, a CFG_KEY name is found without hashing it again.\n
+	 * Calls that may overlap AddSection or Reload on another thread must be made inside a ReadGuard,
+	 * and the parser only used while it is held. With CONFIG_RELOAD this is always the case.
 	 * @param section_name name of the section to get parser for.
 	 * @return base class of the parser hooked into the section.
 	 */
-	ParserBase* GetSection(const TSTRING& section_name);
+	ParserBase* GetSection( const KeyView& section_name );
+
+	/**
+	 * Counter changed after a parser is added or replaced by a reload, once the new parser is published.
+	 * KeyHandle compares it to the value it last resolved at to find out when to resolve again.
+	 * @return the counter, valid while the ConfigLoader is open.
+	 */
+	const std::atomic<UINT64>& SectionGeneration() const
+	{
+		return Generation;
+	}
 
 	/**
 	 * Unhooks a Parser from a Section.
@@ -230,19 +726,63 @@ public:
 	void DeleteSection(const TSTRING& section_name);
 
 	/**
-	 * returns the messages stored in the message_queue.
+	 * returns the oldest diagnostic formatted as a message.
+	 * once every diagnostic has been returned, a count of any that were dropped is returned once.
 	 * returns an empty string if no messages.
-	 * @return the top message from the message queue.
+	 * @return the oldest message.
 	 */
 	TSTRING PollMessages();
 
+	/**
+	 * Removes diagnostics in a batch without formatting them, oldest first.
+	 * Records refer to the file name of this ConfigLoader, so they must be used while it is open.
+	 * @param records vector to append the diagnostics to.
+	 * @param max largest number of diagnostics to remove.
+	 * @return number of diagnostics removed.
+	 */
+	size_t DrainMessages( std::vector<Diagnostic>& records, const size_t max = ~size_t( 0 ) );
+
+	/**
+	 * @return number of diagnostics dropped because too many were waiting, since the file was opened.
+	 */
+	UINT64 DroppedMessages() const
+	{
+		return Messages.Dropped();
+	}
+
+	/**
+	 * Takes a snapshot of the load counters of the file and the lookup counters of its parsers.
+	 * Counters are sharded by thread, so recording them never contends between cores.\n
+	 * Lookups are only counted when the file was opened with CONFIG_LOOKUP_STATS.
+	 * @return the counters.
+	 */
+	ConfigStats Statistics();
+
+	/**
+	 * Writes the statistics of every open config in the Prometheus text format,
+	 * for the node exporter textfile collector.
+	 * @param path full path of the file to write, should end with ".prom".
+	 * @return success or failure.
+	 */
+	static bool ExportStatistics( const TSTRING& path );
+
+	/**
+	 * Reports the most read keys, and the keys never read, of every section with a parser.
+	 * Only sections parsed while the file was opened with CONFIG_PROFILE, or whose parser
+	 * was started with StartProfile, are included.
+	 * @param top largest number of hot keys to report.
+	 * @return the report.
+	 */
+	KeyProfileReport ProfileReport( const size_t top );
+
 	/**
 	 * Returns the parser hooked into a section in a file, should be cast from base to actual.
+	 * Safe to call from multiple threads without locking, the file must be kept open while the parser is used.
 	 * @param file filename of file to get section from.
 	 * @param section name of the section to get parser for. 
 	 * @return base class of the parser hooked into the section.
 	 */
-	static ParserBase* GetFileSection(const TSTRING& file, const TSTRING& section);
+	static ParserBase* GetFileSection( const TSTRING& file, const KeyView& section );
 
 	/**
 	 * Close all configuration files.
@@ -265,6 +805,112 @@ public:
 	static void CloseConfig(const TSTRING& filename, const bool force = false);
 };
 
+/**
+ * Key resolved once and read many times, see Parser::Resolve and BasicDefaultParser::Resolve.
+ * The item is looked up, and converted, when the handle is resolved. A read then checks the
+ * SectionGeneration of the ConfigLoader the parser was added to and returns the value held by
+ * the handle, with no hashing or string compare. After the ConfigLoader adds or replaces a parser,
+ * such as when the file is reloaded, the next read looks the key up again in the parser then
+ * hooked into the section.\n
+ * Handles are cheap to copy but must only be read by one thread at a time, threads should keep
+ * their own copy. The ConfigLoader must stay open while the handle is read.
+ * @code
+ * KeyHandle<INT32> threads = server->Resolve<INT32>( CFG_KEY( "threads" ), 4 );
+ * StartWorkers( threads.Get() );
+ * @endcode
+ *
+ * @tparam T type of the value.
+ */
+template <class T>
+class KeyHandle
+{
+public:
+	/**
+	 * Looks up a value in a parser.
+	 * @param parser parser hooked into the section.
+	 * @param key key to look for.
+	 * @param Default value to return when the key is not found.
+	 * @return the value, or Default.
+	 */
+	typedef T ( *Resolver )( const ParserBase* parser, const KeyView& key, const T& Default );
+
+	/**
+	 * Constructor for an empty handle, which reads a default constructed value.
+	 */
+	KeyHandle()
+		: owner( nullptr ), source( &Unowned ), generation( 0 ), resolver( nullptr ), Default(), value() {}
+
+	/**
+	 * Constructor, use Resolve rather than calling directly.
+	 * @param parser parser to resolve the key in.
+	 * @param key key to resolve.
+	 * @param Default value read when the key is not found.
+	 * @param resolver looks up the value, again whenever the generation changes.
+	 */
+	KeyHandle( const ParserBase* parser, const KeyView& key, const T& Default, const Resolver resolver )
+		: owner( parser->owner ), source( ( parser->owner != nullptr ) ? &parser->owner->SectionGeneration() : &Unowned ),
+		  section( parser->section_name ), key( key.View().str() ), generation( 0 ), resolver( resolver ), Default( Default ), value()
+	{
+		if ( owner != nullptr )
+		{
+			/* the parser may already have been replaced, so the current one is found by name */
+			Refresh();
+		}
+		else
+		{
+			value = resolver( parser, key, Default );
+		}
+	}
+
+	/**
+	 * Reads the value, resolving the key again if the sections have changed since it was last resolved.
+	 * @return the value, valid until the next read.
+	 */
+	const T& Get()
+	{
+		if ( source->load( std::memory_order_acquire ) != generation )
+		{
+			Refresh();
+		}
+		return value;
+	}
+
+	/**
+	 * @return key the handle was resolved from.
+	 */
+	const TSTRING& Key() const
+	{
+		return key;
+	}
+
+private:
+	/**
+	 * Looks the key up in the parser hooked into the section, or reads Default if there is none.
+	 */
+	void Refresh()
+	{
+		/* the generation is read first, a change made while resolving is then seen by the next read */
+		ConfigLoader::ReadGuard guard;
+		generation = source->load( std::memory_order_acquire );
+		const ParserBase* parser = owner->GetSection( KeyView( section ) );
+		value = ( parser != nullptr ) ? resolver( parser, KeyView( key ), Default ) : Default;
+	}
+
+	static const std::atomic<UINT64> Unowned; /**< generation of parsers not added to a ConfigLoader, never changes. */
+
+	ConfigLoader* owner; /**< ConfigLoader the parser was added to, nullptr if it was not added. */
+	const std::atomic<UINT64>* source; /**< SectionGeneration of owner, or Unowned. */
+	TSTRING section; /**< name of the section the key is in. */
+	TSTRING key; /**< key that was resolved. */
+	UINT64 generation; /**< value of source when the key was last resolved. */
+	Resolver resolver; /**< looks up the value. */
+	T Default; /**< value read when the key is not found. */
+	T value; /**< the value last resolved. */
+};
+
+template <class T>
+const std::atomic<UINT64> KeyHandle<T>::Unowned( 0 );
+
 /**
  * Wrapper class that allows configuration files to automatically close when they are
  * out of scope.
@@ -298,7 +944,7 @@ public:
 	 * @param section_name name of the section to get parser for.
 	 * @return base class of the parser hooked into the section.
 	 */
-	ParserBase* GetSection(const TSTRING& section_name)
+	ParserBase* GetSection( const KeyView& section_name )
 	{
 		return config->GetSection( section_name );
 	}
@@ -313,15 +959,81 @@ public:
 	}
 
 	/**
-	 * returns the messages stored in the message_queue.
+	 * Reloads the file and re-parses the sections that changed, see ConfigLoader::Reload.
+	 * @return false if the file could not be opened.
+	 */
+	bool Reload()
+	{
+		return config->Reload();
+	}
+
+	/**
+	 * Registers a callback that is given every change found by a reload.
+	 * @param callback function to call with the changed sections.
+	 * @return id to pass to Unsubscribe.
+	 */
+	int Subscribe( const ChangeCallback& callback )
+	{
+		return config->Subscribe( callback );
+	}
+
+	/**
+	 * Removes a callback registered with Subscribe.
+	 * @param id id returned by Subscribe.
+	 */
+	void Unsubscribe( const int id )
+	{
+		config->Unsubscribe( id );
+	}
+
+	/**
+	 * returns the oldest diagnostic formatted as a message.
 	 * returns an empty string if no messages.
-	 * @return the top message from the message queue.
+	 * @return the oldest message.
 	 */
 	TSTRING PollMessages()
 	{
 		return config->PollMessages();
 	}
 
+	/**
+	 * Removes diagnostics in a batch without formatting them, oldest first.
+	 * @param records vector to append the diagnostics to.
+	 * @param max largest number of diagnostics to remove.
+	 * @return number of diagnostics removed.
+	 */
+	size_t DrainMessages( std::vector<Diagnostic>& records, const size_t max = ~size_t( 0 ) )
+	{
+		return config->DrainMessages( records, max );
+	}
+
+	/**
+	 * @return number of diagnostics dropped because too many were waiting.
+	 */
+	UINT64 DroppedMessages() const
+	{
+		return config->DroppedMessages();
+	}
+
+	/**
+	 * Takes a snapshot of the load and lookup counters.
+	 * @return the counters.
+	 */
+	ConfigStats Statistics()
+	{
+		return config->Statistics();
+	}
+
+	/**
+	 * Reports the most read keys and the keys never read, see ConfigLoader::ProfileReport.
+	 * @param top largest number of hot keys to report.
+	 * @return the report.
+	 */
+	KeyProfileReport ProfileReport( const size_t top )
+	{
+		return config->ProfileReport( top );
+	}
+
 	~ConfigHandle()
 	{
 		ConfigLoader::CloseConfig( config );
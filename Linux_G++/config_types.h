@@ -11,7 +11,23 @@
 
 #include <map>
 #include <string>
+#include <iterator>
+#include <type_traits>
+#include <utility>
 #include "utility.h"
+#include "arena.h"
+#include "flat_map.h"
+#include "config_key.h"
+#include "config_stats.h"
+#include "key_profile.h"
+
+/** std::map::find accepts keys of other types from C++14, and in Visual Studio 2015. */
+#if __cplusplus >= 201402L || ( defined(_MSC_VER) && _MSC_VER >= 1900 )
+#define CONFIG_TRANSPARENT_LOOKUP
+#endif
+
+class ConfigLoader; /**< Forward declaration, parsers refer to the ConfigLoader they were added to. */
+template <class T> class KeyHandle; /**< Forward declaration, defined in config_loader.h. */
 
 /**
  * Base Class for ConfigLoader Parsers.
@@ -25,6 +41,10 @@ class ParserBase
 public:
 	int auto_key;		  /**< last used auto generated key value. */
 	TSTRING section_name; /**< Name of section this is hooked into. */
+	ParserStatCounters stats; /**< lookup and parse counters, see ConfigLoader::Statistics. */
+	std::unique_ptr<KeyProfile> profile; /**< reads of each key, nullptr unless profiling, see StartProfile. */
+	bool count_lookups; /**< add lookups to stats, set when added to a file opened with CONFIG_LOOKUP_STATS. */
+	ConfigLoader* owner; /**< ConfigLoader the parser was added to, nullptr until it is added, see KeyHandle. */
 
 protected:
 
@@ -35,7 +55,7 @@ protected:
 	 * @param sectionName name of the section being hooked into.
 	 */
 	ParserBase(const TSTRING& sectionName)
-		: auto_key(0)
+		: auto_key(0), count_lookups(false), owner(nullptr)
     {
         section_name = sectionName;
     };
@@ -46,7 +66,57 @@ public:
 	 * @param key key to be used for lookups.
 	 * @param value value to be stored in the dictionary.
 	 */
-	virtual void Parse( const TSTRING& key, const TSTRING& value ) {};
+	virtual void Parse( const TSTRING& key, const TSTRING& value ) { ( void ) key; ( void ) value; }
+
+	/**
+	 * Virtual function which will add to the parsers dictionary, taking ownership of the strings.
+	 * By default passed on to the const version of Parse, parsers that store strings
+	 * can override this to move them into their dictionary rather than copying.
+	 * @param key key to be used for lookups.
+	 * @param value value to be stored in the dictionary.
+	 */
+	virtual void Parse( TSTRING&& key, TSTRING&& value )
+	{
+		Parse( static_cast<const TSTRING&>( key ), static_cast<const TSTRING&>( value ) );
+	}
+
+	/**
+	 * Virtual function which will add to the parsers dictionary from views into the loaded file.
+	 * By default the views are copied once and moved into the rvalue version of Parse,
+	 * parsers can override this to avoid the copies.
+	 * @param key key to be used for lookups.
+	 * @param value value to be stored in the dictionary.
+	 */
+	virtual void Parse( const StringView& key, const StringView& value )
+	{
+		Parse( key.str(), value.str() );
+	}
+
+	/**
+	 * Called by the ConfigLoader when the parser is added, before any entries are parsed.
+	 * Parsers should allocate their storage from the arena, it is released with the ConfigLoader.
+	 * @param arena arena owned by the ConfigLoader the parser is being added to.
+	 */
+	virtual void UseArena( Arena* arena ) { ( void ) arena; }
+
+	/**
+	 * Creates a new, empty parser of the same type for the same section.
+	 * Used by CONFIG_RELOAD to parse a changed file while readers still use this parser,
+	 * parsers that return nullptr keep their existing entries when the file is reloaded.
+	 * @return new parser, owned by the caller, or nullptr if reloading is not supported.
+	 */
+	virtual ParserBase* Create() const
+	{
+		return nullptr;
+	}
+
+	/**
+	 * Starts counting reads of each entry, see KeyProfile.
+	 * Called by the ConfigLoader once the section is parsed when the file was opened with CONFIG_PROFILE,
+	 * must not be called while other threads are reading the parser.
+	 * @param period one read in every period is counted.
+	 */
+	virtual void StartProfile( const UINT32 period ) { ( void ) period; }
 
     /**
      * Function returns the most recent error message from the parser.
@@ -64,6 +134,84 @@ public:
     virtual ~ParserBase() {};
 };
 
+/** String whose charactors are kept in the Arena of the dictionary it belongs to, see Parser::MakeString. */
+typedef std::basic_string<TCHAR, std::char_traits<TCHAR>, ArenaAllocator<TCHAR>> ArenaString;
+
+/**
+ * Whether an item owns no memory outside of the arena its dictionary was given, so destroying it can be skipped.
+ * @tparam ItemType type of the items of a parser.
+ */
+template <class ItemType>
+struct ArenaOwned
+{
+	static const bool value = std::is_trivially_destructible<ItemType>::value;
+};
+
+/**
+ * Strings made with the allocator of the dictionary are kept in its arena.
+ */
+template <>
+struct ArenaOwned<ArenaString>
+{
+	static const bool value = true;
+};
+
+/**
+ * Parser storage which keeps entries in a sorted tree ( std::map ).
+ * Entries are ordered by key.\n
+ * Lookups by view only avoid building a string when CONFIG_TRANSPARENT_LOOKUP is available.
+ */
+struct TreeStorage
+{
+	template <class ItemType>
+	struct Map
+	{
+		typedef std::map<ArenaString, ItemType, StringLess, ArenaAllocator<std::pair<const ArenaString, ItemType>>> Type;
+	};
+
+	/**
+	 * Finds an entry by key.
+	 * @param map map to search.
+	 * @param key key to look for.
+	 * @return iterator to the entry, or end if the key is not stored.
+	 */
+	template <class MapType>
+	static typename MapType::const_iterator Find( const MapType& map, const KeyView& key )
+	{
+#ifdef CONFIG_TRANSPARENT_LOOKUP
+		return map.find( key.View() );
+#else
+		return map.find( ArenaString( key.View().data(), key.View().size() ) );
+#endif
+	}
+};
+
+/**
+ * Parser storage which keeps entries contiguously in a FlatMap.
+ * Entries are ordered as they appear in the file, GetAt is constant time and
+ * lookups are a single hash probe, keys made with CFG_KEY are not hashed again.
+ */
+struct FlatStorage
+{
+	template <class ItemType>
+	struct Map
+	{
+		typedef FlatMap<ArenaString, ItemType> Type;
+	};
+
+	/**
+	 * Finds an entry by key.
+	 * @param map map to search.
+	 * @param key key to look for.
+	 * @return iterator to the entry, or end if the key is not stored.
+	 */
+	template <class MapType>
+	static typename MapType::const_iterator Find( const MapType& map, const KeyView& key )
+	{
+		return map.find( key.View(), key.Hash() );
+	}
+};
+
 /**
  * Templated Base type for Parsers, allows different types of parsers.
  * Only minimum functionality is avaliable in this parser.\n
@@ -71,8 +219,9 @@ public:
  * @note Inherit from this class to create custom parsers.
  *
  * @tparam ItemType type of the item to be stored in this configuration section.
+ * @tparam Storage TreeStorage or FlatStorage, decides the type of the parser dictionary.
  */
-template <class ItemType>
+template <class ItemType, class Storage = TreeStorage>
 class Parser : public ParserBase
 {
 protected:
@@ -81,69 +230,202 @@ protected:
 	 * @param key name of the configuration entry.
 	 * @param value storage for the configuration item.
 	 */
-	typedef std::map<TSTRING, ItemType> MapType;
+	typedef typename Storage::template Map<ItemType>::Type MapType;
+
+	/**
+	 * Allocator for the internal map, uses the heap until the parser is added to a ConfigLoader.
+	 */
+	typedef typename MapType::allocator_type AllocatorType;
 
-	MapType Configuration; /**< Parser Dictionary */
+	/* the dictionary is not destroyed when all of its entries are in an arena, see ~Parser */
+	union
+	{
+		MapType Configuration; /**< Parser Dictionary */
+	};
 
 	/**
 	 * Constructor
 	 * @param sectionName name of the section being hooked into.
 	 */
 	Parser( TSTRING sectionName )
-		: ParserBase( sectionName ) {};
+		: ParserBase( sectionName ), Configuration() {};
 
 public:
+	using ParserBase::Parse;
+
+	/**
+	 * Moves the dictionary into the arena of the ConfigLoader the parser is added to.
+	 * Entries parsed before the parser was added stay on the heap.
+	 * @param arena arena owned by the ConfigLoader.
+	 */
+	virtual void UseArena( Arena* arena )
+	{
+		if ( Configuration.empty() )
+		{
+			Configuration = MapType( AllocatorType( arena ) );
+		}
+	}
+
+	/**
+	 * Starts counting reads of each entry, entries parsed afterwards are not counted.
+	 * @param period one read in every period is counted.
+	 */
+	virtual void StartProfile( const UINT32 period )
+	{
+		profile.reset( new KeyProfile( period, Configuration.size() ) );
+		for ( typename MapType::const_iterator mit = Configuration.begin(); mit != Configuration.end(); ++mit )
+		{
+			profile->Add( &mit->second, StringView( mit->first ).str() );
+		}
+	}
 
 	/**
 	 * Virtual function which will add to the parsers dictionary.
+	 * Custom parsers override this to convert or check entries before storing them.
 	 * @param key key to be used for lookups.
 	 * @param value value to be stored in the dictionary.
 	 */
 	virtual void Parse( const TSTRING& key, const ItemType& value )
 	{
-		if ( Configuration.count( key ) == 0 )
+		Store( MakeString( key ), ItemType( value ) );
+	}
+
+	/**
+	 * Virtual function which will add to the parsers dictionary, taking ownership of the key and value.
+	 * Passed on to the const version of Parse, so parsers overriding that still see every entry.
+	 * @param key key to be used for lookups.
+	 * @param value value to be stored in the dictionary.
+	 */
+	virtual void Parse( TSTRING&& key, ItemType&& value )
+	{
+		Parse( static_cast<const TSTRING&>( key ), static_cast<const ItemType&>( value ) );
+	}
+
+	/**
+	 * Finds an item without copying it.
+	 * @param key key to be used for lookups.
+	 * @return pointer to the stored item, or nullptr when the lookup fails.
+	 */
+	const ItemType* FindItem( const KeyView& key ) const
+	{
+		typename MapType::const_iterator mit = Storage::Find( Configuration, key );
+		if ( mit != Configuration.end() )
+		{
+			if ( count_lookups )
+			{
+				stats.Add( PARSER_HITS );
+			}
+			if ( profile )
+			{
+				profile->Hit( &mit->second );
+			}
+			return &mit->second;
+		}
+		if ( count_lookups )
 		{
-			Configuration[key] = value;
+			stats.Add( PARSER_MISSES );
 		}
-		else
+		if ( profile )
 		{
-			message = TEXT("Duplicate Configuration Key: %s\n") + key;
+			profile->Miss();
 		}
+		return nullptr;
 	}
 
 	/**
 	 * Inner Get function for the Parsers.
 	 * @param key key to be used for lookups.
 	 * @param Default value to return when the key lookup fails.
-	 * @return Item which is either value returned from lookup or Default.
+	 * @return reference to the stored item, or to Default when the lookup fails.
 	 */
-	const ItemType GetItem( const TSTRING& key, const ItemType Default )
+	const ItemType& GetItem( const KeyView& key, const ItemType& Default ) const
 	{
-		if ( Configuration.count( key ) != 0 )
-		{
-			return Configuration[key];
-		}
-		return Default;
+		const ItemType* item = FindItem( key );
+		return ( item != nullptr ) ? *item : Default;
+	}
+
+	/**
+	 * Resolves a key once into a handle that reads the item without a lookup, see KeyHandle.
+	 * Parsers added to a ConfigLoader should be resolved after they are added, so the handle
+	 * follows the section when the file is reloaded.
+	 * @param key key to be used for lookups.
+	 * @param Default value read when the key is not in the section.
+	 * @return handle holding a copy of the item.
+	 */
+	KeyHandle<ItemType> Resolve( const KeyView& key, const ItemType& Default = ItemType() ) const
+	{
+		return KeyHandle<ItemType>( this, key, Default, &Parser::ResolveItem );
 	}
 
 	/**
 	 * Gets the Key of the item at the index specified.
+	 * Constant time with FlatStorage, linear with TreeStorage.
 	 * @param index index to look at for the key.
 	 * @return string containing the key of the item at index.
 	 */
 	TSTRING GetAt( const int index )
 	{
-		int i = index;
-		typename MapType::iterator mit = Configuration.begin();
-		/* maps don't actually have indexes, this is a hack just
-		 * so we can access every element without knowing its key */
-		while ( i && mit != Configuration.end() )
+		if ( index < 0 || static_cast<size_t>( index ) >= Configuration.size() )
 		{
-			++mit;
-			--i;
+			return TEXT("");
 		}
 
-		return ( mit == Configuration.end() ) ? "" : mit->first;
+		/* maps don't actually have indexes, advancing is only a walk for tree storage,
+		 * flat storage iterators are random access */
+		typename MapType::const_iterator mit = Configuration.begin();
+		std::advance( mit, index );
+		return StringView( mit->first ).str();
+	}
+
+	/**
+	 * Destructor, a dictionary in an arena is left for the arena to release when none of its
+	 * items own other memory, rather than freeing every entry.
+	 */
+	virtual ~Parser()
+	{
+		if ( Configuration.get_allocator().arena == nullptr || !ArenaOwned<ItemType>::value )
+		{
+			Configuration.~MapType();
+		}
+	}
+
+protected:
+	/**
+	 * Copies charactors into a string kept with the dictionary, in the arena once the parser is added to a ConfigLoader.
+	 * @param text charactors to copy.
+	 * @return the string.
+	 */
+	ArenaString MakeString( const StringView& text ) const
+	{
+		return ArenaString( text.data(), text.size(), ArenaAllocator<TCHAR>( Configuration.get_allocator() ) );
+	}
+
+	/**
+	 * Moves an entry into the dictionary, a duplicate key keeps the stored entry and sets the message.
+	 * @param key key to be used for lookups.
+	 * @param value value to be stored in the dictionary.
+	 */
+	void Store( ArenaString&& key, ItemType&& value )
+	{
+		/* a duplicate leaves the stored entry, whose key is equal to the one given */
+		std::pair<typename MapType::iterator, bool> added = Configuration.emplace( std::move( key ), std::move( value ) );
+		if ( !added.second )
+		{
+			message = TEXT("Duplicate Configuration Key: ") + StringView( added.first->first ).str();
+		}
+	}
+
+	/**
+	 * Looks up an item for a KeyHandle.
+	 * @param parser parser hooked into the section, of this type.
+	 * @param key key to be used for lookups.
+	 * @param Default value to return when the key lookup fails.
+	 * @return copy of the stored item, or Default.
+	 */
+	static ItemType ResolveItem( const ParserBase* parser, const KeyView& key, const ItemType& Default )
+	{
+		const Parser* typed = dynamic_cast<const Parser*>( parser );
+		return ( typed != nullptr ) ? typed->GetItem( key, Default ) : Default;
 	}
 };
 
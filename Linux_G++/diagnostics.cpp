@@ -0,0 +1,158 @@
+#include "diagnostics.h"
+
+#include <cstddef>
+
+#include "utility.h"
+
+Diagnostic::Diagnostic( const DiagnosticCode code, const TSTRING* file, const StringView& section,
+						const INT64 argument, const UINT64 offset, const UINT32 line )
+	: code( code ), line( line ), offset( offset ), argument( argument ), file( file )
+{
+	const size_t length = ( section.size() < SECTION_CHARS ) ? section.size() : SECTION_CHARS;
+	for ( size_t i = 0; i < length; ++i )
+	{
+		this->section[i] = section[i];
+	}
+	this->section[length] = 0;
+}
+
+
+TSTRING
+Diagnostic::Format() const
+{
+	const TSTRING path = ( file != nullptr ) ? *file : TSTRING();
+	TSTRING message;
+
+	switch ( code )
+	{
+		case DIAG_OPEN_FAILED:
+			message = TEXT("Failed to open config file: ") + path;
+			break;
+		case DIAG_WATCH_FAILED:
+			message = TEXT("Failed to watch config file for changes: ") + path;
+			break;
+		case DIAG_AUTO_KEYS:
+			message = TEXT("AutoKeys Generated for section ") + TSTRING( section ) + TEXT(": ") + util::Int64ToString( argument );
+			break;
+		case DIAG_RELOAD_UNSUPPORTED:
+			message = TEXT("Section ") + TSTRING( section ) + TEXT(" does not support reloading, keeping existing entries");
+			break;
+		case DIAG_UNTERMINATED_SECTION:
+			message = TEXT("Section header missing ']': ") + TSTRING( section );
+			break;
+		case DIAG_EMPTY_KEY:
+			message = TEXT("Entry with an empty key in section ") + TSTRING( section );
+			break;
+		case DIAG_PUBLISH_FAILED:
+			message = TEXT("Failed to publish config file to shared memory: ") + path;
+			break;
+		default:
+			return message;
+	}
+
+	if ( line != 0 )
+	{
+		message += TEXT(" (") + path + TEXT(" line ") + util::Int64ToString( line ) + TEXT(")");
+	}
+	return message;
+}
+
+
+DiagnosticRing::DiagnosticRing( const size_t capacity )
+	: mask( 0 ), dropped( 0 )
+{
+	size_t size = 1;
+	while ( size < capacity )
+	{
+		size <<= 1;
+	}
+
+	slots.reset( new Slot[size] );
+	mask = size - 1;
+	for ( size_t i = 0; i < size; ++i )
+	{
+		slots[i].sequence.store( i, std::memory_order_relaxed );
+	}
+	head.value.store( 0, std::memory_order_relaxed );
+	tail.value.store( 0, std::memory_order_relaxed );
+}
+
+
+bool
+DiagnosticRing::Push( const Diagnostic& record )
+{
+	size_t position = head.value.load( std::memory_order_relaxed );
+	for ( ;; )
+	{
+		Slot& slot = slots[position & mask];
+		const size_t sequence = slot.sequence.load( std::memory_order_acquire );
+		const std::ptrdiff_t difference = static_cast<std::ptrdiff_t>( sequence - position );
+
+		if ( difference == 0 )
+		{
+			/* the slot is free for this position, claim the position */
+			if ( head.value.compare_exchange_weak( position, position + 1, std::memory_order_relaxed ) )
+			{
+				slot.record = record;
+				slot.sequence.store( position + 1, std::memory_order_release );
+				return true;
+			}
+		}
+		else if ( difference < 0 )
+		{
+			/* the slot still holds the record from a lap ago, the ring is full */
+			dropped.fetch_add( 1, std::memory_order_relaxed );
+			return false;
+		}
+		else
+		{
+			position = head.value.load( std::memory_order_relaxed );
+		}
+	}
+}
+
+
+bool
+DiagnosticRing::Pop( Diagnostic& record )
+{
+	size_t position = tail.value.load( std::memory_order_relaxed );
+	for ( ;; )
+	{
+		Slot& slot = slots[position & mask];
+		const size_t sequence = slot.sequence.load( std::memory_order_acquire );
+		const std::ptrdiff_t difference = static_cast<std::ptrdiff_t>( sequence - ( position + 1 ) );
+
+		if ( difference == 0 )
+		{
+			if ( tail.value.compare_exchange_weak( position, position + 1, std::memory_order_relaxed ) )
+			{
+				record = slot.record;
+				/* free the slot for the producer one lap ahead */
+				slot.sequence.store( position + mask + 1, std::memory_order_release );
+				return true;
+			}
+		}
+		else if ( difference < 0 )
+		{
+			return false;
+		}
+		else
+		{
+			position = tail.value.load( std::memory_order_relaxed );
+		}
+	}
+}
+
+
+size_t
+DiagnosticRing::Drain( std::vector<Diagnostic>& records, const size_t max )
+{
+	size_t count = 0;
+	Diagnostic record;
+	while ( count < max && Pop( record ) )
+	{
+		records.push_back( record );
+		++count;
+	}
+	return count;
+}
@@ -0,0 +1,161 @@
+
+#ifndef _DIAGNOSTICS_H_
+#define _DIAGNOSTICS_H_
+
+/**
+ * @file diagnostics.h
+ * File containing the structured diagnostics reported while loading configuration files.
+ */
+
+#include "platform.h"
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "unicode_defines.h"
+#include "string_view.h"
+
+/**
+ * Kinds of diagnostic, each has its own message, see Diagnostic::Format.
+ */
+enum DiagnosticCode
+{
+	DIAG_NONE = 0, /**< empty record. */
+	DIAG_OPEN_FAILED = 1, /**< the config file could not be opened. */
+	DIAG_WATCH_FAILED = 2, /**< the config file could not be watched for changes. */
+	DIAG_AUTO_KEYS = 3, /**< argument entries of section were bare values and given automatic keys. */
+	DIAG_RELOAD_UNSUPPORTED = 4, /**< section changed but its parser cannot be recreated, see ParserBase::Create. */
+	DIAG_UNTERMINATED_SECTION = 5, /**< section header without a closing ']', the rest of the line is the name. */
+	DIAG_EMPTY_KEY = 6, /**< entry of section with nothing before its '='. */
+	DIAG_PUBLISH_FAILED = 7 /**< the config file could not be published in shared memory, see CONFIG_PUBLISH. */
+};
+
+/**
+ * Single diagnostic record.
+ * Records are fixed size and hold no allocations, the message is only built when Format is called.
+ */
+struct Diagnostic
+{
+	static const size_t SECTION_CHARS = 47; /**< longest section name stored, longer names are truncated. */
+	static const UINT64 NO_OFFSET = ~0ull; /**< offset of diagnostics not tied to a position in the file. */
+
+	DiagnosticCode code; /**< kind of diagnostic. */
+	UINT32 line; /**< line number in the file starting from 1, 0 when not tied to a line. */
+	UINT64 offset; /**< byte offset of the line in the file, NO_OFFSET when not tied to a line. */
+	INT64 argument; /**< value specific to the code, see DiagnosticCode. */
+	const TSTRING* file; /**< full path of the file, owned by the ConfigLoader and valid while it is open. */
+	TCHAR section[SECTION_CHARS + 1]; /**< null terminated name of the section, empty when not tied to a section. */
+
+	/**
+	 * Constructor, creates an empty record.
+	 */
+	Diagnostic()
+		: code( DIAG_NONE ), line( 0 ), offset( NO_OFFSET ), argument( 0 ), file( nullptr )
+	{
+		section[0] = 0;
+	}
+
+	/**
+	 * Constructor.
+	 * @param code kind of diagnostic.
+	 * @param file full path of the file, must outlive the record.
+	 * @param section name of the section, truncated to SECTION_CHARS.
+	 * @param argument value specific to the code.
+	 * @param offset byte offset of the line in the file.
+	 * @param line line number in the file.
+	 */
+	Diagnostic( const DiagnosticCode code, const TSTRING* file, const StringView& section = StringView(),
+				const INT64 argument = 0, const UINT64 offset = NO_OFFSET, const UINT32 line = 0 );
+
+	/**
+	 * Builds the message of the record.
+	 * @return human readable message.
+	 */
+	TSTRING Format() const;
+};
+
+/**
+ * Bounded ring of diagnostics, any number of threads may add and remove records without locking.
+ * Each slot carries a sequence number that tells producers and consumers whose turn it is,
+ * so a full ring drops new records rather than waiting, and every drop is counted.
+ */
+class DiagnosticRing
+{
+public:
+	/**
+	 * Constructor.
+	 * @param capacity number of records held, rounded up to a power of two.
+	 */
+	explicit DiagnosticRing( const size_t capacity );
+
+	/**
+	 * Adds a record.
+	 * @param record record to add.
+	 * @return false if the ring was full and the record was dropped.
+	 */
+	bool Push( const Diagnostic& record );
+
+	/**
+	 * Removes the oldest record.
+	 * @param record set to the record removed.
+	 * @return false if the ring was empty.
+	 */
+	bool Pop( Diagnostic& record );
+
+	/**
+	 * Removes records, oldest first.
+	 * @param records vector to append the records to.
+	 * @param max largest number of records to remove.
+	 * @return number of records removed.
+	 */
+	size_t Drain( std::vector<Diagnostic>& records, const size_t max = ~size_t( 0 ) );
+
+	/**
+	 * @return number of records dropped because the ring was full, since it was created.
+	 */
+	UINT64 Dropped() const
+	{
+		return dropped.load( std::memory_order_relaxed );
+	}
+
+	/**
+	 * @return number of records the ring holds.
+	 */
+	size_t Capacity() const
+	{
+		return mask + 1;
+	}
+
+private:
+	DiagnosticRing( const DiagnosticRing& );
+	DiagnosticRing& operator=( const DiagnosticRing& );
+
+	/**
+	 * Slot of the ring.
+	 */
+	struct Slot
+	{
+		std::atomic<size_t> sequence; /**< position the slot is next written at, plus one once it holds a record. */
+		Diagnostic record; /**< the record. */
+	};
+
+	/**
+	 * Position counter, padded rather than aligned so producers and consumers do not share a
+	 * cache line, ConfigLoaders are allocated with new which does not support extended alignment.
+	 */
+	struct Position
+	{
+		std::atomic<size_t> value; /**< the position. */
+		char padding[64 - sizeof( std::atomic<size_t> )]; /**< keeps the next member off of this cache line. */
+	};
+
+	std::unique_ptr<Slot[]> slots; /**< the records. */
+	size_t mask; /**< capacity minus one. */
+	Position head; /**< next position written. */
+	Position tail; /**< next position read. */
+	std::atomic<UINT64> dropped; /**< records dropped while full. */
+};
+
+#endif
@@ -0,0 +1,888 @@
+
+#ifndef _EMBEDDED_CONFIG_H_
+#define _EMBEDDED_CONFIG_H_
+
+/**
+ * @file embedded_config.h
+ * File containing the compile time parser of configuration text embedded in the program.
+ */
+
+#include "platform.h"
+
+#include "unicode_defines.h"
+#include "string_view.h"
+#include "utility.h"
+#include "config_key.h"
+#include "static_config.h"
+
+/**
+ * Compile time parsing of embedded configuration text, see EmbeddedConfig.
+ * Every function is written recursively to stay within C++11 constexpr rules. Searches over the
+ * text and its lines split their range in half, so the recursion depth grows with the log of the
+ * size rather than the size, and tables are expanded from packs of indices.
+ */
+namespace embedded
+{
+
+const size_t NPOS = static_cast<size_t>( -1 ); /**< position used when nothing was found. */
+const size_t MAX_AUTO_KEYS = 999; /**< most bare values in a section, their auto-keys are views into AutoKeyNames. */
+const size_t BLOCK_SIZE = 64; /**< charactors per block of the index used to find lines. */
+const size_t AUTO_KEY_CHARS = 9 + 90 * 2 + 900 * 3; /**< length of the names of auto-keys 1 to MAX_AUTO_KEYS. */
+
+/**
+ * Pack of indices, expanded to build a table one element per index.
+ */
+template <size_t... I>
+struct Indices
+{
+	typedef Indices type;
+};
+
+/**
+ * Joins two packs of indices, the second is offset by the size of the first.
+ */
+template <class First, class Second>
+struct JoinIndices;
+
+template <size_t... A, size_t... B>
+struct JoinIndices<Indices<A...>, Indices<B...>> : Indices<A..., ( sizeof...( A ) + B )...> {};
+
+/**
+ * Indices 0 to N - 1, built by halves so the instantiation depth grows with the log of N.
+ */
+template <size_t N>
+struct MakeIndices : JoinIndices<typename MakeIndices<N / 2>::type, typename MakeIndices<N - N / 2>::type> {};
+
+template <>
+struct MakeIndices<0> : Indices<> {};
+
+template <>
+struct MakeIndices<1> : Indices<0> {};
+
+/**
+ * Types of line, decided by the first charactor as LineScanner does.
+ */
+enum LineKind
+{
+	BLANK_LINE = 0, /**< empty line or ';' comment. */
+	HEADER_LINE = 1, /**< [SECTION] header. */
+	ENTRY_LINE = 2 /**< key = value pair, or a bare value that will be given an auto-key. */
+};
+
+/**
+ * Single line of the text, all positions are offsets from the start of the text.
+ */
+struct Line
+{
+	size_t begin; /**< offset of the first charactor. */
+	size_t end; /**< offset of the line ending, excluding a carriage return. */
+	LineKind kind; /**< type of the line. */
+	size_t split; /**< offset of the first '=' ( or ']' for section headers ), NPOS if not found. */
+	size_t key_begin; /**< start of the trimmed key, or the whole trimmed line when there is no '='. */
+	size_t key_end; /**< end of the trimmed key. */
+	size_t value_begin; /**< start of the trimmed value. */
+	size_t value_end; /**< end of the trimmed value. */
+};
+
+/**
+ * Entry line once its section and auto-key are known.
+ */
+struct Item
+{
+	size_t section; /**< sorted position of the section. */
+	StringView key; /**< key of the entry, or its auto-key. */
+	StringView value; /**< trimmed value of the entry. */
+	bool entry; /**< false for blank lines and headers, whose other members are unused. */
+	size_t auto_key; /**< auto-key of a bare value, zero for other lines. */
+};
+
+/**
+ * @return the middle of the range [begin, end).
+ */
+constexpr size_t
+Middle( const size_t begin, const size_t end )
+{
+	return begin + ( end - begin ) / 2;
+}
+
+
+/**
+ * @return found, unless it is the value meaning nothing was found, then other.
+ */
+constexpr size_t
+Either( const size_t found, const size_t missing, const size_t other )
+{
+	return ( found != missing ) ? found : other;
+}
+
+
+/**
+ * @return true if the charactor is kept by trimming, as util::trim and LineScanner decide.
+ */
+constexpr bool
+IsGraph( const TCHAR c )
+{
+	return static_cast<UINT32>( c ) > 0x20 && static_cast<UINT32>( c ) < 0x7F;
+}
+
+
+/**
+ * @return number of times c appears in [begin, end) of text.
+ */
+constexpr size_t
+Count( const TCHAR* text, const size_t begin, const size_t end, const TCHAR c )
+{
+	return ( end - begin == 0 ) ? 0
+		: ( end - begin == 1 ) ? ( ( text[begin] == c ) ? 1 : 0 )
+		: Count( text, begin, Middle( begin, end ), c ) + Count( text, Middle( begin, end ), end, c );
+}
+
+
+constexpr size_t Nth( const TCHAR* text, const size_t begin, const size_t end, const TCHAR c, const size_t n );
+
+/**
+ * Continues Nth in the half of the range holding the charactor.
+ */
+constexpr size_t
+NthSplit( const TCHAR* text, const size_t begin, const size_t middle, const size_t end, const TCHAR c, const size_t n, const size_t before )
+{
+	return ( n < before ) ? Nth( text, begin, middle, c, n ) : Nth( text, middle, end, c, n - before );
+}
+
+
+/**
+ * @return offset of the nth ( from zero ) c in [begin, end) of text, or end if there are fewer.
+ */
+constexpr size_t
+Nth( const TCHAR* text, const size_t begin, const size_t end, const TCHAR c, const size_t n )
+{
+	return ( end - begin == 0 ) ? end
+		: ( end - begin == 1 ) ? ( ( text[begin] == c && n == 0 ) ? begin : end )
+		: NthSplit( text, begin, Middle( begin, end ), end, c, n, Count( text, begin, Middle( begin, end ), c ) );
+}
+
+
+/**
+ * @return offset of the first graphical charactor in [begin, end) of text, or end if there is none.
+ */
+constexpr size_t
+FirstGraph( const TCHAR* text, const size_t begin, const size_t end )
+{
+	return ( end - begin == 0 ) ? end
+		: ( end - begin == 1 ) ? ( IsGraph( text[begin] ) ? begin : end )
+		: Either( FirstGraph( text, begin, Middle( begin, end ) ), Middle( begin, end ), FirstGraph( text, Middle( begin, end ), end ) );
+}
+
+
+/**
+ * @return offset one past the last graphical charactor in [begin, end) of text, or begin if there is none.
+ */
+constexpr size_t
+LastGraph( const TCHAR* text, const size_t begin, const size_t end )
+{
+	return ( end - begin == 0 ) ? begin
+		: ( end - begin == 1 ) ? ( IsGraph( text[begin] ) ? end : begin )
+		: Either( LastGraph( text, Middle( begin, end ), end ), Middle( begin, end ), LastGraph( text, begin, Middle( begin, end ) ) );
+}
+
+
+/**
+ * @return number of lines in the text, a final line ending starts an empty last line.
+ */
+constexpr size_t
+LineCount( const TCHAR* text, const size_t size )
+{
+	return Count( text, 0, size, TEXT('\n') ) + 1;
+}
+
+
+/**
+ * Builds a line once its type and split are known, keys and values are trimmed.
+ */
+constexpr Line
+ScanLineSplit( const TCHAR* text, const size_t begin, const size_t end, const LineKind kind, const size_t split )
+{
+	return Line{ begin, end, kind, split,
+		FirstGraph( text, begin, ( split == NPOS ) ? end : split ),
+		LastGraph( text, FirstGraph( text, begin, ( split == NPOS ) ? end : split ), ( split == NPOS ) ? end : split ),
+		( split == NPOS ) ? end : FirstGraph( text, split + 1, end ),
+		( split == NPOS ) ? end : LastGraph( text, FirstGraph( text, split + 1, end ), end ) };
+}
+
+
+/**
+ * Builds a line once its type is known.
+ */
+constexpr Line
+ScanLineKind( const TCHAR* text, const size_t begin, const size_t end, const LineKind kind )
+{
+	return ScanLineSplit( text, begin, end, kind,
+		( kind == BLANK_LINE ) ? NPOS : Either( Nth( text, begin, end, ( kind == HEADER_LINE ) ? TEXT(']') : TEXT('='), 0 ), end, NPOS ) );
+}
+
+
+/**
+ * Builds a line once its end is known, the type of line is decided by its first charactor.
+ */
+constexpr Line
+ScanLineBetween( const TCHAR* text, const size_t begin, const size_t end )
+{
+	return ScanLineKind( text, begin, end,
+		( begin == end || text[begin] == TEXT(';') ) ? BLANK_LINE : ( ( text[begin] == TEXT('[') ) ? HEADER_LINE : ENTRY_LINE ) );
+}
+
+
+/**
+ * Builds a line from the offset of its first charactor, removing the carriage return of windows line endings.
+ */
+constexpr Line
+ScanLineAt( const TCHAR* text, const size_t begin, const size_t newline )
+{
+	return ScanLineBetween( text, begin, ( newline > begin && text[newline - 1] == TEXT('\r') ) ? newline - 1 : newline );
+}
+
+
+/**
+ * @return number of blocks of BLOCK_SIZE charactors the text is indexed by, the last may be partial or empty.
+ */
+constexpr size_t
+BlockCount( const size_t size )
+{
+	return size / BLOCK_SIZE + 1;
+}
+
+
+/**
+ * @return offset one past the last charactor of a block.
+ */
+constexpr size_t
+BlockEnd( const size_t size, const size_t block )
+{
+	return ( ( block + 1 ) * BLOCK_SIZE < size ) ? ( block + 1 ) * BLOCK_SIZE : size;
+}
+
+
+/**
+ * @return sum of [begin, end) of values.
+ */
+constexpr size_t
+Sum( const size_t* values, const size_t begin, const size_t end )
+{
+	return ( end - begin == 0 ) ? 0
+		: ( end - begin == 1 ) ? values[begin]
+		: Sum( values, begin, Middle( begin, end ) ) + Sum( values, Middle( begin, end ), end );
+}
+
+
+/**
+ * @return last block in [begin, end) with at most n line endings before it, a binary search as before only grows.
+ */
+constexpr size_t
+FindBlock( const size_t* before, const size_t begin, const size_t end, const size_t n )
+{
+	return ( end - begin <= 1 ) ? begin
+		: ( before[Middle( begin, end )] <= n ) ? FindBlock( before, Middle( begin, end ), end, n ) : FindBlock( before, begin, Middle( begin, end ), n );
+}
+
+
+/**
+ * Continues NthLineEnding within the block holding the line ending.
+ */
+constexpr size_t
+NthLineEndingIn( const TCHAR* text, const size_t size, const size_t* before, const size_t block, const size_t n )
+{
+	return Nth( text, block * BLOCK_SIZE, BlockEnd( size, block ), TEXT('\n'), n - before[block] );
+}
+
+
+/**
+ * @param before line endings before each block of the text.
+ * @return offset of the nth ( from zero ) line ending, or size if there are fewer.
+ */
+constexpr size_t
+NthLineEnding( const TCHAR* text, const size_t size, const size_t* before, const size_t n )
+{
+	return NthLineEndingIn( text, size, before, FindBlock( before, 0, BlockCount( size ), n ), n );
+}
+
+
+/**
+ * @param before line endings before each block of the text.
+ * @return the line at index of the text.
+ */
+constexpr Line
+ScanLine( const TCHAR* text, const size_t size, const size_t* before, const size_t index )
+{
+	return ScanLineAt( text, ( index == 0 ) ? 0 : NthLineEnding( text, size, before, index - 1 ) + 1, NthLineEnding( text, size, before, index ) );
+}
+
+
+/**
+ * @return name of the section used for entries before the first header.
+ */
+constexpr StringView
+DefaultName()
+{
+	return StringView( TEXT("DEFAULT"), 7 );
+}
+
+
+/**
+ * @return name between the brackets of a section header.
+ */
+constexpr StringView
+SectionName( const TCHAR* text, const Line& line )
+{
+	return StringView( text + line.begin + 1, ( ( line.split == NPOS ) ? line.end : line.split ) - line.begin - 1 );
+}
+
+
+/**
+ * @return true if a orders before b, as std::char_traits<TCHAR>::lt does.
+ */
+constexpr bool
+CharLess( const TCHAR a, const TCHAR b )
+{
+	return ( sizeof( TCHAR ) == 1 ) ? ( static_cast<unsigned char>( a ) < static_cast<unsigned char>( b ) ) : ( a < b );
+}
+
+
+constexpr int Compare( const StringView& lhs, const StringView& rhs, const bool fold, const size_t index = 0 );
+
+/**
+ * Continues Compare once the charactors at index are folded.
+ */
+constexpr int
+CompareAt( const StringView& lhs, const StringView& rhs, const bool fold, const size_t index, const TCHAR a, const TCHAR b )
+{
+	return ( a != b ) ? ( CharLess( a, b ) ? -1 : 1 ) : Compare( lhs, rhs, fold, index + 1 );
+}
+
+
+/**
+ * Orders two views as StringView::compare does, or as StaticConfig::Compare does when folding.
+ * @return negative if lhs orders first, zero if equal, otherwise positive.
+ */
+constexpr int
+Compare( const StringView& lhs, const StringView& rhs, const bool fold, const size_t index )
+{
+	return ( index == lhs.size() || index == rhs.size() )
+		? ( ( lhs.size() < rhs.size() ) ? -1 : ( ( lhs.size() > rhs.size() ) ? 1 : 0 ) )
+		: CompareAt( lhs, rhs, fold, index,
+			fold ? util::FoldCase( lhs.data()[index] ) : lhs.data()[index],
+			fold ? util::FoldCase( rhs.data()[index] ) : rhs.data()[index] );
+}
+
+
+/**
+ * @return index of the last header in [begin, end) of lines, or NPOS if there is none.
+ */
+constexpr size_t
+LastHeader( const Line* lines, const size_t begin, const size_t end )
+{
+	return ( end - begin == 0 ) ? NPOS
+		: ( end - begin == 1 ) ? ( ( lines[begin].kind == HEADER_LINE ) ? begin : NPOS )
+		: Either( LastHeader( lines, Middle( begin, end ), end ), NPOS, LastHeader( lines, begin, Middle( begin, end ) ) );
+}
+
+
+/**
+ * @return index of the first header in [begin, end) of lines named name ignoring case, or NPOS if there is none.
+ */
+constexpr size_t
+FirstNamed( const TCHAR* text, const Line* lines, const size_t begin, const size_t end, const StringView& name )
+{
+	return ( end - begin == 0 ) ? NPOS
+		: ( end - begin == 1 ) ? ( ( lines[begin].kind == HEADER_LINE && Compare( SectionName( text, lines[begin] ), name, true ) == 0 ) ? begin : NPOS )
+		: Either( FirstNamed( text, lines, begin, Middle( begin, end ), name ), NPOS, FirstNamed( text, lines, Middle( begin, end ), end, name ) );
+}
+
+
+/**
+ * Sections are numbered by their first header, as repeated headers are merged. DEFAULT, whether
+ * implied before the first header or written, is numbered by the number of lines.
+ * @return number of the section of the header at index.
+ */
+constexpr size_t
+FirstHeader( const TCHAR* text, const Line* lines, const size_t count, const size_t index )
+{
+	return ( lines[index].kind != HEADER_LINE ) ? NPOS
+		: ( Compare( SectionName( text, lines[index] ), DefaultName(), true ) == 0 ) ? count
+		: FirstNamed( text, lines, 0, index + 1, SectionName( text, lines[index] ) );
+}
+
+
+/**
+ * @return number of the section of the last header, DEFAULT when there is none.
+ */
+constexpr size_t
+SectionOfHeader( const size_t* headers, const size_t count, const size_t header )
+{
+	return ( header == NPOS ) ? count : headers[header];
+}
+
+
+/**
+ * @return number of the section that the line at index belongs to, a header belongs to its own section.
+ */
+constexpr size_t
+SectionOf( const Line* lines, const size_t* headers, const size_t count, const size_t index )
+{
+	return SectionOfHeader( headers, count, LastHeader( lines, 0, index + 1 ) );
+}
+
+
+/**
+ * @return true if index numbers a section, see FirstHeader.
+ */
+constexpr bool
+IsSection( const size_t* headers, const size_t count, const size_t index )
+{
+	return index == count || headers[index] == index;
+}
+
+
+/**
+ * @return name of the section numbered index.
+ */
+constexpr StringView
+NameOf( const TCHAR* text, const Line* lines, const size_t count, const size_t index )
+{
+	return ( index == count ) ? DefaultName() : SectionName( text, lines[index] );
+}
+
+
+/**
+ * @return number of sections numbered in [begin, end) that are named before name ignoring case.
+ */
+constexpr size_t
+CountSectionsBefore( const TCHAR* text, const Line* lines, const size_t* headers, const size_t count, const size_t begin, const size_t end, const StringView& name )
+{
+	return ( end - begin == 0 ) ? 0
+		: ( end - begin == 1 ) ? ( ( IsSection( headers, count, begin ) && Compare( NameOf( text, lines, count, begin ), name, true ) < 0 ) ? 1 : 0 )
+		: CountSectionsBefore( text, lines, headers, count, begin, Middle( begin, end ), name ) + CountSectionsBefore( text, lines, headers, count, Middle( begin, end ), end, name );
+}
+
+
+/**
+ * @return sorted position of the section numbered index, or NPOS if index does not number a section.
+ */
+constexpr size_t
+SectionRank( const TCHAR* text, const Line* lines, const size_t* headers, const size_t count, const size_t index )
+{
+	return IsSection( headers, count, index )
+		? CountSectionsBefore( text, lines, headers, count, 0, count + 1, NameOf( text, lines, count, index ) )
+		: NPOS;
+}
+
+
+/**
+ * @return number of sections numbered in [begin, end).
+ */
+constexpr size_t
+CountSections( const Line* lines, const size_t* headers, const size_t count, const size_t begin, const size_t end )
+{
+	return ( end - begin == 0 ) ? 0
+		: ( end - begin == 1 ) ? ( IsSection( headers, count, begin ) ? 1 : 0 )
+		: CountSections( lines, headers, count, begin, Middle( begin, end ) ) + CountSections( lines, headers, count, Middle( begin, end ), end );
+}
+
+
+/**
+ * @return true if the line is a value without a key.
+ */
+constexpr bool
+IsBare( const Line& line )
+{
+	return line.kind == ENTRY_LINE && line.split == NPOS;
+}
+
+
+/**
+ * @return number of bare values in [begin, end) of lines that belong to section.
+ */
+constexpr size_t
+CountBare( const Line* lines, const size_t* sections, const size_t begin, const size_t end, const size_t section )
+{
+	return ( end - begin == 0 ) ? 0
+		: ( end - begin == 1 ) ? ( ( IsBare( lines[begin] ) && sections[begin] == section ) ? 1 : 0 )
+		: CountBare( lines, sections, begin, Middle( begin, end ), section ) + CountBare( lines, sections, Middle( begin, end ), end, section );
+}
+
+
+/**
+ * @return charactor at index of the names of auto-keys 1 to MAX_AUTO_KEYS, written one after another.
+ */
+constexpr TCHAR
+AutoKeyDigit( const size_t index )
+{
+	return static_cast<TCHAR>( TEXT('0') + ( ( index < 9 ) ? ( index + 1 )
+		: ( index < 189 ) ? ( ( 10 + ( index - 9 ) / 2 ) / ( ( ( index - 9 ) % 2 == 0 ) ? 10 : 1 ) % 10 )
+		: ( ( 100 + ( index - 189 ) / 3 ) / ( ( ( index - 189 ) % 3 == 0 ) ? 100 : ( ( ( index - 189 ) % 3 == 1 ) ? 10 : 1 ) ) % 10 ) ) );
+}
+
+
+/**
+ * Names of auto-keys 1 to MAX_AUTO_KEYS, written one after another.
+ */
+template <class I = MakeIndices<AUTO_KEY_CHARS>::type>
+struct AutoKeyNames;
+
+template <size_t... I>
+struct AutoKeyNames<Indices<I...>>
+{
+	static constexpr TCHAR text[] = { AutoKeyDigit( I )... };
+};
+
+template <size_t... I>
+constexpr TCHAR AutoKeyNames<Indices<I...>>::text[];
+
+/**
+ * @return view of the name of an auto-key, empty if it is not between 1 and MAX_AUTO_KEYS.
+ */
+constexpr StringView
+AutoKey( const size_t key )
+{
+	return ( key == 0 || key > MAX_AUTO_KEYS ) ? StringView()
+		: ( key < 10 ) ? StringView( AutoKeyNames<>::text + key - 1, 1 )
+		: ( key < 100 ) ? StringView( AutoKeyNames<>::text + 9 + ( key - 10 ) * 2, 2 )
+		: StringView( AutoKeyNames<>::text + 189 + ( key - 100 ) * 3, 3 );
+}
+
+
+/**
+ * Builds an item once its auto-key is known.
+ */
+constexpr Item
+MakeItemWith( const TCHAR* text, const Line& line, const size_t section, const size_t auto_key )
+{
+	return Item{ section,
+		IsBare( line ) ? AutoKey( auto_key ) : StringView( text + line.key_begin, line.key_end - line.key_begin ),
+		IsBare( line ) ? StringView( text + line.key_begin, line.key_end - line.key_begin ) : StringView( text + line.value_begin, line.value_end - line.value_begin ),
+		line.kind == ENTRY_LINE, auto_key };
+}
+
+
+/**
+ * @return the item of the line at index, bare values are given the next auto-key of their section.
+ */
+constexpr Item
+MakeItem( const TCHAR* text, const Line* lines, const size_t* sections, const size_t* section_ranks, const size_t index )
+{
+	return MakeItemWith( text, lines[index], section_ranks[sections[index]],
+		IsBare( lines[index] ) ? CountBare( lines, sections, 0, index, sections[index] ) + 1 : 0 );
+}
+
+
+/**
+ * @return true if a orders before b, by section and then by key.
+ */
+constexpr bool
+ItemLess( const Item& a, const Item& b )
+{
+	return ( a.section != b.section ) ? ( a.section < b.section ) : ( Compare( a.key, b.key, false ) < 0 );
+}
+
+
+/**
+ * @return true if a and b have the same key in the same section.
+ */
+constexpr bool
+ItemSame( const Item& a, const Item& b )
+{
+	return a.section == b.section && Compare( a.key, b.key, false ) == 0;
+}
+
+
+/**
+ * @return number of entries in [begin, end) of items ordered before the item at index.
+ */
+constexpr size_t
+CountLess( const Item* items, const size_t begin, const size_t end, const size_t index )
+{
+	return ( end - begin == 0 ) ? 0
+		: ( end - begin == 1 ) ? ( ( items[begin].entry && ItemLess( items[begin], items[index] ) ) ? 1 : 0 )
+		: CountLess( items, begin, Middle( begin, end ), index ) + CountLess( items, Middle( begin, end ), end, index );
+}
+
+
+/**
+ * @return number of entries in [begin, end) of items with the same key in the same section as the item at index.
+ */
+constexpr size_t
+CountSame( const Item* items, const size_t begin, const size_t end, const size_t index )
+{
+	return ( end - begin == 0 ) ? 0
+		: ( end - begin == 1 ) ? ( ( items[begin].entry && ItemSame( items[begin], items[index] ) ) ? 1 : 0 )
+		: CountSame( items, begin, Middle( begin, end ), index ) + CountSame( items, Middle( begin, end ), end, index );
+}
+
+
+/**
+ * @return number of entries in [begin, end) of items in sections sorted before rank ( or, when equal, at rank ).
+ */
+constexpr size_t
+CountInSections( const Item* items, const size_t begin, const size_t end, const size_t rank, const bool equal )
+{
+	return ( end - begin == 0 ) ? 0
+		: ( end - begin == 1 ) ? ( ( items[begin].entry && ( equal ? items[begin].section == rank : items[begin].section < rank ) ) ? 1 : 0 )
+		: CountInSections( items, begin, Middle( begin, end ), rank, equal ) + CountInSections( items, Middle( begin, end ), end, rank, equal );
+}
+
+
+/**
+ * @return number of entry lines in [begin, end) of lines.
+ */
+constexpr size_t
+CountEntries( const Line* lines, const size_t begin, const size_t end )
+{
+	return ( end - begin == 0 ) ? 0
+		: ( end - begin == 1 ) ? ( ( lines[begin].kind == ENTRY_LINE ) ? 1 : 0 )
+		: CountEntries( lines, begin, Middle( begin, end ) ) + CountEntries( lines, Middle( begin, end ), end );
+}
+
+
+/**
+ * @return index in [begin, end) of ranks holding rank, or NPOS if there is none.
+ */
+constexpr size_t
+FindRank( const size_t* ranks, const size_t begin, const size_t end, const size_t rank )
+{
+	return ( end - begin == 0 ) ? NPOS
+		: ( end - begin == 1 ) ? ( ( ranks[begin] == rank ) ? begin : NPOS )
+		: Either( FindRank( ranks, begin, Middle( begin, end ), rank ), NPOS, FindRank( ranks, Middle( begin, end ), end, rank ) );
+}
+
+
+/**
+ * @return true if the line at index is malformed, see EmbeddedConfig.
+ */
+constexpr bool
+IsMalformed( const Line* lines, const Item* items, const size_t index )
+{
+	return ( lines[index].kind == HEADER_LINE && lines[index].split == NPOS )
+		|| ( lines[index].kind == ENTRY_LINE && lines[index].split != NPOS && lines[index].key_begin == lines[index].key_end )
+		|| ( IsBare( lines[index] ) && items[index].auto_key > MAX_AUTO_KEYS )
+		|| ( items[index].entry && CountSame( items, 0, index, index ) != 0 );
+}
+
+
+/**
+ * @return index of the first malformed line in [begin, end), or NPOS if there is none.
+ */
+constexpr size_t
+FirstMalformed( const Line* lines, const Item* items, const size_t begin, const size_t end )
+{
+	return ( end - begin == 0 ) ? NPOS
+		: ( end - begin == 1 ) ? ( IsMalformed( lines, items, begin ) ? begin : NPOS )
+		: Either( FirstMalformed( lines, items, begin, Middle( begin, end ) ), NPOS, FirstMalformed( lines, items, Middle( begin, end ), end ) );
+}
+
+
+/**
+ * @return the entry of an item, or an empty entry if there is no item.
+ */
+constexpr StaticEntry
+MakeEntry( const Item* items, const size_t index )
+{
+	return ( index == NPOS ) ? StaticEntry() : StaticEntry{ items[index].key, items[index].value };
+}
+
+
+/**
+ * @return the section sorted at rank, whose entries are its range of the sorted entries.
+ */
+constexpr StaticSection
+MakeSection( const Item* items, const size_t count, const StaticEntry* entries, const StringView& name, const size_t rank )
+{
+	return StaticSection{ name, StaticParser( entries + CountInSections( items, 0, count, rank, false ), CountInSections( items, 0, count, rank, true ) ) };
+}
+
+
+/**
+ * Index of the line endings in each block of the text of Source, used to find lines without searching the whole text.
+ *
+ * @tparam Source type whose static text() and size() give the text.
+ */
+template <class Source, class I = typename MakeIndices<BlockCount( Source::size() )>::type>
+struct TextBlocks;
+
+template <class Source, size_t... I>
+struct TextBlocks<Source, Indices<I...>>
+{
+	static constexpr size_t counts[] = { Count( Source::text(), I * BLOCK_SIZE, BlockEnd( Source::size(), I ), TEXT('\n') )... }; /**< line endings in each block. */
+	static constexpr size_t before[] = { Sum( counts, 0, I )... }; /**< line endings before each block. */
+};
+
+template <class Source, size_t... I>
+constexpr size_t TextBlocks<Source, Indices<I...>>::counts[];
+
+template <class Source, size_t... I>
+constexpr size_t TextBlocks<Source, Indices<I...>>::before[];
+
+/**
+ * Lines of the text of Source, their sections, and the items and order of their entries.
+ *
+ * @tparam Source type whose static text() and size() give the text.
+ */
+template <class Source, class I = typename MakeIndices<LineCount( Source::text(), Source::size() )>::type>
+struct ParsedLines;
+
+template <class Source, size_t... I>
+struct ParsedLines<Source, Indices<I...>>
+{
+	static constexpr size_t count = sizeof...( I ); /**< number of lines. */
+	static constexpr Line lines[] = { ScanLine( Source::text(), Source::size(), TextBlocks<Source>::before, I )... }; /**< the lines. */
+	static constexpr size_t headers[] = { FirstHeader( Source::text(), lines, count, I )... }; /**< section of each header, NPOS for other lines. */
+	static constexpr size_t sections[] = { SectionOf( lines, headers, count, I )... }; /**< section of each line. */
+	static constexpr size_t section_ranks[] = { SectionRank( Source::text(), lines, headers, count, I )...,
+		SectionRank( Source::text(), lines, headers, count, count ) }; /**< sorted position of each section, NPOS for other numbers. */
+	static constexpr size_t section_count = CountSections( lines, headers, count, 0, count + 1 ); /**< number of sections. */
+	static constexpr Item items[] = { MakeItem( Source::text(), lines, sections, section_ranks, I )... }; /**< entry of each line. */
+	static constexpr size_t ranks[] = { items[I].entry ? CountLess( items, 0, count, I ) : NPOS... }; /**< sorted position of each entry. */
+	static constexpr size_t entry_count = CountEntries( lines, 0, count ); /**< number of entries. */
+	static constexpr size_t malformed = FirstMalformed( lines, items, 0, count ); /**< first malformed line, or NPOS. */
+};
+
+template <class Source, size_t... I>
+constexpr Line ParsedLines<Source, Indices<I...>>::lines[];
+
+template <class Source, size_t... I>
+constexpr size_t ParsedLines<Source, Indices<I...>>::headers[];
+
+template <class Source, size_t... I>
+constexpr size_t ParsedLines<Source, Indices<I...>>::sections[];
+
+template <class Source, size_t... I>
+constexpr size_t ParsedLines<Source, Indices<I...>>::section_ranks[];
+
+template <class Source, size_t... I>
+constexpr Item ParsedLines<Source, Indices<I...>>::items[];
+
+template <class Source, size_t... I>
+constexpr size_t ParsedLines<Source, Indices<I...>>::ranks[];
+
+/**
+ * Entries of the text of Source sorted by section and key, followed by an empty entry so the table is never empty.
+ */
+template <class Source, class I = typename MakeIndices<ParsedLines<Source>::entry_count>::type>
+struct EntryTable;
+
+template <class Source, size_t... I>
+struct EntryTable<Source, Indices<I...>>
+{
+	typedef ParsedLines<Source> Parsed;
+
+	static constexpr StaticEntry entries[] = { MakeEntry( Parsed::items, FindRank( Parsed::ranks, 0, Parsed::count, I ) )..., StaticEntry() }; /**< the entries. */
+};
+
+template <class Source, size_t... I>
+constexpr StaticEntry EntryTable<Source, Indices<I...>>::entries[];
+
+/**
+ * Sections of the text of Source sorted by name, each viewing its range of EntryTable.
+ */
+template <class Source, class I = typename MakeIndices<ParsedLines<Source>::section_count>::type>
+struct SectionTable;
+
+template <class Source, size_t... I>
+struct SectionTable<Source, Indices<I...>>
+{
+	typedef ParsedLines<Source> Parsed;
+
+	static constexpr size_t count = sizeof...( I ); /**< number of sections. */
+	static constexpr StaticSection sections[] = { MakeSection( Parsed::items, Parsed::count, EntryTable<Source>::entries,
+		NameOf( Source::text(), Parsed::lines, Parsed::count, FindRank( Parsed::section_ranks, 0, Parsed::count + 1, I ) ), I )... }; /**< the sections. */
+};
+
+template <class Source, size_t... I>
+constexpr StaticSection SectionTable<Source, Indices<I...>>::sections[];
+
+/**
+ * Line number, from one, of the first malformed line of the text of Source, zero if it is well formed.
+ * Can be checked without failing the build, unlike EmbeddedConfig.
+ */
+template <class Source>
+struct ErrorLine
+{
+	static constexpr size_t value = ( ParsedLines<Source>::malformed == NPOS ) ? 0 : ParsedLines<Source>::malformed + 1;
+};
+
+/**
+ * Instantiated with the line number of a malformed line, so the compiler reports the line.
+ */
+template <size_t LineNumber>
+struct MalformedAtLine
+{
+	static const bool value = ( LineNumber == 0 );
+};
+
+}
+
+/**
+ * Configuration text embedded in the program, parsed while it is compiled.
+ * The text follows the grammar of ConfigLoader::LoadFile and AddSection: lines starting with ';'
+ * are comments, [SECTION] headers are case insensitive and repeated headers are merged, lines
+ * before the first header belong to DEFAULT, and keys, values and bare values given auto-keys
+ * are trimmed as they are when loading.\n
+ * Text the loader would report is malformed and fails the build, a header without a closing ']',
+ * an entry with nothing before its '=', a key repeated in a section, or more than
+ * embedded::MAX_AUTO_KEYS bare values in a section. The failing line is given by
+ * embedded::MalformedAtLine in the compiler's message.\n
+ * The result is a StaticConfig over tables built by the compiler, so nothing is parsed or
+ * allocated at startup. Its sections are usually the fallback of a DefaultParser, see
+ * BasicDefaultParser::SetFallback, declared with EMBEDDED_CONFIG.
+ * @code
+ * EMBEDDED_CONFIG( ServerDefaults,
+ * 	"[Server]\n"
+ * 	"port = 8080\n"
+ * 	"timeout = 2.5\n" );
+ *
+ * DefaultParser* server = new DefaultParser( TEXT("Server") );
+ * server->SetFallback( ServerDefaults::Section( CFG_KEY( "Server" ) ) );
+ * @endcode
+ *
+ * @tparam Source type whose static constexpr text() and size() give the text.
+ */
+template <class Source>
+class EmbeddedConfig
+{
+public:
+	static constexpr size_t ERROR_LINE = embedded::ErrorLine<Source>::value; /**< always zero, the build fails otherwise. */
+
+	static_assert( embedded::MalformedAtLine<ERROR_LINE>::value, "Malformed embedded configuration, see the line of MalformedAtLine" );
+
+	static constexpr StaticConfig config = StaticConfig( embedded::SectionTable<Source>::sections, embedded::SectionTable<Source>::count ); /**< the sections. */
+
+	/**
+	 * Finds a section, section names are case insensitive.
+	 * @param section_name name of the section.
+	 * @return entries of the section, or nullptr if there is no such section.
+	 */
+	static const StaticParser* Section( const KeyView& section_name )
+	{
+		return config.GetSection( section_name );
+	}
+};
+
+template <class Source>
+constexpr size_t EmbeddedConfig<Source>::ERROR_LINE;
+
+template <class Source>
+constexpr StaticConfig EmbeddedConfig<Source>::config;
+
+/**
+ * Declares NAME as the EmbeddedConfig of a string literal, which is wrapped in TEXT() as CFG_KEY does.
+ * Adjacent literals are joined, so the text can be written a line at a time.
+ * The text is checked where it is declared, so malformed text fails the build even if NAME is never used.
+ */
+#define EMBEDDED_CONFIG( NAME, str ) \
+	struct NAME##Source \
+	{ \
+		static constexpr const TCHAR* text() { return TEXT( str ); } \
+		static constexpr size_t size() { return CFG_LITERAL_LENGTH( str ); } \
+	}; \
+	typedef EmbeddedConfig<NAME##Source> NAME; \
+	static_assert( NAME::ERROR_LINE == 0, "Malformed embedded configuration " #NAME )
+
+#endif
@@ -0,0 +1,192 @@
+#include "file_watcher.h"
+
+#include <chrono>
+
+#ifndef _WIN32
+#include <poll.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#endif
+
+/** Milliseconds the watcher thread waits between checks that it should still be running. */
+static const unsigned int POLL_INTERVAL = 100;
+
+FileWatcher::FileWatcher()
+	: debounce_ms( 0 ), running( false )
+#ifdef _WIN32
+	, change_handle( INVALID_HANDLE_VALUE )
+#else
+	, inotify_fd( -1 )
+#endif
+{
+}
+
+
+FileWatcher::~FileWatcher()
+{
+	Stop();
+}
+
+
+bool
+FileWatcher::Start( const TSTRING& path, const std::function<void()>& callback, const unsigned int debounce,
+				   const std::function<bool()>& check )
+{
+	Stop();
+
+	TSTRING::size_type slash = path.find_last_of( TEXT("\\/") );
+	if ( slash == TSTRING::npos )
+	{
+		directory = TEXT("");
+		name = path;
+	}
+	else
+	{
+		directory = path.substr( 0, slash + 1 );
+		name = path.substr( slash + 1 );
+	}
+
+	on_change = callback;
+	on_check = check;
+	debounce_ms = debounce;
+
+	const TSTRING watched = directory.empty() ? TSTRING( TEXT(".") ) : directory;
+
+#ifdef _WIN32
+	WIN32_FILE_ATTRIBUTE_DATA attributes;
+	if ( GetFileAttributesEx( path.c_str(), GetFileExInfoStandard, &attributes ) )
+	{
+		last_write = attributes.ftLastWriteTime;
+	}
+	else
+	{
+		last_write.dwLowDateTime = 0;
+		last_write.dwHighDateTime = 0;
+	}
+
+	change_handle = FindFirstChangeNotification( watched.c_str(), FALSE,
+							FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_SIZE );
+	if ( change_handle == INVALID_HANDLE_VALUE )
+	{
+		return false;
+	}
+#else
+	inotify_fd = inotify_init1( IN_NONBLOCK | IN_CLOEXEC );
+	if ( inotify_fd < 0 )
+	{
+		return false;
+	}
+
+	/* editors either write the file in place or move a new file over it */
+	if ( inotify_add_watch( inotify_fd, watched.c_str(), IN_CLOSE_WRITE | IN_MODIFY | IN_MOVED_TO | IN_CREATE ) < 0 )
+	{
+		close( inotify_fd );
+		inotify_fd = -1;
+		return false;
+	}
+#endif
+
+	running = true;
+	thread = std::thread( &FileWatcher::Run, this );
+	return true;
+}
+
+
+void
+FileWatcher::Stop()
+{
+	running = false;
+	if ( thread.joinable() )
+	{
+		thread.join();
+	}
+
+#ifdef _WIN32
+	if ( change_handle != INVALID_HANDLE_VALUE )
+	{
+		FindCloseChangeNotification( change_handle );
+		change_handle = INVALID_HANDLE_VALUE;
+	}
+#else
+	if ( inotify_fd >= 0 )
+	{
+		close( inotify_fd );
+		inotify_fd = -1;
+	}
+#endif
+}
+
+
+void
+FileWatcher::Run()
+{
+	typedef std::chrono::steady_clock Clock;
+
+	bool pending = false;
+	Clock::time_point last_change;
+
+	while ( running.load() )
+	{
+		/* while a change is pending only the rest of the quiet period is waited for */
+		if ( Wait( pending ? debounce_ms : POLL_INTERVAL ) )
+		{
+			pending = true;
+			last_change = Clock::now();
+		}
+		else if ( pending && Clock::now() - last_change >= std::chrono::milliseconds( debounce_ms ) )
+		{
+			pending = false;
+			on_change();
+		}
+		else if ( !pending && on_check && on_check() )
+		{
+			on_change();
+		}
+	}
+}
+
+
+bool
+FileWatcher::Wait( const unsigned int timeout )
+{
+	bool changed = false;
+
+#ifdef _WIN32
+	if ( WaitForSingleObject( change_handle, timeout ) == WAIT_OBJECT_0 )
+	{
+		/* the notification covers the whole directory, only report changes to the watched file */
+		WIN32_FILE_ATTRIBUTE_DATA attributes;
+		if ( GetFileAttributesEx( ( directory + name ).c_str(), GetFileExInfoStandard, &attributes ) &&
+			 CompareFileTime( &attributes.ftLastWriteTime, &last_write ) != 0 )
+		{
+			last_write = attributes.ftLastWriteTime;
+			changed = true;
+		}
+		FindNextChangeNotification( change_handle );
+	}
+#else
+	struct pollfd watch = { inotify_fd, POLLIN, 0 };
+	if ( poll( &watch, 1, static_cast<int>( timeout ) ) <= 0 )
+	{
+		return false;
+	}
+
+	/* events are variable length, the buffer must be aligned for inotify_event */
+	alignas( struct inotify_event ) char events[4096];
+	ssize_t length;
+	while ( ( length = read( inotify_fd, events, sizeof( events ) ) ) > 0 )
+	{
+		for ( char* ptr = events; ptr < events + length; )
+		{
+			const struct inotify_event* event = reinterpret_cast<const struct inotify_event*>( ptr );
+			if ( event->len > 0 && name == event->name )
+			{
+				changed = true;
+			}
+			ptr += sizeof( struct inotify_event ) + event->len;
+		}
+	}
+#endif
+
+	return changed;
+}
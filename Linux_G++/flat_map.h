@@ -0,0 +1,344 @@
+
+#ifndef _FLAT_MAP_H_
+#define _FLAT_MAP_H_
+
+/**
+ * @file flat_map.h
+ * File containing a contiguous hash map used as an alternative Parser dictionary.
+ */
+
+#include <vector>
+#include <string>
+#include <utility>
+
+#include "unicode_defines.h"
+#include "string_view.h"
+#include "utility.h"
+#include "arena.h"
+
+/**
+ * Hash function used by FlatMap, hashes strings and views to the same value.
+ */
+struct StringHash
+{
+	UINT32 operator()( const TSTRING& key ) const
+	{
+		return util::HashString( key.data(), key.size() );
+	}
+
+	UINT32 operator()( const StringView& key ) const
+	{
+		return util::HashString( key.data(), key.size() );
+	}
+};
+
+/**
+ * Key comparison used by FlatMap, compares strings and views charactor by charactor.
+ */
+struct StringEqual
+{
+	bool operator()( const StringView& lhs, const StringView& rhs ) const
+	{
+		return lhs == rhs;
+	}
+};
+
+/**
+ * Case insensitive hash function, ignores ASCII case.
+ */
+struct FoldedHash
+{
+	UINT32 operator()( const StringView& key ) const
+	{
+		return util::HashStringFolded( key.data(), key.size() );
+	}
+};
+
+/**
+ * Case insensitive key comparison, ignores ASCII case.
+ */
+struct FoldedEqual
+{
+	bool operator()( const StringView& lhs, const StringView& rhs ) const
+	{
+		if ( lhs.size() != rhs.size() )
+		{
+			return false;
+		}
+		for ( StringView::size_type i = 0; i < lhs.size(); ++i )
+		{
+			if ( util::FoldCase( lhs[i] ) != util::FoldCase( rhs[i] ) )
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+};
+
+/**
+ * Hash map with its entries stored contiguously in insertion order.
+ * Entries live in a dense array so iteration and indexing are plain array accesses,
+ * and an open addressing table of ( hash, index ) pairs kept at most half full finds
+ * a key in about one probe.\n
+ * Supports the subset of the std::map interface used by parsers, so a Parser can switch
+ * between the two without changing its Parse code.
+ *
+ * @note Entries are never erased, parsers only ever add to their dictionary.
+ * @note Iterators are read only, as changing a key would leave it in the wrong slot,
+ * values are changed with operator[] or mapped_at.
+ *
+ * @tparam Key type of the keys.
+ * @tparam Value type of the stored values.
+ * @tparam Hash function object returning a UINT32 hash of a key.
+ * @tparam Equal function object comparing two keys, must agree with Hash.
+ * @tparam Alloc allocator used for the entries and the table.
+ */
+template <class Key, class Value, class Hash = StringHash, class Equal = StringEqual,
+			class Alloc = ArenaAllocator<std::pair<Key, Value>>>
+class FlatMap
+{
+public:
+	typedef Key key_type;
+	typedef Value mapped_type;
+	typedef std::pair<Key, Value> value_type;
+	typedef Alloc allocator_type;
+
+private:
+	/**
+	 * Slot in the lookup table.
+	 */
+	struct Slot
+	{
+		UINT32 hash; /**< hash of the key, compared before the key itself. */
+		UINT32 index; /**< index of the entry plus one, zero for an empty slot. */
+	};
+
+	typedef std::vector<value_type, Alloc> EntryVector;
+	typedef std::vector<Slot, typename std::allocator_traits<Alloc>::template rebind_alloc<Slot>> SlotVector;
+
+	static const size_t NOT_FOUND = static_cast<size_t>( -1 );
+
+public:
+	typedef typename EntryVector::const_iterator iterator;
+	typedef typename EntryVector::const_iterator const_iterator;
+	typedef typename EntryVector::size_type size_type;
+
+	FlatMap() {}
+
+	/**
+	 * Constructor
+	 * @param alloc allocator to use for the entries and the table.
+	 */
+	explicit FlatMap( const allocator_type& alloc )
+		: entries( alloc ), slots( alloc ) {}
+
+	const_iterator begin() const { return entries.begin(); }
+	const_iterator end() const { return entries.end(); }
+
+	size_type size() const { return entries.size(); }
+	bool empty() const { return entries.empty(); }
+
+	/**
+	 * @param index position of the entry in insertion order, must be less than size.
+	 * @return the entry at index.
+	 */
+	const value_type& at_index( const size_type index ) const
+	{
+		return entries[index];
+	}
+
+	/**
+	 * @param position iterator to an entry of this map.
+	 * @return the value of the entry, which can be changed unlike the entry itself.
+	 */
+	Value& mapped_at( const const_iterator position )
+	{
+		return entries[static_cast<size_type>( position - entries.begin() )].second;
+	}
+
+	/**
+	 * Finds an entry by key.
+	 * @param key key to look for.
+	 * @return iterator to the entry, or end if the key is not stored.
+	 */
+	template <class K>
+	const_iterator find( const K& key ) const
+	{
+		size_t index = Find( key, Hash()( key ) );
+		return ( index == NOT_FOUND ) ? entries.end() : entries.begin() + index;
+	}
+
+	/**
+	 * Finds an entry by key using a hash that has already been computed, see CFG_KEY.
+	 * @param key key to look for.
+	 * @param hash hash of the key, must equal Hash()( key ).
+	 * @return iterator to the entry, or end if the key is not stored.
+	 */
+	template <class K>
+	const_iterator find( const K& key, const UINT32 hash ) const
+	{
+		size_t index = Find( key, hash );
+		return ( index == NOT_FOUND ) ? entries.end() : entries.begin() + index;
+	}
+
+	/**
+	 * @param key key to look for.
+	 * @return 1 if the key is stored, otherwise 0.
+	 */
+	template <class K>
+	size_type count( const K& key ) const
+	{
+		return ( Find( key, Hash()( key ) ) == NOT_FOUND ) ? 0 : 1;
+	}
+
+	/**
+	 * Finds an entry by key, adding a default constructed value if it is not stored.
+	 * @param key key to look for.
+	 * @return reference to the value stored under key.
+	 */
+	Value& operator[]( const Key& key )
+	{
+		return mapped_at( Insert( value_type( key, Value() ) ).first );
+	}
+
+	/**
+	 * Adds an entry if its key is not already stored.
+	 * @param entry key and value to add.
+	 * @return iterator to the entry with the key, and true if the entry was added.
+	 */
+	std::pair<iterator, bool> insert( const value_type& entry )
+	{
+		return Insert( value_type( entry ) );
+	}
+
+	/**
+	 * Adds an entry if its key is not already stored, moving the key and value into the map.
+	 * @param key key to add, left unchanged if it is already stored.
+	 * @param value value to add, left unchanged if the key is already stored.
+	 * @return iterator to the entry with the key, and true if the entry was added.
+	 */
+	std::pair<iterator, bool> emplace( Key&& key, Value&& value )
+	{
+		const UINT32 hash = Hash()( key );
+		size_t index = Find( key, hash );
+		if ( index != NOT_FOUND )
+		{
+			return std::make_pair( entries.begin() + index, false );
+		}
+		return Append( hash, value_type( std::move( key ), std::move( value ) ) );
+	}
+
+	/**
+	 * Removes every entry.
+	 */
+	void clear()
+	{
+		entries.clear();
+		slots.clear();
+	}
+
+	allocator_type get_allocator() const
+	{
+		return entries.get_allocator();
+	}
+
+private:
+	/**
+	 * @param key key to look for.
+	 * @param hash hash of the key.
+	 * @return index of the entry, or NOT_FOUND.
+	 */
+	template <class K>
+	size_t Find( const K& key, const UINT32 hash ) const
+	{
+		if ( slots.empty() )
+		{
+			return NOT_FOUND;
+		}
+
+		const size_t mask = slots.size() - 1;
+		for ( size_t pos = hash & mask; ; pos = ( pos + 1 ) & mask )
+		{
+			const Slot& slot = slots[pos];
+			if ( slot.index == 0 )
+			{
+				return NOT_FOUND;
+			}
+			if ( slot.hash == hash && Equal()( key, entries[slot.index - 1].first ) )
+			{
+				return slot.index - 1;
+			}
+		}
+	}
+
+	/**
+	 * Adds an entry if its key is not already stored.
+	 */
+	std::pair<iterator, bool> Insert( value_type&& entry )
+	{
+		const UINT32 hash = Hash()( entry.first );
+		size_t index = Find( entry.first, hash );
+		if ( index != NOT_FOUND )
+		{
+			return std::make_pair( entries.begin() + index, false );
+		}
+		return Append( hash, std::move( entry ) );
+	}
+
+	/**
+	 * Adds an entry whose key is known not to be stored.
+	 */
+	std::pair<iterator, bool> Append( const UINT32 hash, value_type&& entry )
+	{
+		/* keep the table at most half full so lookups rarely probe more than once */
+		if ( ( entries.size() + 1 ) * 2 > slots.size() )
+		{
+			Grow();
+		}
+
+		entries.push_back( std::move( entry ) );
+		Place( hash, static_cast<UINT32>( entries.size() ) );
+		return std::make_pair( entries.end() - 1, true );
+	}
+
+	/**
+	 * Places an entry into the first free slot for its hash.
+	 */
+	void Place( const UINT32 hash, const UINT32 index )
+	{
+		const size_t mask = slots.size() - 1;
+		size_t pos = hash & mask;
+		while ( slots[pos].index != 0 )
+		{
+			pos = ( pos + 1 ) & mask;
+		}
+		slots[pos].hash = hash;
+		slots[pos].index = index;
+	}
+
+	/**
+	 * Doubles the size of the table and re-places every entry using its stored hash.
+	 */
+	void Grow()
+	{
+		SlotVector old( slots.get_allocator() );
+		Slot empty = { 0, 0 };
+
+		old.swap( slots );
+		slots.assign( old.empty() ? 16 : old.size() * 2, empty );
+
+		for ( size_t i = 0; i < old.size(); ++i )
+		{
+			if ( old[i].index != 0 )
+			{
+				Place( old[i].hash, old[i].index );
+			}
+		}
+	}
+
+	EntryVector entries; /**< entries in insertion order. */
+	SlotVector slots; /**< lookup table, size is always a power of two. */
+};
+
+#endif
@@ -0,0 +1,95 @@
+#include "key_profile.h"
+
+#include <algorithm>
+
+#include "utility.h"
+
+const UINT32 KeyProfile::DEFAULT_PERIOD;
+
+TSTRING
+KeyProfileReport::Format() const
+{
+	TSTRING report = TEXT("Hot keys:\n");
+	for ( size_t i = 0; i < hot.size(); ++i )
+	{
+		report += TEXT("  [") + hot[i].section + TEXT("] ") + hot[i].key + TEXT(" ~") + util::Int64ToString( static_cast<INT64>( hot[i].reads ) ) + TEXT("\n");
+	}
+
+	report += TEXT("Keys never read:\n");
+	for ( size_t i = 0; i < dead.size(); ++i )
+	{
+		report += TEXT("  [") + dead[i].section + TEXT("] ") + dead[i].key + TEXT("\n");
+	}
+
+	report += TEXT("Missing keys looked up: ~") + util::Int64ToString( static_cast<INT64>( misses ) ) + TEXT("\n");
+	return report;
+}
+
+
+KeyProfile::KeyProfile( const UINT32 period, const size_t capacity )
+	: period( ( period > 0 ) ? period : 1 ), count( 0 ), capacity( capacity ), entries( new Entry[capacity] ), missed( 0 )
+{
+	size_t size = 2;
+	while ( size < capacity * 2 )
+	{
+		size <<= 1;
+	}
+
+	table.reset( new Slot[size] );
+	mask = size - 1;
+	for ( size_t s = 0; s < size; ++s )
+	{
+		table[s].item = nullptr;
+		table[s].index = 0;
+	}
+	for ( size_t i = 0; i < capacity; ++i )
+	{
+		entries[i].read.store( false, std::memory_order_relaxed );
+		entries[i].samples.store( 0, std::memory_order_relaxed );
+	}
+}
+
+
+void
+KeyProfile::Add( const void* item, const TSTRING& key )
+{
+	if ( count == capacity || Find( item ) != NOT_FOUND )
+	{
+		return;
+	}
+
+	size_t s = Bucket( item );
+	while ( table[s].item != nullptr )
+	{
+		s = ( s + 1 ) & mask;
+	}
+	table[s].item = item;
+	table[s].index = count;
+	entries[count].key = key;
+	++count;
+}
+
+
+void
+KeyProfile::Collect( const TSTRING& section, KeyProfileReport& report, std::vector<KeyReads>& read ) const
+{
+	for ( size_t i = 0; i < count; ++i )
+	{
+		KeyReads reads;
+		reads.section = section;
+		reads.key = entries[i].key;
+		reads.reads = entries[i].samples.load( std::memory_order_relaxed ) * period;
+
+		if ( entries[i].read.load( std::memory_order_relaxed ) )
+		{
+			/* a key read fewer times than the period may not have been sampled, but was still read */
+			reads.reads = std::max<UINT64>( reads.reads, 1 );
+			read.push_back( reads );
+		}
+		else
+		{
+			report.dead.push_back( reads );
+		}
+	}
+	report.misses += missed.load( std::memory_order_relaxed ) * period;
+}
@@ -0,0 +1,142 @@
+
+#ifndef _LINE_SCANNER_H_
+#define _LINE_SCANNER_H_
+
+/**
+ * @file line_scanner.h
+ * File containing the vectorised line scanner used to split configuration files.
+ */
+
+#include "platform.h"
+
+#include <vector>
+
+#include "unicode_defines.h"
+#include "string_view.h"
+
+/**
+ * Types of line that the LineScanner will emit.
+ * Blank and comment lines are dropped by the scanner and never emitted.
+ */
+enum LineType
+{
+	LINE_ENTRY = 0, /**< key = value pair, or a bare value that will be given an auto-key. */
+	LINE_SECTION = 1 /**< [SECTION] header. */
+};
+
+/**
+ * Single line found by the LineScanner.
+ * All positions are offsets from the start of the line so the record stays small,
+ * views are produced on demand from the contents the line was scanned from.
+ */
+struct ScannedLine
+{
+	static const UINT32 NO_SPLIT = 0xFFFFFFFF; /**< split value used when no split charactor was found. */
+
+	size_t start; /**< offset of the first charactor of the line in the scanned contents. */
+	UINT32 length; /**< length of the line, excluding the line ending. */
+	UINT32 split; /**< offset of the first '=' ( or ']' for section headers ), NO_SPLIT if not found. */
+	UINT32 key_begin; /**< start of the trimmed key, or the whole trimmed line when there is no '='. */
+	UINT32 key_end; /**< end of the trimmed key. */
+	UINT32 value_begin; /**< start of the trimmed value. */
+	UINT32 value_end; /**< end of the trimmed value. */
+	LineType type; /**< type of the line. */
+
+	/**
+	 * @param contents contents the line was scanned from.
+	 * @return view of the entire line.
+	 */
+	StringView Line( const StringView& contents ) const
+	{
+		return contents.substr( start, length );
+	}
+
+	/**
+	 * @param contents contents the line was scanned from.
+	 * @return view of the trimmed key, or of the trimmed line when it has no '='.
+	 */
+	StringView Key( const StringView& contents ) const
+	{
+		return contents.substr( start + key_begin, key_end - key_begin );
+	}
+
+	/**
+	 * @param contents contents the line was scanned from.
+	 * @return view of the trimmed value, empty when the line has no '='.
+	 */
+	StringView Value( const StringView& contents ) const
+	{
+		return contents.substr( start + value_begin, value_end - value_begin );
+	}
+
+	/**
+	 * @param contents contents the line was scanned from.
+	 * @return view of the name between the brackets of a section header.
+	 */
+	StringView SectionName( const StringView& contents ) const
+	{
+		return contents.substr( start + 1, ( split == NO_SPLIT ) ? length - 1 : split - 1 );
+	}
+
+	/**
+	 * @param contents contents the line was scanned from.
+	 * @return offset of the charactor following the line ending.
+	 */
+	size_t NextLine( const StringView& contents ) const
+	{
+		size_t next = start + length;
+		if ( next < contents.size() && contents[next] == '\r' )
+		{
+			next += 1;
+		}
+		if ( next < contents.size() && contents[next] == '\n' )
+		{
+			next += 1;
+		}
+		return next;
+	}
+
+	/**
+	 * @return true if the line contains a key, value split.
+	 */
+	bool HasValue() const
+	{
+		return split != NO_SPLIT;
+	}
+};
+
+/**
+ * Splits configuration file contents into lines and tokens.
+ * Newlines, '=', ']', and non-graphical charactors are classified a block at a time using
+ * SSE2 ( 16 bytes ) or AVX2 ( 32 bytes ) when the processor supports it, and per line only
+ * the resulting bit masks are inspected, so there is no per charactor branching.\n
+ * The scanner follows the same rules as the original line by line loader:
+ * lines starting with ';' are comments, lines starting with '[' are section headers,
+ * and keys and values are trimmed of non-graphical charactors.
+ */
+class LineScanner
+{
+public:
+	/**
+	 * Scans contents and appends every section header and entry line found.
+	 * @param contents charactors to scan.
+	 * @param lines vector to append the scanned lines to.
+	 * @param offset added to the start of every line, used when contents is part of a larger view.
+	 */
+	static void Scan( const StringView& contents, std::vector<ScannedLine>& lines, const size_t offset = 0 );
+
+	/**
+	 * Scans contents and appends only the section headers found.
+	 * Entry lines are skipped over without being split, see Scan.
+	 * @param contents charactors to scan.
+	 * @param lines vector to append the scanned headers to.
+	 */
+	static void ScanSections( const StringView& contents, std::vector<ScannedLine>& lines );
+
+	/**
+	 * @return name of the instruction set used by Scan, for reporting.
+	 */
+	static const TCHAR* InstructionSet();
+};
+
+#endif
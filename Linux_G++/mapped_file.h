@@ -0,0 +1,103 @@
+
+#ifndef _MAPPED_FILE_H_
+#define _MAPPED_FILE_H_
+
+/**
+ * @file mapped_file.h
+ * File containing a read only memory mapping of a configuration file.
+ */
+
+#include "platform.h"
+
+#include <string>
+
+#include "unicode_defines.h"
+#include "string_view.h"
+
+/**
+ * Read only view of an entire file.
+ * The file is memory mapped where possible so that lines can be referred to in place,
+ * if the file can not be mapped ( or the build is unicode and the file must be widened )
+ * it is read into a single buffer owned by this class instead.
+ *
+ * @note Views into the file are valid until Close is called or the class is destroyed.
+ * @warning A mapped file must not be rewritten in place while it is open, truncating it makes reads
+ * past the new end fault and other writes show through the mapping. Pass map as false to Open
+ * for files that may be rewritten.
+ */
+class MappedFile
+{
+public:
+	/**
+	 * Constructor, does nothing.
+	 */
+	MappedFile();
+
+	/**
+	 * Opens and maps a file, closing any file that was previously open.
+	 * @param path full path to the file to open.
+	 * @param map false to read the file into a buffer, so the contents do not change if the file is written in place.
+	 * @return success or failure.
+	 */
+	bool Open( const TSTRING& path, const bool map = true );
+
+	/**
+	 * Unmaps the file and releases any buffers.
+	 */
+	void Close();
+
+	/**
+	 * @return view of the entire contents of the file.
+	 */
+	StringView Contents() const
+	{
+		return StringView( data, size );
+	}
+
+	/**
+	 * @return true if the file is mapped rather than buffered.
+	 */
+	bool IsMapped() const
+	{
+		return mapping != nullptr;
+	}
+
+	/**
+	 * Exchanges the open files of two MappedFiles.
+	 * Offsets into either file remain valid, views may not as a small buffered file can be held inside the class.
+	 * @param other file to swap with.
+	 */
+	void Swap( MappedFile& other );
+
+	/**
+	 * Destructor, closes the file.
+	 */
+	~MappedFile();
+
+private:
+	/* mappings can not be shared between owners */
+	MappedFile( const MappedFile& );
+	MappedFile& operator=( const MappedFile& );
+
+	/**
+	 * Reads the file into the internal buffer, used when mapping is not possible.
+	 * @param path full path to the file to read.
+	 * @return success or failure.
+	 */
+	bool ReadFile( const TSTRING& path );
+
+	const TCHAR* data; /**< start of the file contents. */
+	size_t size; /**< number of charactors in the file. */
+
+	void* mapping; /**< start of the mapped view, nullptr if not mapped. */
+	size_t mapping_size; /**< size in bytes of the mapped view. */
+
+#ifdef _WIN32
+	HANDLE file_handle; /**< handle of the open file. */
+	HANDLE map_handle; /**< handle of the file mapping object. */
+#endif
+
+	TSTRING buffer; /**< file contents when the file could not be mapped. */
+};
+
+#endif
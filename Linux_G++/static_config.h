@@ -0,0 +1,227 @@
+
+#ifndef _STATIC_CONFIG_H_
+#define _STATIC_CONFIG_H_
+
+/**
+ * @file static_config.h
+ * File containing the read only tables of configuration files compiled into the program,
+ * see ConfigHeader and EmbeddedConfig.
+ */
+
+#include "platform.h"
+
+#include <string>
+#include <algorithm>
+
+#include "unicode_defines.h"
+#include "string_view.h"
+#include "utility.h"
+#include "config_key.h"
+
+/**
+ * Entry of a compiled section, bare values have already been given their auto-key.
+ */
+struct StaticEntry
+{
+	StringView key; /**< key of the entry. */
+	StringView value; /**< trimmed value of the entry. */
+};
+
+/**
+ * Read only parser over a table of entries sorted by key, with the getters of DefaultParser.
+ * The table is built at compile time, so nothing is read, parsed or allocated at startup.
+ */
+class StaticParser
+{
+public:
+	/**
+	 * Constructor
+	 * @param entries entries sorted by StringView::compare of their keys, each key once.
+	 * @param count number of entries.
+	 */
+	constexpr StaticParser( const StaticEntry* entries, const size_t count )
+		: entries( entries ), count( count ) {}
+
+	/**
+	 * Finds an entry by key with a binary search.
+	 * @param key key to look for.
+	 * @return the entry, or nullptr if the key is not in the table.
+	 */
+	const StaticEntry* FindItem( const KeyView& key ) const
+	{
+		const StaticEntry* last = entries + count;
+		const StaticEntry* found = std::lower_bound( entries, last, key.View(),
+			[]( const StaticEntry& entry, const StringView& name ) { return entry.key.compare( name ) < 0; } );
+		return ( found != last && found->key == key.View() ) ? found : nullptr;
+	}
+
+	/**
+	 * Gets a string from the table.
+	 * @param key key to use when looking for a value in the table.
+	 * @param Default value to return when the key lookup fails.
+	 * @return string which is either value returned from lookup or Default.
+	 */
+	TSTRING getString( const KeyView& key, const TSTRING& Default ) const
+	{
+		const StaticEntry* entry = FindItem( key );
+		return ( entry != nullptr ) ? entry->value.str() : Default;
+	}
+
+	/**
+	 * Gets a view of a string in the table, without copying it.
+	 * @param key key to use when looking for a value in the table.
+	 * @param Default value to return when the key lookup fails.
+	 * @return view of either the stored value or Default.
+	 */
+	StringView getStringView( const KeyView& key, const StringView& Default = StringView() ) const
+	{
+		const StaticEntry* entry = FindItem( key );
+		return ( entry != nullptr ) ? entry->value : Default;
+	}
+
+	/**
+	 * Gets an Int16 from the table.
+	 * @param key key to use when looking for a value in the table.
+	 * @param Default value to return when the key lookup fails.
+	 * @return either the converted value or Default.
+	 */
+	INT16 getInt16( const KeyView& key, const INT16 Default ) const
+	{
+		const StaticEntry* entry = FindItem( key );
+		return ( entry != nullptr && !entry->value.empty() ) ? util::StringToInt16( entry->value ) : Default;
+	}
+
+	/**
+	 * Gets an Int32 from the table.
+	 * @param key key to use when looking for a value in the table.
+	 * @param Default value to return when the key lookup fails.
+	 * @return either the converted value or Default.
+	 */
+	INT32 getInt32( const KeyView& key, const INT32 Default ) const
+	{
+		const StaticEntry* entry = FindItem( key );
+		return ( entry != nullptr && !entry->value.empty() ) ? util::StringToInt32( entry->value ) : Default;
+	}
+
+	/**
+	 * Gets an Int64 from the table.
+	 * @param key key to use when looking for a value in the table.
+	 * @param Default value to return when the key lookup fails.
+	 * @return either the converted value or Default.
+	 */
+	INT64 getInt64( const KeyView& key, const INT64 Default ) const
+	{
+		const StaticEntry* entry = FindItem( key );
+		return ( entry != nullptr && !entry->value.empty() ) ? util::StringToInt64( entry->value ) : Default;
+	}
+
+	/**
+	 * Gets a double from the table.
+	 * @param key key to use when looking for a value in the table.
+	 * @param Default value to return when the key lookup fails.
+	 * @return either the converted value or Default.
+	 */
+	double getDouble( const KeyView& key, const double Default ) const
+	{
+		const StaticEntry* entry = FindItem( key );
+		return ( entry != nullptr && !entry->value.empty() ) ? util::StringToDouble( entry->value ) : Default;
+	}
+
+	/**
+	 * Gets the key of the entry at an index, entries are in key order.
+	 * @param index index to look at for the key.
+	 * @return string containing the key of the entry at index.
+	 */
+	TSTRING GetAt( const int index ) const
+	{
+		if ( index < 0 || static_cast<size_t>( index ) >= count )
+		{
+			return TEXT("");
+		}
+		return entries[index].key.str();
+	}
+
+	/**
+	 * @return number of entries.
+	 */
+	constexpr size_t Size() const
+	{
+		return count;
+	}
+
+private:
+	const StaticEntry* entries; /**< the entries, sorted by key. */
+	size_t count; /**< number of entries. */
+};
+
+/**
+ * Compiled section, found by name ignoring case.
+ */
+struct StaticSection
+{
+	StringView name; /**< name of the section. */
+	StaticParser parser; /**< entries of the section. */
+};
+
+/**
+ * Read only table of the sections of a compiled configuration file, sorted by name.
+ */
+class StaticConfig
+{
+public:
+	/**
+	 * Constructor
+	 * @param sections sections sorted by Compare of their names.
+	 * @param count number of sections.
+	 */
+	constexpr StaticConfig( const StaticSection* sections, const size_t count )
+		: sections( sections ), count( count ) {}
+
+	/**
+	 * Finds a section, section names are case insensitive as they are in ConfigLoader.
+	 * @param section_name name of the section.
+	 * @return parser of the section, or nullptr if there is no such section.
+	 */
+	const StaticParser* GetSection( const KeyView& section_name ) const
+	{
+		const StaticSection* last = sections + count;
+		const StaticSection* found = std::lower_bound( sections, last, section_name.View(),
+			[]( const StaticSection& section, const StringView& name ) { return Compare( section.name, name ) < 0; } );
+		return ( found != last && Compare( found->name, section_name.View() ) == 0 ) ? &found->parser : nullptr;
+	}
+
+	/**
+	 * @return number of sections.
+	 */
+	constexpr size_t Size() const
+	{
+		return count;
+	}
+
+	/**
+	 * Orders section names ignoring ASCII case, the order the sections are sorted in.
+	 * @param lhs name to compare.
+	 * @param rhs name to compare to.
+	 * @return negative if lhs orders first, zero if equal, otherwise positive.
+	 */
+	static int Compare( const StringView& lhs, const StringView& rhs )
+	{
+		const size_t length = ( lhs.size() < rhs.size() ) ? lhs.size() : rhs.size();
+		for ( size_t i = 0; i < length; ++i )
+		{
+			const TCHAR a = util::FoldCase( lhs[i] );
+			const TCHAR b = util::FoldCase( rhs[i] );
+			if ( a != b )
+			{
+				return std::char_traits<TCHAR>::lt( a, b ) ? -1 : 1;
+			}
+		}
+		return ( lhs.size() < rhs.size() ) ? -1 : ( ( lhs.size() > rhs.size() ) ? 1 : 0 );
+	}
+
+private:
+	const StaticSection* sections; /**< the sections, sorted by name. */
+	size_t count; /**< number of sections. */
+};
+
+#endif
@@ -5,14 +5,43 @@
 #include <functional> 
 #include <cctype>
 #include <locale>
+#include <limits>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+
+#if defined( _MSC_VER ) && defined( _M_X64 )
+#include <intrin.h>
+#endif
+
+/**
+ * Case folding uses SSE2 for narrow charactors on x86 processors that have it.
+ */
+#if !defined( _UNICODE ) && ( defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 ) )
+#define UTIL_SSE2_FOLD
+#include <emmintrin.h>
+#endif
+
+#include "float_tables.h"
 
 namespace util
 {
 
+/**
+ * @param c charactor to check.
+ * @return true if c is a graphical charactor.
+ */
+static bool
+IsGraph( const TCHAR c )
+{
+	return std::isgraph( c ) != 0;
+}
+
+
 TSTRING&
 left_trim( TSTRING& s )
 {
-	s.erase( s.begin(), std::find_if( s.begin(), s.end(), std::ptr_fun<int, int>( std::isgraph ) ) );
+	s.erase( s.begin(), std::find_if( s.begin(), s.end(), IsGraph ) );
 	return s;
 }
 
@@ -20,7 +49,7 @@ left_trim( TSTRING& s )
 TSTRING&
 right_trim( TSTRING& s )
 {
-	s.erase( std::find_if( s.rbegin(), s.rend(), std::ptr_fun<int, int>( std::isgraph ) ).base(), s.end() );
+	s.erase( std::find_if( s.rbegin(), s.rend(), IsGraph ).base(), s.end() );
 	return s;
 }
 
@@ -32,65 +61,1116 @@ trim( TSTRING& s )
 }
 
 
+StringView
+trim( const StringView& s )
+{
+	StringView::const_iterator first = std::find_if( s.begin(), s.end(), IsGraph );
+	StringView::const_iterator last = s.end();
+
+	while ( last != first && !IsGraph( *( last - 1 ) ) )
+	{
+		--last;
+	}
+
+	return StringView( first, last - first );
+}
+
+
+void
+FoldCaseInPlace( TCHAR* str, const size_t size )
+{
+	size_t i = 0;
+#ifdef UTIL_SSE2_FOLD
+	/* charactors above 0x7F compare as negative, so only 'a' to 'z' are in range */
+	const __m128i before = _mm_set1_epi8( 'a' - 1 );
+	const __m128i after = _mm_set1_epi8( 'z' + 1 );
+	const __m128i difference = _mm_set1_epi8( 'a' - 'A' );
+	for ( ; i + 16 <= size; i += 16 )
+	{
+		__m128i v = _mm_loadu_si128( reinterpret_cast<const __m128i*>( str + i ) );
+		__m128i lower = _mm_and_si128( _mm_cmpgt_epi8( v, before ), _mm_cmplt_epi8( v, after ) );
+		v = _mm_sub_epi8( v, _mm_and_si128( lower, difference ) );
+		_mm_storeu_si128( reinterpret_cast<__m128i*>( str + i ), v );
+	}
+#endif
+	for ( ; i < size; ++i )
+	{
+		str[i] = FoldCase( str[i] );
+	}
+}
+
+
 TSTRING
-Int64ToString( const INT64 num )
+FoldedString( const StringView& str )
 {
-	INT64 i = 0;
-	INT64 p_num = num;
+	TSTRING folded( str.data(), str.size() );
+	FoldCaseInPlace( &folded[0], folded.size() );
+	return folded;
+}
+
+
+/**
+ * SWAR digit parsing reads eight narrow charactors as one little endian 64 bit word.
+ */
+#if !defined( _UNICODE ) && ( defined( _WIN32 ) || ( defined( __BYTE_ORDER__ ) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__ ) )
+#define UTIL_SWAR_DIGITS
+#endif
+
+/**
+ * Double arithmetic is exactly rounded to 53 bits, without the wider intermediates of x87.
+ */
+#if defined( _M_X64 ) || defined( __x86_64__ ) || defined( __aarch64__ ) || defined( _M_ARM64 ) || \
+	( defined( __FLT_EVAL_METHOD__ ) && __FLT_EVAL_METHOD__ == 0 )
+#define UTIL_EXACT_DOUBLE_ARITHMETIC
+#endif
+
+/** Every pair of base 10 digits from "00" to "99", so numbers are formatted two digits per division. */
+static const char DIGIT_PAIRS[] = "00010203040506070809101112131415161718192021222324252627282930313233343536373839404142434445464748495051525354555657585960616263646566676869707172737475767778798081828384858687888990919293949596979899";
+
+size_t
+FormatUInt64( UINT64 num, TCHAR* buffer )
+{
+	TCHAR digits[INT64_MAX_CHARS];
+	TCHAR* ptr = digits + INT64_MAX_CHARS;
+
+	while ( num >= 100 )
+	{
+		const size_t pair = static_cast<size_t>( num % 100 ) * 2;
+		num /= 100;
+		*--ptr = static_cast<TCHAR>( DIGIT_PAIRS[pair + 1] );
+		*--ptr = static_cast<TCHAR>( DIGIT_PAIRS[pair] );
+	}
+
+	if ( num >= 10 )
+	{
+		const size_t pair = static_cast<size_t>( num ) * 2;
+		*--ptr = static_cast<TCHAR>( DIGIT_PAIRS[pair + 1] );
+		*--ptr = static_cast<TCHAR>( DIGIT_PAIRS[pair] );
+	}
+	else
+	{
+		*--ptr = static_cast<TCHAR>( TEXT('0') + num );
+	}
 
-	int neg = 0;
-	int digits = 0;
+	const size_t length = static_cast<size_t>( digits + INT64_MAX_CHARS - ptr );
+	std::copy( ptr, digits + INT64_MAX_CHARS, buffer );
+	return length;
+}
 
-	TSTRING str( TEXT("0") );
 
+size_t
+FormatInt64( const INT64 num, TCHAR* buffer )
+{
 	if ( num < 0 )
 	{
-		neg = 1;
-		p_num = -num;
+		/* negate unsigned so the smallest Int64 does not overflow */
+		buffer[0] = TEXT('-');
+		return 1 + FormatUInt64( 0 - static_cast<UINT64>( num ), buffer + 1 );
+	}
+	return FormatUInt64( static_cast<UINT64>( num ), buffer );
+}
+
+
+TSTRING
+Int64ToString( const INT64 num )
+{
+	TCHAR buffer[INT64_MAX_CHARS];
+	return TSTRING( buffer, FormatInt64( num, buffer ) );
+}
+
+
+/**
+ * @param c charactor to convert.
+ * @return value of c as a digit of any base up to 36, or 36 if it is not a digit.
+ */
+static inline unsigned int
+DigitValue( const TCHAR c )
+{
+	if ( c >= TEXT('0') && c <= TEXT('9') )
+	{
+		return static_cast<unsigned int>( c - TEXT('0') );
+	}
+	if ( c >= TEXT('a') && c <= TEXT('z') )
+	{
+		return static_cast<unsigned int>( c - TEXT('a') ) + 10;
+	}
+	if ( c >= TEXT('A') && c <= TEXT('Z') )
+	{
+		return static_cast<unsigned int>( c - TEXT('A') ) + 10;
+	}
+	return 36;
+}
+
+
+#ifdef UTIL_SWAR_DIGITS
+/**
+ * @param chunk eight charactors read as a little endian word.
+ * @return true if all eight charactors are '0' to '9'.
+ */
+static inline bool
+IsEightDigits( const UINT64 chunk )
+{
+	/* digits are 0x30 to 0x39, adding 6 must not carry out of the low nibble */
+	return ( ( chunk & 0xF0F0F0F0F0F0F0F0ull ) |
+			 ( ( ( chunk + 0x0606060606060606ull ) & 0xF0F0F0F0F0F0F0F0ull ) >> 4 ) ) == 0x3333333333333333ull;
+}
+
+
+/**
+ * @param chunk eight digit charactors read as a little endian word.
+ * @return value of the eight digits, combined in pairs, then fours, then eights.
+ */
+static inline UINT32
+EightDigitsValue( UINT64 chunk )
+{
+	chunk -= 0x3030303030303030ull;
+	chunk = ( chunk * 10 ) + ( chunk >> 8 );
+	chunk = ( ( ( chunk & 0x000000FF000000FFull ) * ( 100 + ( 1000000ull << 32 ) ) ) +
+			  ( ( ( chunk >> 16 ) & 0x000000FF000000FFull ) * ( 1 + ( 10000ull << 32 ) ) ) ) >> 32;
+	return static_cast<UINT32>( chunk );
+}
+#endif
+
+
+/**
+ * Parses the base 10 digits at the start of a run of charactors.
+ * @param ptr first charactor to parse.
+ * @param last one past the last charactor.
+ * @param magnitude set to the value of the digits.
+ * @return one past the last digit, or nullptr if the value does not fit in 64 bits.
+ */
+static const TCHAR*
+ParseDecimal( const TCHAR* ptr, const TCHAR* last, UINT64& magnitude )
+{
+	while ( ptr != last && *ptr == TEXT('0') )
+	{
+		++ptr;
+	}
+
+	/* any 19 digits fit in 64 bits, only a 20th digit has to be checked */
+	const TCHAR* checked = ptr + ( ( last - ptr < 19 ) ? ( last - ptr ) : 19 );
+	UINT64 value = 0;
+
+#ifdef UTIL_SWAR_DIGITS
+	while ( checked - ptr >= 8 )
+	{
+		UINT64 chunk;
+		std::memcpy( &chunk, ptr, sizeof( chunk ) );
+		if ( !IsEightDigits( chunk ) )
+		{
+			break;
+		}
+		value = ( value * 100000000 ) + EightDigitsValue( chunk );
+		ptr += 8;
+	}
+#endif
+
+	unsigned int digit;
+	while ( ptr != checked && ( digit = DigitValue( *ptr ) ) < 10 )
+	{
+		value = ( value * 10 ) + digit;
+		++ptr;
+	}
+
+	if ( ptr == checked && ptr != last && ( digit = DigitValue( *ptr ) ) < 10 )
+	{
+		if ( value > ( ~0ull - digit ) / 10 )
+		{
+			return nullptr;
+		}
+		value = ( value * 10 ) + digit;
+		if ( ++ptr != last && DigitValue( *ptr ) < 10 )
+		{
+			return nullptr;
+		}
+	}
+
+	magnitude = value;
+	return ptr;
+}
+
+
+/**
+ * Parses a sign, base prefix and digits, the way strtol does without skipping whitespace.
+ * @param first first charactor to parse.
+ * @param last one past the last charactor.
+ * @param base number system to parse from, 0 to detect it from the prefix.
+ * @param magnitude set to the value of the digits.
+ * @param negative set to true if there was a '-' sign.
+ * @return one past the last charactor parsed, or nullptr if there were no digits or the value does not fit in 64 bits.
+ */
+static const TCHAR*
+ParseDigits( const TCHAR* first, const TCHAR* last, int base, UINT64& magnitude, bool& negative )
+{
+	if ( base == 1 || base < 0 || base > 36 )
+	{
+		return nullptr;
+	}
+
+	const TCHAR* ptr = first;
+	negative = false;
+	if ( ptr != last && ( *ptr == TEXT('-') || *ptr == TEXT('+') ) )
+	{
+		negative = ( *ptr == TEXT('-') );
+		++ptr;
+	}
+
+	if ( ( base == 0 || base == 16 ) && last - ptr > 2 && ptr[0] == TEXT('0') &&
+		 ( ptr[1] == TEXT('x') || ptr[1] == TEXT('X') ) && DigitValue( ptr[2] ) < 16 )
+	{
+		ptr += 2;
+		base = 16;
+	}
+	else if ( base == 0 )
+	{
+		base = ( ptr != last && *ptr == TEXT('0') ) ? 8 : 10;
 	}
 
-	for ( i = 1; i <= p_num; i *= 10 )
+	const TCHAR* digits = ptr;
+	if ( base == 10 )
 	{
-		digits += 1;
+		ptr = ParseDecimal( ptr, last, magnitude );
 	}
+	else
+	{
+		const UINT64 limit = ~0ull / static_cast<unsigned int>( base );
+		UINT64 value = 0;
+		unsigned int digit;
+		for ( ; ptr != last && ( digit = DigitValue( *ptr ) ) < static_cast<unsigned int>( base ); ++ptr )
+		{
+			if ( value > limit || ( value == limit && digit > ~0ull % static_cast<unsigned int>( base ) ) )
+			{
+				return nullptr;
+			}
+			value = ( value * static_cast<unsigned int>( base ) ) + digit;
+		}
+		magnitude = value;
+	}
+
+	return ( ptr == digits ) ? nullptr : ptr;
+}
 
-	if ( digits > 0 )
+
+/**
+ * Skips the whitespace strtol and strtod skip in the C locale.
+ * @param first first charactor to check.
+ * @param last one past the last charactor.
+ * @return first charactor that is not whitespace, or last.
+ */
+static inline const TCHAR*
+SkipSpace( const TCHAR* first, const TCHAR* last )
+{
+	while ( first != last && ( *first == TEXT(' ') || ( *first >= TEXT('\t') && *first <= TEXT('\r') ) ) )
 	{
-		str.resize( digits + neg );
+		++first;
+	}
+	return first;
+}
 
-		if ( neg ) str[0] = '0';
 
-		for ( ; p_num > 0; digits -= 1 )
+/**
+ * Applies a sign to a parsed magnitude if the result fits in T.
+ * @param magnitude value of the digits.
+ * @param negative true if there was a '-' sign.
+ * @param value set to the signed number, unchanged if it does not fit.
+ * @return true if the number fits in T.
+ */
+template<typename T> static bool
+ToSigned( const UINT64 magnitude, const bool negative, T& value )
+{
+	const UINT64 max = static_cast<UINT64>( std::numeric_limits<T>::max() );
+	if ( negative )
+	{
+		if ( magnitude > max + 1 )
 		{
-			str[digits] = '0' + ( p_num % 10 );
-			p_num = (INT64) ( p_num * 0.1 );
+			return false;
 		}
+		value = ( magnitude == max + 1 ) ? std::numeric_limits<T>::min() : static_cast<T>( -static_cast<T>( magnitude ) );
+	}
+	else
+	{
+		if ( magnitude > max )
+		{
+			return false;
+		}
+		value = static_cast<T>( magnitude );
+	}
+	return true;
+}
+
+
+/**
+ * Parses the whole of a view into a signed integer.
+ * @param str view to parse.
+ * @param value set to the parsed number on success.
+ * @param base number system to parse from.
+ * @return false if the view is not a number or the number does not fit in T.
+ */
+template<typename T> static bool
+ParseSigned( const StringView& str, T& value, const int base )
+{
+	const TCHAR* last = str.data() + str.size();
+	UINT64 magnitude;
+	bool negative;
+
+	const TCHAR* end = ParseDigits( str.data(), last, base, magnitude, negative );
+	return end != nullptr && end == last && ToSigned( magnitude, negative, value );
+}
+
+
+/**
+ * Parses the number at the start of a view into a signed integer, the way strtol does.
+ * @param str view to parse.
+ * @param base number system to parse from.
+ * @return the parsed number, 0 on failure or if it does not fit in T.
+ */
+template<typename T> static T
+StringToSigned( const StringView& str, const int base )
+{
+	const TCHAR* last = str.data() + str.size();
+	const TCHAR* first = SkipSpace( str.data(), last );
+
+	T value = 0;
+	UINT64 magnitude;
+	bool negative;
+	if ( ParseDigits( first, last, base, magnitude, negative ) != nullptr )
+	{
+		ToSigned( magnitude, negative, value );
 	}
+	return value;
+}
+
 
-	return str;
+bool
+ParseInt16( const StringView& str, INT16& value, const int base )
+{
+	return ParseSigned( str, value, base );
+}
+
+
+bool
+ParseInt32( const StringView& str, INT32& value, const int base )
+{
+	return ParseSigned( str, value, base );
 }
 
 
+bool
+ParseInt64( const StringView& str, INT64& value, const int base )
+{
+	return ParseSigned( str, value, base );
+}
+
 
 INT16
-StringToInt16( const TSTRING& str, const int base )
+StringToInt16( const StringView& str, const int base )
 {
-	return static_cast<INT16>( StringToInt64(str, base) );
+	return StringToSigned<INT16>( str, base );
 }
 
 
 INT32
-StringToInt32( const TSTRING& str, const int base )
+StringToInt32( const StringView& str, const int base )
 {
-	return static_cast<INT32>( StringToInt64(str, base) );
+	return StringToSigned<INT32>( str, base );
 }
 
 
 INT64
-StringToInt64( const TSTRING& str, const int base )
+StringToInt64( const StringView& str, const int base )
+{
+	return StringToSigned<INT64>( str, base );
+}
+
+/**
+ * Multiplies two 64 bit numbers into a 128 bit product.
+ * @param a first number.
+ * @param b second number.
+ * @param high set to the high 64 bits of the product.
+ * @return low 64 bits of the product.
+ */
+static inline UINT64
+Multiply128( const UINT64 a, const UINT64 b, UINT64& high )
+{
+#if defined( __SIZEOF_INT128__ )
+	__extension__ typedef unsigned __int128 UINT128;
+	const UINT128 product = static_cast<UINT128>( a ) * b;
+	high = static_cast<UINT64>( product >> 64 );
+	return static_cast<UINT64>( product );
+#elif defined( _MSC_VER ) && defined( _M_X64 )
+	return _umul128( a, b, &high );
+#else
+	const UINT64 lowLow = ( a & 0xFFFFFFFF ) * ( b & 0xFFFFFFFF );
+	const UINT64 highLow = ( a >> 32 ) * ( b & 0xFFFFFFFF );
+	const UINT64 lowHigh = ( a & 0xFFFFFFFF ) * ( b >> 32 );
+	const UINT64 cross = ( lowLow >> 32 ) + ( highLow & 0xFFFFFFFF ) + lowHigh;
+	high = ( highLow >> 32 ) + ( cross >> 32 ) + ( a >> 32 ) * ( b >> 32 );
+	return ( cross << 32 ) | ( lowLow & 0xFFFFFFFF );
+#endif
+}
+
+
+/**
+ * @param value number to count the leading zero bits of, not zero.
+ * @return number of leading zero bits.
+ */
+static inline int
+LeadingZeros( UINT64 value )
+{
+#if defined( __GNUC__ )
+	return __builtin_clzll( value );
+#elif defined( _MSC_VER ) && defined( _M_X64 )
+	unsigned long index;
+	_BitScanReverse64( &index, value );
+	return 63 - static_cast<int>( index );
+#else
+	int zeros = 0;
+	for ( UINT64 bit = 1ull << 63; ( value & bit ) == 0; bit >>= 1 )
+	{
+		++zeros;
+	}
+	return zeros;
+#endif
+}
+
+
+/**
+ * Computes the double nearest to w * 10^q with the Eisel-Lemire algorithm, w is multiplied
+ * by a 128 bit approximation of 5^q and the product rounded to 53 bits.
+ * @param w decimal significand, not zero.
+ * @param q decimal exponent, from POWERS_OF_FIVE_MIN to POWERS_OF_FIVE_MAX.
+ * @param bits set to the exponent and fraction bits of the double, without the sign.
+ * @return false if the approximation is too close to halfway between two doubles to be rounded.
+ */
+static bool
+EiselLemire( UINT64 w, const int q, UINT64& bits )
+{
+	const int zeros = LeadingZeros( w );
+	w <<= zeros;
+
+	const UINT64* power = POWERS_OF_FIVE + 2 * ( q - POWERS_OF_FIVE_MIN );
+	UINT64 high;
+	UINT64 low = Multiply128( w, power[0], high );
+
+	/* only the top 55 bits are needed, the low half of the power is used when a carry could reach them */
+	if ( ( high & 0x1FF ) == 0x1FF )
+	{
+		UINT64 carry;
+		Multiply128( w, power[1], carry );
+		low += carry;
+		if ( carry > low )
+		{
+			++high;
+		}
+	}
+
+	/* powers outside of this range are inexact, so a product this close to a carry is ambiguous */
+	if ( low == ~0ull && ( q < -27 || q > 55 ) )
+	{
+		return false;
+	}
+
+	const int upper = static_cast<int>( high >> 63 );
+	const int shift = upper + 64 - 52 - 3;
+	UINT64 mantissa = high >> shift;
+
+	/* floor( q log2( 10 ) ) + 63, plus the exponent bias */
+	int exponent = ( ( 217706 * q ) >> 16 ) + 63 + upper - zeros + 1023;
+
+	if ( exponent <= 0 )
+	{
+		/* subnormal, or rounds to zero */
+		if ( -exponent + 1 >= 64 )
+		{
+			bits = 0;
+			return true;
+		}
+		mantissa >>= -exponent + 1;
+		mantissa += mantissa & 1;
+		mantissa >>= 1;
+		exponent = ( mantissa < ( 1ull << 52 ) ) ? 0 : 1;
+		bits = ( static_cast<UINT64>( exponent ) << 52 ) | ( mantissa & ( ( 1ull << 52 ) - 1 ) );
+		return true;
+	}
+
+	/* exactly halfway between two doubles, only possible for small exponents, rounds to even */
+	if ( low <= 1 && q >= -4 && q <= 23 && ( mantissa & 3 ) == 1 && ( mantissa << shift ) == high )
+	{
+		mantissa &= ~1ull;
+	}
+
+	mantissa += mantissa & 1;
+	mantissa >>= 1;
+	if ( mantissa >= ( 2ull << 52 ) )
+	{
+		mantissa = 1ull << 52;
+		++exponent;
+	}
+	mantissa &= ~( 1ull << 52 );
+
+	if ( exponent >= 0x7FF )
+	{
+		exponent = 0x7FF;
+		mantissa = 0;
+	}
+
+	bits = ( static_cast<UINT64>( exponent ) << 52 ) | mantissa;
+	return true;
+}
+
+
+/**
+ * @param ptr first charactor to check.
+ * @param last one past the last charactor.
+ * @param word lower case word to match.
+ * @return true if the charactors start with word, ignoring ASCII case.
+ */
+static bool
+StartsWithWord( const TCHAR* ptr, const TCHAR* last, const char* word )
 {
-	TCHAR* end;
-	return strtol_t( str.c_str(), &end, base );
+	for ( ; *word != '\0'; ++ptr, ++word )
+	{
+		if ( ptr == last || ( *ptr | 0x20 ) != *word )
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+
+/**
+ * Skips base 10 digits.
+ * @param ptr first charactor to check.
+ * @param last one past the last charactor.
+ * @return first charactor that is not a digit, or last.
+ */
+static inline const TCHAR*
+SkipDigits( const TCHAR* ptr, const TCHAR* last )
+{
+	while ( ptr != last && DigitValue( *ptr ) < 10 )
+	{
+		++ptr;
+	}
+	return ptr;
+}
+
+
+/**
+ * Accumulates base 10 digits into a significand.
+ * @param ptr first digit.
+ * @param last one past the last digit, every charactor before it must be a digit.
+ * @param value significand to add the digits to.
+ * @param remaining number of digits that can still be added, reduced by the digits added.
+ * @return one past the last digit added.
+ */
+static const TCHAR*
+AccumulateDigits( const TCHAR* ptr, const TCHAR* last, UINT64& value, int& remaining )
+{
+#ifdef UTIL_SWAR_DIGITS
+	while ( remaining >= 8 && last - ptr >= 8 )
+	{
+		UINT64 chunk;
+		std::memcpy( &chunk, ptr, sizeof( chunk ) );
+		value = ( value * 100000000 ) + EightDigitsValue( chunk );
+		remaining -= 8;
+		ptr += 8;
+	}
+#endif
+
+	for ( ; remaining > 0 && ptr != last; --remaining, ++ptr )
+	{
+		value = ( value * 10 ) + DigitValue( *ptr );
+	}
+	return ptr;
+}
+
+
+/**
+ * @param ptr first digit to check.
+ * @param last one past the last digit.
+ * @return true if any of the digits is not zero.
+ */
+static inline bool
+HasNonZero( const TCHAR* ptr, const TCHAR* last )
+{
+	for ( ; ptr != last; ++ptr )
+	{
+		if ( *ptr != TEXT('0') )
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+
+/**
+ * Correctly rounds a decimal number too long or too close to halfway for EiselLemire.
+ * The digits are copied without a decimal point, which would depend on the locale, and
+ * converted by strtod. Digits after the first 768 cannot change the rounding and are
+ * replaced by a single non zero digit.
+ * @param digits first significant digit, in the integer part or in the fraction.
+ * @param integerEnd one past the last digit of the integer part.
+ * @param fraction first digit of the fraction.
+ * @param fractionEnd one past the last digit of the fraction.
+ * @param exponent value of the exponent part.
+ * @return magnitude of the number.
+ */
+static double
+ParseDoubleSlow( const TCHAR* digits, const TCHAR* integerEnd, const TCHAR* fraction, const TCHAR* fractionEnd, const INT64 exponent )
+{
+	const size_t MAX_DIGITS = 768;
+	char buffer[MAX_DIGITS + 32];
+	size_t length = 0;
+	bool dropped = false;
+
+	for ( const TCHAR* ptr = digits; ptr != fractionEnd; ++ptr )
+	{
+		if ( ptr == integerEnd )
+		{
+			ptr = fraction;
+			if ( ptr == fractionEnd )
+			{
+				break;
+			}
+		}
+
+		if ( length < MAX_DIGITS )
+		{
+			buffer[length++] = static_cast<char>( *ptr );
+		}
+		else
+		{
+			dropped = dropped || *ptr != TEXT('0');
+		}
+	}
+
+	/* the digits stand for an integer scaled by the exponent */
+	INT64 scale = exponent - ( fractionEnd - fraction );
+	const INT64 total = ( integerEnd > digits ? integerEnd - digits : 0 ) + ( fractionEnd - ( digits > fraction ? digits : fraction ) );
+	scale += total - static_cast<INT64>( length );
+	if ( dropped )
+	{
+		buffer[length++] = '1';
+		--scale;
+	}
+
+	scale = ALIMA<INT64>( scale, 100000, -100000 );
+	std::snprintf( buffer + length, sizeof( buffer ) - length, "e%d", static_cast<int>( scale ) );
+	return std::strtod( buffer, nullptr );
+}
+
+
+/**
+ * Parses a floating point number, the way strtod does without skipping whitespace.
+ * Hexadecimal floating point is not supported.
+ * @param first first charactor to parse.
+ * @param last one past the last charactor.
+ * @param value set to the parsed number.
+ * @return one past the last charactor parsed, or nullptr if there is no number.
+ */
+static const TCHAR*
+ParseFloat( const TCHAR* first, const TCHAR* last, double& value )
+{
+	const TCHAR* ptr = first;
+	bool negative = false;
+	if ( ptr != last && ( *ptr == TEXT('-') || *ptr == TEXT('+') ) )
+	{
+		negative = ( *ptr == TEXT('-') );
+		++ptr;
+	}
+
+	if ( StartsWithWord( ptr, last, "inf" ) )
+	{
+		value = negative ? -std::numeric_limits<double>::infinity() : std::numeric_limits<double>::infinity();
+		return ptr + ( StartsWithWord( ptr, last, "infinity" ) ? 8 : 3 );
+	}
+	if ( StartsWithWord( ptr, last, "nan" ) )
+	{
+		value = std::numeric_limits<double>::quiet_NaN();
+		return ptr + 3;
+	}
+
+	const TCHAR* integer = ptr;
+	const TCHAR* integerEnd = SkipDigits( integer, last );
+	const TCHAR* fraction = integerEnd;
+	const TCHAR* fractionEnd = integerEnd;
+	if ( integerEnd != last && *integerEnd == TEXT('.') )
+	{
+		fraction = integerEnd + 1;
+		fractionEnd = SkipDigits( fraction, last );
+	}
+	if ( integer == integerEnd && fraction == fractionEnd )
+	{
+		return nullptr;
+	}
+	ptr = fractionEnd;
+
+	/* the exponent is only part of the number if it has digits */
+	INT64 exponent = 0;
+	if ( ptr != last && ( *ptr == TEXT('e') || *ptr == TEXT('E') ) )
+	{
+		const TCHAR* digits = ptr + 1;
+		const bool negativeExponent = ( digits != last && *digits == TEXT('-') );
+		if ( digits != last && ( *digits == TEXT('-') || *digits == TEXT('+') ) )
+		{
+			++digits;
+		}
+		if ( digits != last && DigitValue( *digits ) < 10 )
+		{
+			for ( ptr = digits; ptr != last && DigitValue( *ptr ) < 10; ++ptr )
+			{
+				/* far beyond the range of a double, so further digits cannot matter */
+				if ( exponent < 0x10000000 )
+				{
+					exponent = ( exponent * 10 ) + DigitValue( *ptr );
+				}
+			}
+			exponent = negativeExponent ? -exponent : exponent;
+		}
+	}
+
+	/* the first 19 significant digits always fit in 64 bits */
+	const TCHAR* digits = integer;
+	while ( digits != integerEnd && *digits == TEXT('0') )
+	{
+		++digits;
+	}
+	if ( digits == integerEnd )
+	{
+		for ( digits = fraction; digits != fractionEnd && *digits == TEXT('0'); ++digits )
+		{
+		}
+	}
+
+	UINT64 significand = 0;
+	int remaining = 19;
+	INT64 scale = exponent;
+	bool truncated;
+	if ( digits < integerEnd )
+	{
+		const TCHAR* end = AccumulateDigits( digits, integerEnd, significand, remaining );
+		if ( end == integerEnd )
+		{
+			end = AccumulateDigits( fraction, fractionEnd, significand, remaining );
+			scale -= end - fraction;
+			truncated = HasNonZero( end, fractionEnd );
+		}
+		else
+		{
+			scale += integerEnd - end;
+			truncated = HasNonZero( end, integerEnd ) || HasNonZero( fraction, fractionEnd );
+		}
+	}
+	else
+	{
+		const TCHAR* end = AccumulateDigits( digits, fractionEnd, significand, remaining );
+		scale -= end - fraction;
+		truncated = HasNonZero( end, fractionEnd );
+	}
+
+#ifdef UTIL_EXACT_DOUBLE_ARITHMETIC
+	/* significands and powers of ten that are exact doubles give a correctly rounded
+	 * result with a single multiply or divide, which covers most configuration values */
+	if ( !truncated && significand <= ( 1ull << 53 ) && scale >= -22 && scale <= 22 )
+	{
+		static const double POWERS[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+										 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+		const double exact = static_cast<double>( significand );
+		value = ( scale < 0 ) ? exact / POWERS[-scale] : exact * POWERS[scale];
+		value = negative ? -value : value;
+		return ptr;
+	}
+#endif
+
+	UINT64 bits;
+	if ( significand == 0 || scale < POWERS_OF_FIVE_MIN )
+	{
+		bits = 0;
+	}
+	else if ( scale > POWERS_OF_FIVE_MAX )
+	{
+		bits = 0x7FFull << 52;
+	}
+	else
+	{
+		/* with digits cut off the number lies between significand and significand + 1,
+		 * if both round to the same double so does the number */
+		UINT64 upper;
+		const int q = static_cast<int>( scale );
+		if ( !EiselLemire( significand, q, bits ) ||
+			 ( truncated && ( !EiselLemire( significand + 1, q, upper ) || upper != bits ) ) )
+		{
+			const double slow = ParseDoubleSlow( digits, integerEnd, fraction, fractionEnd, exponent );
+			value = negative ? -slow : slow;
+			return ptr;
+		}
+	}
+
+	if ( negative )
+	{
+		bits |= 1ull << 63;
+	}
+	std::memcpy( &value, &bits, sizeof( value ) );
+	return ptr;
+}
+
+
+bool
+ParseDouble( const StringView& str, double& value )
+{
+	const TCHAR* last = str.data() + str.size();
+	double parsed;
+
+	const TCHAR* end = ParseFloat( str.data(), last, parsed );
+	if ( end == nullptr || end != last )
+	{
+		return false;
+	}
+	value = parsed;
+	return true;
+}
+
+
+double
+StringToDouble( const StringView& str )
+{
+	const TCHAR* last = str.data() + str.size();
+	double value = 0.0;
+
+	if ( ParseFloat( SkipSpace( str.data(), last ), last, value ) == nullptr )
+	{
+		return 0.0;
+	}
+	return value;
+}
+
+
+/** @return floor( e log10( 2 ) ). */
+static inline int
+FloorLog10Pow2( const int e )
+{
+	return static_cast<int>( ( e * 661971961083ll ) >> 41 );
+}
+
+
+/** @return floor( log10( 3/4 2^e ) ). */
+static inline int
+FloorLog10ThreeQuartersPow2( const int e )
+{
+	return static_cast<int>( ( e * 661971961083ll - 274743187321ll ) >> 41 );
+}
+
+
+/** @return floor( e log2( 10 ) ). */
+static inline int
+FloorLog2Pow10( const int e )
+{
+	return static_cast<int>( ( e * 913124641741ll ) >> 38 );
+}
+
+
+/**
+ * Multiplies by a POWERS_OF_TEN entry and divides by 2^127, rounding to odd.
+ * @param g1 high 63 bits of the power.
+ * @param g0 low 63 bits of the power.
+ * @param cp number to multiply.
+ * @return product, with the lowest bit set if any bits were lost.
+ */
+static inline UINT64
+RoundToOdd( const UINT64 g1, const UINT64 g0, const UINT64 cp )
+{
+	const UINT64 MASK_63 = ( 1ull << 63 ) - 1;
+	UINT64 x1;
+	UINT64 y1;
+	Multiply128( g0, cp, x1 );
+	const UINT64 y0 = Multiply128( g1, cp, y1 );
+	const UINT64 z = ( y0 >> 1 ) + x1;
+	const UINT64 vbp = y1 + ( z >> 63 );
+	return vbp | ( ( ( z & MASK_63 ) + MASK_63 ) >> 63 );
+}
+
+
+/**
+ * Finds the shortest decimal that rounds to c * 2^q with Giulietti's Schubfach algorithm.
+ * The decimals within the rounding interval of the double are bracketed by scaling its bounds
+ * with a 128 bit power of ten, trying one digit fewer first.
+ * @param q binary exponent.
+ * @param c binary significand, at least 3.
+ * @param significand set to the decimal significand.
+ * @param exponent set to the decimal exponent.
+ */
+static void
+Schubfach( const int q, const UINT64 c, UINT64& significand, int& exponent )
+{
+	const UINT64 out = c & 1;
+	const UINT64 cb = c << 2;
+	const UINT64 cbr = cb + 2;
+	UINT64 cbl;
+	int k;
+
+	/* the interval below a power of two is half the width of the one above it */
+	if ( c != ( 1ull << 52 ) || q == -1074 )
+	{
+		cbl = cb - 2;
+		k = FloorLog10Pow2( q );
+	}
+	else
+	{
+		cbl = cb - 1;
+		k = FloorLog10ThreeQuartersPow2( q );
+	}
+	const int h = q + FloorLog2Pow10( -k ) + 2;
+
+	const UINT64* power = POWERS_OF_TEN + 2 * ( k - POWERS_OF_TEN_MIN );
+	const UINT64 vb = RoundToOdd( power[0], power[1], cb << h );
+	const UINT64 vbl = RoundToOdd( power[0], power[1], cbl << h );
+	const UINT64 vbr = RoundToOdd( power[0], power[1], cbr << h );
+
+	const UINT64 s = vb >> 2;
+	if ( s >= 10 )
+	{
+		/* one digit fewer, sp10 is s rounded down to a multiple of 10 */
+		UINT64 quotient;
+		Multiply128( s, 115292150460684698ull << 4, quotient );
+		const UINT64 sp10 = 10 * quotient;
+		const UINT64 tp10 = sp10 + 10;
+		const bool upin = vbl + out <= ( sp10 << 2 );
+		const bool wpin = ( tp10 << 2 ) + out <= vbr;
+		if ( upin != wpin )
+		{
+			significand = upin ? sp10 : tp10;
+			exponent = k;
+			return;
+		}
+	}
+
+	const UINT64 t = s + 1;
+	const bool uin = vbl + out <= ( s << 2 );
+	const bool win = ( t << 2 ) + out <= vbr;
+	exponent = k;
+	if ( uin != win )
+	{
+		significand = uin ? s : t;
+		return;
+	}
+
+	/* both are in the interval, use the closer one, or the even one if they are as close */
+	const UINT64 middle = ( s + t ) << 1;
+	significand = ( vb < middle || ( vb == middle && ( s & 1 ) == 0 ) ) ? s : t;
+}
+
+
+size_t
+FormatDouble( const double num, TCHAR* buffer )
+{
+	UINT64 bits;
+	std::memcpy( &bits, &num, sizeof( bits ) );
+
+	const UINT64 fraction = bits & ( ( 1ull << 52 ) - 1 );
+	const int biased = static_cast<int>( ( bits >> 52 ) & 0x7FF );
+
+	if ( biased == 0x7FF && fraction != 0 )
+	{
+		std::copy( TEXT("nan"), TEXT("nan") + 3, buffer );
+		return 3;
+	}
+
+	TCHAR* ptr = buffer;
+	if ( ( bits >> 63 ) != 0 )
+	{
+		*ptr++ = TEXT('-');
+	}
+
+	if ( biased == 0x7FF )
+	{
+		ptr = std::copy( TEXT("inf"), TEXT("inf") + 3, ptr );
+		return static_cast<size_t>( ptr - buffer );
+	}
+
+	UINT64 significand = 0;
+	int exponent = 0;
+	if ( biased != 0 )
+	{
+		const int shift = 1075 - biased;
+		const UINT64 c = ( 1ull << 52 ) | fraction;
+		const UINT64 integer = ( shift > 0 && shift < 53 ) ? c >> shift : 0;
+
+		/* integers are their own shortest representation */
+		if ( integer != 0 && ( integer << shift ) == c )
+		{
+			significand = integer;
+		}
+		else
+		{
+			Schubfach( -shift, c, significand, exponent );
+		}
+	}
+	else if ( fraction >= 3 )
+	{
+		Schubfach( -1074, fraction, significand, exponent );
+	}
+	else if ( fraction != 0 )
+	{
+		/* the two smallest subnormals are too narrow for the tables to bracket, 5e-324 and 1e-323 */
+		significand = ( fraction == 1 ) ? 5 : 1;
+		exponent = ( fraction == 1 ) ? -324 : -323;
+	}
+
+	while ( significand >= 10 && significand % 10 == 0 )
+	{
+		significand /= 10;
+		++exponent;
+	}
+
+	TCHAR digits[INT64_MAX_CHARS];
+	const int length = static_cast<int>( FormatUInt64( significand, digits ) );
+	const int point = length + exponent;
+
+	if ( length <= point && point <= 21 )
+	{
+		/* integer */
+		ptr = std::copy( digits, digits + length, ptr );
+		ptr = std::fill_n( ptr, point - length, TEXT('0') );
+	}
+	else if ( 0 < point && point <= 21 )
+	{
+		/* decimal point within the digits */
+		ptr = std::copy( digits, digits + point, ptr );
+		*ptr++ = TEXT('.');
+		ptr = std::copy( digits + point, digits + length, ptr );
+	}
+	else if ( -6 < point && point <= 0 )
+	{
+		/* leading zeros after the decimal point */
+		*ptr++ = TEXT('0');
+		*ptr++ = TEXT('.');
+		ptr = std::fill_n( ptr, -point, TEXT('0') );
+		ptr = std::copy( digits, digits + length, ptr );
+	}
+	else
+	{
+		*ptr++ = digits[0];
+		if ( length > 1 )
+		{
+			*ptr++ = TEXT('.');
+			ptr = std::copy( digits + 1, digits + length, ptr );
+		}
+		*ptr++ = TEXT('e');
+		*ptr++ = ( point > 0 ) ? TEXT('+') : TEXT('-');
+		ptr += FormatUInt64( static_cast<UINT64>( ( point > 0 ) ? point - 1 : 1 - point ), ptr );
+	}
+
+	return static_cast<size_t>( ptr - buffer );
+}
+
+
+TSTRING
+DoubleToString( const double num )
+{
+	TCHAR buffer[DOUBLE_MAX_CHARS];
+	return TSTRING( buffer, FormatDouble( num, buffer ) );
 }
 
 static const TCHAR hex[] = { TEXT("0123456789ABCDEF") };
@@ -117,7 +1197,7 @@ fromHex( TSTRING str )
 	TSTRING::size_type i = 0;
 	TSTRING bin;
 	bin.reserve(str.size() / 2);
-	std::transform( str.begin(), str.end(), str.begin(), ::toupper );
+	FoldCaseInPlace( &str[0], str.size() );
 	
 	for ( i = 0; i < str.size(); i += 2 )
 	{
@@ -127,11 +1207,4 @@ fromHex( TSTRING str )
 }
 
 
-double
-StringToDouble( const TSTRING& str )
-{
-	TCHAR* end;
-	return strtod_t( str.c_str(), &end );
-}
-
 }
\ No newline at end of file
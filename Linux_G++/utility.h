@@ -9,13 +9,12 @@
  * These funcitons do not belong to any one class so they are extracted and put here.
  */
 
-#define WIN32_LEAN_AND_MEAN
-#include <Windows.h>
-#undef WIN32_LEAN_AND_MEAN
+#include "platform.h"
 
 #include <string>
 
 #include "unicode_defines.h"
+#include "string_view.h"
 
 namespace util
 {
@@ -81,6 +80,141 @@ TSTRING& right_trim( TSTRING& s );
  */
 TSTRING& trim( TSTRING& s );
 
+/**
+ * Trims leading and trailing non-graphical charactors from a view.
+ * @param s view to trim non-graphical from.
+ * @return view of the same charactors with non-graphical trimmed.
+ */
+StringView trim( const StringView& s );
+
+/**
+ * Hashes a run of charactors using 32 bit FNV-1a.
+ * @param str charactors to hash.
+ * @param size number of charactors to hash.
+ * @return hash of the charactors.
+ */
+inline UINT32
+HashString( const TCHAR* str, const size_t size )
+{
+	UINT32 hash = 2166136261u;
+	for ( size_t i = 0; i < size; ++i )
+	{
+		hash = ( hash ^ static_cast<UINT32>( str[i] ) ) * 16777619u;
+	}
+	return hash;
+}
+
+/**
+ * Hashes a run of charactors using 64 bit FNV-1a.
+ * Used where collisions must be negligible, such as detecting changed sections of a file.
+ * @param str charactors to hash.
+ * @param size number of charactors to hash.
+ * @param hash hash of any preceding charactors, so a hash can be built from several runs.
+ * @return hash of the charactors.
+ */
+inline UINT64
+HashString64( const TCHAR* str, const size_t size, UINT64 hash = 14695981039346656037ull )
+{
+	for ( size_t i = 0; i < size; ++i )
+	{
+		hash = ( hash ^ static_cast<UINT64>( str[i] ) ) * 1099511628211ull;
+	}
+	return hash;
+}
+
+/**
+ * Folds an ASCII lower case charactor to upper case, other charactors are unchanged.
+ * Unlike toupper the result does not depend on the locale.
+ * @param c charactor to fold.
+ * @return upper case charactor.
+ */
+constexpr TCHAR
+FoldCase( const TCHAR c )
+{
+	return ( c >= TEXT('a') && c <= TEXT('z') ) ? static_cast<TCHAR>( c - ( TEXT('a') - TEXT('A') ) ) : c;
+}
+
+/**
+ * Hashes a run of charactors using 32 bit FNV-1a, ignoring ASCII case.
+ * Used for section names, which are case insensitive.
+ * @param str charactors to hash.
+ * @param size number of charactors to hash.
+ * @return hash of the upper case charactors.
+ */
+inline UINT32
+HashStringFolded( const TCHAR* str, const size_t size )
+{
+	UINT32 hash = 2166136261u;
+	for ( size_t i = 0; i < size; ++i )
+	{
+		hash = ( hash ^ static_cast<UINT32>( FoldCase( str[i] ) ) ) * 16777619u;
+	}
+	return hash;
+}
+
+/**
+ * Folds ASCII lower case charactors to upper case in place, other charactors are unchanged.
+ * Narrow charactors are folded 16 at a time with SSE2 where it is available.
+ * @param str charactors to fold.
+ * @param size number of charactors to fold.
+ */
+void FoldCaseInPlace( TCHAR* str, const size_t size );
+
+/**
+ * Copies a string with ASCII lower case charactors folded to upper case.
+ * Used to store section names, which are case insensitive.
+ * @param str charactors to copy.
+ * @return upper case copy.
+ */
+TSTRING FoldedString( const StringView& str );
+
+/**
+ * Compile time version of HashString, written recursively to stay within C++11 constexpr rules.
+ * @param str charactors to hash.
+ * @param size number of charactors to hash.
+ * @param hash hash of the charactors before str.
+ * @return hash of the charactors, equal to HashString( str, size ).
+ */
+constexpr UINT32
+HashLiteral( const TCHAR* str, const size_t size, const UINT32 hash = 2166136261u )
+{
+	return ( size == 0 ) ? hash : HashLiteral( str + 1, size - 1, ( hash ^ static_cast<UINT32>( *str ) ) * 16777619u );
+}
+
+/**
+ * Compile time version of HashStringFolded.
+ * @param str charactors to hash.
+ * @param size number of charactors to hash.
+ * @param hash hash of the charactors before str.
+ * @return hash of the charactors, equal to HashStringFolded( str, size ).
+ */
+constexpr UINT32
+HashLiteralFolded( const TCHAR* str, const size_t size, const UINT32 hash = 2166136261u )
+{
+	return ( size == 0 ) ? hash : HashLiteralFolded( str + 1, size - 1, ( hash ^ static_cast<UINT32>( FoldCase( *str ) ) ) * 16777619u );
+}
+
+/**
+ * Most charactors written by FormatInt64, the length of "-9223372036854775808".
+ */
+const size_t INT64_MAX_CHARS = 20;
+
+/**
+ * Writes the base 10 representation of an unsigned Int64 into a buffer, two digits at a time.
+ * @param num number to format.
+ * @param buffer buffer of at least INT64_MAX_CHARS charactors, no null is written.
+ * @return number of charactors written.
+ */
+size_t FormatUInt64( UINT64 num, TCHAR* buffer );
+
+/**
+ * Writes the base 10 representation of an Int64 into a buffer, two digits at a time.
+ * @param num number to format.
+ * @param buffer buffer of at least INT64_MAX_CHARS charactors, no null is written.
+ * @return number of charactors written.
+ */
+size_t FormatInt64( const INT64 num, TCHAR* buffer );
+
 /**
  * Parses an Int64 into its base 10 string representation.
  * Can be used for Int8, Int16, Int32, supports negative numbers.
@@ -89,36 +223,104 @@ TSTRING& trim( TSTRING& s );
  */
 TSTRING Int64ToString( const INT64 num );
 
+/**
+ * Parses a whole view into an Int16, the view must hold nothing but the number.
+ * Accepts an optional sign, base 0 detects a "0x" hex or "0" octal prefix like strtol.
+ * Unlike strtol the result does not depend on the locale.
+ * @param str view to parse.
+ * @param value set to the parsed number on success, unchanged on failure.
+ * @param base number system to parse from, 0 or 2 to 36.
+ * @return false if the view is not a number or the number does not fit in an Int16.
+ */
+bool ParseInt16( const StringView& str, INT16& value, const int base = 0 );
+
+/**
+ * Parses a whole view into an Int32, see ParseInt16.
+ * @param str view to parse.
+ * @param value set to the parsed number on success, unchanged on failure.
+ * @param base number system to parse from, 0 or 2 to 36.
+ * @return false if the view is not a number or the number does not fit in an Int32.
+ */
+bool ParseInt32( const StringView& str, INT32& value, const int base = 0 );
+
+/**
+ * Parses a whole view into an Int64, see ParseInt16.
+ * @param str view to parse.
+ * @param value set to the parsed number on success, unchanged on failure.
+ * @param base number system to parse from, 0 or 2 to 36.
+ * @return false if the view is not a number or the number does not fit in an Int64.
+ */
+bool ParseInt64( const StringView& str, INT64& value, const int base = 0 );
+
 /**
  * Parses a string into an Int16
+ * Like strtol leading whitespace is skipped and parsing stops at the first charactor that is not a digit.
  * @param str string to parse.
  * @param base number system to parse to.
- * @return 0 on failure, parsed number on success.
+ * @return 0 on failure or if the number does not fit in an Int16, parsed number on success.
  */
-INT16 StringToInt16( const TSTRING& str, const int base = 0 );
+INT16 StringToInt16( const StringView& str, const int base = 0 );
 
 /**
  * Parses a string into an Int32
+ * Like strtol leading whitespace is skipped and parsing stops at the first charactor that is not a digit.
  * @param str string to parse.
  * @param base number system to parse to.
- * @return 0 on failure, parsed number on success.
+ * @return 0 on failure or if the number does not fit in an Int32, parsed number on success.
  */
-INT32 StringToInt32( const TSTRING& str, const int base = 0 );
+INT32 StringToInt32( const StringView& str, const int base = 0 );
 
 /**
  * Parses a string into an Int64
+ * Like strtol leading whitespace is skipped and parsing stops at the first charactor that is not a digit.
  * @param str string to parse.
  * @param base number system to parse to.
- * @return 0 on failure, parsed number on success.
+ * @return 0 on failure or if the number does not fit in an Int64, parsed number on success.
+ */
+INT64 StringToInt64( const StringView& str, const int base = 0 );
+
+/**
+ * Most charactors written by FormatDouble, the length of "-0.000001" followed by 17 digits.
+ */
+const size_t DOUBLE_MAX_CHARS = 25;
+
+/**
+ * Writes the shortest base 10 representation of a double that parses back to the same double.
+ * Of the shortest representations the one closest to the double is used. Numbers from 1e-6 up
+ * to 1e21 are written without an exponent, others as in "1.5e+300". Infinity is "inf" and
+ * nan is "nan".\n
+ * Unlike sprintf the result does not depend on the locale.
+ * @param num number to format.
+ * @param buffer buffer of at least DOUBLE_MAX_CHARS charactors, no null is written.
+ * @return number of charactors written.
+ */
+size_t FormatDouble( const double num, TCHAR* buffer );
+
+/**
+ * Converts a double to its shortest round trip string representation, see FormatDouble.
+ * @param num number to convert.
+ * @return string containing the numbers string representation.
+ */
+TSTRING DoubleToString( const double num );
+
+/**
+ * Parses a whole view into a double, correctly rounded, the view must hold nothing but the number.
+ * Accepts an optional sign, digits with an optional '.' and an optional exponent,
+ * as well as "inf", "infinity" and "nan" in any case.\n
+ * Unlike strtod the result does not depend on the locale, '.' is always the decimal point.
+ * @param str view to parse.
+ * @param value set to the parsed number on success, unchanged on failure.
+ * @return false if the view is not a number.
  */
-INT64 StringToInt64( const TSTRING& str, const int base = 0 );
+bool ParseDouble( const StringView& str, double& value );
 
 /**
  * Parses a string into an Double
+ * Like strtod leading whitespace is skipped and parsing stops at the first charactor that is not part of the number.
  * @param str string to parse.
  * @return 0 on failure, parsed number on success.
  */
-double StringToDouble( const TSTRING& str );
+double StringToDouble( const StringView& str );
 
 /**
  * Converts an array of charactors into their hex representation.
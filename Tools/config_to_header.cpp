@@ -0,0 +1,33 @@
+/**
+ * @file config_to_header.cpp
+ * Compiles a configuration file into a C++ header of constexpr tables, see ConfigHeader.
+ *
+ * @code
+ * config_to_header <config.ini> <header.h> <namespace>
+ * @endcode
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "config_header.h"
+
+int
+main( int argc, char** argv )
+{
+	if ( argc != 4 )
+	{
+		std::fprintf( stderr, "usage: %s <config.ini> <header.h> <namespace>\n", argv[0] );
+		return 2;
+	}
+
+	const TSTRING source( argv[1], argv[1] + std::strlen( argv[1] ) );
+	const TSTRING header( argv[2], argv[2] + std::strlen( argv[2] ) );
+	if ( !ConfigHeader::Compile( source, header, argv[3] ) )
+	{
+		std::fprintf( stderr, "could not compile %s into %s\n", argv[1], argv[2] );
+		return 1;
+	}
+	return 0;
+}
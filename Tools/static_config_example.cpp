@@ -0,0 +1,32 @@
+/**
+ * @file static_config_example.cpp
+ * Reads a configuration file compiled into the program by config_to_header, see ConfigHeader.
+ */
+
+#include <cstdio>
+
+#include "example_config.h"
+
+/* values are constants, so they can be used wherever the compiler needs one */
+static_assert( example_config::SERVER::keys::port == 8080, "first of a duplicate key is kept" );
+static_assert( example_config::SERVER::keys::backlog == 128, "hex values are folded" );
+static_assert( example_config::SERVER::keys::max_ > 0, "reserved names gain a suffix" );
+
+static char buffer[example_config::SERVER::keys::max_];
+
+int
+main()
+{
+	/* the tables have the getters of DefaultParser */
+	const StaticParser* server = example_config::config.GetSection( TEXT( "Server" ) );
+	const StaticParser* paths = example_config::config.GetSection( CFG_KEY( "paths" ) );
+	if ( server == nullptr || paths == nullptr )
+	{
+		return 1;
+	}
+
+	std::printf( "%s:%d timeout %g, %d byte buffer\n", server->getString( TEXT( "host" ), TEXT( "" ) ).c_str(),
+				 server->getInt32( TEXT( "port" ), 0 ), example_config::SERVER::keys::timeout, static_cast<int>( sizeof( buffer ) ) );
+	std::printf( "%s\n", paths->getString( TEXT( "1" ), TEXT( "" ) ).c_str() );
+	return 0;
+}
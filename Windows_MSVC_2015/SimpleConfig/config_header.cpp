@@ -0,0 +1,308 @@
+#include "config_header.h"
+
+#include <vector>
+#include <cctype>
+#include <cstdio>
+#include <fstream>
+#include <algorithm>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "utility.h"
+#include "line_scanner.h"
+#include "mapped_file.h"
+#include "static_config.h"
+
+/**
+ * Section gathered from the file before it is written.
+ */
+struct HeaderSection
+{
+	TSTRING name; /**< upper case name. */
+	std::vector<std::pair<TSTRING, StringView>> entries; /**< keys and values, in file order until sorted. */
+	std::unordered_set<TSTRING> keys; /**< keys already added, the first of a duplicate is kept. */
+	int auto_key; /**< last auto-key given to a bare value. */
+};
+
+/** Names that cannot be used as identifiers, C++ keywords and macros defined by common headers. */
+static const char* const RESERVED_NAMES[] = {
+	"alignas", "alignof", "and", "and_eq", "asm", "auto", "bitand", "bitor", "bool", "break", "case", "catch",
+	"char", "char16_t", "char32_t", "class", "compl", "const", "constexpr", "const_cast", "continue", "decltype",
+	"default", "delete", "do", "double", "dynamic_cast", "else", "enum", "explicit", "export", "extern", "false",
+	"float", "for", "friend", "goto", "if", "inline", "int", "long", "mutable", "namespace", "new", "noexcept",
+	"not", "not_eq", "nullptr", "operator", "or", "or_eq", "private", "protected", "public", "register",
+	"reinterpret_cast", "return", "short", "signed", "sizeof", "static", "static_assert", "static_cast", "struct",
+	"switch", "template", "this", "thread_local", "throw", "true", "try", "typedef", "typeid", "typename", "union",
+	"unsigned", "using", "virtual", "void", "volatile", "wchar_t", "while", "xor", "xor_eq",
+	"min", "max", "errno", "assert", "NULL", "TRUE", "FALSE", "ERROR", "DELETE", "IN", "OUT", "OPTIONAL",
+	"CONST", "VOID", "BOOL", "INT", "UINT", "TEXT", "EOF", "keys", "entries", "parser", "sections", "config"
+};
+
+/**
+ * Makes a name into an identifier that is not reserved or already used in its scope.
+ * @param name name of a section or key.
+ * @param used identifiers already used in the scope, the result is added.
+ * @return the identifier.
+ */
+static std::string
+MakeIdentifier( const StringView& name, std::unordered_set<std::string>& used )
+{
+	std::string identifier;
+	for ( size_t i = 0; i < name.size(); ++i )
+	{
+		const UINT32 c = static_cast<UINT32>( name[i] );
+		const bool alpha = ( c >= 'a' && c <= 'z' ) || ( c >= 'A' && c <= 'Z' ) || c == '_';
+		const bool digit = ( c >= '0' && c <= '9' );
+		identifier += ( alpha || digit ) ? static_cast<char>( c ) : '_';
+	}
+	if ( identifier.empty() || ( identifier[0] >= '0' && identifier[0] <= '9' ) )
+	{
+		identifier.insert( identifier.begin(), '_' );
+	}
+	for ( size_t i = 0; i < sizeof( RESERVED_NAMES ) / sizeof( RESERVED_NAMES[0] ); ++i )
+	{
+		if ( identifier == RESERVED_NAMES[i] )
+		{
+			identifier += '_';
+			break;
+		}
+	}
+
+	std::string unique = identifier;
+	for ( int suffix = 2; used.count( unique ) != 0; ++suffix )
+	{
+		char number[16];
+		std::snprintf( number, sizeof( number ), "_%d", suffix );
+		unique = identifier + number;
+	}
+	used.insert( unique );
+	return unique;
+}
+
+
+/**
+ * Appends a string literal, "TEXT(...)", holding exactly the charactors of a view.
+ * @param out text to append to.
+ * @param text charactors of the literal.
+ */
+static void
+AppendLiteral( std::string& out, const StringView& text )
+{
+	out += "StringView( TEXT(\"";
+	for ( size_t i = 0; i < text.size(); ++i )
+	{
+		const UINT32 c = static_cast<UINT32>( static_cast<std::make_unsigned<TCHAR>::type>( text[i] ) );
+		if ( c == '"' || c == '\\' || c == '?' )
+		{
+			/* '?' is escaped so that no trigraph is formed */
+			out += '\\';
+			out += static_cast<char>( c );
+		}
+		else if ( c >= 0x20 && c < 0x7F )
+		{
+			out += static_cast<char>( c );
+		}
+		else if ( c <= 0777 )
+		{
+			/* octal escapes end after three digits, so the next charactor cannot extend them */
+			char escape[8];
+			std::snprintf( escape, sizeof( escape ), "\\%03o", static_cast<unsigned int>( c ) );
+			out += escape;
+		}
+		else
+		{
+			/* hex escapes do not end, the literal is split so the next charactor is not part of it */
+			char escape[24];
+			std::snprintf( escape, sizeof( escape ), "\\x%X\") TEXT(\"", static_cast<unsigned int>( c ) );
+			out += escape;
+		}
+	}
+	out += "\"), ";
+	out += std::to_string( static_cast<unsigned long long>( text.size() ) );
+	out += " )";
+}
+
+
+/**
+ * Appends the constexpr constant of an entry, typed from its value.
+ * @param out text to append to.
+ * @param identifier name of the constant.
+ * @param value value of the entry.
+ */
+static void
+AppendConstant( std::string& out, const std::string& identifier, const StringView& value )
+{
+	INT64 integer = 0;
+	double number = 0.0;
+
+	if ( util::ParseInt64( value, integer ) )
+	{
+		out += "\t\t\tconstexpr INT64 " + identifier + " = ";
+		if ( integer == INT64( -9223372036854775807LL - 1 ) )
+		{
+			/* the literal of the smallest value is out of range before it is negated */
+			out += "( -9223372036854775807LL - 1 );\n";
+		}
+		else
+		{
+			out += std::to_string( static_cast<long long>( integer ) ) + "LL;\n";
+		}
+	}
+	else if ( util::ParseDouble( value, number ) && number - number == 0.0 )
+	{
+		/* the shortest round trip representation, made into a double literal */
+		const TSTRING text = util::DoubleToString( number );
+		std::string literal( text.begin(), text.end() );
+		if ( literal.find_first_of( ".e" ) == std::string::npos )
+		{
+			literal += ".0";
+		}
+		out += "\t\t\tconstexpr double " + identifier + " = " + literal + ";\n";
+	}
+	else
+	{
+		out += "\t\t\tconstexpr StringView " + identifier + " = ";
+		AppendLiteral( out, value );
+		out += ";\n";
+	}
+}
+
+
+std::string
+ConfigHeader::Generate( const StringView& contents, const std::string& name )
+{
+	std::vector<ScannedLine> lines;
+	LineScanner::Scan( contents, lines );
+
+	/* DEFAULT holds any lines before the first header, as it does when loading */
+	std::vector<HeaderSection> sections( 1 );
+	std::unordered_map<TSTRING, size_t> lookup;
+	sections[0].name = TEXT("DEFAULT");
+	sections[0].auto_key = 0;
+	lookup[sections[0].name] = 0;
+
+	size_t current = 0;
+	for ( size_t i = 0; i < lines.size(); ++i )
+	{
+		if ( lines[i].type == LINE_SECTION )
+		{
+			/* section headers are case insensitive */
+			const TSTRING folded = util::FoldedString( lines[i].SectionName( contents ) );
+			std::unordered_map<TSTRING, size_t>::iterator lit = lookup.find( folded );
+			if ( lit == lookup.end() )
+			{
+				lit = lookup.insert( std::make_pair( folded, sections.size() ) ).first;
+				sections.push_back( HeaderSection() );
+				sections.back().name = folded;
+				sections.back().auto_key = 0;
+			}
+			current = lit->second;
+			continue;
+		}
+
+		/* as in ConfigLoader::ParseEntry, bare values are stored under the next auto-key */
+		HeaderSection& section = sections[current];
+		TSTRING key;
+		StringView value;
+		if ( lines[i].HasValue() )
+		{
+			key = lines[i].Key( contents ).str();
+			value = lines[i].Value( contents );
+		}
+		else
+		{
+			key = util::Int64ToString( ++section.auto_key );
+			value = lines[i].Key( contents );
+		}
+		if ( section.keys.insert( key ).second )
+		{
+			section.entries.push_back( std::make_pair( key, value ) );
+		}
+	}
+
+	std::sort( sections.begin(), sections.end(), []( const HeaderSection& lhs, const HeaderSection& rhs )
+		{ return StaticConfig::Compare( StringView( lhs.name ), StringView( rhs.name ) ) < 0; } );
+
+	std::string guard = "_";
+	for ( size_t i = 0; i < name.size(); ++i )
+	{
+		const char c = name[i];
+		guard += ( ( c >= 'a' && c <= 'z' ) ? static_cast<char>( c - ( 'a' - 'A' ) ) : ( std::isalnum( static_cast<unsigned char>( c ) ) ? c : '_' ) );
+	}
+	guard += "_H_";
+
+	std::string out;
+	out += "\n/* Generated by ConfigHeader, do not edit. */\n\n";
+	out += "#ifndef " + guard + "\n#define " + guard + "\n\n";
+	out += "#include \"static_config.h\"\n\n";
+	out += "namespace " + name + "\n{\n";
+
+	std::unordered_set<std::string> sectionNames;
+	std::vector<std::string> identifiers;
+	for ( size_t s = 0; s < sections.size(); ++s )
+	{
+		HeaderSection& section = sections[s];
+		std::sort( section.entries.begin(), section.entries.end(),
+			[]( const std::pair<TSTRING, StringView>& lhs, const std::pair<TSTRING, StringView>& rhs )
+			{ return StringView( lhs.first ).compare( StringView( rhs.first ) ) < 0; } );
+
+		identifiers.push_back( MakeIdentifier( StringView( section.name ), sectionNames ) );
+		out += "\tnamespace " + identifiers.back() + "\n\t{\n\t\tnamespace keys\n\t\t{\n";
+
+		std::unordered_set<std::string> keyNames;
+		for ( size_t e = 0; e < section.entries.size(); ++e )
+		{
+			AppendConstant( out, MakeIdentifier( StringView( section.entries[e].first ), keyNames ), section.entries[e].second );
+		}
+		out += "\t\t}\n";
+
+		if ( section.entries.empty() )
+		{
+			/* arrays cannot be empty, the placeholder is never searched */
+			out += "\t\tconstexpr StaticEntry entries[1] = { { StringView(), StringView() } };\n";
+		}
+		else
+		{
+			out += "\t\tconstexpr StaticEntry entries[] = {\n";
+			for ( size_t e = 0; e < section.entries.size(); ++e )
+			{
+				out += "\t\t\t{ ";
+				AppendLiteral( out, StringView( section.entries[e].first ) );
+				out += ", ";
+				AppendLiteral( out, section.entries[e].second );
+				out += " },\n";
+			}
+			out += "\t\t};\n";
+		}
+		out += "\t\tconstexpr StaticParser parser( entries, " + std::to_string( static_cast<unsigned long long>( section.entries.size() ) ) + " );\n";
+		out += "\t}\n\n";
+	}
+
+	out += "\tconstexpr StaticSection sections[] = {\n";
+	for ( size_t s = 0; s < sections.size(); ++s )
+	{
+		out += "\t\t{ ";
+		AppendLiteral( out, StringView( sections[s].name ) );
+		out += ", " + identifiers[s] + "::parser },\n";
+	}
+	out += "\t};\n";
+	out += "\tconstexpr StaticConfig config( sections, " + std::to_string( static_cast<unsigned long long>( sections.size() ) ) + " );\n";
+	out += "}\n\n#endif\n";
+	return out;
+}
+
+
+bool
+ConfigHeader::Compile( const TSTRING& source, const TSTRING& header, const std::string& name )
+{
+	MappedFile file;
+	if ( !file.Open( source ) )
+	{
+		return false;
+	}
+
+	const std::string text = Generate( file.Contents(), name );
+	std::ofstream out( header.c_str(), std::ios::out | std::ios::binary | std::ios::trunc );
+	return static_cast<bool>( out.write( text.data(), text.size() ) );
+}
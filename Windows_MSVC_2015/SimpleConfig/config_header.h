@@ -0,0 +1,66 @@
+
+#ifndef _CONFIG_HEADER_H_
+#define _CONFIG_HEADER_H_
+
+/**
+ * @file config_header.h
+ * File containing the generator of C++ headers from configuration files.
+ */
+
+#include "platform.h"
+
+#include <string>
+
+#include "unicode_defines.h"
+#include "string_view.h"
+
+/**
+ * Compiles a configuration file into a C++ header, for configs that are fixed when the program is built.
+ * The file is read with the same rules as ConfigLoader::LoadFile and AddSection: lines before
+ * the first header belong to DEFAULT, headers are case insensitive and repeated headers are
+ * merged, bare values are given auto-keys and the first of any duplicate key is kept.\n
+ * For each section the header holds a namespace with a constexpr constant per key, typed INT64,
+ * double or StringView from its value, and a StaticParser over the entries sorted by key with
+ * the getters of DefaultParser. A StaticConfig named config finds the sections by name.
+ * @code
+ * namespace server_config
+ * {
+ * 	namespace SERVER
+ * 	{
+ * 		namespace keys
+ * 		{
+ * 			constexpr INT64 port = 8080LL;
+ * 			constexpr StringView name = StringView( TEXT("primary"), 7 );
+ * 		}
+ * 		constexpr StaticEntry entries[] = { ... };
+ * 		constexpr StaticParser parser( entries, 2 );
+ * 	}
+ * 	constexpr StaticSection sections[] = { ... };
+ * 	constexpr StaticConfig config( sections, 2 );
+ * }
+ * @endcode
+ * Section and key names are made into identifiers by replacing other charactors with '_',
+ * names that start with a digit gain a leading '_', and keywords and names already used gain a suffix.
+ */
+class ConfigHeader
+{
+public:
+	/**
+	 * Generates the header of a configuration file.
+	 * @param contents text of the configuration file.
+	 * @param name namespace of the generated code, also used for the include guard.
+	 * @return text of the header.
+	 */
+	static std::string Generate( const StringView& contents, const std::string& name );
+
+	/**
+	 * Generates the header of a configuration file and writes it.
+	 * @param source full path of the configuration file.
+	 * @param header full path of the header to write.
+	 * @param name namespace of the generated code, also used for the include guard.
+	 * @return success or failure.
+	 */
+	static bool Compile( const TSTRING& source, const TSTRING& header, const std::string& name );
+};
+
+#endif
@@ -0,0 +1,688 @@
+#include "config_image.h"
+
+#include <new>
+#include <atomic>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <algorithm>
+#include <unordered_map>
+
+#ifndef _WIN32
+#include <sys/stat.h>
+#endif
+
+#include "utility.h"
+#include "flat_map.h"
+#include "line_scanner.h"
+
+/** Identifies an image, the null is part of the magic. */
+static const char IMAGE_MAGIC[8] = { 'S', 'C', 'F', 'G', 'I', 'M', 'G', '\0' };
+
+/** Identifies the control segment of a shared image, the null is part of the magic. */
+static const char PUBLISH_MAGIC[8] = { 'S', 'C', 'F', 'G', 'P', 'U', 'B', '\0' };
+
+/* processes only share the generation if it is updated without a lock */
+static_assert( ATOMIC_LLONG_LOCK_FREE == 2, "shared images need lock free 64 bit atomics" );
+
+/**
+ * Gets the size and modification time of a file, used to tell when an image is stale.
+ * @param path full path to the file.
+ * @param size set to the size of the file in bytes.
+ * @param time set to the modification time of the file, in the platform's own units.
+ * @return false if the file does not exist.
+ */
+static bool
+SourceStamp( const TSTRING& path, UINT64& size, UINT64& time )
+{
+#ifdef _WIN32
+	WIN32_FILE_ATTRIBUTE_DATA attributes;
+	if ( !GetFileAttributesEx( path.c_str(), GetFileExInfoStandard, &attributes ) )
+	{
+		return false;
+	}
+	size = ( static_cast<UINT64>( attributes.nFileSizeHigh ) << 32 ) | attributes.nFileSizeLow;
+	time = ( static_cast<UINT64>( attributes.ftLastWriteTime.dwHighDateTime ) << 32 ) | attributes.ftLastWriteTime.dwLowDateTime;
+#else
+	struct stat file_stat;
+	if ( stat( path.c_str(), &file_stat ) != 0 )
+	{
+		return false;
+	}
+	size = static_cast<UINT64>( file_stat.st_size );
+	time = static_cast<UINT64>( file_stat.st_mtim.tv_sec ) * 1000000000ull + static_cast<UINT64>( file_stat.st_mtim.tv_nsec );
+#endif
+	return true;
+}
+
+/**
+ * 64 bit FNV-1a of a run of bytes.
+ * @param bytes bytes to hash.
+ * @param size number of bytes.
+ * @return hash of the bytes.
+ */
+static UINT64
+Checksum( const unsigned char* bytes, const size_t size )
+{
+	UINT64 hash = 14695981039346656037ull;
+	for ( size_t i = 0; i < size; ++i )
+	{
+		hash = ( hash ^ bytes[i] ) * 1099511628211ull;
+	}
+	return hash;
+}
+
+/**
+ * @param count number of items to index.
+ * @return number of slots for a hash index of count items, kept at most half full.
+ */
+static UINT32
+IndexSize( const size_t count )
+{
+	UINT32 size = 0;
+	if ( count > 0 )
+	{
+		size = 2;
+		while ( size < count * 2 )
+		{
+			size *= 2;
+		}
+	}
+	return size;
+}
+
+/**
+ * @param value value to test.
+ * @return true if value is zero or a power of two.
+ */
+static bool
+IsPowerOfTwo( const UINT64 value )
+{
+	return ( value & ( value - 1 ) ) == 0;
+}
+
+/**
+ * Appends charactors to the string table of an image being compiled.
+ * @param strings string table.
+ * @param str charactors to append.
+ * @return charactor offset of str in the table.
+ */
+static UINT32
+AddString( TSTRING& strings, const StringView& str )
+{
+	UINT32 offset = static_cast<UINT32>( strings.size() );
+	strings.append( str.data(), str.size() );
+	return offset;
+}
+
+/**
+ * Appends a table to an image being compiled.
+ * @param buffer image being compiled.
+ * @param table first item of the table.
+ * @param count number of items in the table.
+ * @return byte offset of the table in the image.
+ */
+template <class T>
+static UINT64
+AppendTable( std::vector<char>& buffer, const T* table, const size_t count )
+{
+	UINT64 offset = buffer.size();
+	if ( count > 0 )
+	{
+		const char* bytes = reinterpret_cast<const char*>( table );
+		buffer.insert( buffer.end(), bytes, bytes + count * sizeof( T ) );
+	}
+	return offset;
+}
+
+
+bool
+ConfigImage::Build( const TSTRING& source, std::vector<char>& image )
+{
+#ifdef _UNICODE
+	/* images are read as bytes, which unicode builds widen */
+	return false;
+#else
+	/**
+	 * Section gathered from the text file before its records are written.
+	 */
+	struct PendingSection
+	{
+		TSTRING name; /**< upper case name. */
+		std::vector<size_t> lines; /**< indexes of the section's entry lines. */
+	};
+
+	MappedFile file;
+	UINT64 sourceSize = 0;
+	UINT64 sourceTime = 0;
+	if ( !SourceStamp( source, sourceSize, sourceTime ) || !file.Open( source ) )
+	{
+		return false;
+	}
+
+	StringView contents = file.Contents();
+	std::vector<ScannedLine> lines;
+	LineScanner::Scan( contents, lines );
+
+	/* DEFAULT holds any lines before the first header, as it does when loading text */
+	std::vector<PendingSection> pending( 1 );
+	std::unordered_map<TSTRING, size_t> lookup;
+	pending[0].name = TEXT("DEFAULT");
+	lookup[pending[0].name] = 0;
+
+	size_t current = 0;
+	for ( size_t i = 0; i < lines.size(); ++i )
+	{
+		if ( lines[i].type == LINE_SECTION )
+		{
+			/* section headers are case insensitive */
+			const TSTRING name = util::FoldedString( lines[i].SectionName( contents ) );
+
+			std::unordered_map<TSTRING, size_t>::iterator lit = lookup.find( name );
+			if ( lit == lookup.end() )
+			{
+				lit = lookup.insert( std::make_pair( name, pending.size() ) ).first;
+				pending.push_back( PendingSection() );
+				pending.back().name = name;
+			}
+			current = lit->second;
+		}
+		else
+		{
+			pending[current].lines.push_back( i );
+		}
+	}
+
+	std::vector<SectionRecord> sectionRecords( pending.size() );
+	std::vector<EntryRecord> entryRecords;
+	std::vector<UINT32> entryIndex;
+	TSTRING strings;
+
+	entryRecords.reserve( lines.size() );
+	for ( size_t s = 0; s < pending.size(); ++s )
+	{
+		SectionRecord& record = sectionRecords[s];
+		record.name = AddString( strings, StringView( pending[s].name ) );
+		record.name_length = static_cast<UINT32>( pending[s].name.size() );
+		record.hash = util::HashStringFolded( pending[s].name.data(), pending[s].name.size() );
+		record.first_entry = static_cast<UINT32>( entryRecords.size() );
+		record.entry_count = static_cast<UINT32>( pending[s].lines.size() );
+		record.index_first = static_cast<UINT32>( entryIndex.size() );
+		record.index_size = IndexSize( pending[s].lines.size() );
+		record.reserved = 0;
+
+		entryIndex.resize( entryIndex.size() + record.index_size, 0 );
+		for ( size_t e = 0; e < pending[s].lines.size(); ++e )
+		{
+			const ScannedLine& line = lines[pending[s].lines[e]];
+			StringView key = line.Key( contents );
+			StringView value = line.Value( contents );
+
+			EntryRecord entry;
+			entry.key = AddString( strings, key );
+			entry.key_length = static_cast<UINT32>( key.size() );
+			entry.value = AddString( strings, value );
+			entry.value_length = static_cast<UINT32>( value.size() );
+			entry.hash = util::HashString( key.data(), key.size() );
+			entry.flags = line.HasValue() ? ENTRY_HAS_VALUE : 0;
+			entryRecords.push_back( entry );
+
+			/* parsers keep the first of any duplicate key, so the index does too */
+			const UINT32 mask = record.index_size - 1;
+			for ( UINT32 pos = entry.hash & mask; ; pos = ( pos + 1 ) & mask )
+			{
+				UINT32& slot = entryIndex[record.index_first + pos];
+				if ( slot == 0 )
+				{
+					slot = static_cast<UINT32>( e + 1 );
+					break;
+				}
+				const EntryRecord& other = entryRecords[record.first_entry + slot - 1];
+				if ( other.hash == entry.hash && StringView( strings.data() + other.key, other.key_length ) == key )
+				{
+					break;
+				}
+			}
+		}
+	}
+
+	if ( strings.size() > 0xFFFFFFFFu || entryRecords.size() > 0xFFFFFFFFu || entryIndex.size() > 0xFFFFFFFFu )
+	{
+		/* offsets are 32 bit, the file is too large to compile */
+		return false;
+	}
+
+	std::vector<UINT32> sectionIndex( IndexSize( sectionRecords.size() ), 0 );
+	for ( size_t s = 0; s < sectionRecords.size(); ++s )
+	{
+		const UINT32 mask = static_cast<UINT32>( sectionIndex.size() ) - 1;
+		UINT32 pos = sectionRecords[s].hash & mask;
+		while ( sectionIndex[pos] != 0 )
+		{
+			pos = ( pos + 1 ) & mask;
+		}
+		sectionIndex[pos] = static_cast<UINT32>( s + 1 );
+	}
+
+	Header header;
+	std::memset( &header, 0, sizeof( header ) );
+	std::memcpy( header.magic, IMAGE_MAGIC, sizeof( IMAGE_MAGIC ) );
+	header.version = VERSION;
+	header.char_size = sizeof( TCHAR );
+	header.source_size = sourceSize;
+	header.source_time = sourceTime;
+	header.strings_size = strings.size();
+	header.section_count = static_cast<UINT32>( sectionRecords.size() );
+	header.entry_count = static_cast<UINT32>( entryRecords.size() );
+	header.section_index_size = static_cast<UINT32>( sectionIndex.size() );
+	header.entry_index_size = static_cast<UINT32>( entryIndex.size() );
+
+	std::vector<char> buffer( sizeof( Header ) );
+	header.sections_offset = AppendTable( buffer, sectionRecords.data(), sectionRecords.size() );
+	header.entries_offset = AppendTable( buffer, entryRecords.data(), entryRecords.size() );
+	header.section_index_offset = AppendTable( buffer, sectionIndex.data(), sectionIndex.size() );
+	header.entry_index_offset = AppendTable( buffer, entryIndex.data(), entryIndex.size() );
+	header.strings_offset = AppendTable( buffer, strings.data(), strings.size() );
+	header.image_size = buffer.size();
+	header.checksum = Checksum( reinterpret_cast<const unsigned char*>( buffer.data() ) + sizeof( Header ), buffer.size() - sizeof( Header ) );
+	std::memcpy( buffer.data(), &header, sizeof( Header ) );
+	image.swap( buffer );
+	return true;
+#endif
+}
+
+
+bool
+ConfigImage::Compile( const TSTRING& source, const TSTRING& image )
+{
+	std::vector<char> buffer;
+	if ( !Build( source, buffer ) )
+	{
+		return false;
+	}
+
+	/* write beside the image and move it into place, so an open never sees a partly written image */
+	TSTRING temporary = image + TEXT(".tmp");
+	{
+		std::ofstream out( temporary.c_str(), std::ios::out | std::ios::binary | std::ios::trunc );
+		if ( !out.write( buffer.data(), buffer.size() ) )
+		{
+			return false;
+		}
+	}
+	std::remove( image.c_str() );
+	return std::rename( temporary.c_str(), image.c_str() ) == 0;
+}
+
+
+TSTRING
+ConfigImage::SharedName( const TSTRING& source )
+{
+	static const TCHAR digits[] = TEXT("0123456789abcdef");
+
+	/* names may not hold the separators of a path, so the path is hashed */
+	const UINT64 hash = util::HashString64( source.data(), source.size() );
+#ifdef _WIN32
+	TSTRING name = TEXT("Local\\scfg.");
+#else
+	TSTRING name = TEXT("/scfg.");
+#endif
+	for ( int shift = 60; shift >= 0; shift -= 4 )
+	{
+		name += digits[( hash >> shift ) & 0xF];
+	}
+	return name;
+}
+
+
+TSTRING
+ConfigImage::SegmentName( const TSTRING& name, const UINT64 generation )
+{
+	return name + TEXT(".") + util::Int64ToString( static_cast<INT64>( generation ) );
+}
+
+
+ConfigImage::ConfigImage()
+	: generation( 0 ), header( nullptr ), sections( nullptr ), entries( nullptr ),
+	  section_index( nullptr ), entry_index( nullptr ), strings( nullptr )
+{
+}
+
+
+bool
+ConfigImage::Open( const TSTRING& image, const TSTRING& source, const bool verify )
+{
+	Close();
+
+#ifdef _UNICODE
+	return false;
+#else
+	if ( !File.Open( image ) || !Map( File.Contents(), source, verify, true ) )
+	{
+		Close();
+		return false;
+	}
+	return true;
+#endif
+}
+
+
+bool
+ConfigImage::Attach( const TSTRING& name, const TSTRING& source, const bool verify )
+{
+	Close();
+
+#ifdef _UNICODE
+	return false;
+#else
+	if ( !Control.Open( name ) || Control.Size() < sizeof( SharedControl ) ||
+		 std::memcmp( static_cast<const SharedControl*>( Control.Data() )->magic, PUBLISH_MAGIC, sizeof( PUBLISH_MAGIC ) ) != 0 )
+	{
+		Close();
+		return false;
+	}
+
+	/* the publisher removes an image once a newer one is published, so a generation read just before is tried again */
+	const SharedControl* control = static_cast<const SharedControl*>( Control.Data() );
+	for ( int attempt = 0; attempt < 3; ++attempt )
+	{
+		const UINT64 latest = control->generation.load( std::memory_order_acquire );
+		if ( latest == 0 )
+		{
+			break;
+		}
+
+		if ( Shared.Open( SegmentName( name, latest ) ) )
+		{
+			if ( Map( StringView( static_cast<const TCHAR*>( Shared.Data() ), Shared.Size() ), source, verify, false ) )
+			{
+				generation = latest;
+				return true;
+			}
+			break;
+		}
+
+		if ( control->generation.load( std::memory_order_acquire ) == latest )
+		{
+			break;
+		}
+	}
+	Close();
+	return false;
+#endif
+}
+
+
+bool
+ConfigImage::Map( const StringView& contents, const TSTRING& source, const bool verify, const bool exact )
+{
+	const Header* candidate = reinterpret_cast<const Header*>( contents.data() );
+	if ( contents.size() < sizeof( Header ) ||
+		 std::memcmp( candidate->magic, IMAGE_MAGIC, sizeof( IMAGE_MAGIC ) ) != 0 ||
+		 candidate->version != VERSION || candidate->char_size != sizeof( TCHAR ) ||
+		 ( exact ? candidate->image_size != contents.size() : candidate->image_size > contents.size() ) )
+	{
+		return false;
+	}
+
+	/* an image is stale once its text file has changed, it is used as is if there is no text file */
+	UINT64 sourceSize = 0;
+	UINT64 sourceTime = 0;
+	if ( SourceStamp( source, sourceSize, sourceTime ) &&
+		 ( sourceSize != candidate->source_size || sourceTime != candidate->source_time ) )
+	{
+		return false;
+	}
+
+	const size_t size = static_cast<size_t>( candidate->image_size );
+	if ( verify && Checksum( reinterpret_cast<const unsigned char*>( contents.data() ) + sizeof( Header ),
+							 size - sizeof( Header ) ) != candidate->checksum )
+	{
+		return false;
+	}
+
+	header = candidate;
+	if ( !Validate( size ) )
+	{
+		header = nullptr;
+		return false;
+	}
+
+	const char* base = reinterpret_cast<const char*>( contents.data() );
+	sections = reinterpret_cast<const SectionRecord*>( base + header->sections_offset );
+	entries = reinterpret_cast<const EntryRecord*>( base + header->entries_offset );
+	section_index = reinterpret_cast<const UINT32*>( base + header->section_index_offset );
+	entry_index = reinterpret_cast<const UINT32*>( base + header->entry_index_offset );
+	strings = reinterpret_cast<const TCHAR*>( base + header->strings_offset );
+	return true;
+}
+
+
+UINT64
+ConfigImage::LatestGeneration() const
+{
+	if ( generation == 0 )
+	{
+		return 0;
+	}
+	return static_cast<const SharedControl*>( Control.Data() )->generation.load( std::memory_order_acquire );
+}
+
+
+bool
+ConfigImage::Validate( const UINT64 size ) const
+{
+	/* each table must be aligned and lie inside the image, counts are 32 bit so the products can not overflow */
+	const UINT64 tables[5][2] = {
+		{ header->sections_offset, static_cast<UINT64>( header->section_count ) * sizeof( SectionRecord ) },
+		{ header->entries_offset, static_cast<UINT64>( header->entry_count ) * sizeof( EntryRecord ) },
+		{ header->section_index_offset, static_cast<UINT64>( header->section_index_size ) * sizeof( UINT32 ) },
+		{ header->entry_index_offset, static_cast<UINT64>( header->entry_index_size ) * sizeof( UINT32 ) },
+		{ header->strings_offset, header->strings_size * sizeof( TCHAR ) }
+	};
+	for ( size_t i = 0; i < 5; ++i )
+	{
+		if ( tables[i][0] < sizeof( Header ) || tables[i][0] > size || tables[i][1] > size - tables[i][0] ||
+			 ( i < 4 && tables[i][0] % sizeof( UINT32 ) != 0 ) )
+		{
+			return false;
+		}
+	}
+
+	if ( !IsPowerOfTwo( header->section_index_size ) || header->strings_size > 0xFFFFFFFFu )
+	{
+		return false;
+	}
+
+	const SectionRecord* records = reinterpret_cast<const SectionRecord*>(
+		reinterpret_cast<const char*>( header ) + header->sections_offset );
+	for ( UINT32 s = 0; s < header->section_count; ++s )
+	{
+		const SectionRecord& record = records[s];
+		if ( static_cast<UINT64>( record.first_entry ) + record.entry_count > header->entry_count ||
+			 static_cast<UINT64>( record.index_first ) + record.index_size > header->entry_index_size ||
+			 !IsPowerOfTwo( record.index_size ) ||
+			 static_cast<UINT64>( record.name ) + record.name_length > header->strings_size )
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+
+void
+ConfigImage::Close()
+{
+	File.Close();
+	Control.Close();
+	Shared.Close();
+	generation = 0;
+	header = nullptr;
+	sections = nullptr;
+	entries = nullptr;
+	section_index = nullptr;
+	entry_index = nullptr;
+	strings = nullptr;
+}
+
+
+void
+ConfigImage::Swap( ConfigImage& other )
+{
+	File.Swap( other.File );
+	Control.Swap( other.Control );
+	Shared.Swap( other.Shared );
+	std::swap( generation, other.generation );
+	std::swap( header, other.header );
+	std::swap( sections, other.sections );
+	std::swap( entries, other.entries );
+	std::swap( section_index, other.section_index );
+	std::swap( entry_index, other.entry_index );
+	std::swap( strings, other.strings );
+}
+
+
+const ConfigImage::SectionRecord*
+ConfigImage::FindSection( const KeyView& name ) const
+{
+	if ( header == nullptr || header->section_index_size == 0 )
+	{
+		return nullptr;
+	}
+
+	const UINT32 hash = name.FoldedHash();
+	const UINT32 mask = header->section_index_size - 1;
+	UINT32 pos = hash & mask;
+	for ( UINT32 probe = 0; probe < header->section_index_size; ++probe, pos = ( pos + 1 ) & mask )
+	{
+		const UINT32 slot = section_index[pos];
+		if ( slot == 0 || slot > header->section_count )
+		{
+			return nullptr;
+		}
+		const SectionRecord& record = sections[slot - 1];
+		if ( record.hash == hash && FoldedEqual()( Name( record ), name.View() ) )
+		{
+			return &record;
+		}
+	}
+	return nullptr;
+}
+
+
+const ConfigImage::EntryRecord*
+ConfigImage::FindEntry( const SectionRecord& section, const KeyView& key ) const
+{
+	if ( section.index_size == 0 )
+	{
+		return nullptr;
+	}
+
+	const UINT32 hash = key.Hash();
+	const UINT32 mask = section.index_size - 1;
+	UINT32 pos = hash & mask;
+	for ( UINT32 probe = 0; probe < section.index_size; ++probe, pos = ( pos + 1 ) & mask )
+	{
+		const UINT32 slot = entry_index[section.index_first + pos];
+		if ( slot == 0 || slot > section.entry_count )
+		{
+			return nullptr;
+		}
+		const EntryRecord& entry = entries[section.first_entry + slot - 1];
+		if ( entry.hash == hash && Key( entry ) == key.View() )
+		{
+			return &entry;
+		}
+	}
+	return nullptr;
+}
+
+
+ImagePublisher::ImagePublisher()
+	: generation( 0 )
+{
+}
+
+
+ImagePublisher::~ImagePublisher()
+{
+	Close();
+}
+
+
+bool
+ImagePublisher::Publish( const TSTRING& source, const TSTRING& name )
+{
+	std::vector<char> image;
+	if ( !ConfigImage::Build( source, image ) )
+	{
+		return false;
+	}
+
+	if ( name != this->name )
+	{
+		Close();
+	}
+
+	if ( !Control.IsOpen() )
+	{
+		/* a control segment left behind by a publisher that did not close is taken over */
+		if ( ( !Control.Create( name, sizeof( ConfigImage::SharedControl ) ) && !Control.Open( name, true ) ) ||
+			 Control.Size() < sizeof( ConfigImage::SharedControl ) )
+		{
+			Control.Close();
+			return false;
+		}
+
+		ConfigImage::SharedControl* control = static_cast<ConfigImage::SharedControl*>( Control.Data() );
+		if ( std::memcmp( control->magic, PUBLISH_MAGIC, sizeof( PUBLISH_MAGIC ) ) != 0 )
+		{
+			new ( &control->generation ) std::atomic<UINT64>( 0 );
+			std::memcpy( control->magic, PUBLISH_MAGIC, sizeof( PUBLISH_MAGIC ) );
+		}
+		this->name = name;
+		generation = control->generation.load( std::memory_order_acquire );
+	}
+
+	/* the image is written in full before the generation makes it visible */
+	const UINT64 next = generation + 1;
+	const TSTRING segment = ConfigImage::SegmentName( name, next );
+	SharedSegment fresh;
+	SharedSegment::Remove( segment );
+	if ( !fresh.Create( segment, image.size() ) )
+	{
+		return false;
+	}
+	std::memcpy( fresh.Data(), image.data(), image.size() );
+	static_cast<ConfigImage::SharedControl*>( Control.Data() )->generation.store( next, std::memory_order_release );
+
+	if ( generation != 0 )
+	{
+		SharedSegment::Remove( ConfigImage::SegmentName( name, generation ) );
+	}
+	Current.Swap( fresh );
+	generation = next;
+	return true;
+}
+
+
+void
+ImagePublisher::Close()
+{
+	if ( !name.empty() )
+	{
+		/* attached processes keep their mappings, processes opening the file afterwards load the text */
+		if ( generation != 0 )
+		{
+			SharedSegment::Remove( ConfigImage::SegmentName( name, generation ) );
+		}
+		SharedSegment::Remove( name );
+	}
+
+	Current.Close();
+	Control.Close();
+	name.clear();
+	generation = 0;
+}
@@ -1,27 +1,128 @@
 #include "config_loader.h"
 
+#include <map>
 #include <vector>
 #include <fstream>
 #include <sstream>
 #include <algorithm>
 
-ConfigLoader::ConfigMap ConfigLoader::OpenConfigs;
+#ifndef _WIN32
+#include <climits>
+#include <unistd.h>
+#endif
+
+ConfigRegistry ConfigLoader::OpenConfigs;
+const size_t ConfigLoader::MAX_MESSAGES;
+
+
+/**
+ * Finds the line numbers of offsets in a file for diagnostics.
+ * Offsets are usually asked for in increasing order, so lines are only counted from the previous offset.
+ */
+class LineCounter
+{
+public:
+	/**
+	 * Constructor.
+	 * @param contents contents of the file.
+	 */
+	explicit LineCounter( const StringView& contents )
+		: contents( contents ), offset( 0 ), line( 1 ) {}
+
+	/**
+	 * @param target offset of a charactor in the file.
+	 * @return line number of the charactor, starting from 1.
+	 */
+	UINT32 LineAt( const size_t target )
+	{
+		if ( target < offset )
+		{
+			offset = 0;
+			line = 1;
+		}
+		line += static_cast<UINT32>( std::count( contents.data() + offset, contents.data() + target, TEXT('\n') ) );
+		offset = target;
+		return line;
+	}
+
+private:
+	StringView contents; /**< contents of the file. */
+	size_t offset; /**< offset line was counted up to. */
+	UINT32 line; /**< line number at offset. */
+};
+
 
 CONFIGHANDLE
-ConfigLoader::InitialiseConfig( const TSTRING& filename, const TSTRING& path )
+ConfigLoader::InitialiseConfig( const TSTRING& filename, const TSTRING& path, const int flags )
 {
 	TSTRING sanitised = RemoveExtension( filename );
+	ConfigLoader* config = nullptr;
+
+	{
+		/* fast path, the file is already open */
+		ConfigRegistry::ReadGuard guard( OpenConfigs );
+		config = OpenConfigs.Find( sanitised );
+		if ( config != nullptr && !config->Acquire() )
+		{
+			config = nullptr;
+		}
+	}
 
-	if( OpenConfigs.count( sanitised ) )
+	if ( config == nullptr )
 	{
-		OpenConfigs[sanitised]->references += 1;
+		/* while the shard is locked a config in it can not be retired, so no guard is needed */
+		std::lock_guard<std::mutex> lock( OpenConfigs.ShardLock( sanitised ) );
+		config = OpenConfigs.Find( sanitised );
+		if ( config == nullptr || !config->Acquire() )
+		{
+			/* a config that is being closed is replaced, Retire only removes its own entry */
+			config = new ConfigLoader( filename, path, flags );
+			OpenConfigs.Insert( sanitised, config );
+		}
 	}
-	else
+
+	return CONFIGHANDLE( new ConfigHandle( config ) );
+}
+
+
+bool
+ConfigLoader::Acquire()
+{
+	int count = references.load();
+	while ( count > 0 )
+	{
+		if ( references.compare_exchange_weak( count, count + 1 ) )
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+
+bool
+ConfigLoader::Release( const bool force )
+{
+	if ( force )
+	{
+		return references.exchange( 0 ) > 0;
+	}
+	return references.fetch_sub( 1 ) == 1;
+}
+
+
+void
+ConfigLoader::Retire( ConfigLoader* config )
+{
+	TSTRING sanitised = RemoveExtension( config->fileName );
 	{
-		OpenConfigs[sanitised] = new ConfigLoader( filename, path );
+		std::lock_guard<std::mutex> lock( OpenConfigs.ShardLock( sanitised ) );
+		OpenConfigs.Remove( sanitised, config );
 	}
 
-	return CONFIGHANDLE( new ConfigHandle( OpenConfigs[sanitised] ) );
+	/* readers that found the config before it was removed may still be using it */
+	OpenConfigs.Synchronize();
+	delete config;
 }
 
 
@@ -35,62 +136,167 @@ ConfigLoader::RemoveExtension( const TSTRING& filename )
 }
 
 
-ConfigLoader::ConfigLoader( const TSTRING& filename, const TSTRING& path )
+ConfigLoader::ConfigLoader( const TSTRING& filename, const TSTRING& path, const int flags )
+	: FileMap( 0, FileMapping::hasher(), FileMapping::key_equal(), FileMapping::allocator_type( ( flags & CONFIG_RELOAD ) ? nullptr : &Memory ) ),
+	  Sections( StorageMap::allocator_type( ( flags & CONFIG_RELOAD ) ? nullptr : &Memory ) ),
+	  Published( nullptr ),
+	  Generation( 0 ),
+	  Messages( MAX_MESSAGES ),
+	  reported_drops( 0 ),
+	  next_subscriber( 0 )
 {
 	fileName = filename;
 	filePath = path;
 
 	references = 1;
+	this->flags = flags;
 
-	max_messages = 100;
-
+	ResolvePath();
+	fullPath = filePath + fileName;
 	LoadFile();
+
+	/* readers only ever see copies of Sections that are no longer changed */
+	Published = CopySections();
+
+	if ( flags & CONFIG_RELOAD )
+	{
+		/* an attached image is replaced when the publisher raises the generation, which may be well after the file is written */
+		std::function<bool()> check;
+		if ( Image.IsShared() )
+		{
+			check = [this]() { return SharedImageChanged(); };
+		}
+
+		if ( !Watcher.Start( filePath + fileName, [this]() { Reload(); }, 100, check ) )
+		{
+			AddMessage( DIAG_WATCH_FAILED );
+		}
+	}
 }
 
 
 void
-ConfigLoader::AddMessage( TSTRING message, ... )
+ConfigLoader::AddMessage( const DiagnosticCode code, const StringView& section, const INT64 argument, const UINT64 offset, const UINT32 line )
+{
+	Messages.Push( Diagnostic( code, &fullPath, section, argument, offset, line ) );
+}
+
+
+TSTRING
+ConfigLoader::PollMessages()
 {
-	std::vector<TCHAR> buf;
-	int lineLength;
-	va_list args;
+	Diagnostic record;
+	if ( Messages.Pop( record ) )
+	{
+		return record.Format();
+	}
 
-	va_start( args, message );
+	/* report drops once the messages before them have been read */
+	const UINT64 dropped = Messages.Dropped();
+	const UINT64 reported = reported_drops.exchange( dropped );
+	if ( dropped > reported )
+	{
+		return TEXT("Additional Messages Truncated: ") + util::Int64ToString( static_cast<INT64>( dropped - reported ) );
+	}
+	return TSTRING();
+}
+
+
+size_t
+ConfigLoader::DrainMessages( std::vector<Diagnostic>& records, const size_t max )
+{
+	return Messages.Drain( records, max );
+}
 
-	lineLength = vsnprintf_t( NULL, 0, message.c_str(), args );
-	buf.resize( lineLength + 1 );
 
-	vsprintf_t( &buf[0], message.c_str(), args );
+ConfigStats
+ConfigLoader::Statistics()
+{
+	ConfigStats stats;
+	stats.file = fullPath;
 
-	if( message_queue.size() < 100 )
+	std::lock_guard<std::mutex> lock( Writer );
+	for ( size_t c = 0; c < LOAD_COUNTERS; ++c )
 	{
-		message_queue.push( TSTRING( &buf[0] ) );
+		stats.counters[c] = Stats.Get( c );
 	}
-	else if ( message_queue.size() == 100 )
+	stats.counters[LOAD_SECTIONS] = Image.IsOpen() ? Image.SectionCount() : FileMap.size();
+
+	for ( StorageMap::const_iterator sit = Sections.begin(); sit != Sections.end(); ++sit )
 	{
-		message_queue.push( TEXT("Additional Messages Truncated.") );
+		ParserStats parser;
+		parser.section = sit->second->section_name;
+		for ( size_t c = 0; c < PARSER_COUNTERS; ++c )
+		{
+			parser.counters[c] = sit->second->stats.Get( c );
+		}
+		stats.parsers.push_back( parser );
 	}
+	return stats;
+}
+
+
+bool
+ConfigLoader::ExportStatistics( const TSTRING& path )
+{
+	std::vector<TSTRING> filenames;
+	std::vector<ConfigStats> stats;
+	OpenConfigs.Names( filenames );
+
+	for ( size_t i = 0; i < filenames.size(); ++i )
+	{
+		ConfigLoader* config = nullptr;
+		{
+			/* hold a reference rather than the guard, Statistics waits for the writer lock */
+			ConfigRegistry::ReadGuard guard( OpenConfigs );
+			config = OpenConfigs.Find( filenames[i] );
+			if ( config != nullptr && !config->Acquire() )
+			{
+				config = nullptr;
+			}
+		}
 
-	va_end( args );
+		if ( config != nullptr )
+		{
+			stats.push_back( config->Statistics() );
+			CloseConfig( config );
+		}
+	}
+	return WritePrometheus( path, stats );
 }
 
-TSTRING
-ConfigLoader::PollMessages()
+
+KeyProfileReport
+ConfigLoader::ProfileReport( const size_t top )
 {
-	TSTRING message = TEXT("");
+	KeyProfileReport report;
+	std::vector<KeyReads> read;
 
-	if( !message_queue.empty() )
+	std::lock_guard<std::mutex> lock( Writer );
+	for ( StorageMap::const_iterator sit = Sections.begin(); sit != Sections.end(); ++sit )
 	{
-		message = message_queue.front();
-		message_queue.pop();
+		if ( sit->second->profile )
+		{
+			sit->second->profile->Collect( sit->second->section_name, report, read );
+		}
 	}
 
-	return message;
+	/* only the top entries need to be in order */
+	const size_t hot = ( top < read.size() ) ? top : read.size();
+	std::partial_sort( read.begin(), read.begin() + hot, read.end(),
+		[]( const KeyReads& lhs, const KeyReads& rhs ) { return lhs.reads > rhs.reads; } );
+	report.hot.assign( read.begin(), read.begin() + hot );
+	return report;
 }
 
 
 ConfigLoader::~ConfigLoader()
 {
+	/* stop reloading before the parsers are freed */
+	Watcher.Stop();
+
+	delete Published.load();
+
 	StorageMap::iterator sit;
 	for ( sit = Sections.begin(); sit != Sections.end(); ++sit )
 	{
@@ -104,97 +310,627 @@ bool
 ConfigLoader::AddSection(ParserBase* section)
 {
 	bool retrn = false;
-	TSTRING name( section->section_name );
+	std::lock_guard<std::mutex> lock( Writer );
+	StatTimer<LoadStatCounters> timer( Stats, LOAD_ADD_SECTION_NS );
 
 	/* section headers are case insensitive */
-	std::transform( name.begin(), name.end(), name.begin(), ::toupper );
-	ParserBase* newBase = GetSection( name );
+	const TSTRING name = util::FoldedString( section->section_name );
+
+	/* reloaded parsers outlive the file they were parsed from, so they keep their entries on the heap */
+	Arena* arena = ( flags & CONFIG_RELOAD ) ? nullptr : &Memory;
+
+	if ( Sections.find( name ) == Sections.end() && ParseSection( name, section, arena ) )
+	{
+		section->owner = this;
+		Sections[name] = section;
+		PublishSections();
+		Generation.fetch_add( 1, std::memory_order_release );
+		Stats.Add( LOAD_ADD_SECTIONS );
+		retrn = true;
+	}
+	return retrn;
+}
+
+
+bool
+ConfigLoader::ParseSection( const TSTRING& name, ParserBase* section, Arena* arena )
+{
+	if ( Image.IsOpen() )
+	{
+		return ParseImageSection( name, section, arena );
+	}
 
-	if ( newBase == nullptr )
+	FileMapping::iterator fit = FileMap.find( name );
+	if ( fit == FileMap.end() )
 	{
-		std::vector<TSTRING> sectionMap;
-		if ( FileMap.count( name ) != 0 )
+		return false;
+	}
+
+	if ( !fit->second.scanned )
+	{
+		ScanSection( fit->second );
+	}
+
+	StatTimer<ParserStatCounters> timer( section->stats, PARSER_PARSE_NS );
+	const std::vector<Range>& sectionMap = fit->second.lines;
+	StringView contents = File.Contents();
+	size_t entries = 0;
+
+	if ( arena != nullptr )
+	{
+		section->UseArena( arena );
+	}
+
+	/* parse the existing section using the new parser */
+	LineCounter counter( contents );
+	for ( unsigned int r = 0; r < sectionMap.size(); ++r )
+	{
+		entries += sectionMap[r].last - sectionMap[r].first;
+		for ( size_t i = sectionMap[r].first; i < sectionMap[r].last; ++i )
+		{
+			const ScannedLine& line = Lines[i];
+			if ( line.key_begin == line.key_end && line.HasValue() )
+			{
+				AddMessage( DIAG_EMPTY_KEY, section->section_name, 0, line.start, counter.LineAt( line.start ) );
+			}
+			ParseEntry( section, line.Key( contents ), line.Value( contents ), line.HasValue() );
+		}
+	}
+
+	section->stats.Add( PARSER_ENTRIES, entries );
+	if ( section->auto_key > 0 )
+	{
+		Stats.Add( LOAD_AUTO_KEYS, section->auto_key );
+		AddMessage( DIAG_AUTO_KEYS, section->section_name, section->auto_key );
+	}
+	section->count_lookups = ( flags & CONFIG_LOOKUP_STATS ) != 0;
+	if ( flags & CONFIG_PROFILE )
+	{
+		section->StartProfile( KeyProfile::DEFAULT_PERIOD );
+	}
+	return true;
+}
+
+
+bool
+ConfigLoader::ParseImageSection( const TSTRING& name, ParserBase* section, Arena* arena )
+{
+	const ConfigImage::SectionRecord* record = Image.FindSection( name );
+	if ( record == nullptr )
+	{
+		return false;
+	}
+
+	StatTimer<ParserStatCounters> timer( section->stats, PARSER_PARSE_NS );
+	if ( arena != nullptr )
+	{
+		section->UseArena( arena );
+	}
+
+	/* keys and values were split and trimmed when the image was compiled */
+	const ConfigImage::EntryRecord* entries = Image.Entries( *record );
+	for ( UINT32 i = 0; i < record->entry_count; ++i )
+	{
+		if ( entries[i].key_length == 0 && ( entries[i].flags & ConfigImage::ENTRY_HAS_VALUE ) )
+		{
+			AddMessage( DIAG_EMPTY_KEY, section->section_name );
+		}
+		ParseEntry( section, Image.Key( entries[i] ), Image.Value( entries[i] ), ( entries[i].flags & ConfigImage::ENTRY_HAS_VALUE ) != 0 );
+	}
+
+	section->stats.Add( PARSER_ENTRIES, record->entry_count );
+	if ( section->auto_key > 0 )
+	{
+		Stats.Add( LOAD_AUTO_KEYS, section->auto_key );
+		AddMessage( DIAG_AUTO_KEYS, section->section_name, section->auto_key );
+	}
+	section->count_lookups = ( flags & CONFIG_LOOKUP_STATS ) != 0;
+	if ( flags & CONFIG_PROFILE )
+	{
+		section->StartProfile( KeyProfile::DEFAULT_PERIOD );
+	}
+	return true;
+}
+
+
+void
+ConfigLoader::ParseEntry( ParserBase* section, const StringView& key, const StringView& value, const bool hasValue )
+{
+	/* Section is designed to use indexing ( key, value ), but if there is
+	 * no key found, then an 'auto-key' will be generated. */
+	if( hasValue )
+	{
+		section->Parse( key, value );
+	}
+	else
+	{
+		section->Parse( util::Int64ToString( ++section->auto_key ), key.str() );
+	}
+}
+
+
+bool
+ConfigLoader::Reload()
+{
+	std::vector<SectionChange> changes;
+	{
+		std::lock_guard<std::mutex> lock( Writer );
+		std::vector<ParserBase*> retired;
+
+		/* attached images are only replaced by a newer published image, checking for one reads a single counter */
+		if ( Image.IsShared() && Image.LatestGeneration() == Image.Generation() )
+		{
+			return true;
+		}
+		Stats.Add( LOAD_RELOADS );
+
+		bool compareKeys;
+		{
+			std::lock_guard<std::mutex> subscriberLock( subscriber_lock );
+			compareKeys = !subscribers.empty();
+		}
+
+		/* keep the previous load so the new file can be compared to it, or restored if it fails to open */
+		MappedFile previousFile;
+		std::vector<ScannedLine> previousLines;
+		FileMapping previousMap( 0, FileMapping::hasher(), FileMapping::key_equal(), FileMapping::allocator_type( nullptr ) );
+		ConfigImage previousImage;
+
+		if ( Image.IsShared() )
+		{
+			previousImage.Swap( Image );
+			if ( !Image.Attach( ConfigImage::SharedName( fullPath ), fullPath, ( flags & CONFIG_VERIFY_IMAGE ) != 0 ) )
+			{
+				Image.Swap( previousImage );
+				return false;
+			}
+			Stats.Add( LOAD_BYTES, Image.Size() );
+			DiffImages( previousImage, changes, compareKeys );
+		}
+		else
 		{
-			sectionMap = FileMap[name];
+			/* the swap moves the heap allocator into FileMap, so the maps of later loads are not kept in the arena */
+			previousFile.Swap( File );
+			previousLines.swap( Lines );
+			previousMap.swap( FileMap );
 
-			/* parse the existing section using the new parser */
-			TSTRING key;
-			TSTRING value;
-			TSTRING line;
-			TSTRING::size_type index;
-			for ( unsigned int i = 0; i < sectionMap.size(); ++i )
+			/* the diff needs the text, so reloads never use an image */
+			if ( !LoadFile( false ) )
 			{
-				line = sectionMap[i];
-				index = line.find( '=' );
-				/* Section is designed to use indexing ( key, value ), but if there is
-				 * no key found, then an 'auto-key' will be generated. */
-				if( index != TSTRING::npos )
-				{
-					key = line.substr( 0, index );
-                    key = util::trim( key );
-                    
-					value = line.substr( index + 1 );
-                    value = util::trim( value );
-				}
-				else
-				{
-					key = util::Int64ToString( ++section->auto_key );
-					value = util::trim( line );
-				}
-				section->Parse( key, value );
+				File.Swap( previousFile );
+				Lines.swap( previousLines );
+				FileMap.swap( previousMap );
+				return false;
 			}
-			Sections[name] = section;
-			if ( section->auto_key > 0 )
+			Image.Close();
+			/* a mapped file written in place shows the new contents through the old mapping */
+			DiffSections( previousFile.Contents(), previousMap, !previousFile.IsMapped(), changes, compareKeys );
+		}
+
+		/* parse changed sections into new parsers, readers keep using the old ones until the new set is published */
+		for ( size_t c = 0; c < changes.size(); ++c )
+		{
+			StorageMap::iterator sit = Sections.find( changes[c].section );
+			if ( sit == Sections.end() )
 			{
-				AddMessage( TEXT("AutoKeys Generated for section %s: %d"), section->section_name.c_str(), section->auto_key );
+				continue;
 			}
-			retrn = true;
+
+			ParserBase* fresh = sit->second->Create();
+			if ( fresh == nullptr )
+			{
+				AddMessage( DIAG_RELOAD_UNSUPPORTED, sit->second->section_name );
+				continue;
+			}
+
+			/* the arena is only released when the file closes, so parsers replaced on every reload live on the heap */
+			fresh->owner = this;
+			ParseSection( sit->first, fresh, nullptr );
+			retired.push_back( sit->second );
+			Sections.mapped_at( sit ) = fresh;
+			changes[c].reparsed = true;
+		}
+
+		/* no reader inside a ReadGuard can be using the old parsers once the new set is published */
+		if ( !retired.empty() )
+		{
+			PublishSections();
+		}
+
+		/* key handles resolve again once the new parsers can be found */
+		if ( !retired.empty() )
+		{
+			Generation.fetch_add( 1, std::memory_order_release );
+		}
+
+		for ( size_t i = 0; i < retired.size(); ++i )
+		{
+			delete retired[i];
 		}
 	}
-	return retrn;
+
+	if ( !changes.empty() )
+	{
+		/* callbacks are copied so they can subscribe or unsubscribe while being called */
+		std::vector<std::pair<int, ChangeCallback>> callbacks;
+		{
+			std::lock_guard<std::mutex> lock( subscriber_lock );
+			callbacks = subscribers;
+		}
+		for ( size_t i = 0; i < callbacks.size(); ++i )
+		{
+			callbacks[i].second( changes );
+		}
+	}
+	return true;
 }
 
+
+UINT64
+ConfigLoader::HashSection( const StringView& contents, const std::vector<Range>* bytes )
+{
+	UINT64 hash = util::HashString64( nullptr, 0 );
+	if ( bytes != nullptr )
+	{
+		for ( size_t i = 0; i < bytes->size(); ++i )
+		{
+			hash = util::HashString64( contents.data() + ( *bytes )[i].first, ( *bytes )[i].last - ( *bytes )[i].first, hash );
+		}
+	}
+	return hash;
+}
+
+
+UINT64
+ConfigLoader::HashImageSection( const ConfigImage& image, const ConfigImage::SectionRecord* section )
+{
+	UINT64 hash = util::HashString64( nullptr, 0 );
+	if ( section != nullptr )
+	{
+		const ConfigImage::EntryRecord* entries = image.Entries( *section );
+		for ( UINT32 i = 0; i < section->entry_count; ++i )
+		{
+			/* keys can not hold an '=' and no part of an entry can hold a new line, so entries hash apart */
+			const TCHAR separator = ( entries[i].flags & ConfigImage::ENTRY_HAS_VALUE ) ? TEXT('=') : TEXT('\n');
+			const TCHAR end = TEXT('\n');
+			const StringView key = image.Key( entries[i] );
+			const StringView value = image.Value( entries[i] );
+			hash = util::HashString64( key.data(), key.size(), hash );
+			hash = util::HashString64( &separator, 1, hash );
+			hash = util::HashString64( value.data(), value.size(), hash );
+			hash = util::HashString64( &end, 1, hash );
+		}
+	}
+	return hash;
+}
+
+
+void
+ConfigLoader::CollectImageEntries( const ConfigImage& image, const ConfigImage::SectionRecord* section, std::map<TSTRING, TSTRING>& entries )
+{
+	INT64 autoKey = 0;
+
+	if ( section == nullptr )
+	{
+		return;
+	}
+
+	const ConfigImage::EntryRecord* records = image.Entries( *section );
+	for ( UINT32 i = 0; i < section->entry_count; ++i )
+	{
+		if ( records[i].flags & ConfigImage::ENTRY_HAS_VALUE )
+		{
+			entries.insert( std::make_pair( image.Key( records[i] ).str(), image.Value( records[i] ).str() ) );
+		}
+		else
+		{
+			entries.insert( std::make_pair( util::Int64ToString( ++autoKey ), image.Key( records[i] ).str() ) );
+		}
+	}
+}
+
+
+void
+ConfigLoader::DiffImages( const ConfigImage& previous, std::vector<SectionChange>& changes, const bool compareKeys ) const
+{
+	std::map<TSTRING, TSTRING> before;
+	std::map<TSTRING, TSTRING> after;
+
+	/* images hold each section once with an upper case name, so names compare as they do for the file map */
+	for ( size_t s = 0; s < Image.SectionCount(); ++s )
+	{
+		const ConfigImage::SectionRecord& section = Image.Section( s );
+		const ConfigImage::SectionRecord* old = previous.FindSection( KeyView( Image.Name( section ) ) );
+		if ( old != nullptr && HashImageSection( previous, old ) == HashImageSection( Image, &section ) )
+		{
+			continue;
+		}
+
+		SectionChange change;
+		change.type = ( old != nullptr ) ? CHANGE_MODIFIED : CHANGE_ADDED;
+		change.section = Image.Name( section ).str();
+		change.reparsed = false;
+		if ( compareKeys )
+		{
+			before.clear();
+			after.clear();
+			CollectImageEntries( previous, old, before );
+			CollectImageEntries( Image, &section, after );
+			CompareEntries( before, after, change.keys );
+		}
+		changes.push_back( change );
+	}
+
+	for ( size_t s = 0; s < previous.SectionCount(); ++s )
+	{
+		const ConfigImage::SectionRecord& section = previous.Section( s );
+		if ( Image.FindSection( KeyView( previous.Name( section ) ) ) == nullptr )
+		{
+			SectionChange change;
+			change.type = CHANGE_REMOVED;
+			change.section = previous.Name( section ).str();
+			change.reparsed = false;
+			if ( compareKeys )
+			{
+				before.clear();
+				after.clear();
+				CollectImageEntries( previous, &section, before );
+				CompareEntries( before, after, change.keys );
+			}
+			changes.push_back( change );
+		}
+	}
+
+	std::sort( changes.begin(), changes.end(), []( const SectionChange& lhs, const SectionChange& rhs )
+	{
+		return lhs.section < rhs.section;
+	} );
+}
+
+
+void
+ConfigLoader::DiffSections( const StringView& previous, const FileMapping& previousMap, const bool comparable,
+							std::vector<SectionChange>& changes, const bool compareKeys ) const
+{
+	StringView current = File.Contents();
+	FileMapping::const_iterator fit;
+
+	for ( fit = FileMap.begin(); fit != FileMap.end(); ++fit )
+	{
+		FileMapping::const_iterator pit = previousMap.find( fit->first );
+		const std::vector<Range>* previousBytes = ( pit != previousMap.end() ) ? &pit->second.bytes : nullptr;
+
+		if ( comparable && previousBytes != nullptr && HashSection( previous, previousBytes ) == HashSection( current, &fit->second.bytes ) )
+		{
+			continue;
+		}
+
+		SectionChange change;
+		change.type = ( previousBytes != nullptr ) ? CHANGE_MODIFIED : CHANGE_ADDED;
+		change.section = fit->first;
+		change.reparsed = false;
+		if ( compareKeys && ( comparable || previousBytes == nullptr ) )
+		{
+			DiffKeys( previous, previousBytes, current, &fit->second.bytes, change.keys );
+		}
+		changes.push_back( change );
+	}
+
+	for ( fit = previousMap.begin(); fit != previousMap.end(); ++fit )
+	{
+		if ( FileMap.count( fit->first ) == 0 )
+		{
+			SectionChange change;
+			change.type = CHANGE_REMOVED;
+			change.section = fit->first;
+			change.reparsed = false;
+			if ( compareKeys && comparable )
+			{
+				DiffKeys( previous, &fit->second.bytes, current, nullptr, change.keys );
+			}
+			changes.push_back( change );
+		}
+	}
+
+	/* the file map is unordered, report sections in name order */
+	std::sort( changes.begin(), changes.end(), []( const SectionChange& lhs, const SectionChange& rhs )
+	{
+		return lhs.section < rhs.section;
+	} );
+}
+
+
+void
+ConfigLoader::CollectEntries( const StringView& contents, const std::vector<Range>* bytes, std::map<TSTRING, TSTRING>& entries )
+{
+	std::vector<ScannedLine> lines;
+	INT64 autoKey = 0;
+
+	if ( bytes == nullptr )
+	{
+		return;
+	}
+
+	for ( size_t r = 0; r < bytes->size(); ++r )
+	{
+		const Range& range = ( *bytes )[r];
+		LineScanner::Scan( contents.substr( range.first, range.last - range.first ), lines, range.first );
+	}
+
+	for ( size_t i = 0; i < lines.size(); ++i )
+	{
+		if ( lines[i].HasValue() )
+		{
+			entries.insert( std::make_pair( lines[i].Key( contents ).str(), lines[i].Value( contents ).str() ) );
+		}
+		else
+		{
+			entries.insert( std::make_pair( util::Int64ToString( ++autoKey ), lines[i].Key( contents ).str() ) );
+		}
+	}
+}
+
+
+void
+ConfigLoader::DiffKeys( const StringView& previous, const std::vector<Range>* previousBytes,
+						const StringView& current, const std::vector<Range>* currentBytes,
+						std::vector<KeyChange>& keys )
+{
+	std::map<TSTRING, TSTRING> before;
+	std::map<TSTRING, TSTRING> after;
+	CollectEntries( previous, previousBytes, before );
+	CollectEntries( current, currentBytes, after );
+	CompareEntries( before, after, keys );
+}
+
+
+void
+ConfigLoader::CompareEntries( const std::map<TSTRING, TSTRING>& before, const std::map<TSTRING, TSTRING>& after,
+							  std::vector<KeyChange>& keys )
+{
+	/* walk both sorted maps together */
+	std::map<TSTRING, TSTRING>::const_iterator bit = before.begin();
+	std::map<TSTRING, TSTRING>::const_iterator ait = after.begin();
+	while ( bit != before.end() || ait != after.end() )
+	{
+		KeyChange change;
+		if ( ait == after.end() || ( bit != before.end() && bit->first < ait->first ) )
+		{
+			change.type = CHANGE_REMOVED;
+			change.key = bit->first;
+			change.old_value = bit->second;
+			++bit;
+		}
+		else if ( bit == before.end() || ait->first < bit->first )
+		{
+			change.type = CHANGE_ADDED;
+			change.key = ait->first;
+			change.new_value = ait->second;
+			++ait;
+		}
+		else
+		{
+			change.type = CHANGE_MODIFIED;
+			change.key = bit->first;
+			change.old_value = bit->second;
+			change.new_value = ait->second;
+			++bit;
+			++ait;
+			if ( change.old_value == change.new_value )
+			{
+				continue;
+			}
+		}
+		keys.push_back( change );
+	}
+}
+
+
+int
+ConfigLoader::Subscribe( const ChangeCallback& callback )
+{
+	std::lock_guard<std::mutex> lock( subscriber_lock );
+	subscribers.push_back( std::make_pair( ++next_subscriber, callback ) );
+	return next_subscriber;
+}
+
+
+void
+ConfigLoader::Unsubscribe( const int id )
+{
+	std::lock_guard<std::mutex> lock( subscriber_lock );
+	for ( size_t i = 0; i < subscribers.size(); ++i )
+	{
+		if ( subscribers[i].first == id )
+		{
+			subscribers.erase( subscribers.begin() + i );
+			return;
+		}
+	}
+}
+
+
+ConfigLoader::StorageMap*
+ConfigLoader::CopySections() const
+{
+	/* copies are kept on the heap, the arena would hold on to every copy replaced until the file is closed */
+	StorageMap* copy = new StorageMap( StorageMap::allocator_type( nullptr ) );
+	StorageMap::const_iterator sit;
+	for ( sit = Sections.begin(); sit != Sections.end(); ++sit )
+	{
+		copy->insert( *sit );
+	}
+	return copy;
+}
+
+
+bool
+ConfigLoader::SharedImageChanged()
+{
+	/* Reload swaps the attached image, so it is only read under the writer lock */
+	std::lock_guard<std::mutex> lock( Writer );
+	return Image.IsShared() && Image.LatestGeneration() != Image.Generation();
+}
+
+
+void
+ConfigLoader::PublishSections()
+{
+	const StorageMap* old = Published.exchange( CopySections() );
+
+	/* wait for readers that may have found a parser through the old copy */
+	OpenConfigs.Synchronize();
+	delete old;
+}
+
+
 void
 ConfigLoader::DeleteSection( const TSTRING& section_name )
 {
 	/* Not currently implemented, ( never been needed ). */
+	( void ) section_name;
 }
 
 
 ParserBase*
-ConfigLoader::GetFileSection( const TSTRING& file, const TSTRING& section )
+ConfigLoader::GetFileSection( const TSTRING& file, const KeyView& section )
 {
 	TSTRING sanitised = RemoveExtension( file );
-	if( OpenConfigs.count( sanitised ) )
+	ConfigRegistry::ReadGuard guard( OpenConfigs );
+	ConfigLoader* config = OpenConfigs.Find( sanitised );
+	if( config != nullptr )
 	{
-		return OpenConfigs[sanitised]->GetSection( section );
+		return config->GetSection( section );
 	}
 	return nullptr;
 }
 
 
 ParserBase*
-ConfigLoader::GetSection( const TSTRING& section_name )
+ConfigLoader::GetSection( const KeyView& section_name )
 {
-	TSTRING name( section_name );
-	/* section headers are case insensitive */
-	std::transform( name.begin(), name.end(), name.begin(), ::toupper );
-	if( Sections.count( name ) != 0 )
+	/* section headers are case insensitive, the map compares names ignoring case */
+	const StorageMap* sections = Published.load();
+	StorageMap::const_iterator sit = sections->find( section_name.View(), section_name.FoldedHash() );
+	if( sit != sections->end() )
 	{
-		return Sections[name];
+		if ( flags & CONFIG_LOOKUP_STATS )
+		{
+			Stats.Add( LOAD_SECTION_HITS );
+		}
+		return sit->second;
+	}
+	if ( flags & CONFIG_LOOKUP_STATS )
+	{
+		Stats.Add( LOAD_SECTION_MISSES );
 	}
 	return nullptr;
 }
 
 
 void
-ConfigLoader::LoadFile()
+ConfigLoader::ResolvePath()
 {
-	TSTRING value;
-	std::vector<TSTRING>* sectionMap = nullptr;
-    
-	TCHAR exeLocation[MAX_PATH];
-	
 	TSTRING::size_type ext = fileName.rfind( '.' );
 	if ( ext != TSTRING::npos )
 	{
@@ -205,8 +941,11 @@ ConfigLoader::LoadFile()
 		fileType = TEXT(".ini");
 	}
 
+#ifdef _WIN32
 	if( filePath.size() > 2 && filePath[1] != TEXT(':') )
 	{
+		TCHAR exeLocation[MAX_PATH];
+
 		/* if file opening fails attempt to use the exe location */
 		HMODULE hm = NULL;
 		GetModuleHandleEx(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
@@ -224,43 +963,156 @@ ConfigLoader::LoadFile()
         
 		filePath = TSTRING( exeLocationStr ) + filePath + TEXT('\\');
 	}
+#else
+	/* the same rules with '/' as the root, relative paths are taken from the exe location */
+	std::replace( filePath.begin(), filePath.end(), TEXT('\\'), TEXT('/') );
+	if ( filePath.size() > 2 && filePath[0] != TEXT('/') )
+	{
+		char exeLocation[PATH_MAX];
+		ssize_t length = readlink( "/proc/self/exe", exeLocation, sizeof( exeLocation ) - 1 );
+		if ( length > 0 )
+		{
+			TSTRING exeLocationStr( exeLocation, exeLocation + length );
+			exeLocationStr.erase( exeLocationStr.find_last_of( TEXT('/') ) + 1 );
+			filePath = exeLocationStr + filePath;
+		}
+	}
+	if ( !filePath.empty() && filePath[filePath.size() - 1] != TEXT('/') )
+	{
+		filePath += TEXT('/');
+	}
+#endif
+}
 
-	TSTREAM infile( filePath + fileName );
-	if ( !infile.is_open() )
+
+bool
+ConfigLoader::LoadFile( const bool useImage )
+{
+	TSTRING value;
+	SectionRanges* sectionMap = nullptr;
+
+	/* the publisher compiles the file for other processes, its own sections are loaded as usual */
+	if ( ( flags & CONFIG_PUBLISH ) && !Publisher.Publish( filePath + fileName, ConfigImage::SharedName( filePath + fileName ) ) )
 	{
-		AddMessage( TEXT("Failed to open config file: %s"), TSTRING(filePath + fileName).c_str() );
-		return;
+		AddMessage( DIAG_PUBLISH_FAILED );
+	}
+
+	{
+		/* only opening and reading or mapping, pages of a mapped file are read as they are scanned */
+		StatTimer<LoadStatCounters> timer( Stats, LOAD_IO_NS );
+
+		/* an image published by another process is used if there is one, shared images are
+		 * reloaded by attaching to a newer generation so they are also used by reloading configs */
+		if ( useImage && ( flags & CONFIG_SHARED ) &&
+			 Image.Attach( ConfigImage::SharedName( filePath + fileName ), filePath + fileName, ( flags & CONFIG_VERIFY_IMAGE ) != 0 ) )
+		{
+			Stats.Add( LOAD_BYTES, Image.Size() );
+			return true;
+		}
+
+		/* a compiled image that is up to date with the file replaces scanning the text,
+		 * reloading configs always use the text as they compare it between loads */
+		if ( useImage && !( flags & CONFIG_RELOAD ) &&
+			 Image.Open( ConfigImage::ImagePath( filePath + fileName ), filePath + fileName, ( flags & CONFIG_VERIFY_IMAGE ) != 0 ) )
+		{
+			Stats.Add( LOAD_BYTES, Image.Size() );
+			return true;
+		}
+
+		if ( !File.Open( filePath + fileName, useImage && ( flags & CONFIG_MAPPED ) && !( flags & CONFIG_RELOAD ) ) )
+		{
+			AddMessage( DIAG_OPEN_FAILED );
+			return false;
+		}
+	}
+
+	StatTimer<LoadStatCounters> timer( Stats, LOAD_SCAN_NS );
+	StringView contents = File.Contents();
+	Stats.Add( LOAD_BYTES, contents.size() * sizeof( TCHAR ) );
+	if ( flags & CONFIG_LAZY )
+	{
+		LineScanner::ScanSections( contents, Lines );
+	}
+	else
+	{
+		LineScanner::Scan( contents, Lines );
 	}
 
 	/* DEFAULT is now a default section that will be used if no others are avaliable */
 	sectionMap = &FileMap[TEXT("DEFAULT")];
+	sectionMap->scanned = !( flags & CONFIG_LAZY );
 
-    TSTRING line;
-	while (std::getline(infile, line))
-    {
-		/*-- if this line is not a comment and not blank--*/
-		if ( line[0] != ';' && line[0] )
+	Range lines = { 0, 0 };
+	Range bytes = { 0, 0 };
+	LineCounter counter( contents );
+	for ( size_t i = 0; i < Lines.size(); ++i )
+	{
+		if ( Lines[i].type == LINE_SECTION )
 		{
-			if ( line[0] == '[' )
+			if ( Lines[i].split == ScannedLine::NO_SPLIT )
 			{
-				value = line.substr( 1, line.find( ']' ) - 1 );
-				/* section headers are case insensitive */
-				std::transform( value.begin(), value.end(), value.begin(), ::toupper );
-				sectionMap = &FileMap[value];
+				AddMessage( DIAG_UNTERMINATED_SECTION, Lines[i].SectionName( contents ), 0, Lines[i].start, counter.LineAt( Lines[i].start ) );
 			}
-			else
+
+			/* close off the previous section, lazy loads only have headers so never have lines */
+			lines.last = i;
+			bytes.last = Lines[i].start;
+			if ( lines.last > lines.first )
 			{
-				if ( sectionMap )
-				{
-					sectionMap->push_back( line );
-				}
-				else
-				{
-					AddMessage( TEXT("Attempted to write to null section\n") );
-				}
+				sectionMap->lines.push_back( lines );
 			}
+			if ( bytes.last > bytes.first )
+			{
+				sectionMap->bytes.push_back( bytes );
+			}
+			lines.first = i + 1;
+			bytes.first = Lines[i].NextLine( contents );
+
+			/* section headers are case insensitive */
+			value = util::FoldedString( Lines[i].SectionName( contents ) );
+			sectionMap = &FileMap[value];
+			sectionMap->scanned = !( flags & CONFIG_LAZY );
 		}
 	}
+
+	lines.last = Lines.size();
+	bytes.last = contents.size();
+	if ( lines.last > lines.first )
+	{
+		sectionMap->lines.push_back( lines );
+	}
+	if ( bytes.last > bytes.first )
+	{
+		sectionMap->bytes.push_back( bytes );
+	}
+	Stats.Add( LOAD_LINES, Lines.size() );
+	return true;
+}
+
+
+void
+ConfigLoader::ScanSection( SectionRanges& section )
+{
+	StatTimer<LoadStatCounters> timer( Stats, LOAD_SCAN_NS );
+	StringView contents = File.Contents();
+	const size_t scanned = Lines.size();
+	Range lines;
+
+	for ( unsigned int i = 0; i < section.bytes.size(); ++i )
+	{
+		const Range& bytes = section.bytes[i];
+
+		lines.first = Lines.size();
+		LineScanner::Scan( contents.substr( bytes.first, bytes.last - bytes.first ), Lines, bytes.first );
+		lines.last = Lines.size();
+
+		if ( lines.last > lines.first )
+		{
+			section.lines.push_back( lines );
+		}
+	}
+	section.scanned = true;
+	Stats.Add( LOAD_LINES, Lines.size() - scanned );
 }
 
 
@@ -270,16 +1122,12 @@ ConfigLoader::CloseAll( const bool force )
 	TSTRING::size_type i = 0;
 	std::vector<TSTRING> filenames;
 
-	ConfigMap::iterator sit;
-	for ( sit = OpenConfigs.begin(); sit != OpenConfigs.end(); ++sit )
-	{
-		filenames.push_back( sit->second->fileName );
-	}
+	/* take a copy of the names as closing a config changes the registry */
+	OpenConfigs.Names( filenames );
 
-	/* we need to do this because CloseConfig will invalidate sit when called */
 	for ( i = 0; i < filenames.size(); ++i )
 	{
-		CloseConfig( filenames[i], true );
+		CloseConfig( filenames[i], force );
 	}
 }
 
@@ -287,7 +1135,10 @@ ConfigLoader::CloseAll( const bool force )
 void
 ConfigLoader::CloseConfig(ConfigLoader* config, const bool force)
 {
-	CloseConfig( config->fileName, force );
+	if ( config->Release( force ) )
+	{
+		Retire( config );
+	}
 }
 
 
@@ -295,25 +1146,17 @@ void
 ConfigLoader::CloseConfig(const TSTRING& filename, const bool force)
 {
 	TSTRING sanitised = RemoveExtension( filename );
-	ConfigMap::iterator sit;
+	ConfigLoader* config = nullptr;
 
-	if ( OpenConfigs.size() > 0 )
 	{
-		if( OpenConfigs.count( sanitised ) )
+		ConfigRegistry::ReadGuard guard( OpenConfigs );
+		config = OpenConfigs.Find( sanitised );
+		if ( config == nullptr || !config->Release( force ) )
 		{
-			sit = OpenConfigs.find( sanitised );
-
-			sit->second->references -= 1;
-			if ( force )
-			{
-				sit->second->references = 0;
-			}
-
-			if ( sit->second->references <= 0 )
-			{
-				delete sit->second;
-				OpenConfigs.erase( sit );
-			}
+			return;
 		}
 	}
+
+	/* this thread dropped the last reference, Retire must be called outside of the guard */
+	Retire( config );
 }
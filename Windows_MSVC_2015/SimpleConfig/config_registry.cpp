@@ -0,0 +1,175 @@
+#include "config_registry.h"
+
+#include <thread>
+
+#include "utility.h"
+
+/**
+ * @return reader slot of the calling thread, assigned round robin on first use.
+ */
+static size_t
+ReaderSlot()
+{
+	static std::atomic<size_t> next( 0 );
+	static thread_local size_t slot = next.fetch_add( 1 ) % ConfigRegistry::READER_SLOTS;
+	return slot;
+}
+
+
+ConfigRegistry::ReadGuard::ReadGuard( ConfigRegistry& registry )
+{
+	/* readers that enter as the phase flips may use either set of counters,
+	 * Synchronize waits for both so it does not matter which */
+	counter = &registry.counters[registry.phase.load() & 1][ReaderSlot()].readers;
+	counter->fetch_add( 1 );
+}
+
+
+ConfigRegistry::ReadGuard::~ReadGuard()
+{
+	counter->fetch_sub( 1 );
+}
+
+
+ConfigRegistry::ConfigRegistry()
+	: phase( 0 )
+{
+	for ( size_t i = 0; i < SHARDS; ++i )
+	{
+		shards[i].table.store( nullptr );
+	}
+	for ( size_t p = 0; p < 2; ++p )
+	{
+		for ( size_t i = 0; i < READER_SLOTS; ++i )
+		{
+			counters[p][i].readers.store( 0 );
+		}
+	}
+}
+
+
+ConfigRegistry::~ConfigRegistry()
+{
+	for ( size_t i = 0; i < SHARDS; ++i )
+	{
+		delete shards[i].table.load();
+	}
+}
+
+
+ConfigRegistry::Shard&
+ConfigRegistry::ShardFor( const TSTRING& name ) const
+{
+	return shards[util::HashString( name.data(), name.size() ) & ( SHARDS - 1 )];
+}
+
+
+ConfigLoader*
+ConfigRegistry::Find( const TSTRING& name ) const
+{
+	const Table* table = ShardFor( name ).table.load();
+	if ( table != nullptr )
+	{
+		Table::const_iterator it = table->find( name );
+		if ( it != table->end() )
+		{
+			return it->second;
+		}
+	}
+	return nullptr;
+}
+
+
+std::mutex&
+ConfigRegistry::ShardLock( const TSTRING& name )
+{
+	return ShardFor( name ).lock;
+}
+
+
+void
+ConfigRegistry::Insert( const TSTRING& name, ConfigLoader* config )
+{
+	Shard& shard = ShardFor( name );
+	const Table* current = shard.table.load();
+	Table* table = ( current != nullptr ) ? new Table( *current ) : new Table();
+
+	( *table )[name] = config;
+	Publish( shard, table );
+}
+
+
+bool
+ConfigRegistry::Remove( const TSTRING& name, ConfigLoader* config )
+{
+	Shard& shard = ShardFor( name );
+	const Table* current = shard.table.load();
+	if ( current == nullptr )
+	{
+		return false;
+	}
+
+	Table::const_iterator it = current->find( name );
+	if ( it == current->end() || it->second != config )
+	{
+		return false;
+	}
+
+	Table* table = new Table( *current );
+	table->erase( name );
+	Publish( shard, table );
+	return true;
+}
+
+
+void
+ConfigRegistry::Names( std::vector<TSTRING>& names )
+{
+	/* a table replaced while it is walked is only freed once the guard is left */
+	ReadGuard guard( *this );
+	for ( size_t i = 0; i < SHARDS; ++i )
+	{
+		const Table* table = shards[i].table.load();
+		if ( table != nullptr )
+		{
+			Table::const_iterator it;
+			for ( it = table->begin(); it != table->end(); ++it )
+			{
+				names.push_back( it->first );
+			}
+		}
+	}
+}
+
+
+void
+ConfigRegistry::Publish( Shard& shard, const Table* table )
+{
+	const Table* old = shard.table.exchange( table );
+	if ( old != nullptr )
+	{
+		Synchronize();
+		delete old;
+	}
+}
+
+
+void
+ConfigRegistry::Synchronize()
+{
+	std::lock_guard<std::mutex> lock( grace );
+
+	/* flip the phase twice, waiting for the readers of each phase to drain,
+	 * so a reader that read the phase just before a flip is still waited for */
+	for ( int flip = 0; flip < 2; ++flip )
+	{
+		unsigned int old = phase.fetch_add( 1 ) & 1;
+		for ( size_t i = 0; i < READER_SLOTS; ++i )
+		{
+			while ( counters[old][i].readers.load() != 0 )
+			{
+				std::this_thread::yield();
+			}
+		}
+	}
+}
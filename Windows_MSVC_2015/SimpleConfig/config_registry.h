@@ -0,0 +1,158 @@
+
+#ifndef _CONFIG_REGISTRY_H_
+#define _CONFIG_REGISTRY_H_
+
+/**
+ * @file config_registry.h
+ * File containing the thread safe registry of open configuration files.
+ */
+
+#include "platform.h"
+
+#include <mutex>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include "unicode_defines.h"
+
+class ConfigLoader; /**< Forward declaration, the registry only stores pointers. */
+
+/**
+ * Registry of open ConfigLoaders, keyed by sanitised file name.
+ * Names are split across shards by hash, each shard publishes an immutable table that
+ * readers search without taking a lock.\n
+ * Writers copy the table of their shard under the shard's mutex, publish the copy, and wait
+ * for a grace period before the old table ( or a removed ConfigLoader ) is freed, in the same
+ * way as read-copy-update. Readers mark themselves in one of a set of per thread counters,
+ * so concurrent readers on different cores do not write to the same cache line.
+ *
+ * @note Every Find, and every use of the pointer it returns, must be inside a ReadGuard.
+ */
+class ConfigRegistry
+{
+public:
+	static const size_t SHARDS = 16; /**< number of shards, must be a power of two. */
+	static const size_t READER_SLOTS = 64; /**< number of reader counters per phase. */
+
+	/**
+	 * Read side critical section, pointers found while a guard is held remain valid until it is destroyed.
+	 * Guards may be nested.
+	 */
+	class ReadGuard
+	{
+	public:
+		/**
+		 * Constructor, enters the critical section.
+		 * @param registry registry that will be read.
+		 */
+		explicit ReadGuard( ConfigRegistry& registry );
+
+		/**
+		 * Destructor, leaves the critical section.
+		 */
+		~ReadGuard();
+
+	private:
+		ReadGuard( const ReadGuard& );
+		ReadGuard& operator=( const ReadGuard& );
+
+		std::atomic<int>* counter; /**< counter incremented on entry. */
+	};
+
+	/**
+	 * Constructor, creates an empty registry.
+	 */
+	ConfigRegistry();
+
+	/**
+	 * Destructor, frees the tables, ConfigLoaders still in the registry are not deleted.
+	 */
+	~ConfigRegistry();
+
+	/**
+	 * Finds an open config, must be called inside a ReadGuard.
+	 * @param name sanitised name of the config.
+	 * @return pointer to the ConfigLoader, or nullptr if it is not open.
+	 */
+	ConfigLoader* Find( const TSTRING& name ) const;
+
+	/**
+	 * @param name sanitised name of a config.
+	 * @return mutex that serialises changes to the shard holding name.
+	 */
+	std::mutex& ShardLock( const TSTRING& name );
+
+	/**
+	 * Adds or replaces a config, the shard lock for name must be held.
+	 * @param name sanitised name of the config.
+	 * @param config ConfigLoader to store under name.
+	 */
+	void Insert( const TSTRING& name, ConfigLoader* config );
+
+	/**
+	 * Removes a config if it is still the one stored under name, the shard lock for name must be held.
+	 * The caller must Synchronize before deleting the ConfigLoader.
+	 * @param name sanitised name of the config.
+	 * @param config ConfigLoader expected under name.
+	 * @return true if config was removed.
+	 */
+	bool Remove( const TSTRING& name, ConfigLoader* config );
+
+	/**
+	 * Appends the names of every open config.
+	 * Enters a ReadGuard itself, so the tables can not be freed while they are walked.
+	 * @param names vector to append the names to.
+	 */
+	void Names( std::vector<TSTRING>& names );
+
+	/**
+	 * Waits until every ReadGuard that was entered before the call has been left.
+	 * Must not be called inside a ReadGuard.
+	 */
+	void Synchronize();
+
+private:
+	ConfigRegistry( const ConfigRegistry& );
+	ConfigRegistry& operator=( const ConfigRegistry& );
+
+	typedef std::unordered_map<TSTRING, ConfigLoader*> Table;
+
+	/**
+	 * Part of the registry, padded so shards do not share a cache line.
+	 */
+	struct alignas( 64 ) Shard
+	{
+		std::atomic<const Table*> table; /**< published table, nullptr when empty. */
+		std::mutex lock; /**< held by writers while replacing the table. */
+	};
+
+	/**
+	 * Reader counter, padded so each sits on its own cache line.
+	 */
+	struct alignas( 64 ) Counter
+	{
+		std::atomic<int> readers; /**< number of readers inside a ReadGuard. */
+	};
+
+	/**
+	 * @param name sanitised name of a config.
+	 * @return shard holding name.
+	 */
+	Shard& ShardFor( const TSTRING& name ) const;
+
+	/**
+	 * Publishes a new table for a shard and frees the old one after a grace period.
+	 * @param shard shard to update, its lock must be held.
+	 * @param table new table, ownership is taken.
+	 */
+	void Publish( Shard& shard, const Table* table );
+
+	mutable Shard shards[SHARDS]; /**< shards selected by the hash of the name. */
+	Counter counters[2][READER_SLOTS]; /**< reader counters for each phase. */
+	std::atomic<unsigned int> phase; /**< low bit selects the counters new readers use. */
+	std::mutex grace; /**< serialises grace periods. */
+};
+
+#endif
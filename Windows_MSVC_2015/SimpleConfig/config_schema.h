@@ -0,0 +1,370 @@
+
+#ifndef _CONFIG_SCHEMA_H_
+#define _CONFIG_SCHEMA_H_
+
+/**
+ * @file config_schema.h
+ * File containing the schema parser, which binds a section directly into the fields of a struct.
+ */
+
+#include "platform.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "unicode_defines.h"
+#include "string_view.h"
+#include "utility.h"
+#include "flat_map.h"
+#include "config_key.h"
+#include "config_types.h"
+
+/**
+ * Converts the text of an entry to the type of a schema field.
+ * Specialised for INT16, INT32, INT64, double, bool and TSTRING.
+ *
+ * @tparam T type of the field.
+ */
+template <class T>
+struct SchemaConverter;
+
+template <>
+struct SchemaConverter<INT16>
+{
+	static bool Convert( const StringView& text, INT16& value ) { return util::ParseInt16( text, value ); }
+};
+
+template <>
+struct SchemaConverter<INT32>
+{
+	static bool Convert( const StringView& text, INT32& value ) { return util::ParseInt32( text, value ); }
+};
+
+template <>
+struct SchemaConverter<INT64>
+{
+	static bool Convert( const StringView& text, INT64& value ) { return util::ParseInt64( text, value ); }
+};
+
+template <>
+struct SchemaConverter<double>
+{
+	static bool Convert( const StringView& text, double& value ) { return util::ParseDouble( text, value ); }
+};
+
+template <>
+struct SchemaConverter<TSTRING>
+{
+	static bool Convert( const StringView& text, TSTRING& value )
+	{
+		value.assign( text.data(), text.size() );
+		return true;
+	}
+};
+
+template <>
+struct SchemaConverter<bool>
+{
+	/**
+	 * Accepts true, yes, on and 1, or false, no, off and 0, ignoring case.
+	 */
+	static bool Convert( const StringView& text, bool& value )
+	{
+		static const TCHAR* const words[] = { TEXT("TRUE"), TEXT("YES"), TEXT("ON"), TEXT("1"),
+											  TEXT("FALSE"), TEXT("NO"), TEXT("OFF"), TEXT("0") };
+		for ( size_t i = 0; i < sizeof( words ) / sizeof( words[0] ); ++i )
+		{
+			if ( FoldedEqual()( text, StringView( words[i] ) ) )
+			{
+				value = ( i < 4 );
+				return true;
+			}
+		}
+		return false;
+	}
+};
+
+/**
+ * Field of a Schema, type erased so fields of any type can be kept together.
+ *
+ * @tparam Struct struct the field belongs to.
+ */
+template <class Struct>
+class SchemaField
+{
+public:
+	/**
+	 * Constructor
+	 * @param key key of the entry bound to the field.
+	 */
+	explicit SchemaField( const TSTRING& key )
+		: key( key ) {}
+
+	/**
+	 * Virtual Destructor for correct polymorphism.
+	 */
+	virtual ~SchemaField() {}
+
+	/**
+	 * Sets the field to its default.
+	 * @param target struct holding the field.
+	 */
+	virtual void Reset( Struct& target ) const = 0;
+
+	/**
+	 * Converts an entry and stores it in the field.
+	 * @param target struct holding the field.
+	 * @param text value of the entry.
+	 * @param message set when the entry is not valid.
+	 */
+	virtual void Bind( Struct& target, const StringView& text, TSTRING& message ) const = 0;
+
+	TSTRING key; /**< key of the entry bound to the field. */
+};
+
+/**
+ * Field of a Schema holding a T.
+ * Entries that do not convert keep the default, entries outside of the bounds are clamped to them.
+ *
+ * @tparam Struct struct the field belongs to.
+ * @tparam T type of the field, see SchemaConverter.
+ */
+template <class Struct, class T>
+class TypedSchemaField : public SchemaField<Struct>
+{
+public:
+	/**
+	 * Constructor
+	 * @param key key of the entry bound to the field.
+	 * @param member pointer to the field in Struct.
+	 * @param fallback value used when the entry is missing or does not convert.
+	 * @param bounded true if the value must lie between minimum and maximum.
+	 * @param minimum smallest value allowed.
+	 * @param maximum largest value allowed.
+	 */
+	TypedSchemaField( const TSTRING& key, T Struct::* member, const T& fallback, const bool bounded, const T& minimum, const T& maximum )
+		: SchemaField<Struct>( key ), member( member ), fallback( fallback ), bounded( bounded ), minimum( minimum ), maximum( maximum ) {}
+
+	void Reset( Struct& target ) const
+	{
+		target.*member = fallback;
+	}
+
+	void Bind( Struct& target, const StringView& text, TSTRING& message ) const
+	{
+		T value;
+		if ( !SchemaConverter<T>::Convert( text, value ) )
+		{
+			message = TEXT("Invalid Configuration Value: ") + this->key;
+			target.*member = fallback;
+			return;
+		}
+
+		if ( bounded && ( value < minimum || maximum < value ) )
+		{
+			message = TEXT("Configuration Value Out Of Range: ") + this->key;
+			value = ( value < minimum ) ? minimum : maximum;
+		}
+		target.*member = value;
+	}
+
+private:
+	T Struct::* member; /**< the field in Struct. */
+	T fallback; /**< value used when the entry is missing or does not convert. */
+	bool bounded; /**< true if minimum and maximum apply. */
+	T minimum; /**< smallest value allowed. */
+	T maximum; /**< largest value allowed. */
+};
+
+/**
+ * Declares the fields of a struct bound to the entries of a section.
+ * Built once and shared by every SchemaParser using it, including those created when the file is reloaded.
+ * @code
+ * struct ServerSettings
+ * {
+ * 	INT32 port;
+ * 	double timeout;
+ * 	TSTRING name;
+ * };
+ *
+ * std::shared_ptr<Schema<ServerSettings>> schema( new Schema<ServerSettings>() );
+ * schema->Field( TEXT("port"), &ServerSettings::port, 8080, 1, 65535 )
+ * 		.Field( TEXT("timeout"), &ServerSettings::timeout, 2.5 )
+ * 		.Field( TEXT("name"), &ServerSettings::name, TSTRING( TEXT("server") ) );
+ * @endcode
+ *
+ * @tparam Struct default constructible struct holding the fields.
+ */
+template <class Struct>
+class Schema
+{
+	/**
+	 * Keeps T from being deduced from the defaults, so literals convert to the type of the member.
+	 */
+	template <class T>
+	struct Argument
+	{
+		typedef T type;
+	};
+
+public:
+	typedef FlatMap<TSTRING, size_t> FieldIndex; /**< position of each field by key. */
+
+	/**
+	 * Adds a field without bounds.
+	 * @param key key of the entry bound to the field.
+	 * @param member pointer to the field in Struct.
+	 * @param fallback value used when the entry is missing or does not convert.
+	 * @return this schema, so fields can be chained.
+	 */
+	template <class T>
+	Schema& Field( const TSTRING& key, T Struct::* member, const typename Argument<T>::type& fallback )
+	{
+		return Add( new TypedSchemaField<Struct, T>( key, member, fallback, false, fallback, fallback ) );
+	}
+
+	/**
+	 * Adds a field whose value is clamped between two bounds.
+	 * @param key key of the entry bound to the field.
+	 * @param member pointer to the field in Struct.
+	 * @param fallback value used when the entry is missing or does not convert.
+	 * @param minimum smallest value allowed.
+	 * @param maximum largest value allowed.
+	 * @return this schema, so fields can be chained.
+	 */
+	template <class T>
+	Schema& Field( const TSTRING& key, T Struct::* member, const typename Argument<T>::type& fallback,
+				   const typename Argument<T>::type& minimum, const typename Argument<T>::type& maximum )
+	{
+		return Add( new TypedSchemaField<Struct, T>( key, member, fallback, true, minimum, maximum ) );
+	}
+
+	/**
+	 * Sets every field to its default.
+	 * @param target struct to reset.
+	 */
+	void Reset( Struct& target ) const
+	{
+		for ( size_t i = 0; i < fields.size(); ++i )
+		{
+			fields[i]->Reset( target );
+		}
+	}
+
+	/**
+	 * Finds the field bound to a key.
+	 * @param key key of an entry.
+	 * @return the field, or nullptr if no field is bound to the key.
+	 */
+	const SchemaField<Struct>* Find( const KeyView& key ) const
+	{
+		typename FieldIndex::const_iterator fit = index.find( key.View(), key.Hash() );
+		return ( fit != index.end() ) ? fields[fit->second].get() : nullptr;
+	}
+
+private:
+	/**
+	 * Takes ownership of a field, a later field with the same key replaces the earlier one.
+	 */
+	Schema& Add( SchemaField<Struct>* field )
+	{
+		std::pair<typename FieldIndex::iterator, bool> added = index.insert( std::make_pair( field->key, fields.size() ) );
+		if ( added.second )
+		{
+			fields.push_back( std::unique_ptr<const SchemaField<Struct>>( field ) );
+		}
+		else
+		{
+			fields[added.first->second].reset( field );
+		}
+		return *this;
+	}
+
+	std::vector<std::unique_ptr<const SchemaField<Struct>>> fields; /**< the fields, in the order they were added. */
+	FieldIndex index; /**< position of each field by key. */
+};
+
+/**
+ * Parser which converts each entry of its section once, as the section is parsed, into the
+ * fields of a struct declared by a Schema. Reading a setting is then a member access, with
+ * no lookup and no conversion.\n
+ * Fields without an entry keep their default. Keys the schema does not know, entries that do not
+ * convert and values out of bounds are reported by CheckMessage.\n
+ * Supports CONFIG_RELOAD, a reload binds the new file into a new parser, see ConfigLoader::ReadGuard.
+ * @code
+ * SchemaParser<ServerSettings>* server = new SchemaParser<ServerSettings>( TEXT("Server"), schema );
+ * config->AddSection( server );
+ * listen( server->Values().port );
+ * @endcode
+ *
+ * @tparam Struct default constructible struct holding the fields.
+ */
+template <class Struct>
+class SchemaParser : public ParserBase
+{
+public:
+	using ParserBase::Parse;
+
+	/**
+	 * Constructor, every field starts at its default.
+	 * @param sectionName name of the section being hooked into.
+	 * @param schema fields of the struct, shared with parsers created on reload.
+	 */
+	SchemaParser( const TSTRING& sectionName, const std::shared_ptr<const Schema<Struct>>& schema )
+		: ParserBase( sectionName ), schema( schema )
+	{
+		schema->Reset( values );
+	}
+
+	/**
+	 * Creates a parser for the same section and schema, used when the file is reloaded.
+	 * @return new parser, owned by the caller.
+	 */
+	ParserBase* Create() const
+	{
+		return new SchemaParser( section_name, schema );
+	}
+
+	/**
+	 * Binds an entry to its field.
+	 * @param key key of the entry.
+	 * @param value value of the entry.
+	 */
+	void Parse( const StringView& key, const StringView& value )
+	{
+		const SchemaField<Struct>* field = schema->Find( key );
+		if ( field != nullptr )
+		{
+			field->Bind( values, value, message );
+		}
+		else
+		{
+			message = TEXT("Unknown Configuration Key: ") + key.str();
+		}
+	}
+
+	/**
+	 * Binds an entry to its field.
+	 * @param key key of the entry.
+	 * @param value value of the entry.
+	 */
+	void Parse( const TSTRING& key, const TSTRING& value )
+	{
+		Parse( StringView( key ), StringView( value ) );
+	}
+
+	/**
+	 * @return the bound values, valid while the parser is.
+	 */
+	const Struct& Values() const
+	{
+		return values;
+	}
+
+private:
+	std::shared_ptr<const Schema<Struct>> schema; /**< fields of the struct. */
+	Struct values; /**< the bound values. */
+};
+
+#endif
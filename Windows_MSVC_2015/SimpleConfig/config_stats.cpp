@@ -0,0 +1,213 @@
+#include "config_stats.h"
+
+#include <cstdio>
+#include <fstream>
+
+/**
+ * Describes a counter for export.
+ */
+struct MetricInfo
+{
+	const char* name; /**< metric name. */
+	const char* type; /**< "counter" or "gauge". */
+	const char* help; /**< description. */
+	const char* label; /**< extra label name and value, or nullptr. */
+	bool seconds; /**< counter is in nanoseconds and exported in seconds. */
+};
+
+/** Export of each LoadCounter, counters sharing a name are told apart by their label. */
+static const MetricInfo LOAD_METRICS[LOAD_COUNTERS] = {
+	{ "simpleconfig_read_bytes_total", "counter", "Bytes of config files and images read.", nullptr, false },
+	{ "simpleconfig_scanned_lines_total", "counter", "Section headers and entries scanned.", nullptr, false },
+	{ "simpleconfig_sections", "gauge", "Sections found in the config file, including DEFAULT.", nullptr, false },
+	{ "simpleconfig_auto_keys_total", "counter", "Bare values given automatic keys.", nullptr, false },
+	{ "simpleconfig_load_seconds_total", "counter", "Time spent loading by phase.", "phase=\"io\"", true },
+	{ "simpleconfig_load_seconds_total", "counter", "Time spent loading by phase.", "phase=\"scan\"", true },
+	{ "simpleconfig_added_sections_total", "counter", "Sections added with AddSection.", nullptr, false },
+	{ "simpleconfig_load_seconds_total", "counter", "Time spent loading by phase.", "phase=\"add_section\"", true },
+	{ "simpleconfig_reloads_total", "counter", "Reloads of the config file.", nullptr, false },
+	{ "simpleconfig_section_lookups_total", "counter", "GetSection calls by result.", "result=\"hit\"", false },
+	{ "simpleconfig_section_lookups_total", "counter", "GetSection calls by result.", "result=\"miss\"", false },
+};
+
+/** Export of each ParserCounter. */
+static const MetricInfo PARSER_METRICS[PARSER_COUNTERS] = {
+	{ "simpleconfig_lookups_total", "counter", "Key lookups by result, misses return the default.", "result=\"hit\"", false },
+	{ "simpleconfig_lookups_total", "counter", "Key lookups by result, misses return the default.", "result=\"miss\"", false },
+	{ "simpleconfig_conversions_total", "counter", "Values converted to numbers by the getters.", nullptr, false },
+	{ "simpleconfig_entries_total", "counter", "Entries parsed into the section.", nullptr, false },
+	{ "simpleconfig_parse_seconds_total", "counter", "Time spent parsing the section.", nullptr, true },
+};
+
+/**
+ * Appends a label value, escaped as the exposition format requires.
+ * Charactors outside of ASCII are replaced, names are expected to be ASCII.
+ * @param out text to append to.
+ * @param value value of the label.
+ */
+static void
+AppendLabel( std::string& out, const TSTRING& value )
+{
+	for ( size_t i = 0; i < value.size(); ++i )
+	{
+		const TCHAR c = value[i];
+		if ( c == '\\' || c == '"' )
+		{
+			out += '\\';
+			out += static_cast<char>( c );
+		}
+		else if ( c == '\n' )
+		{
+			out += "\\n";
+		}
+		else
+		{
+			out += ( static_cast<UINT32>( c ) < 0x80 ) ? static_cast<char>( c ) : '?';
+		}
+	}
+}
+
+
+/**
+ * Appends one sample.
+ * @param out text to append to.
+ * @param metric metric of the sample.
+ * @param file value of the file label.
+ * @param section value of the section label, or nullptr.
+ * @param value value of the counter.
+ */
+static void
+AppendSample( std::string& out, const MetricInfo& metric, const TSTRING& file, const TSTRING* section, const UINT64 value )
+{
+	char number[32];
+	if ( metric.seconds )
+	{
+		std::snprintf( number, sizeof( number ), "%.9f", static_cast<double>( value ) / 1e9 );
+	}
+	else
+	{
+		std::snprintf( number, sizeof( number ), "%llu", static_cast<unsigned long long>( value ) );
+	}
+
+	out += metric.name;
+	out += "{file=\"";
+	AppendLabel( out, file );
+	out += '"';
+	if ( section != nullptr )
+	{
+		out += ",section=\"";
+		AppendLabel( out, *section );
+		out += '"';
+	}
+	if ( metric.label != nullptr )
+	{
+		out += ',';
+		out += metric.label;
+	}
+	out += "} ";
+	out += number;
+	out += '\n';
+}
+
+
+/**
+ * Appends the header of a metric the first time its name is seen.
+ * @param out text to append to.
+ * @param metrics table of metrics.
+ * @param index metric in the table.
+ * @return false if an earlier metric has the same name, so the header was already written.
+ */
+static bool
+AppendHeader( std::string& out, const MetricInfo* metrics, const size_t index )
+{
+	for ( size_t i = 0; i < index; ++i )
+	{
+		if ( std::string( metrics[i].name ) == metrics[index].name )
+		{
+			return false;
+		}
+	}
+	out += "# HELP ";
+	out += metrics[index].name;
+	out += ' ';
+	out += metrics[index].help;
+	out += "\n# TYPE ";
+	out += metrics[index].name;
+	out += ' ';
+	out += metrics[index].type;
+	out += '\n';
+	return true;
+}
+
+
+std::string
+FormatPrometheus( const std::vector<ConfigStats>& configs )
+{
+	std::string out;
+
+	/* samples of a metric must be grouped together, so every config is visited once per name */
+	for ( size_t m = 0; m < LOAD_COUNTERS; ++m )
+	{
+		if ( !AppendHeader( out, LOAD_METRICS, m ) )
+		{
+			continue;
+		}
+		for ( size_t same = m; same < LOAD_COUNTERS; ++same )
+		{
+			if ( std::string( LOAD_METRICS[same].name ) != LOAD_METRICS[m].name )
+			{
+				continue;
+			}
+			for ( size_t c = 0; c < configs.size(); ++c )
+			{
+				AppendSample( out, LOAD_METRICS[same], configs[c].file, nullptr, configs[c].counters[same] );
+			}
+		}
+	}
+
+	for ( size_t m = 0; m < PARSER_COUNTERS; ++m )
+	{
+		if ( !AppendHeader( out, PARSER_METRICS, m ) )
+		{
+			continue;
+		}
+		for ( size_t same = m; same < PARSER_COUNTERS; ++same )
+		{
+			if ( std::string( PARSER_METRICS[same].name ) != PARSER_METRICS[m].name )
+			{
+				continue;
+			}
+			for ( size_t c = 0; c < configs.size(); ++c )
+			{
+				for ( size_t p = 0; p < configs[c].parsers.size(); ++p )
+				{
+					const ParserStats& parser = configs[c].parsers[p];
+					AppendSample( out, PARSER_METRICS[same], configs[c].file, &parser.section, parser.counters[same] );
+				}
+			}
+		}
+	}
+	return out;
+}
+
+
+bool
+WritePrometheus( const TSTRING& path, const std::vector<ConfigStats>& configs )
+{
+	const std::string text = FormatPrometheus( configs );
+
+	/* write beside the file and move it into place, so the collector never sees a partly written file */
+	TSTRING temporary = path + TEXT(".tmp");
+	{
+		std::ofstream out( temporary.c_str(), std::ios::out | std::ios::binary | std::ios::trunc );
+		if ( !out.write( text.data(), text.size() ) )
+		{
+			return false;
+		}
+	}
+#ifdef _WIN32
+	return MoveFileEx( temporary.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING ) != 0;
+#else
+	return std::rename( temporary.c_str(), path.c_str() ) == 0;
+#endif
+}
@@ -0,0 +1,252 @@
+
+#ifndef _CONFIG_STATS_H_
+#define _CONFIG_STATS_H_
+
+/**
+ * @file config_stats.h
+ * File containing the load and lookup statistics of configuration files.
+ */
+
+#include "platform.h"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "unicode_defines.h"
+
+/**
+ * @return index of the calling thread, threads are numbered as they first record a statistic.
+ */
+inline size_t
+StatSlot()
+{
+	static std::atomic<size_t> next( 0 );
+	static thread_local size_t slot = next.fetch_add( 1 );
+	return slot;
+}
+
+
+static const size_t STAT_MAX_SHARDS = 64; /**< most shards given to StatCounters, the same as ConfigRegistry::READER_SLOTS. */
+
+/**
+ * @return number of shards given to StatCounters, the number of hardware threads rounded up to a power of two,
+ * at most STAT_MAX_SHARDS.
+ */
+inline size_t
+StatShards()
+{
+	static const size_t shards = []()
+	{
+		const size_t threads = std::thread::hardware_concurrency();
+		size_t count = 1;
+		while ( count < threads && count < STAT_MAX_SHARDS )
+		{
+			count <<= 1;
+		}
+		return count;
+	}();
+	return shards;
+}
+
+
+/**
+ * Set of counters split into shards, each thread adds to the shard picked by its StatSlot.
+ * There is a shard for each hardware thread, see StatShards. Shards sit on their own cache lines,
+ * so threads on different cores do not contend when counting, and snapshots add the shards together.
+ * Copies start from zero, counts belong to the object they were recorded on.
+ *
+ * @tparam COUNT number of counters.
+ */
+template <size_t COUNT>
+class StatCounters
+{
+public:
+	static const size_t CACHE_LINE = 64; /**< size shards are aligned and padded to. */
+
+	/**
+	 * Constructor, every counter starts at zero.
+	 */
+	StatCounters()
+		: mask( StatShards() - 1 ), storage( new char[( mask + 2 ) * sizeof( Shard )] )
+	{
+		/* align the shards by hand, new does not support extended alignment before C++17 */
+		const size_t address = reinterpret_cast<size_t>( storage.get() );
+		shards = reinterpret_cast<Shard*>( storage.get() + ( CACHE_LINE - address % CACHE_LINE ) % CACHE_LINE );
+		for ( size_t s = 0; s <= mask; ++s )
+		{
+			new ( &shards[s] ) Shard();
+			for ( size_t c = 0; c < COUNT; ++c )
+			{
+				shards[s].values[c].store( 0, std::memory_order_relaxed );
+			}
+		}
+	}
+
+	/**
+	 * Copy constructor, the copy starts at zero.
+	 */
+	StatCounters( const StatCounters& )
+		: StatCounters() {}
+
+	/**
+	 * Assignment, keeps the existing counts.
+	 * @return this object.
+	 */
+	StatCounters& operator=( const StatCounters& )
+	{
+		return *this;
+	}
+
+	/**
+	 * Adds to a counter.
+	 * @param counter index of the counter.
+	 * @param value amount to add.
+	 */
+	void Add( const size_t counter, const UINT64 value = 1 ) const
+	{
+		shards[StatSlot() & mask].values[counter].fetch_add( value, std::memory_order_relaxed );
+	}
+
+	/**
+	 * @param counter index of a counter.
+	 * @return total of the counter across every shard.
+	 */
+	UINT64 Get( const size_t counter ) const
+	{
+		UINT64 total = 0;
+		for ( size_t s = 0; s <= mask; ++s )
+		{
+			total += shards[s].values[counter].load( std::memory_order_relaxed );
+		}
+		return total;
+	}
+
+private:
+	/**
+	 * Counters of one shard, padded to whole cache lines.
+	 */
+	struct Shard
+	{
+		std::atomic<UINT64> values[COUNT]; /**< the counters. */
+		char padding[CACHE_LINE - ( COUNT * sizeof( UINT64 ) ) % CACHE_LINE]; /**< rounds the shard up to whole cache lines. */
+	};
+
+	size_t mask; /**< number of shards less one, the number is a power of two. */
+	std::unique_ptr<char[]> storage; /**< memory holding the shards. */
+	Shard* shards; /**< the shards, aligned to CACHE_LINE inside of storage. */
+};
+
+/**
+ * Counters kept by each ConfigLoader.
+ * The section lookups are only counted for files opened with CONFIG_LOOKUP_STATS.
+ */
+enum LoadCounter
+{
+	LOAD_BYTES, /**< bytes of the file or image read. */
+	LOAD_LINES, /**< section headers and entries scanned. */
+	LOAD_SECTIONS, /**< sections found in the file, including DEFAULT. */
+	LOAD_AUTO_KEYS, /**< bare values given automatic keys. */
+	LOAD_IO_NS, /**< time spent opening and mapping the file. */
+	LOAD_SCAN_NS, /**< time spent scanning the file into lines and sections. */
+	LOAD_ADD_SECTIONS, /**< sections added. */
+	LOAD_ADD_SECTION_NS, /**< time spent in AddSection, including parsing. */
+	LOAD_RELOADS, /**< reloads of the file. */
+	LOAD_SECTION_HITS, /**< GetSection calls that found a parser. */
+	LOAD_SECTION_MISSES, /**< GetSection calls that found nothing. */
+	LOAD_COUNTERS /**< number of counters. */
+};
+
+/**
+ * Counters kept by each parser.
+ * Hits, misses and conversions are only counted for files opened with CONFIG_LOOKUP_STATS.
+ */
+enum ParserCounter
+{
+	PARSER_HITS, /**< lookups that found their key. */
+	PARSER_MISSES, /**< lookups that did not find their key, and returned the default if they had one. */
+	PARSER_CONVERSIONS, /**< values converted to numbers by the DefaultParser getters. */
+	PARSER_ENTRIES, /**< entries parsed. */
+	PARSER_PARSE_NS, /**< time spent parsing the section. */
+	PARSER_COUNTERS /**< number of counters. */
+};
+
+typedef StatCounters<LOAD_COUNTERS> LoadStatCounters; /**< counters of a ConfigLoader. */
+typedef StatCounters<PARSER_COUNTERS> ParserStatCounters; /**< counters of a parser. */
+
+/**
+ * Measures the time taken by a phase and adds it to a counter when destroyed.
+ *
+ * @tparam Counters StatCounters type.
+ */
+template <class Counters>
+class StatTimer
+{
+public:
+	/**
+	 * Constructor, starts timing.
+	 * @param counters counters to add to.
+	 * @param counter index of the counter in nanoseconds.
+	 */
+	StatTimer( const Counters& counters, const size_t counter )
+		: counters( counters ), counter( counter ), start( std::chrono::steady_clock::now() ) {}
+
+	/**
+	 * Destructor, adds the time taken.
+	 */
+	~StatTimer()
+	{
+		counters.Add( counter, static_cast<UINT64>( std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now() - start ).count() ) );
+	}
+
+private:
+	StatTimer( const StatTimer& );
+	StatTimer& operator=( const StatTimer& );
+
+	const Counters& counters; /**< counters to add to. */
+	size_t counter; /**< counter to add to. */
+	std::chrono::steady_clock::time_point start; /**< when timing started. */
+};
+
+/**
+ * Snapshot of the counters of a parser.
+ */
+struct ParserStats
+{
+	TSTRING section; /**< name of the section. */
+	UINT64 counters[PARSER_COUNTERS]; /**< value of each ParserCounter. */
+};
+
+/**
+ * Snapshot of the counters of a ConfigLoader and its parsers.
+ */
+struct ConfigStats
+{
+	TSTRING file; /**< full path of the file. */
+	UINT64 counters[LOAD_COUNTERS]; /**< value of each LoadCounter. */
+	std::vector<ParserStats> parsers; /**< counters of each section with a parser. */
+};
+
+/**
+ * Formats statistics in the Prometheus text exposition format.
+ * Times are exported in seconds, files and sections are labels.
+ * @param configs statistics of each config.
+ * @return the metrics.
+ */
+std::string FormatPrometheus( const std::vector<ConfigStats>& configs );
+
+/**
+ * Writes statistics in the Prometheus text exposition format, for the node exporter textfile collector.
+ * The file is written beside path and moved into place, so it is never read partly written.
+ * @param path full path of the file to write, should end with ".prom".
+ * @param configs statistics of each config.
+ * @return success or failure.
+ */
+bool WritePrometheus( const TSTRING& path, const std::vector<ConfigStats>& configs );
+
+#endif
@@ -0,0 +1,99 @@
+
+#ifndef _FILE_WATCHER_H_
+#define _FILE_WATCHER_H_
+
+/**
+ * @file file_watcher.h
+ * File containing a background watcher that reports changes to a configuration file.
+ */
+
+#include "platform.h"
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <functional>
+
+#include "unicode_defines.h"
+
+/**
+ * Watches a single file and calls back on a background thread when it changes.
+ * The directory holding the file is watched rather than the file itself, so files replaced
+ * by editors that write a new file and rename it over the old one are still followed.\n
+ * Bursts of writes are debounced, the callback runs once the file has been quiet for
+ * the debounce interval.\n
+ * Uses inotify on Linux and directory change notifications on Windows.
+ */
+class FileWatcher
+{
+public:
+	/**
+	 * Constructor, does nothing.
+	 */
+	FileWatcher();
+
+	/**
+	 * Starts watching a file, stopping any previous watch.
+	 * @param path full path to the file to watch.
+	 * @param callback function called on the watcher thread after the file changes.
+	 * @param debounce milliseconds the file must be quiet before callback is called.
+	 * @param check optional test run on the watcher thread about every 100 milliseconds while no change is pending,
+	 *		callback is also called when it returns true, for changes that are not written to the file.
+	 * @return success or failure.
+	 */
+	bool Start( const TSTRING& path, const std::function<void()>& callback, const unsigned int debounce = 100,
+				const std::function<bool()>& check = std::function<bool()>() );
+
+	/**
+	 * Stops watching, waits for a running callback to finish.
+	 * Must not be called from the callback.
+	 */
+	void Stop();
+
+	/**
+	 * @return true if a file is being watched.
+	 */
+	bool IsWatching() const
+	{
+		return thread.joinable();
+	}
+
+	/**
+	 * Destructor, stops watching.
+	 */
+	~FileWatcher();
+
+private:
+	FileWatcher( const FileWatcher& );
+	FileWatcher& operator=( const FileWatcher& );
+
+	/**
+	 * Body of the watcher thread.
+	 */
+	void Run();
+
+	/**
+	 * Waits for a change to the watched file.
+	 * @param timeout maximum number of milliseconds to wait.
+	 * @return true if the watched file changed.
+	 */
+	bool Wait( const unsigned int timeout );
+
+	TSTRING directory; /**< directory containing the watched file, including the trailing separator. */
+	TSTRING name; /**< name of the watched file within directory. */
+	std::function<void()> on_change; /**< called after the file changes. */
+	std::function<bool()> on_check; /**< polled for changes made elsewhere, may be empty. */
+	unsigned int debounce_ms; /**< quiet period required before on_change is called. */
+
+	std::atomic<bool> running; /**< cleared to ask the watcher thread to exit. */
+	std::thread thread; /**< watcher thread. */
+
+#ifdef _WIN32
+	HANDLE change_handle; /**< directory change notification. */
+	FILETIME last_write; /**< last write time of the file when it was last checked. */
+#else
+	int inotify_fd; /**< inotify instance. */
+#endif
+};
+
+#endif
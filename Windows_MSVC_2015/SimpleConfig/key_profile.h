@@ -0,0 +1,204 @@
+
+#ifndef _KEY_PROFILE_H_
+#define _KEY_PROFILE_H_
+
+/**
+ * @file key_profile.h
+ * File containing the sampled key access profiler of parsers.
+ */
+
+#include "platform.h"
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "unicode_defines.h"
+
+/**
+ * Estimated reads of a single key.
+ */
+struct KeyReads
+{
+	TSTRING section; /**< name of the section. */
+	TSTRING key; /**< key of the entry. */
+	UINT64 reads; /**< sampled reads multiplied by the sample period, zero for keys never read. */
+};
+
+/**
+ * Hot and dead keys of a config file, see ConfigLoader::ProfileReport.
+ */
+struct KeyProfileReport
+{
+	std::vector<KeyReads> hot; /**< most read keys, most read first. */
+	std::vector<KeyReads> dead; /**< keys never read since they were loaded, in section order. */
+	UINT64 misses; /**< estimated lookups of keys that were not in their section. */
+
+	/**
+	 * Constructor, creates an empty report.
+	 */
+	KeyProfileReport()
+		: misses( 0 ) {}
+
+	/**
+	 * Builds a human readable report, one key per line.
+	 * @return the report.
+	 */
+	TSTRING Format() const;
+};
+
+/**
+ * Counts reads of each entry of a parser, enabled with CONFIG_PROFILE or Parser::StartProfile.
+ * Entries are found by the address of their item in an open addressing table built once all
+ * entries are parsed, so recording a read takes no lock and the table is never resized.\n
+ * Every read marks its entry as read, so keys never read are exact. Only about one read in
+ * every period, per thread, adds to the entry's count, which keeps threads reading the same hot
+ * key from contending on its counter, the counts are an estimate.
+ */
+class KeyProfile
+{
+public:
+	static const UINT32 DEFAULT_PERIOD = 64; /**< sample period used by CONFIG_PROFILE. */
+
+	/**
+	 * Constructor.
+	 * @param period one read in every period is counted, 1 counts every read.
+	 * @param capacity number of entries that will be added.
+	 */
+	KeyProfile( const UINT32 period, const size_t capacity );
+
+	/**
+	 * Adds an entry, every entry must be added before any read is recorded.
+	 * @param item address of the entry's item, which must not move while the profile is used.
+	 * @param key key of the entry.
+	 */
+	void Add( const void* item, const TSTRING& key );
+
+	/**
+	 * Records a read of an entry, safe to call from multiple threads.
+	 * @param item address of the entry's item.
+	 */
+	void Hit( const void* item ) const
+	{
+		const size_t index = Find( item );
+		if ( index == NOT_FOUND )
+		{
+			return;
+		}
+
+		Entry& entry = entries[index];
+		if ( !entry.read.load( std::memory_order_relaxed ) )
+		{
+			entry.read.store( true, std::memory_order_relaxed );
+		}
+		if ( Sample() )
+		{
+			entry.samples.fetch_add( 1, std::memory_order_relaxed );
+		}
+	}
+
+	/**
+	 * Records a lookup of a key that was not found, safe to call from multiple threads.
+	 */
+	void Miss() const
+	{
+		if ( Sample() )
+		{
+			missed.fetch_add( 1, std::memory_order_relaxed );
+		}
+	}
+
+	/**
+	 * Adds the entries of the profile to a report.
+	 * @param section name of the section, used in the report.
+	 * @param report report whose dead keys and misses are added to.
+	 * @param read vector that every entry read at least once is appended to, unsorted.
+	 */
+	void Collect( const TSTRING& section, KeyProfileReport& report, std::vector<KeyReads>& read ) const;
+
+private:
+	KeyProfile( const KeyProfile& );
+	KeyProfile& operator=( const KeyProfile& );
+
+	static const size_t NOT_FOUND = static_cast<size_t>( -1 );
+
+	/**
+	 * Counters of one entry.
+	 */
+	struct Entry
+	{
+		TSTRING key; /**< key of the entry. */
+		std::atomic<bool> read; /**< true once the entry has been read. */
+		std::atomic<UINT64> samples; /**< sampled reads. */
+	};
+
+	/**
+	 * Slot of the lookup table.
+	 */
+	struct Slot
+	{
+		const void* item; /**< address of the item, nullptr for an empty slot. */
+		size_t index; /**< index of the entry. */
+	};
+
+	/**
+	 * @param item address of an item.
+	 * @return start of its probe sequence in the table.
+	 */
+	size_t Bucket( const void* item ) const
+	{
+		/* items are at least pointer aligned, fibonacci hashing spreads the remaining bits */
+		const UINT64 address = static_cast<UINT64>( reinterpret_cast<size_t>( item ) );
+		return static_cast<size_t>( ( address * 0x9E3779B97F4A7C15ull ) >> 32 ) & mask;
+	}
+
+	/**
+	 * @param item address of an item.
+	 * @return index of its entry, or NOT_FOUND.
+	 */
+	size_t Find( const void* item ) const
+	{
+		for ( size_t s = Bucket( item ); ; s = ( s + 1 ) & mask )
+		{
+			if ( table[s].item == item )
+			{
+				return table[s].index;
+			}
+			if ( table[s].item == nullptr )
+			{
+				return NOT_FOUND;
+			}
+		}
+	}
+
+	/**
+	 * @return true if the calling thread's read should be counted, on average once every period reads.
+	 */
+	bool Sample() const
+	{
+		/* the gap to the next sample is random, a fixed gap would alias with loops that read keys in a fixed pattern */
+		static thread_local UINT32 state = static_cast<UINT32>( reinterpret_cast<size_t>( &state ) ) | 1;
+		static thread_local UINT32 countdown = 0;
+		if ( countdown == 0 )
+		{
+			state ^= state << 13;
+			state ^= state >> 17;
+			state ^= state << 5;
+			countdown = state % ( 2 * period - 1 );
+			return true;
+		}
+		--countdown;
+		return false;
+	}
+
+	UINT32 period; /**< one read in every period is counted. */
+	size_t count; /**< number of entries added. */
+	size_t capacity; /**< number of entries there is room for. */
+	std::unique_ptr<Entry[]> entries; /**< the entries, in the order they were added. */
+	std::unique_ptr<Slot[]> table; /**< lookup table, kept at most half full. */
+	size_t mask; /**< size of the table minus one. */
+	mutable std::atomic<UINT64> missed; /**< sampled lookups of missing keys. */
+};
+
+#endif
@@ -0,0 +1,524 @@
+
+#include "line_scanner.h"
+
+#include <cstring>
+#include <algorithm>
+
+/* the vector paths only apply to narrow charactors on x86 processors with at least SSE2 */
+#if !defined(_UNICODE) && ( defined(__SSE2__) || defined(_M_X64) || ( defined(_M_IX86_FP) && _M_IX86_FP >= 2 ) )
+#define SCANNER_SSE2
+#include <emmintrin.h>
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(__GNUC__)
+#define SCANNER_TARGET_AVX2 __attribute__(( target( "avx2" ) ))
+#else
+#define SCANNER_TARGET_AVX2
+#endif
+
+namespace
+{
+
+const size_t BLOCK_SIZE = 64; /**< number of charactors classified at once, one bit per charactor. */
+const size_t NONE = static_cast<size_t>( -1 ); /**< position used when nothing has been found yet. */
+
+/**
+ * Bit masks for a block of charactors, bit n is set when charactor n is of that class.
+ */
+struct BlockMasks
+{
+	UINT64 newline; /**< '\n' */
+	UINT64 equals; /**< '=' */
+	UINT64 bracket; /**< ']' */
+	UINT64 graph; /**< graphical charactors, everything util::trim keeps. */
+};
+
+typedef void ( *ClassifyFunction )( const TCHAR* block, BlockMasks& masks );
+
+/**
+ * @param mask non zero mask.
+ * @return index of the lowest set bit.
+ */
+inline unsigned
+LowestBit( UINT64 mask )
+{
+#if defined(__GNUC__)
+	return static_cast<unsigned>( __builtin_ctzll( mask ) );
+#else
+	unsigned bit = 0;
+	while ( ( mask & 0xFF ) == 0 )
+	{
+		mask >>= 8;
+		bit += 8;
+	}
+	while ( ( mask & 1 ) == 0 )
+	{
+		mask >>= 1;
+		bit += 1;
+	}
+	return bit;
+#endif
+}
+
+/**
+ * @param mask non zero mask.
+ * @return index of the highest set bit.
+ */
+inline unsigned
+HighestBit( UINT64 mask )
+{
+#if defined(__GNUC__)
+	return 63 - static_cast<unsigned>( __builtin_clzll( mask ) );
+#else
+	unsigned bit = 63;
+	while ( ( mask & 0xFF00000000000000ULL ) == 0 )
+	{
+		mask <<= 8;
+		bit -= 8;
+	}
+	while ( ( mask & 0x8000000000000000ULL ) == 0 )
+	{
+		mask <<= 1;
+		bit -= 1;
+	}
+	return bit;
+#endif
+}
+
+/**
+ * @param first first bit in the range.
+ * @param last one past the last bit in the range, at most 64.
+ * @return mask with the bits [first, last) set.
+ */
+inline UINT64
+RangeMask( unsigned first, unsigned last )
+{
+	UINT64 upper = ( last >= 64 ) ? ~UINT64( 0 ) : ( ( UINT64( 1 ) << last ) - 1 );
+	return upper & ~( ( UINT64( 1 ) << first ) - 1 );
+}
+
+#ifndef SCANNER_SSE2
+
+/**
+ * Portable classification, used for wide charactors and processors without SSE2.
+ */
+void
+ClassifyScalar( const TCHAR* block, BlockMasks& masks )
+{
+	masks.newline = 0;
+	masks.equals = 0;
+	masks.bracket = 0;
+	masks.graph = 0;
+
+	for ( size_t i = 0; i < BLOCK_SIZE; ++i )
+	{
+		UINT64 bit = UINT64( 1 ) << i;
+		TCHAR c = block[i];
+		masks.newline |= ( c == '\n' ) ? bit : 0;
+		masks.equals |= ( c == '=' ) ? bit : 0;
+		masks.bracket |= ( c == ']' ) ? bit : 0;
+		masks.graph |= ( c > 0x20 && c < 0x7F ) ? bit : 0;
+	}
+}
+
+#else
+
+/**
+ * SSE2 classification, 16 charactors per compare.
+ */
+void
+ClassifySSE2( const TCHAR* block, BlockMasks& masks )
+{
+	const __m128i newline = _mm_set1_epi8( '\n' );
+	const __m128i equals = _mm_set1_epi8( '=' );
+	const __m128i bracket = _mm_set1_epi8( ']' );
+	const __m128i space = _mm_set1_epi8( 0x20 );
+	const __m128i del = _mm_set1_epi8( 0x7F );
+
+	masks.newline = 0;
+	masks.equals = 0;
+	masks.bracket = 0;
+	masks.graph = 0;
+
+	for ( unsigned i = 0; i < BLOCK_SIZE; i += 16 )
+	{
+		__m128i v = _mm_loadu_si128( reinterpret_cast<const __m128i*>( block + i ) );
+		/* signed compares, so charactors above 0x7F are not graphical, matching util::trim */
+		__m128i graph = _mm_and_si128( _mm_cmpgt_epi8( v, space ), _mm_cmplt_epi8( v, del ) );
+
+		masks.newline |= UINT64( static_cast<UINT16>( _mm_movemask_epi8( _mm_cmpeq_epi8( v, newline ) ) ) ) << i;
+		masks.equals |= UINT64( static_cast<UINT16>( _mm_movemask_epi8( _mm_cmpeq_epi8( v, equals ) ) ) ) << i;
+		masks.bracket |= UINT64( static_cast<UINT16>( _mm_movemask_epi8( _mm_cmpeq_epi8( v, bracket ) ) ) ) << i;
+		masks.graph |= UINT64( static_cast<UINT16>( _mm_movemask_epi8( graph ) ) ) << i;
+	}
+}
+
+/**
+ * AVX2 classification, 32 charactors per compare.
+ */
+SCANNER_TARGET_AVX2 void
+ClassifyAVX2( const TCHAR* block, BlockMasks& masks )
+{
+	const __m256i newline = _mm256_set1_epi8( '\n' );
+	const __m256i equals = _mm256_set1_epi8( '=' );
+	const __m256i bracket = _mm256_set1_epi8( ']' );
+	const __m256i space = _mm256_set1_epi8( 0x20 );
+	const __m256i del = _mm256_set1_epi8( 0x7F );
+
+	masks.newline = 0;
+	masks.equals = 0;
+	masks.bracket = 0;
+	masks.graph = 0;
+
+	for ( unsigned i = 0; i < BLOCK_SIZE; i += 32 )
+	{
+		__m256i v = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( block + i ) );
+		__m256i graph = _mm256_and_si256( _mm256_cmpgt_epi8( v, space ), _mm256_cmpgt_epi8( del, v ) );
+
+		masks.newline |= UINT64( static_cast<UINT32>( _mm256_movemask_epi8( _mm256_cmpeq_epi8( v, newline ) ) ) ) << i;
+		masks.equals |= UINT64( static_cast<UINT32>( _mm256_movemask_epi8( _mm256_cmpeq_epi8( v, equals ) ) ) ) << i;
+		masks.bracket |= UINT64( static_cast<UINT32>( _mm256_movemask_epi8( _mm256_cmpeq_epi8( v, bracket ) ) ) ) << i;
+		masks.graph |= UINT64( static_cast<UINT32>( _mm256_movemask_epi8( graph ) ) ) << i;
+	}
+}
+
+/**
+ * @return true if both the processor and operating system support AVX2.
+ */
+bool
+HasAVX2()
+{
+#if defined(_MSC_VER)
+	int info[4];
+	__cpuid( info, 1 );
+	/* OSXSAVE and AVX, then check the OS saves the upper halves of the registers */
+	if ( ( info[2] & ( 1 << 27 ) ) == 0 || ( info[2] & ( 1 << 28 ) ) == 0 )
+	{
+		return false;
+	}
+	if ( ( _xgetbv( 0 ) & 6 ) != 6 )
+	{
+		return false;
+	}
+	__cpuidex( info, 7, 0 );
+	return ( info[1] & ( 1 << 5 ) ) != 0;
+#elif defined(__GNUC__)
+	/* this runs during static initialisation, so the cpu model may not be set up yet */
+	__builtin_cpu_init();
+	return __builtin_cpu_supports( "avx2" ) != 0;
+#else
+	return false;
+#endif
+}
+
+#endif /* SCANNER_SSE2 */
+
+/**
+ * @return the best classification function for this processor.
+ */
+ClassifyFunction
+SelectClassify()
+{
+#ifdef SCANNER_SSE2
+	return HasAVX2() ? ClassifyAVX2 : ClassifySSE2;
+#else
+	return ClassifyScalar;
+#endif
+}
+
+const ClassifyFunction Classify = SelectClassify(); /**< chosen once at start up. */
+
+/**
+ * Tracks the line currently being scanned and emits it when its end is found.
+ */
+class LineBuilder
+{
+public:
+	LineBuilder( const StringView& contents, std::vector<ScannedLine>& output )
+		: data( contents.data() ), size( contents.size() ), lines( output )
+	{
+		Begin( 0 );
+	}
+
+	/**
+	 * Starts a new line, the type of line is decided by its first charactor.
+	 * @param start offset of the first charactor of the line.
+	 */
+	void Begin( size_t start )
+	{
+		line_start = start;
+		comment = ( start < size ) && ( data[start] == ';' );
+		section = ( start < size ) && ( data[start] == '[' );
+		split = NONE;
+		key_first = NONE;
+		key_last = NONE;
+		value_first = NONE;
+		value_last = NONE;
+	}
+
+	/**
+	 * Consumes part of a block that belongs to the current line.
+	 * @param base offset of the block.
+	 * @param range bits of the block that belong to the line.
+	 * @param masks classification of the block.
+	 */
+	void Segment( size_t base, UINT64 range, const BlockMasks& masks )
+	{
+		UINT64 graph = masks.graph & range;
+		UINT64 splits;
+
+		if ( comment )
+		{
+			return;
+		}
+
+		if ( split != NONE )
+		{
+			Extend( base, graph, value_first, value_last );
+			return;
+		}
+
+		splits = ( section ? masks.bracket : masks.equals ) & range;
+		if ( splits )
+		{
+			unsigned bit = LowestBit( splits );
+			UINT64 below = ( UINT64( 1 ) << bit ) - 1;
+
+			split = base + bit;
+			Extend( base, graph & below, key_first, key_last );
+			Extend( base, graph & ~below & ~( UINT64( 1 ) << bit ), value_first, value_last );
+		}
+		else
+		{
+			Extend( base, graph, key_first, key_last );
+		}
+	}
+
+	/**
+	 * Finishes the current line and emits it if it is not blank or a comment.
+	 * @param end offset of the line ending ( or the end of the contents ).
+	 */
+	void End( size_t end )
+	{
+		ScannedLine line;
+		size_t length = end - line_start;
+
+		/* remove the carriage return from windows line endings */
+		if ( length > 0 && data[end - 1] == '\r' )
+		{
+			length -= 1;
+		}
+
+		if ( comment || length == 0 )
+		{
+			return;
+		}
+
+		line.start = line_start;
+		line.length = static_cast<UINT32>( length );
+		line.type = section ? LINE_SECTION : LINE_ENTRY;
+		line.split = ( split == NONE ) ? ScannedLine::NO_SPLIT : static_cast<UINT32>( split - line_start );
+		Range( key_first, key_last, line.key_begin, line.key_end );
+		Range( value_first, value_last, line.value_begin, line.value_end );
+
+		lines.push_back( line );
+	}
+
+private:
+	/**
+	 * Extends a range of graphical charactors with those in a mask.
+	 */
+	static void Extend( size_t base, UINT64 graph, size_t& first, size_t& last )
+	{
+		if ( graph )
+		{
+			if ( first == NONE )
+			{
+				first = base + LowestBit( graph );
+			}
+			last = base + HighestBit( graph );
+		}
+	}
+
+	/**
+	 * Converts a range of graphical charactors into line relative offsets.
+	 */
+	void Range( size_t first, size_t last, UINT32& begin, UINT32& end ) const
+	{
+		if ( first == NONE )
+		{
+			begin = 0;
+			end = 0;
+		}
+		else
+		{
+			begin = static_cast<UINT32>( first - line_start );
+			end = static_cast<UINT32>( last + 1 - line_start );
+		}
+	}
+
+	const TCHAR* data;
+	size_t size;
+	std::vector<ScannedLine>& lines;
+
+	size_t line_start;
+	bool comment;
+	bool section;
+	size_t split;
+	size_t key_first;
+	size_t key_last;
+	size_t value_first;
+	size_t value_last;
+};
+
+/**
+ * @param data charactors being scanned.
+ * @param size number of charactors being scanned.
+ * @param start offset of the first charactor of a line.
+ * @return length of the line, excluding the line ending.
+ */
+size_t
+HeaderLength( const TCHAR* data, const size_t size, const size_t start )
+{
+	return std::find( data + start, data + size, '\n' ) - ( data + start );
+}
+
+}
+
+
+void
+LineScanner::Scan( const StringView& contents, std::vector<ScannedLine>& lines, const size_t offset )
+{
+	size_t first = lines.size();
+
+	const TCHAR* data = contents.data();
+	const size_t size = contents.size();
+
+	TCHAR tail[BLOCK_SIZE];
+	BlockMasks masks;
+	LineBuilder builder( contents, lines );
+
+	if ( size == 0 )
+	{
+		return;
+	}
+
+	/* rough guess so that large files do not repeatedly grow the vector,
+	 * still grow geometrically so repeated small scans stay linear */
+	if ( lines.capacity() - lines.size() < size / 32 )
+	{
+		lines.reserve( std::max( lines.size() + size / 32, lines.size() * 2 ) );
+	}
+
+	for ( size_t base = 0; base < size; base += BLOCK_SIZE )
+	{
+		size_t count = size - base;
+		unsigned segment_start = 0;
+
+		if ( count >= BLOCK_SIZE )
+		{
+			count = BLOCK_SIZE;
+			Classify( data + base, masks );
+		}
+		else
+		{
+			/* the padding charactors do not belong to any class, so they never need masking */
+			std::memset( tail, 0, sizeof( tail ) );
+			std::memcpy( tail, data + base, count * sizeof( TCHAR ) );
+			Classify( tail, masks );
+		}
+
+		while ( masks.newline )
+		{
+			unsigned bit = LowestBit( masks.newline );
+
+			builder.Segment( base, RangeMask( segment_start, bit ), masks );
+			builder.End( base + bit );
+			builder.Begin( base + bit + 1 );
+
+			segment_start = bit + 1;
+			masks.newline &= masks.newline - 1;
+		}
+
+		if ( segment_start < count )
+		{
+			builder.Segment( base, RangeMask( segment_start, static_cast<unsigned>( count ) ), masks );
+		}
+	}
+
+	/* the last line does not need a line ending */
+	if ( data[size - 1] != '\n' )
+	{
+		builder.End( size );
+	}
+
+	if ( offset != 0 )
+	{
+		for ( size_t i = first; i < lines.size(); ++i )
+		{
+			lines[i].start += offset;
+		}
+	}
+}
+
+
+void
+LineScanner::ScanSections( const StringView& contents, std::vector<ScannedLine>& lines )
+{
+	const TCHAR* data = contents.data();
+	const size_t size = contents.size();
+
+	TCHAR tail[BLOCK_SIZE];
+	BlockMasks masks;
+	size_t start;
+
+	if ( size == 0 )
+	{
+		return;
+	}
+
+	/* headers are rare, so each one is scanned on its own with the full scanner */
+	if ( data[0] == '[' )
+	{
+		Scan( contents.substr( 0, HeaderLength( data, size, 0 ) ), lines );
+	}
+
+	for ( size_t base = 0; base < size; base += BLOCK_SIZE )
+	{
+		if ( size - base >= BLOCK_SIZE )
+		{
+			Classify( data + base, masks );
+		}
+		else
+		{
+			std::memset( tail, 0, sizeof( tail ) );
+			std::memcpy( tail, data + base, ( size - base ) * sizeof( TCHAR ) );
+			Classify( tail, masks );
+		}
+
+		while ( masks.newline )
+		{
+			start = base + LowestBit( masks.newline ) + 1;
+			if ( start < size && data[start] == '[' )
+			{
+				Scan( contents.substr( start, HeaderLength( data, size, start ) ), lines, start );
+			}
+			masks.newline &= masks.newline - 1;
+		}
+	}
+}
+
+
+const TCHAR*
+LineScanner::InstructionSet()
+{
+#ifdef SCANNER_SSE2
+	return ( Classify == ClassifyAVX2 ) ? TEXT("AVX2") : TEXT("SSE2");
+#else
+	return TEXT("Scalar");
+#endif
+}
@@ -1,7 +1,7 @@
 #include "config_loader.h"
 
 int
-main( int argc, char* argv[] )
+main()
 {
 	/* open the configuration file, or get an existing instance. */
 	CONFIGHANDLE config = OPEN_CONFIG( TEXT( "test.ini" ) );
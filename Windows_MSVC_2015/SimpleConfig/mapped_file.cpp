@@ -0,0 +1,200 @@
+
+#include "mapped_file.h"
+
+#include <utility>
+#include <iterator>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+MappedFile::MappedFile()
+	: data( nullptr ), size( 0 ), mapping( nullptr ), mapping_size( 0 )
+#ifdef _WIN32
+	, file_handle( INVALID_HANDLE_VALUE ), map_handle( NULL )
+#endif
+{
+}
+
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+
+bool
+MappedFile::Open( const TSTRING& path, const bool map )
+{
+	Close();
+
+#ifdef _UNICODE
+	/* the file is stored as narrow charactors, so it has to be widened into a buffer */
+	( void ) map;
+	return ReadFile( path );
+#else
+	if ( !map )
+	{
+		return ReadFile( path );
+	}
+
+#ifdef _WIN32
+	LARGE_INTEGER file_size;
+
+	file_handle = CreateFile( path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+								OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL );
+	if ( file_handle == INVALID_HANDLE_VALUE )
+	{
+		return false;
+	}
+
+	if ( !GetFileSizeEx( file_handle, &file_size ) )
+	{
+		Close();
+		return false;
+	}
+
+	if ( file_size.QuadPart == 0 )
+	{
+		/* empty files can not be mapped, but they are still valid config files */
+		Close();
+		return true;
+	}
+
+	map_handle = CreateFileMapping( file_handle, NULL, PAGE_READONLY, 0, 0, NULL );
+	if ( map_handle != NULL )
+	{
+		mapping = MapViewOfFile( map_handle, FILE_MAP_READ, 0, 0, 0 );
+		mapping_size = static_cast<size_t>( file_size.QuadPart );
+	}
+#else
+	struct stat file_stat;
+
+	int fd = open( path.c_str(), O_RDONLY );
+	if ( fd < 0 )
+	{
+		return false;
+	}
+
+	if ( fstat( fd, &file_stat ) != 0 )
+	{
+		close( fd );
+		return false;
+	}
+
+	if ( file_stat.st_size == 0 )
+	{
+		/* empty files can not be mapped, but they are still valid config files */
+		close( fd );
+		return true;
+	}
+
+	mapping_size = static_cast<size_t>( file_stat.st_size );
+	mapping = mmap( NULL, mapping_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+	if ( mapping == MAP_FAILED )
+	{
+		mapping = nullptr;
+	}
+	else
+	{
+		madvise( mapping, mapping_size, MADV_SEQUENTIAL );
+	}
+
+	/* the mapping keeps its own reference to the file */
+	close( fd );
+#endif
+
+	if ( mapping == nullptr )
+	{
+		Close();
+		return ReadFile( path );
+	}
+
+	data = static_cast<const TCHAR*>( mapping );
+	size = mapping_size;
+	return true;
+#endif /* _UNICODE */
+}
+
+
+void
+MappedFile::Swap( MappedFile& other )
+{
+	/* buffered contents must move without reallocating so existing views stay valid */
+	TSTRING::size_type bufferSize = buffer.size();
+	TSTRING::size_type otherSize = other.buffer.size();
+	buffer.swap( other.buffer );
+
+	std::swap( data, other.data );
+	std::swap( size, other.size );
+	std::swap( mapping, other.mapping );
+	std::swap( mapping_size, other.mapping_size );
+#ifdef _WIN32
+	std::swap( file_handle, other.file_handle );
+	std::swap( map_handle, other.map_handle );
+#endif
+
+	/* short strings are stored inside the string object itself, so their views have to follow the swap */
+	if ( mapping == nullptr && otherSize != 0 )
+	{
+		data = buffer.data();
+	}
+	if ( other.mapping == nullptr && bufferSize != 0 )
+	{
+		other.data = other.buffer.data();
+	}
+}
+
+
+bool
+MappedFile::ReadFile( const TSTRING& path )
+{
+	TSTREAM infile( path.c_str(), std::ios::in | std::ios::binary );
+	if ( !infile.is_open() )
+	{
+		return false;
+	}
+
+	buffer.assign( std::istreambuf_iterator<TCHAR>( infile ), std::istreambuf_iterator<TCHAR>() );
+
+	data = buffer.data();
+	size = buffer.size();
+	return true;
+}
+
+
+void
+MappedFile::Close()
+{
+#ifdef _WIN32
+	if ( mapping != nullptr )
+	{
+		UnmapViewOfFile( mapping );
+	}
+	if ( map_handle != NULL )
+	{
+		CloseHandle( map_handle );
+		map_handle = NULL;
+	}
+	if ( file_handle != INVALID_HANDLE_VALUE )
+	{
+		CloseHandle( file_handle );
+		file_handle = INVALID_HANDLE_VALUE;
+	}
+#else
+	if ( mapping != nullptr )
+	{
+		munmap( mapping, mapping_size );
+	}
+#endif
+
+	mapping = nullptr;
+	mapping_size = 0;
+
+	buffer.clear();
+	data = nullptr;
+	size = 0;
+}
@@ -0,0 +1,38 @@
+
+#ifndef _PLATFORM_H_
+#define _PLATFORM_H_
+
+/**
+ * @file platform.h
+ * File containing the Windows types used throughout the program.
+ * They come from Windows.h on Windows and are defined to match on other platforms.
+ */
+
+#ifdef _WIN32
+
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#undef WIN32_LEAN_AND_MEAN
+
+#else
+
+#include <stdint.h>
+
+typedef int16_t INT16;
+typedef int32_t INT32;
+typedef int64_t INT64;
+typedef uint16_t UINT16;
+typedef uint32_t UINT32;
+typedef uint64_t UINT64;
+
+#ifdef _UNICODE
+typedef wchar_t TCHAR;
+#define TEXT( str ) L##str
+#else
+typedef char TCHAR;
+#define TEXT( str ) str
+#endif
+
+#endif /* _WIN32 */
+
+#endif
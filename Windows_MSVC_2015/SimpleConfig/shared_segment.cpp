@@ -0,0 +1,179 @@
+#include "shared_segment.h"
+
+#include <utility>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+SharedSegment::SharedSegment()
+	: mapping( nullptr ), mapping_size( 0 )
+#ifdef _WIN32
+	, map_handle( NULL )
+#endif
+{
+}
+
+
+SharedSegment::~SharedSegment()
+{
+	Close();
+}
+
+
+bool
+SharedSegment::Create( const TSTRING& name, const size_t size )
+{
+	Close();
+	if ( size == 0 )
+	{
+		return false;
+	}
+
+#ifdef _WIN32
+	const UINT64 size64 = static_cast<UINT64>( size );
+	map_handle = CreateFileMapping( INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE,
+									static_cast<DWORD>( size64 >> 32 ), static_cast<DWORD>( size64 & 0xFFFFFFFFu ), name.c_str() );
+	if ( map_handle == NULL || GetLastError() == ERROR_ALREADY_EXISTS )
+	{
+		Close();
+		return false;
+	}
+
+	mapping = MapViewOfFile( map_handle, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, size );
+	if ( mapping == nullptr )
+	{
+		Close();
+		return false;
+	}
+#else
+	int fd = shm_open( name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644 );
+	if ( fd < 0 )
+	{
+		return false;
+	}
+
+	/* new segments are zero filled as they are grown */
+	if ( ftruncate( fd, static_cast<off_t>( size ) ) != 0 )
+	{
+		close( fd );
+		shm_unlink( name.c_str() );
+		return false;
+	}
+
+	mapping = mmap( NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+	close( fd );
+	if ( mapping == MAP_FAILED )
+	{
+		mapping = nullptr;
+		shm_unlink( name.c_str() );
+		return false;
+	}
+#endif
+
+	mapping_size = size;
+	return true;
+}
+
+
+bool
+SharedSegment::Open( const TSTRING& name, const bool writable )
+{
+	Close();
+
+#ifdef _WIN32
+	const DWORD access = writable ? ( FILE_MAP_READ | FILE_MAP_WRITE ) : FILE_MAP_READ;
+	map_handle = OpenFileMapping( access, FALSE, name.c_str() );
+	if ( map_handle == NULL )
+	{
+		return false;
+	}
+
+	mapping = MapViewOfFile( map_handle, access, 0, 0, 0 );
+	MEMORY_BASIC_INFORMATION info;
+	if ( mapping == nullptr || VirtualQuery( mapping, &info, sizeof( info ) ) == 0 )
+	{
+		Close();
+		return false;
+	}
+	mapping_size = info.RegionSize;
+#else
+	struct stat segment_stat;
+
+	int fd = shm_open( name.c_str(), writable ? O_RDWR : O_RDONLY, 0 );
+	if ( fd < 0 )
+	{
+		return false;
+	}
+
+	if ( fstat( fd, &segment_stat ) != 0 || segment_stat.st_size == 0 )
+	{
+		close( fd );
+		return false;
+	}
+
+	mapping_size = static_cast<size_t>( segment_stat.st_size );
+	mapping = mmap( NULL, mapping_size, writable ? ( PROT_READ | PROT_WRITE ) : PROT_READ, MAP_SHARED, fd, 0 );
+
+	/* the mapping keeps its own reference to the segment */
+	close( fd );
+	if ( mapping == MAP_FAILED )
+	{
+		mapping = nullptr;
+		mapping_size = 0;
+		return false;
+	}
+#endif
+	return true;
+}
+
+
+void
+SharedSegment::Remove( const TSTRING& name )
+{
+#ifdef _WIN32
+	/* file mappings are removed by the system once the last handle is closed */
+	( void ) name;
+#else
+	shm_unlink( name.c_str() );
+#endif
+}
+
+
+void
+SharedSegment::Swap( SharedSegment& other )
+{
+	std::swap( mapping, other.mapping );
+	std::swap( mapping_size, other.mapping_size );
+#ifdef _WIN32
+	std::swap( map_handle, other.map_handle );
+#endif
+}
+
+
+void
+SharedSegment::Close()
+{
+#ifdef _WIN32
+	if ( mapping != nullptr )
+	{
+		UnmapViewOfFile( mapping );
+	}
+	if ( map_handle != NULL )
+	{
+		CloseHandle( map_handle );
+		map_handle = NULL;
+	}
+#else
+	if ( mapping != nullptr )
+	{
+		munmap( mapping, mapping_size );
+	}
+#endif
+
+	mapping = nullptr;
+	mapping_size = 0;
+}
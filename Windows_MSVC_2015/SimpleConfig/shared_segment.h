@@ -0,0 +1,108 @@
+
+#ifndef _SHARED_SEGMENT_H_
+#define _SHARED_SEGMENT_H_
+
+/**
+ * @file shared_segment.h
+ * File containing a named block of memory shared between processes.
+ */
+
+#include "platform.h"
+
+#include <string>
+
+#include "unicode_defines.h"
+
+/**
+ * Named block of memory that several processes can map at once.
+ * On POSIX systems the segment is made with shm_open and remains until it is removed, even once no
+ * process has it open. On Windows it is a file mapping backed by the paging file, which is removed
+ * by the system when the last process closes it, and Remove does nothing.
+ *
+ * @note Mappings stay valid after the segment is removed, until they are closed.
+ */
+class SharedSegment
+{
+public:
+	/**
+	 * Constructor, does nothing.
+	 */
+	SharedSegment();
+
+	/**
+	 * Creates a segment and maps it for reading and writing, its contents start as zero.
+	 * Closes any segment that was previously open.
+	 * @param name name of the segment, see ConfigImage::SharedName.
+	 * @param size size of the segment in bytes, must not be zero.
+	 * @return false if the segment already exists or could not be created.
+	 */
+	bool Create( const TSTRING& name, const size_t size );
+
+	/**
+	 * Maps an existing segment, closing any segment that was previously open.
+	 * @param name name of the segment.
+	 * @param writable map for writing as well as reading.
+	 * @return false if there is no such segment.
+	 */
+	bool Open( const TSTRING& name, const bool writable = false );
+
+	/**
+	 * Unmaps the segment, the segment itself is kept until it is removed.
+	 */
+	void Close();
+
+	/**
+	 * Removes a segment so that it can no longer be opened, processes that have it mapped keep their mapping.
+	 * @param name name of the segment.
+	 */
+	static void Remove( const TSTRING& name );
+
+	/**
+	 * @return true if a segment is mapped.
+	 */
+	bool IsOpen() const
+	{
+		return mapping != nullptr;
+	}
+
+	/**
+	 * @return start of the mapping, nullptr when closed.
+	 */
+	void* Data() const
+	{
+		return mapping;
+	}
+
+	/**
+	 * @return size in bytes of the mapping, on Windows rounded up to a whole number of pages.
+	 */
+	size_t Size() const
+	{
+		return mapping_size;
+	}
+
+	/**
+	 * Exchanges the mappings of two segments, pointers into either remain valid.
+	 * @param other segment to swap with.
+	 */
+	void Swap( SharedSegment& other );
+
+	/**
+	 * Destructor, unmaps the segment.
+	 */
+	~SharedSegment();
+
+private:
+	/* mappings can not be shared between owners */
+	SharedSegment( const SharedSegment& );
+	SharedSegment& operator=( const SharedSegment& );
+
+	void* mapping; /**< start of the mapped view, nullptr if not mapped. */
+	size_t mapping_size; /**< size in bytes of the mapped view. */
+
+#ifdef _WIN32
+	HANDLE map_handle; /**< handle of the file mapping object. */
+#endif
+};
+
+#endif
@@ -0,0 +1,155 @@
+
+#ifndef _STRING_VIEW_H_
+#define _STRING_VIEW_H_
+
+/**
+ * @file string_view.h
+ * File containing a light weight, non-owning string view.
+ * Used to refer to lines and tokens in a loaded configuration file without copying them.
+ */
+
+#include "platform.h"
+
+#include <string>
+#include <cstring>
+#include <algorithm>
+
+#include "unicode_defines.h"
+
+/**
+ * Non-owning reference to a run of charactors.
+ * The referenced memory must outlive the view, views handed out by the ConfigLoader
+ * remain valid for as long as the ConfigLoader is open.
+ */
+class StringView
+{
+public:
+	typedef TSTRING::size_type size_type;
+	typedef const TCHAR* const_iterator;
+
+	static const size_type npos = static_cast<size_type>( -1 ); /**< returned when a search fails. */
+
+	/**
+	 * Default Constructor, creates an empty view.
+	 */
+	constexpr StringView()
+		: ptr( nullptr ), len( 0 ) {}
+
+	/**
+	 * Constructor
+	 * @param str start of the charactors to view.
+	 * @param size number of charactors in the view.
+	 */
+	constexpr StringView( const TCHAR* str, size_type size )
+		: ptr( str ), len( size ) {}
+
+	/**
+	 * Constructor, views a null terminated string.
+	 * Explicit so that overloads taking both TSTRING and StringView are not ambiguous for literals.
+	 * @param str null terminated string to view.
+	 */
+	explicit StringView( const TCHAR* str )
+		: ptr( str ), len( std::char_traits<TCHAR>::length( str ) ) {}
+
+	/**
+	 * Constructor, views the contents of a string.
+	 * @tparam Alloc allocator of the string, so strings kept in an Arena can be viewed as well.
+	 * @param str string to view, must outlive the view.
+	 */
+	template <class Alloc>
+	StringView( const std::basic_string<TCHAR, std::char_traits<TCHAR>, Alloc>& str )
+		: ptr( str.data() ), len( str.size() ) {}
+
+	constexpr const TCHAR* data() const { return ptr; }
+	constexpr size_type size() const { return len; }
+	constexpr bool empty() const { return len == 0; }
+
+	const_iterator begin() const { return ptr; }
+	const_iterator end() const { return ptr + len; }
+
+	TCHAR operator[]( size_type index ) const { return ptr[index]; }
+
+	/**
+	 * Finds the first instance of a charactor in the view.
+	 * @param c charactor to search for.
+	 * @param pos position to start searching from.
+	 * @return index of the charactor or npos if it was not found.
+	 */
+	size_type find( TCHAR c, size_type pos = 0 ) const
+	{
+		const TCHAR* found;
+		if ( pos >= len )
+		{
+			return npos;
+		}
+		found = std::find( ptr + pos, ptr + len, c );
+		return ( found == ptr + len ) ? npos : static_cast<size_type>( found - ptr );
+	}
+
+	/**
+	 * Returns a view of part of this view, clamped to the bounds of this view.
+	 * @param pos index of the first charactor in the new view.
+	 * @param count maximum number of charactors in the new view.
+	 * @return the sub view.
+	 */
+	StringView substr( size_type pos, size_type count = npos ) const
+	{
+		pos = ( pos > len ) ? len : pos;
+		count = ( count > len - pos ) ? len - pos : count;
+		return StringView( ptr + pos, count );
+	}
+
+	/**
+	 * Copies the viewed charactors into a new string.
+	 * @return string containing a copy of the view.
+	 */
+	TSTRING str() const
+	{
+		return TSTRING( ptr, len );
+	}
+
+	/**
+	 * Compares two views charactor by charactor, as TSTRING::compare does.
+	 * @param rhs view to compare to.
+	 * @return negative if this view orders first, zero if equal, otherwise positive.
+	 */
+	int compare( const StringView& rhs ) const
+	{
+		int result = std::char_traits<TCHAR>::compare( ptr, rhs.ptr, ( len < rhs.len ) ? len : rhs.len );
+		if ( result == 0 )
+		{
+			result = ( len < rhs.len ) ? -1 : ( ( len > rhs.len ) ? 1 : 0 );
+		}
+		return result;
+	}
+
+	bool operator==( const StringView& rhs ) const
+	{
+		return len == rhs.len && std::char_traits<TCHAR>::compare( ptr, rhs.ptr, len ) == 0;
+	}
+
+	bool operator!=( const StringView& rhs ) const
+	{
+		return !( *this == rhs );
+	}
+
+private:
+	const TCHAR* ptr; /**< first charactor of the view. */
+	size_type len; /**< number of charactors in the view. */
+};
+
+/**
+ * Transparent less than comparison for strings and views.
+ * Allows ordered containers keyed by TSTRING to be searched with a StringView.
+ */
+struct StringLess
+{
+	typedef void is_transparent;
+
+	bool operator()( const StringView& lhs, const StringView& rhs ) const
+	{
+		return lhs.compare( rhs ) < 0;
+	}
+};
+
+#endif
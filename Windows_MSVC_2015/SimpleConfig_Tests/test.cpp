@@ -1,10 +1,49 @@
 #include "stdafx.h"
 #include "CppUnitTest.h"
 
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <algorithm>
+#include <random>
+#include <limits>
+#include <type_traits>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+
 #include "config_loader.h"
+#include "config_header.h"
+#include "static_config.h"
+#include "embedded_config.h"
 
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
 
+/* counts heap allocations so tests can check that lookups do not allocate, atomic as tests allocate from many threads */
+static std::atomic<size_t> allocations( 0 );
+
+void* operator new( size_t size )
+{
+	++allocations;
+	void* ptr = malloc( size ? size : 1 );
+	if ( ptr == nullptr )
+	{
+		throw std::bad_alloc();
+	}
+	return ptr;
+}
+
+void operator delete( void* ptr ) noexcept
+{
+	free( ptr );
+}
+
+void operator delete( void* ptr, size_t ) noexcept
+{
+	free( ptr );
+}
+
 namespace SimpleConfig_Tests
 {
 	TEST_CLASS( ConfigFile_Test )
@@ -12,7 +51,1509 @@ namespace SimpleConfig_Tests
 	public:
 		TEST_METHOD( LoadFile_Test )
 		{
+			/* windows line endings, a repeated header, comments, blank lines and no final line ending */
+			FILE* file = fopen( "load_test.ini", "wb" );
+			Assert::IsTrue( file != nullptr );
+			fputs( "top = 1\r\n[Server]\r\nthreads = 4\r\n; threads = 99\r\n\r\n  name =  primary db  \r\nbare\r\n"
+				   "[Client]\r\nretries = 3\r\n[server]\r\nport = 80", file );
+			fclose( file );
+
+			CONFIGHANDLE config = OPEN_CONFIG( TEXT( "load_test.ini" ), TEXT( "" ) );
+			DefaultParser* server = new DefaultParser( TEXT( "Server" ) );
+			DefaultParser* top = new DefaultParser( TEXT( "Default" ) );
+			Assert::IsTrue( config->AddSection( server ) );
+			Assert::IsTrue( config->AddSection( top ) );
+			Assert::AreEqual( 4, server->getInt32( CFG_KEY( "threads" ), 0 ) );
+			Assert::AreEqual( TSTRING( TEXT( "primary db" ) ), server->getString( CFG_KEY( "name" ), TSTRING() ) );
+			Assert::AreEqual( TSTRING( TEXT( "bare" ) ), server->getString( CFG_KEY( "1" ), TSTRING() ) );
+			Assert::AreEqual( 80, server->getInt32( CFG_KEY( "port" ), 0 ) );
+			Assert::AreEqual( 0, server->getInt32( CFG_KEY( "retries" ), 0 ) );
+			Assert::AreEqual( 1, top->getInt32( CFG_KEY( "top" ), 0 ) );
+
+			/* sections not in the file are not added, sections are only added once */
+			DefaultParser missing( TEXT( "Missing" ) );
+			DefaultParser again( TEXT( "SERVER" ) );
+			Assert::IsFalse( config->AddSection( &missing ) );
+			Assert::IsFalse( config->AddSection( &again ) );
+
+			ConfigStats stats = config->Statistics();
+			Assert::AreEqual( (UINT64) 9, stats.counters[LOAD_LINES] );
+			config.reset();
+			remove( "load_test.ini" );
+
+			/* files that can not be opened report it and have no sections */
+			config = OPEN_CONFIG( TEXT( "missing_test.ini" ), TEXT( "" ) );
+			std::vector<Diagnostic> records;
+			config->DrainMessages( records );
+			Assert::AreEqual( (size_t) 1, records.size() );
+			Assert::AreEqual( (int) DIAG_OPEN_FAILED, (int) records[0].code );
+			Assert::IsTrue( config->GetSection( TEXT( "Default" ) ) == nullptr );
+			config.reset();
+		}
+
+		TEST_METHOD( ConfigFile_MappedFile )
+		{
+			const char text[] = "[Server]\nthreads = 4\n";
+			FILE* file = fopen( "mapped_test.ini", "wb" );
+			Assert::IsTrue( file != nullptr );
+			fputs( text, file );
+			fclose( file );
+
+			/* narrow builds map the file, unicode builds widen it into a buffer */
+			MappedFile mapped;
+			Assert::IsTrue( mapped.Open( TEXT( "mapped_test.ini" ) ) );
+			Assert::AreEqual( sizeof( text ) - 1, mapped.Contents().size() );
+			Assert::IsTrue( mapped.Contents() == StringView( TEXT( "[Server]\nthreads = 4\n" ) ) );
+#ifdef _UNICODE
+			Assert::IsFalse( mapped.IsMapped() );
+#else
+			Assert::IsTrue( mapped.IsMapped() );
+#endif
+
+			/* contents move with the file to another owner, a buffer may be at a new address */
+			MappedFile buffered;
+			Assert::IsTrue( buffered.Open( TEXT( "mapped_test.ini" ), false ) );
+			Assert::IsFalse( buffered.IsMapped() );
+			const bool wasMapped = mapped.IsMapped();
+			mapped.Swap( buffered );
+			Assert::IsFalse( mapped.IsMapped() );
+			Assert::AreEqual( wasMapped, buffered.IsMapped() );
+			Assert::IsTrue( mapped.Contents() == StringView( TEXT( "[Server]\nthreads = 4\n" ) ) );
+			Assert::IsTrue( mapped.Contents() == buffered.Contents() );
+
+			/* empty files are valid but have nothing to map, missing files fail */
+			file = fopen( "mapped_test.ini", "wb" );
+			Assert::IsTrue( file != nullptr );
+			fclose( file );
+			MappedFile empty;
+			Assert::IsTrue( empty.Open( TEXT( "mapped_test.ini" ) ) );
+			Assert::AreEqual( (size_t) 0, empty.Contents().size() );
+			remove( "mapped_test.ini" );
+			Assert::IsFalse( empty.Open( TEXT( "mapped_test.ini" ) ) );
+		}
+
+		TEST_METHOD( ConfigFile_RewrittenBeforeAdd )
+		{
+			const int modes[] = { CONFIG_EAGER, CONFIG_LAZY };
+			for ( size_t i = 0; i < sizeof( modes ) / sizeof( modes[0] ); ++i )
+			{
+				FILE* file = fopen( "rewrite_test.ini", "wb" );
+				Assert::IsTrue( file != nullptr );
+				fputs( "[Server]\nthreads = 4\n[Client]\nretries = 3\nname = primary\n", file );
+				fclose( file );
+
+				CONFIGHANDLE config = OPEN_CONFIG( TEXT( "rewrite_test.ini" ), TEXT( "" ), modes[i] );
+				Assert::IsTrue( config->AddSection( new DefaultParser( TEXT( "Server" ) ) ) );
+
+				/* files are read when opened by default, a shorter file written in place is not seen */
+				file = fopen( "rewrite_test.ini", "wb" );
+				Assert::IsTrue( file != nullptr );
+				fputs( "[Server]\n", file );
+				fclose( file );
+
+				DefaultParser* client = new DefaultParser( TEXT( "Client" ) );
+				Assert::IsTrue( config->AddSection( client ) );
+				Assert::AreEqual( 3, client->getInt32( CFG_KEY( "retries" ), 0 ) );
+				Assert::AreEqual( TSTRING( TEXT( "primary" ) ), client->getString( CFG_KEY( "name" ), TSTRING() ) );
+
+				config.reset();
+				remove( "rewrite_test.ini" );
+			}
+		}
+
+		TEST_METHOD( ConfigFile_LazyMatchesEager )
+		{
+			/* records every entry in the order it is parsed */
+			class RecordingParser : public Parser<TSTRING>
+			{
+			public:
+				RecordingParser( const TSTRING& name ) : Parser<TSTRING>( name ) {}
+				using Parser<TSTRING>::Parse;
+				void Parse( const TSTRING& key, const TSTRING& value )
+				{
+					entries.push_back( key + TEXT( "=" ) + value );
+				}
+				std::vector<TSTRING> entries;
+			};
+
+			const char* text = "top = 1\r\n[Server]\r\nthreads = 4\r\n; [Hidden]\r\nbare\r\n[Empty]\r\n[Client]\nretries = 3\n"
+							   "  [NotHeader]\n[server]\nport = 80\n[Last]\nkey = [value]";
+			const char* names[] = { "lazy_test.ini", "eager_test.ini" };
+			for ( int n = 0; n < 2; ++n )
+			{
+				FILE* file = fopen( names[n], "wb" );
+				Assert::IsTrue( file != nullptr );
+				fputs( text, file );
+				fclose( file );
+			}
+
+			CONFIGHANDLE lazy = OPEN_CONFIG( TEXT( "lazy_test.ini" ), TEXT( "" ), CONFIG_LAZY );
+			CONFIGHANDLE eager = OPEN_CONFIG( TEXT( "eager_test.ini" ), TEXT( "" ), CONFIG_EAGER );
+
+			/* only the headers are scanned until a section is added */
+			Assert::AreEqual( (UINT64) 5, lazy->Statistics().counters[LOAD_LINES] );
+			Assert::AreEqual( (UINT64) 12, eager->Statistics().counters[LOAD_LINES] );
+
+			const TCHAR* sections[] = { TEXT( "Last" ), TEXT( "Server" ), TEXT( "Default" ), TEXT( "Empty" ), TEXT( "Client" ),
+										TEXT( "Hidden" ), TEXT( "NotHeader" ) };
+			for ( size_t i = 0; i < sizeof( sections ) / sizeof( sections[0] ); ++i )
+			{
+				RecordingParser* lazyParser = new RecordingParser( sections[i] );
+				RecordingParser* eagerParser = new RecordingParser( sections[i] );
+				const bool lazyAdded = lazy->AddSection( lazyParser );
+				const bool eagerAdded = eager->AddSection( eagerParser );
+				Assert::AreEqual( eagerAdded, lazyAdded );
+				Assert::IsTrue( lazyParser->entries == eagerParser->entries );
+				if ( !eagerAdded )
+				{
+					delete lazyParser;
+					delete eagerParser;
+				}
+			}
+
+			/* once every section is added both have scanned the same lines */
+			RecordingParser* server = static_cast<RecordingParser*>( lazy->GetSection( TEXT( "Server" ) ) );
+			Assert::AreEqual( (size_t) 3, server->entries.size() );
+			Assert::AreEqual( TSTRING( TEXT( "port=80" ) ), server->entries[2] );
+			Assert::AreEqual( eager->Statistics().counters[LOAD_LINES], lazy->Statistics().counters[LOAD_LINES] );
+
+			lazy.reset();
+			eager.reset();
+			remove( "lazy_test.ini" );
+			remove( "eager_test.ini" );
+		}
+
+		TEST_METHOD( ConfigFile_GetSectionDuringAdd )
+		{
+			FILE* file = fopen( "add_test.ini", "wb" );
+			Assert::IsTrue( file != nullptr );
+			for ( int i = 0; i < 64; ++i )
+			{
+				fprintf( file, "[Section%d]\nvalue = %d\n", i, i );
+			}
+			fclose( file );
+
+			CONFIGHANDLE config = OPEN_CONFIG( TEXT( "add_test.ini" ), TEXT( "" ) );
+			DefaultParser* first = new DefaultParser( TEXT( "Section0" ) );
+			Assert::IsTrue( config->AddSection( first ) );
+			std::atomic<bool> stop( false );
+			std::atomic<int> missing( 0 );
+
+			/* readers inside a guard never see a map being grown by AddSection */
+			std::thread reader( [&]()
+			{
+				while ( !stop.load() )
+				{
+					ConfigLoader::ReadGuard guard;
+					if ( config->GetSection( TEXT( "Section0" ) ) != first )
+					{
+						++missing;
+					}
+				}
+			} );
+
+			for ( int i = 1; i < 64; ++i )
+			{
+				TSTRING name( TEXT( "Section" ) );
+				name += util::Int64ToString( i );
+				Assert::IsTrue( config->AddSection( new DefaultParser( name ) ) );
+			}
+
+			stop = true;
+			reader.join();
+			Assert::AreEqual( 0, missing.load() );
+			Assert::IsTrue( config->GetSection( TEXT( "Section63" ) ) != nullptr );
+
+			config.reset();
+			remove( "add_test.ini" );
+		}
+	};
+
+	/**
+	 * Splits contents one charactor at a time by the rules of the original line by line loader,
+	 * used to check the vectorised LineScanner.
+	 */
+	static void
+	ReferenceScan( const TSTRING& contents, std::vector<ScannedLine>& lines )
+	{
+		size_t start = 0;
+		while ( start < contents.size() )
+		{
+			size_t end = contents.find( TEXT( '\n' ), start );
+			const size_t next = ( end == TSTRING::npos ) ? contents.size() : end + 1;
+			end = ( end == TSTRING::npos ) ? contents.size() : end;
+
+			ScannedLine line;
+			size_t length = end - start;
+			if ( length > 0 && contents[end - 1] == TEXT( '\r' ) )
+			{
+				length -= 1;
+			}
+			if ( length == 0 || contents[start] == TEXT( ';' ) )
+			{
+				start = next;
+				continue;
+			}
+
+			line.start = start;
+			line.length = static_cast<UINT32>( length );
+			line.type = ( contents[start] == TEXT( '[' ) ) ? LINE_SECTION : LINE_ENTRY;
+			const size_t split = contents.find( ( line.type == LINE_SECTION ) ? TEXT( ']' ) : TEXT( '=' ), start );
+			const size_t keyEnd = ( split < end ) ? split : end;
+			line.split = ( split < end ) ? static_cast<UINT32>( split - start ) : ScannedLine::NO_SPLIT;
+
+			/* keys and values are trimmed to their first and last graphical charactors */
+			UINT32* bounds[2][2] = { { &line.key_begin, &line.key_end }, { &line.value_begin, &line.value_end } };
+			const size_t ranges[2][2] = { { start, keyEnd }, { keyEnd + 1, end } };
+			for ( int r = 0; r < 2; ++r )
+			{
+				*bounds[r][0] = 0;
+				*bounds[r][1] = 0;
+				bool found = false;
+				for ( size_t i = ranges[r][0]; i < ranges[r][1]; ++i )
+				{
+					if ( contents[i] > 0x20 && contents[i] < 0x7F )
+					{
+						if ( !found )
+						{
+							*bounds[r][0] = static_cast<UINT32>( i - start );
+							found = true;
+						}
+						*bounds[r][1] = static_cast<UINT32>( i + 1 - start );
+					}
+				}
+			}
+			lines.push_back( line );
+			start = next;
+		}
+	}
+
+	TEST_CLASS( LineScanner_Test )
+	{
+	public:
+		/**
+		 * Checks the scanner and the reference agree on every field of every line.
+		 */
+		static void CheckScan( const TSTRING& contents )
+		{
+			std::vector<ScannedLine> expected, scanned;
+			ReferenceScan( contents, expected );
+			LineScanner::Scan( StringView( contents.data(), contents.size() ), scanned );
+
+			Assert::AreEqual( expected.size(), scanned.size() );
+			for ( size_t i = 0; i < expected.size() && i < scanned.size(); ++i )
+			{
+				Assert::AreEqual( expected[i].start, scanned[i].start );
+				Assert::AreEqual( expected[i].length, scanned[i].length );
+				Assert::AreEqual( expected[i].split, scanned[i].split );
+				Assert::AreEqual( expected[i].key_begin, scanned[i].key_begin );
+				Assert::AreEqual( expected[i].key_end, scanned[i].key_end );
+				Assert::AreEqual( expected[i].value_begin, scanned[i].value_begin );
+				Assert::AreEqual( expected[i].value_end, scanned[i].value_end );
+				Assert::IsTrue( expected[i].type == scanned[i].type );
+			}
+
+			/* headers found on their own match those of the full scan */
+			std::vector<ScannedLine> headers;
+			LineScanner::ScanSections( StringView( contents.data(), contents.size() ), headers );
+			size_t h = 0;
+			for ( size_t i = 0; i < expected.size(); ++i )
+			{
+				if ( expected[i].type == LINE_SECTION )
+				{
+					Assert::IsTrue( h < headers.size() && headers[h].start == expected[i].start && headers[h].split == expected[i].split );
+					++h;
+				}
+			}
+			Assert::AreEqual( h, headers.size() );
+		}
+
+		TEST_METHOD( LineScanner_BlockEdges )
+		{
+			/* the vector paths classify 16 or 32 charactors at a time inside 64 charactor blocks */
+			const size_t edges[] = { 15, 16, 17, 31, 32, 33, 63, 64, 65, 127, 128 };
+			for ( size_t e = 0; e < sizeof( edges ) / sizeof( edges[0] ); ++e )
+			{
+				for ( size_t shift = 0; shift < 3; ++shift )
+				{
+					/* line endings, splits and trimmed charactors either side of each edge */
+					TSTRING padding( edges[e] - shift, TEXT( 'k' ) );
+					CheckScan( padding + TEXT( "=value\n[Next]\n" ) );
+					CheckScan( padding + TEXT( "\r\nkey = value\r\n" ) );
+					CheckScan( TEXT( "[" ) + padding + TEXT( "]\t\n  key\t= " ) + padding );
+					CheckScan( TEXT( "key = " ) + padding + TEXT( "  \n; comment = " ) + padding );
+					CheckScan( TSTRING( edges[e] - shift, TEXT( ' ' ) ) + TEXT( "key=\r" ) );
+				}
+			}
+		}
+
+		TEST_METHOD( LineScanner_LineEndings )
+		{
+			CheckScan( TEXT( "" ) );
+			CheckScan( TEXT( "\n" ) );
+			CheckScan( TEXT( "\r\n\r\n" ) );
+			CheckScan( TEXT( "key = value" ) );
+			CheckScan( TEXT( "key = value\r" ) );
+			CheckScan( TEXT( "[Section]\r\nkey = value\r\nbare\r\n" ) );
+			CheckScan( TEXT( "[Section\nkey == value = more\n  \n;\n=\n]\n" ) );
+			CheckScan( TEXT( "\r[Section]\n\rkey\r=\rvalue\r\r\n" ) );
+		}
+
+		TEST_METHOD( LineScanner_Random )
+		{
+			const TCHAR alphabet[] = { TEXT( 'a' ), TEXT( 'Z' ), TEXT( '=' ), TEXT( '[' ), TEXT( ']' ), TEXT( ';' ),
+									   TEXT( ' ' ), TEXT( '\t' ), TEXT( '\r' ), TEXT( '\n' ), TEXT( '\n' ),
+									   static_cast<TCHAR>( 0x7F ), static_cast<TCHAR>( 0xE9 ) };
+			std::mt19937 random( 12345 );
+			std::uniform_int_distribution<size_t> pick( 0, sizeof( alphabet ) / sizeof( alphabet[0] ) - 1 );
+			std::uniform_int_distribution<size_t> length( 0, 300 );
+
+			for ( int i = 0; i < 2000; ++i )
+			{
+				TSTRING contents( length( random ), TEXT( ' ' ) );
+				for ( size_t c = 0; c < contents.size(); ++c )
+				{
+					contents[c] = alphabet[pick( random )];
+				}
+				CheckScan( contents );
+			}
+		}
+
+		TEST_METHOD( LineScanner_Offset )
+		{
+			/* lines scanned from part of a larger view are placed in that view */
+			const TSTRING contents( TEXT( "[A]\nkey = 1\n[B]\nother = 2\n" ) );
+			std::vector<ScannedLine> whole, parts;
+			LineScanner::Scan( StringView( contents.data(), contents.size() ), whole );
+			LineScanner::Scan( StringView( contents.data(), 12 ), parts );
+			LineScanner::Scan( StringView( contents.data() + 12, contents.size() - 12 ), parts, 12 );
+			Assert::AreEqual( whole.size(), parts.size() );
+			for ( size_t i = 0; i < whole.size(); ++i )
+			{
+				Assert::AreEqual( whole[i].start, parts[i].start );
+				Assert::IsTrue( whole[i].Key( StringView( contents.data(), contents.size() ) ) == parts[i].Key( StringView( contents.data(), contents.size() ) ) );
+			}
+		}
+	};
+
+	TEST_CLASS( Arena_Test )
+	{
+	public:
+		TEST_METHOD( Arena_Allocate )
+		{
+			Arena arena( 256 );
+
+			/* allocations are aligned and come from the same chunk until it is full */
+			char* first = static_cast<char*>( arena.Allocate( 3, 1 ) );
+			double* second = static_cast<double*>( arena.Allocate( sizeof( double ), alignof( double ) ) );
+			Assert::IsTrue( reinterpret_cast<size_t>( second ) % alignof( double ) == 0 );
+			Assert::IsTrue( reinterpret_cast<char*>( second ) > first );
+			size_t reserved = arena.Reserved();
+
+			/* large allocations get their own chunk */
+			arena.Allocate( 1024 );
+			Assert::IsTrue( arena.Reserved() > reserved + 1024 );
+
+			arena.Release();
+			Assert::AreEqual( (size_t) 0, arena.Reserved() );
+		}
+
+		TEST_METHOD( Arena_ParserEntries )
+		{
+			Arena arena;
+			DefaultParser testParser( TEXT( "TestSection" ) );
+
+			/* entries parsed after the arena is set should be stored in it */
+			testParser.UseArena( &arena );
+			testParser.Parse( TEXT( "TestKey" ), TEXT( "1" ) );
+			Assert::IsTrue( arena.Reserved() > 0 );
+			Assert::AreEqual( TSTRING( TEXT( "1" ) ), testParser.getString( TEXT( "TestKey" ), TEXT( "" ) ) );
+
+			/* keys and values too long for small string storage are copied into the arena as well */
+			FlatDefaultParser* flatParser = new FlatDefaultParser( TEXT( "TestSection" ) );
+			flatParser->UseArena( &arena );
+			size_t before = allocations.load();
+			testParser.Parse( StringView( TEXT( "a_key_that_is_too_long_for_small_strings" ) ), StringView( TEXT( "a value that is too long for small string storage" ) ) );
+			flatParser->Parse( StringView( TEXT( "a_key_that_is_too_long_for_small_strings" ) ), StringView( TEXT( "a value that is too long for small string storage" ) ) );
+			Assert::AreEqual( before, allocations.load() );
+			Assert::AreEqual( TSTRING( TEXT( "a value that is too long for small string storage" ) ),
+							  flatParser->getString( CFG_KEY( "a_key_that_is_too_long_for_small_strings" ), TSTRING() ) );
+			Assert::AreEqual( TSTRING( TEXT( "a_key_that_is_too_long_for_small_strings" ) ), testParser.GetAt( 1 ) );
+
+			/* the entries are left for the arena to release */
+			delete flatParser;
+		}
+	};
+
+	TEST_CLASS( ConfigRegistry_Test )
+	{
+	public:
+		TEST_METHOD( ConfigRegistry_InsertRemove )
+		{
+			ConfigRegistry registry;
+			ConfigLoader* first = reinterpret_cast<ConfigLoader*>( 0x10 );
+			ConfigLoader* second = reinterpret_cast<ConfigLoader*>( 0x20 );
+			TSTRING name( TEXT( "test" ) );
+
+			{
+				std::lock_guard<std::mutex> lock( registry.ShardLock( name ) );
+				registry.Insert( name, first );
+			}
+			{
+				ConfigRegistry::ReadGuard guard( registry );
+				Assert::IsTrue( registry.Find( name ) == first );
+				Assert::IsTrue( registry.Find( TEXT( "other" ) ) == nullptr );
+			}
+
+			/* only the config stored under the name is removed */
+			std::lock_guard<std::mutex> lock( registry.ShardLock( name ) );
+			Assert::IsFalse( registry.Remove( name, second ) );
+			Assert::IsTrue( registry.Remove( name, first ) );
+			Assert::IsTrue( registry.Find( name ) == nullptr );
+		}
+
+		TEST_METHOD( ConfigRegistry_ConcurrentReaders )
+		{
+			ConfigRegistry registry;
+			ConfigLoader* config = reinterpret_cast<ConfigLoader*>( 0x10 );
+			std::atomic<bool> stop( false );
+			std::atomic<int> missing( 0 );
+			std::vector<std::thread> readers;
+
+			{
+				std::lock_guard<std::mutex> lock( registry.ShardLock( TEXT( "stable" ) ) );
+				registry.Insert( TEXT( "stable" ), config );
+			}
+
+			for ( int t = 0; t < 4; ++t )
+			{
+				readers.push_back( std::thread( [&]()
+				{
+					while ( !stop.load() )
+					{
+						ConfigRegistry::ReadGuard guard( registry );
+						if ( registry.Find( TEXT( "stable" ) ) != config )
+						{
+							++missing;
+						}
+					}
+				} ) );
+			}
+
+			/* tables are replaced under the readers, which must always see the stable entry */
+			for ( int i = 0; i < 200; ++i )
+			{
+				TSTRING name( TEXT( "churn0" ) );
+				name[5] = static_cast<TCHAR>( TEXT( '0' ) + i % 8 );
+				std::lock_guard<std::mutex> lock( registry.ShardLock( name ) );
+				if ( !registry.Remove( name, config ) )
+				{
+					registry.Insert( name, config );
+				}
+			}
+
+			stop = true;
+			for ( size_t t = 0; t < readers.size(); ++t )
+			{
+				readers[t].join();
+			}
+			Assert::AreEqual( 0, missing.load() );
+		}
+
+		TEST_METHOD( ConfigRegistry_NamesDuringChurn )
+		{
+			ConfigRegistry registry;
+			ConfigLoader* config = reinterpret_cast<ConfigLoader*>( 0x10 );
+			std::atomic<bool> stop( false );
+			std::atomic<int> missing( 0 );
+
+			{
+				std::lock_guard<std::mutex> lock( registry.ShardLock( TEXT( "stable" ) ) );
+				registry.Insert( TEXT( "stable" ), config );
+			}
+
+			/* Names guards itself, so the tables it walks are not freed under it */
+			std::thread reader( [&]()
+			{
+				while ( !stop.load() )
+				{
+					std::vector<TSTRING> names;
+					registry.Names( names );
+					if ( std::find( names.begin(), names.end(), TSTRING( TEXT( "stable" ) ) ) == names.end() )
+					{
+						++missing;
+					}
+				}
+			} );
+
+			for ( int i = 0; i < 200; ++i )
+			{
+				TSTRING name( TEXT( "churn0" ) );
+				name[5] = static_cast<TCHAR>( TEXT( '0' ) + i % 8 );
+				std::lock_guard<std::mutex> lock( registry.ShardLock( name ) );
+				if ( !registry.Remove( name, config ) )
+				{
+					registry.Insert( name, config );
+				}
+			}
+
+			stop = true;
+			reader.join();
+			Assert::AreEqual( 0, missing.load() );
+		}
+	};
+
+	TEST_CLASS( Utility_Test )
+	{
+	public:
+		TEST_METHOD( Utility_Int64ToString )
+		{
+			Assert::AreEqual( TSTRING( TEXT( "0" ) ), util::Int64ToString( 0 ) );
+			Assert::AreEqual( TSTRING( TEXT( "-42" ) ), util::Int64ToString( -42 ) );
+			Assert::AreEqual( TSTRING( TEXT( "9223372036854775807" ) ), util::Int64ToString( INT64( 9223372036854775807 ) ) );
+			Assert::AreEqual( TSTRING( TEXT( "-9223372036854775808" ) ), util::Int64ToString( -INT64( 9223372036854775807 ) - 1 ) );
+		}
+
+		TEST_METHOD( Utility_FoldCase )
+		{
+			/* long enough for the vector loop and a tail, charactors outside 'a' to 'z' are unchanged */
+			TSTRING name( TEXT( "server.Primary-db_{az}[AZ]@`~09 connection_pool" ) );
+			name += static_cast<TCHAR>( 0xE9 );
+			TSTRING expected( TEXT( "SERVER.PRIMARY-DB_{AZ}[AZ]@`~09 CONNECTION_POOL" ) );
+			expected += static_cast<TCHAR>( 0xE9 );
+			Assert::AreEqual( expected, util::FoldedString( name ) );
+
+			for ( size_t length = 0; length < name.size(); ++length )
+			{
+				Assert::AreEqual( expected.substr( 0, length ), util::FoldedString( StringView( name.data(), length ) ) );
+			}
+		}
+
+		TEST_METHOD( Utility_ParseInt )
+		{
+			INT64 value64 = 0;
+			Assert::IsTrue( util::ParseInt64( TSTRING( TEXT( "-1234567890123456789" ) ), value64 ) );
+			Assert::IsTrue( value64 == INT64( -1234567890123456789 ) );
+			Assert::IsFalse( util::ParseInt64( TSTRING( TEXT( "9223372036854775808" ) ), value64 ) );
+			Assert::IsFalse( util::ParseInt64( TSTRING( TEXT( "12 " ) ), value64 ) );
+			Assert::IsFalse( util::ParseInt64( TSTRING( TEXT( "" ) ), value64 ) );
+
+			/* overflow is checked for each width */
+			INT16 value16 = 0;
+			Assert::IsTrue( util::ParseInt16( TSTRING( TEXT( "-32768" ) ), value16 ) );
+			Assert::IsFalse( util::ParseInt16( TSTRING( TEXT( "32768" ) ), value16 ) );
+			Assert::AreEqual( (INT16) -32768, value16 );
+
+			INT32 value32 = 0;
+			Assert::IsTrue( util::ParseInt32( TSTRING( TEXT( "0x7FFFFFFF" ) ), value32 ) );
+			Assert::AreEqual( (INT32) 0x7FFFFFFF, value32 );
+			Assert::IsFalse( util::ParseInt32( TSTRING( TEXT( "0x80000000" ) ), value32 ) );
+		}
+
+		TEST_METHOD( Utility_StringToInt )
+		{
+			/* like strtol leading whitespace is skipped and parsing stops at the first non digit */
+			Assert::AreEqual( (INT32) 250, util::StringToInt32( TSTRING( TEXT( "  250ms" ) ) ) );
+			Assert::AreEqual( (INT32) 8, util::StringToInt32( TSTRING( TEXT( "010" ) ) ) );
+			Assert::AreEqual( (INT32) 255, util::StringToInt32( TSTRING( TEXT( "ff" ) ), 16 ) );
+			Assert::IsTrue( util::StringToInt64( TSTRING( TEXT( "4294967296" ) ) ) == INT64( 4294967296 ) );
+			Assert::AreEqual( (INT16) 0, util::StringToInt16( TSTRING( TEXT( "70000" ) ) ) );
+		}
+
+		TEST_METHOD( Utility_DoubleToString )
+		{
+			/* shortest representation that parses back to the same double */
+			Assert::AreEqual( TSTRING( TEXT( "0.1" ) ), util::DoubleToString( 0.1 ) );
+			Assert::AreEqual( TSTRING( TEXT( "-1.5" ) ), util::DoubleToString( -1.5 ) );
+			Assert::AreEqual( TSTRING( TEXT( "100" ) ), util::DoubleToString( 100.0 ) );
+			Assert::AreEqual( TSTRING( TEXT( "0.000001" ) ), util::DoubleToString( 1e-6 ) );
+			Assert::AreEqual( TSTRING( TEXT( "1e-7" ) ), util::DoubleToString( 1e-7 ) );
+			Assert::AreEqual( TSTRING( TEXT( "1e+21" ) ), util::DoubleToString( 1e21 ) );
+			Assert::AreEqual( TSTRING( TEXT( "5e-324" ) ), util::DoubleToString( 4.9406564584124654e-324 ) );
+			Assert::AreEqual( TSTRING( TEXT( "1.7976931348623157e+308" ) ), util::DoubleToString( 1.7976931348623157e308 ) );
+		}
+
+		TEST_METHOD( Utility_ParseDouble )
+		{
+			double value = 0.0;
+			Assert::IsTrue( util::ParseDouble( TSTRING( TEXT( "-2.5e-3" ) ), value ) );
+			Assert::AreEqual( -2.5e-3, value );
+			Assert::IsTrue( util::ParseDouble( TSTRING( TEXT( "1e400" ) ), value ) );
+			Assert::IsTrue( value == std::numeric_limits<double>::infinity() );
+			Assert::IsFalse( util::ParseDouble( TSTRING( TEXT( "1.5x" ) ), value ) );
+			Assert::IsFalse( util::ParseDouble( TSTRING( TEXT( "." ) ), value ) );
+			Assert::AreEqual( 0.25, util::StringToDouble( TSTRING( TEXT( " .25e" ) ) ) );
+		}
+
+		TEST_METHOD( Utility_ParseDouble_MatchesStrtod )
+		{
+			std::mt19937_64 random( 2016 );
+			char buffer[64];
+
+			for ( int i = 0; i < 100000; ++i )
+			{
+				/* random doubles written with a random number of digits, and random digit strings */
+				UINT64 bits = random();
+				double number;
+				std::memcpy( &number, &bits, sizeof( number ) );
+				int length;
+				if ( ( i & 1 ) == 0 )
+				{
+					length = std::snprintf( buffer, sizeof( buffer ), "%.*g", static_cast<int>( random() % 17 ) + 1, number );
+				}
+				else
+				{
+					length = std::snprintf( buffer, sizeof( buffer ), "%llu.%llue%d", static_cast<unsigned long long>( random() % 100000 ),
+											static_cast<unsigned long long>( random() >> ( random() % 64 ) ), static_cast<int>( random() % 700 ) - 350 );
+				}
+
+				double parsed = 0.0;
+				Assert::IsTrue( util::ParseDouble( TSTRING( buffer, buffer + length ), parsed ) );
+				double expected = std::strtod( buffer, nullptr );
+				Assert::IsTrue( std::memcmp( &parsed, &expected, sizeof( parsed ) ) == 0 || ( parsed != parsed && expected != expected ) );
+
+				/* formatting round trips */
+				Assert::IsTrue( util::ParseDouble( util::DoubleToString( parsed ), number ) );
+				Assert::IsTrue( std::memcmp( &parsed, &number, sizeof( parsed ) ) == 0 || parsed != parsed );
+			}
+		}
+	};
+
+	TEST_CLASS( Diagnostics_Test )
+	{
+	public:
+		TEST_METHOD( Diagnostics_RingDrops )
+		{
+			TSTRING file( TEXT( "test.ini" ) );
+			TSTRING section( TEXT( "Section" ) );
+			DiagnosticRing ring( 3 );
+			Assert::AreEqual( (size_t) 4, ring.Capacity() );
+
+			/* a full ring drops new records and counts every one */
+			for ( INT64 i = 0; i < 6; ++i )
+			{
+				Assert::AreEqual( i < 4, ring.Push( Diagnostic( DIAG_AUTO_KEYS, &file, section, i ) ) );
+			}
+			Assert::AreEqual( (UINT64) 2, ring.Dropped() );
+
+			std::vector<Diagnostic> records;
+			Assert::AreEqual( (size_t) 3, ring.Drain( records, 3 ) );
+			Assert::AreEqual( (size_t) 1, ring.Drain( records ) );
+			Assert::AreEqual( (size_t) 0, ring.Drain( records ) );
+			for ( size_t i = 0; i < records.size(); ++i )
+			{
+				Assert::AreEqual( (INT64) i, records[i].argument );
+			}
+			Assert::AreEqual( TSTRING( TEXT( "AutoKeys Generated for section Section: 3" ) ), records[3].Format() );
+		}
+
+		TEST_METHOD( Diagnostics_ConcurrentProducers )
+		{
+			TSTRING file( TEXT( "test.ini" ) );
+			DiagnosticRing ring( 64 );
+			std::atomic<bool> done( false );
+			std::vector<std::thread> producers;
+			std::vector<INT64> last( 4, -1 );
+			size_t received = 0;
+			bool ordered = true;
+
+			for ( int t = 0; t < 4; ++t )
+			{
+				producers.push_back( std::thread( [&ring, &file, t]()
+				{
+					for ( INT64 i = 0; i < 5000; ++i )
+					{
+						ring.Push( Diagnostic( DIAG_AUTO_KEYS, &file, StringView(), i, t ) );
+					}
+				} ) );
+			}
+
+			/* records of each producer arrive in the order they were added */
+			std::thread consumer( [&]()
+			{
+				Diagnostic record;
+				while ( !done.load() || ring.Pop( record ) )
+				{
+					while ( ring.Pop( record ) )
+					{
+						ordered = ordered && record.argument > last[record.offset];
+						last[record.offset] = record.argument;
+						++received;
+					}
+				}
+			} );
+
+			for ( size_t t = 0; t < producers.size(); ++t )
+			{
+				producers[t].join();
+			}
+			done = true;
+			consumer.join();
+
+			Assert::IsTrue( ordered );
+			Assert::AreEqual( (UINT64) 20000, received + ring.Dropped() );
+		}
+
+		TEST_METHOD( Diagnostics_MalformedFile )
+		{
+			FILE* file = fopen( "diagnostics_test.ini", "wb" );
+			Assert::IsTrue( file != nullptr );
+			fputs( "[broken\na = 1\n[Good]\n= value\nb = 2\n", file );
+			for ( size_t i = 0; i < ConfigLoader::MAX_MESSAGES + 10; ++i )
+			{
+				fputs( "[flood\n", file );
+			}
+			fclose( file );
+
+			CONFIGHANDLE config = OPEN_CONFIG( TEXT( "diagnostics_test.ini" ), TEXT( "" ) );
+
+			/* every header is reported as the file loads, until the ring is full */
+			std::vector<Diagnostic> records;
+			Assert::AreEqual( ConfigLoader::MAX_MESSAGES, config->DrainMessages( records ) );
+			Assert::AreEqual( (UINT64) 11, config->DroppedMessages() );
+			Assert::AreEqual( (int) DIAG_UNTERMINATED_SECTION, (int) records[0].code );
+			Assert::AreEqual( (UINT32) 1, records[0].line );
+			Assert::AreEqual( (UINT64) 0, records[0].offset );
+			Assert::AreEqual( (UINT32) 6, records[1].line );
+			Assert::AreEqual( (UINT64) 35, records[1].offset );
+
+			/* entries are checked when a section is parsed */
+			DefaultParser* good = new DefaultParser( TEXT( "Good" ) );
+			Assert::IsTrue( config->AddSection( good ) );
+			Assert::AreEqual( TSTRING( TEXT( "Entry with an empty key in section Good (diagnostics_test.ini line 4)" ) ), config->PollMessages() );
+			Assert::AreEqual( TSTRING( TEXT( "Additional Messages Truncated: 11" ) ), config->PollMessages() );
+			Assert::AreEqual( TSTRING(), config->PollMessages() );
+
+			config.reset();
+			remove( "diagnostics_test.ini" );
+		}
+	};
+
+	TEST_CLASS( Statistics_Test )
+	{
+	public:
+		TEST_METHOD( Statistics_ShardedCounters )
+		{
+			ParserStatCounters counters;
+			std::vector<std::thread> threads;
+
+			/* every thread adds to its own shard, the totals are exact */
+			for ( int t = 0; t < 4; ++t )
+			{
+				threads.push_back( std::thread( [&counters]()
+				{
+					for ( int i = 0; i < 10000; ++i )
+					{
+						counters.Add( PARSER_HITS );
+						counters.Add( PARSER_ENTRIES, 2 );
+					}
+				} ) );
+			}
+			for ( size_t t = 0; t < threads.size(); ++t )
+			{
+				threads[t].join();
+			}
+			Assert::AreEqual( (UINT64) 40000, counters.Get( PARSER_HITS ) );
+			Assert::AreEqual( (UINT64) 80000, counters.Get( PARSER_ENTRIES ) );
+			Assert::AreEqual( (UINT64) 0, counters.Get( PARSER_MISSES ) );
+
+			ParserStatCounters copy( counters );
+			Assert::AreEqual( (UINT64) 0, copy.Get( PARSER_HITS ) );
+
+			/* a shard for each hardware thread, rounded up to a power of two */
+			Assert::IsTrue( StatShards() >= 1 && StatShards() <= STAT_MAX_SHARDS );
+			Assert::AreEqual( (size_t) 0, StatShards() & ( StatShards() - 1 ) );
+			Assert::IsTrue( StatShards() >= std::min<size_t>( std::thread::hardware_concurrency(), STAT_MAX_SHARDS ) );
+		}
+
+		TEST_METHOD( Statistics_Snapshot )
+		{
+			FILE* file = fopen( "statistics_test.ini", "wb" );
+			Assert::IsTrue( file != nullptr );
+			fputs( "[Numbers]\na = 1\nb = 2.5\nc = text\n[Other]\nd = 4\n", file );
+			fclose( file );
+
+			CONFIGHANDLE config = OPEN_CONFIG( TEXT( "statistics_test.ini" ), TEXT( "" ), CONFIG_LOOKUP_STATS );
+			DefaultParser* numbers = new DefaultParser( TEXT( "Numbers" ) );
+			Assert::IsTrue( config->AddSection( numbers ) );
+			TSTRING a( TEXT( "a" ) ), b( TEXT( "b" ) ), c( TEXT( "c" ) ), missing( TEXT( "missing" ) );
+			Assert::AreEqual( 1, numbers->getInt32( a, 0 ) );
+			Assert::AreEqual( 2.5, numbers->getDouble( b, 0.0 ) );
+			Assert::AreEqual( 7, numbers->getInt32( missing, 7 ) );
+			Assert::AreEqual( TSTRING( TEXT( "text" ) ), numbers->getString( c, TSTRING() ) );
+			Assert::IsTrue( config->GetSection( TEXT( "Numbers" ) ) != nullptr );
+			Assert::IsTrue( config->GetSection( TEXT( "Missing" ) ) == nullptr );
+
+			ConfigStats stats = config->Statistics();
+			Assert::AreEqual( (UINT64) 3, stats.counters[LOAD_SECTIONS] );
+			Assert::AreEqual( (UINT64) 6, stats.counters[LOAD_LINES] );
+			Assert::AreEqual( (UINT64) 1, stats.counters[LOAD_ADD_SECTIONS] );
+			Assert::AreEqual( (UINT64) 1, stats.counters[LOAD_SECTION_HITS] );
+			Assert::AreEqual( (UINT64) 1, stats.counters[LOAD_SECTION_MISSES] );
+			Assert::IsTrue( stats.counters[LOAD_BYTES] > 0 );
+			Assert::AreEqual( (size_t) 1, stats.parsers.size() );
+			Assert::AreEqual( (UINT64) 3, stats.parsers[0].counters[PARSER_HITS] );
+			Assert::AreEqual( (UINT64) 1, stats.parsers[0].counters[PARSER_MISSES] );
+			Assert::AreEqual( (UINT64) 2, stats.parsers[0].counters[PARSER_CONVERSIONS] );
+			Assert::AreEqual( (UINT64) 3, stats.parsers[0].counters[PARSER_ENTRIES] );
+
+			/* samples are labelled with the file and section, and each name has one header */
+			std::vector<ConfigStats> configs( 1, stats );
+			configs[0].file = TEXT( "dir/\"quoted\".ini" );
+			const std::string text = FormatPrometheus( configs );
+			Assert::IsTrue( text.find( "simpleconfig_lookups_total{file=\"dir/\\\"quoted\\\".ini\",section=\"Numbers\",result=\"miss\"} 1\n" ) != std::string::npos );
+			Assert::IsTrue( text.find( "simpleconfig_section_lookups_total{file=\"dir/\\\"quoted\\\".ini\",result=\"hit\"} 1\n" ) != std::string::npos );
+			const size_t header = text.find( "# TYPE simpleconfig_load_seconds_total counter\n" );
+			Assert::IsTrue( header != std::string::npos );
+			Assert::IsTrue( text.find( "# TYPE simpleconfig_load_seconds_total", header + 1 ) == std::string::npos );
+			config.reset();
+
+			/* lookups are not counted by default, loading still is */
+			config = OPEN_CONFIG( TEXT( "statistics_test.ini" ), TEXT( "" ) );
+			numbers = new DefaultParser( TEXT( "Numbers" ) );
+			Assert::IsTrue( config->AddSection( numbers ) );
+			Assert::AreEqual( 1, numbers->getInt32( a, 0 ) );
+			Assert::IsTrue( config->GetSection( TEXT( "Numbers" ) ) != nullptr );
+			stats = config->Statistics();
+			Assert::AreEqual( (UINT64) 6, stats.counters[LOAD_LINES] );
+			Assert::AreEqual( (UINT64) 0, stats.counters[LOAD_SECTION_HITS] );
+			Assert::AreEqual( (UINT64) 0, stats.parsers[0].counters[PARSER_HITS] );
+			Assert::AreEqual( (UINT64) 0, stats.parsers[0].counters[PARSER_CONVERSIONS] );
+			Assert::AreEqual( (UINT64) 3, stats.parsers[0].counters[PARSER_ENTRIES] );
+
+			config.reset();
+			remove( "statistics_test.ini" );
+		}
+	};
+
+	TEST_CLASS( KeyProfile_Test )
+	{
+	public:
+		TEST_METHOD( KeyProfile_HotAndDeadKeys )
+		{
+			FILE* file = fopen( "profile_test.ini", "wb" );
+			Assert::IsTrue( file != nullptr );
+			fputs( "[Numbers]\nhot = 1\nwarm = 2\ncold = 3\nunused = 4\n", file );
+			fclose( file );
+
+			CONFIGHANDLE config = OPEN_CONFIG( TEXT( "profile_test.ini" ), TEXT( "" ), CONFIG_PROFILE );
+			FlatDefaultParser* numbers = new FlatDefaultParser( TEXT( "Numbers" ) );
+			Assert::IsTrue( config->AddSection( numbers ) );
+			TSTRING hot( TEXT( "hot" ) ), warm( TEXT( "warm" ) ), cold( TEXT( "cold" ) ), missing( TEXT( "missing" ) );
+
+			std::vector<std::thread> threads;
+			for ( int t = 0; t < 4; ++t )
+			{
+				threads.push_back( std::thread( [&]()
+				{
+					for ( int i = 0; i < 6400; ++i )
+					{
+						numbers->getInt32( hot, 0 );
+						if ( i % 4 == 0 )
+						{
+							numbers->getInt32( warm, 0 );
+							numbers->getInt32( missing, 0 );
+						}
+					}
+				} ) );
+			}
+			for ( size_t t = 0; t < threads.size(); ++t )
+			{
+				threads[t].join();
+			}
+			numbers->getInt32( cold, 0 );
+
+			/* counts are sampled, keys never read are exact */
+			KeyProfileReport report = config->ProfileReport( 2 );
+			Assert::AreEqual( (size_t) 2, report.hot.size() );
+			Assert::AreEqual( hot, report.hot[0].key );
+			Assert::AreEqual( warm, report.hot[1].key );
+			Assert::IsTrue( report.hot[0].reads > 20000 && report.hot[0].reads < 30000 );
+			Assert::IsTrue( report.hot[1].reads > 5000 && report.hot[1].reads < 8000 );
+			Assert::IsTrue( report.misses > 5000 && report.misses < 8000 );
+			Assert::AreEqual( (size_t) 1, report.dead.size() );
+			Assert::AreEqual( TSTRING( TEXT( "unused" ) ), report.dead[0].key );
+			Assert::AreEqual( TSTRING( TEXT( "Numbers" ) ), report.dead[0].section );
+
+			config.reset();
+			remove( "profile_test.ini" );
+		}
+	};
+
+	/** settings bound by Schema_Test. */
+	struct ServerSettings
+	{
+		INT32 port;
+		INT64 limit;
+		double timeout;
+		bool verbose;
+		TSTRING name;
+	};
+
+	TEST_CLASS( Schema_Test )
+	{
+	public:
+		TEST_METHOD( Schema_BindSection )
+		{
+			FILE* file = fopen( "schema_test.ini", "wb" );
+			Assert::IsTrue( file != nullptr );
+			fputs( "[Server]\nport = 70000\ntimeout = 0.25\nverbose = Yes\nname = primary\nlimit = lots\n", file );
+			fclose( file );
+
+			std::shared_ptr<Schema<ServerSettings>> schema( new Schema<ServerSettings>() );
+			schema->Field( TEXT( "port" ), &ServerSettings::port, 8080, 1, 65535 )
+				.Field( TEXT( "limit" ), &ServerSettings::limit, 100 )
+				.Field( TEXT( "timeout" ), &ServerSettings::timeout, 2.5 )
+				.Field( TEXT( "verbose" ), &ServerSettings::verbose, false )
+				.Field( TEXT( "name" ), &ServerSettings::name, TSTRING( TEXT( "server" ) ) );
+
+			CONFIGHANDLE config = OPEN_CONFIG( TEXT( "schema_test.ini" ), TEXT( "" ) );
+			SchemaParser<ServerSettings>* server = new SchemaParser<ServerSettings>( TEXT( "Server" ), schema );
+			Assert::IsTrue( config->AddSection( server ) );
+
+			/* values out of bounds are clamped, values that do not convert keep the default */
+			const ServerSettings& settings = server->Values();
+			Assert::AreEqual( 65535, settings.port );
+			Assert::AreEqual( (INT64) 100, settings.limit );
+			Assert::AreEqual( 0.25, settings.timeout );
+			Assert::IsTrue( settings.verbose );
+			Assert::AreEqual( TSTRING( TEXT( "primary" ) ), settings.name );
+			Assert::AreEqual( TSTRING( TEXT( "Invalid Configuration Value: limit" ) ), server->CheckMessage() );
+
+			/* parsers created for a reload start from the defaults of the same schema */
+			std::unique_ptr<ParserBase> fresh( server->Create() );
+			SchemaParser<ServerSettings>* created = dynamic_cast<SchemaParser<ServerSettings>*>( fresh.get() );
+			Assert::IsTrue( created != nullptr );
+			Assert::AreEqual( 8080, created->Values().port );
+			created->Parse( TSTRING( TEXT( "port" ) ), TSTRING( TEXT( "9090" ) ) );
+			created->Parse( TSTRING( TEXT( "unknown" ) ), TSTRING( TEXT( "1" ) ) );
+			Assert::AreEqual( 9090, created->Values().port );
+			Assert::AreEqual( TSTRING( TEXT( "Unknown Configuration Key: unknown" ) ), created->CheckMessage() );
+
+			config.reset();
+			remove( "schema_test.ini" );
+		}
+	};
+
+	TEST_CLASS( StaticConfig_Test )
+	{
+	public:
+		TEST_METHOD( StaticConfig_Getters )
+		{
+			static constexpr StaticEntry entries[] = {
+				{ StringView( TEXT( "name" ), 4 ), StringView( TEXT( "primary" ), 7 ) },
+				{ StringView( TEXT( "port" ), 4 ), StringView( TEXT( "8080" ), 4 ) },
+				{ StringView( TEXT( "timeout" ), 7 ), StringView( TEXT( "2.5" ), 3 ) },
+			};
+			static constexpr StaticSection sections[] = {
+				{ StringView( TEXT( "DEFAULT" ), 7 ), StaticParser( entries, 0 ) },
+				{ StringView( TEXT( "SERVER" ), 6 ), StaticParser( entries, 3 ) },
+			};
+			static constexpr StaticConfig config( sections, 2 );
+
+			/* section names are found ignoring case, keys are not */
+			const StaticParser* server = config.GetSection( CFG_KEY( "Server" ) );
+			Assert::IsTrue( server != nullptr );
+			Assert::IsTrue( config.GetSection( TEXT( "missing" ) ) == nullptr );
+			Assert::AreEqual( 8080, server->getInt32( TEXT( "port" ), 0 ) );
+			Assert::AreEqual( (INT64) 7, server->getInt64( TEXT( "PORT" ), 7 ) );
+			Assert::AreEqual( 2.5, server->getDouble( TEXT( "timeout" ), 0.0 ) );
+			Assert::AreEqual( TSTRING( TEXT( "primary" ) ), server->getString( TEXT( "name" ), TSTRING() ) );
+			Assert::AreEqual( TSTRING( TEXT( "timeout" ) ), server->GetAt( 2 ) );
+		}
+
+		TEST_METHOD( StaticConfig_GenerateHeader )
+		{
+			TSTRING text( TEXT( "top = 1\n[Server]\nport = 8080\nratio = 0.5\nmax = x\"y\n[SERVER]\nport = 1\nbare\n" ) );
+			const std::string header = ConfigHeader::Generate( StringView( text ), "server_config" );
+
+			/* the same rules as loading, repeated headers merge and the first duplicate is kept */
+			Assert::IsTrue( header.find( "#ifndef _SERVER_CONFIG_H_" ) != std::string::npos );
+			Assert::IsTrue( header.find( "namespace DEFAULT" ) != std::string::npos );
+			Assert::IsTrue( header.find( "constexpr INT64 top = 1LL;" ) != std::string::npos );
+			Assert::IsTrue( header.find( "constexpr INT64 port = 8080LL;" ) != std::string::npos );
+			Assert::IsTrue( header.find( "constexpr double ratio = 0.5;" ) != std::string::npos );
+			Assert::IsTrue( header.find( "constexpr StringView max_ = StringView( TEXT(\"x\\\"y\"), 3 );" ) != std::string::npos );
+			Assert::IsTrue( header.find( "constexpr StringView _1 = StringView( TEXT(\"bare\"), 4 );" ) != std::string::npos );
+			Assert::IsTrue( header.find( "port = 1LL" ) == std::string::npos );
+			Assert::IsTrue( header.find( "constexpr StaticConfig config( sections, 2 );" ) != std::string::npos );
+		}
+	};
+
+	EMBEDDED_CONFIG( EmbeddedDefaults,
+		"; built in defaults\n"
+		"name = primary\n"
+		"[Server]\n"
+		"port = 8080\n"
+		"timeout = 2.5\n"
+		"[Paths]\n"
+		"  C:\\data  \n"
+		"D:\\logs\n"
+		"[SERVER]\r\n"
+		"backlog=128\n" );
+
+	/* the source of EMBEDDED_CONFIG without its check, which fails the build for malformed text */
+#define EMBEDDED_SOURCE( NAME, str ) \
+	struct NAME##Source \
+	{ \
+		static constexpr const TCHAR* text() { return TEXT( str ); } \
+		static constexpr size_t size() { return CFG_LITERAL_LENGTH( str ); } \
+	}
+
+	EMBEDDED_SOURCE( EmbeddedDuplicate, "[Server]\nport = 1\n[server]\nport = 2\n" );
+	EMBEDDED_SOURCE( EmbeddedUnterminated, "a = 1\n[Server\n" );
+	EMBEDDED_SOURCE( EmbeddedEmptyKey, "a = 1\n\n = 2\n" );
+
+	/* malformed text is found while compiling */
+	static_assert( embedded::ErrorLine<EmbeddedDefaultsSource>::value == 0, "well formed" );
+	static_assert( embedded::ErrorLine<EmbeddedDuplicateSource>::value == 4, "duplicate key" );
+	static_assert( embedded::ErrorLine<EmbeddedUnterminatedSource>::value == 2, "unterminated header" );
+	static_assert( embedded::ErrorLine<EmbeddedEmptyKeySource>::value == 3, "empty key" );
+	static_assert( EmbeddedDefaults::config.Size() == 3, "DEFAULT, PATHS and SERVER" );
+
+	TEST_CLASS( EmbeddedConfig_Test )
+	{
+	public:
+		TEST_METHOD( EmbeddedConfig_Sections )
+		{
+			/* repeated headers are merged and bare values are given auto-keys, as when loading */
+			const StaticParser* server = EmbeddedDefaults::Section( CFG_KEY( "server" ) );
+			Assert::IsTrue( server != nullptr );
+			Assert::AreEqual( (size_t) 3, server->Size() );
+			Assert::AreEqual( 8080, server->getInt32( CFG_KEY( "port" ), 0 ) );
+			Assert::AreEqual( 128, server->getInt32( CFG_KEY( "backlog" ), 0 ) );
+			Assert::AreEqual( 2.5, server->getDouble( CFG_KEY( "timeout" ), 0.0 ) );
+
+			const StaticParser* paths = EmbeddedDefaults::Section( CFG_KEY( "PATHS" ) );
+			Assert::AreEqual( TSTRING( TEXT( "C:\\data" ) ), paths->getString( CFG_KEY( "1" ), TSTRING() ) );
+			Assert::AreEqual( TSTRING( TEXT( "D:\\logs" ) ), paths->getString( CFG_KEY( "2" ), TSTRING() ) );
+
+			Assert::AreEqual( TSTRING( TEXT( "primary" ) ), EmbeddedDefaults::Section( CFG_KEY( "DEFAULT" ) )->getString( CFG_KEY( "name" ), TSTRING() ) );
+			Assert::IsTrue( EmbeddedDefaults::Section( CFG_KEY( "missing" ) ) == nullptr );
+		}
+
+		TEST_METHOD( EmbeddedConfig_Fallback )
+		{
+			DefaultParser server( TEXT( "Server" ) );
+			server.Parse( TSTRING( TEXT( "port" ) ), TSTRING( TEXT( "9090" ) ) );
+			server.Parse( TSTRING( TEXT( "backlog" ) ), TSTRING() );
+			server.SetFallback( EmbeddedDefaults::Section( CFG_KEY( "Server" ) ) );
+
+			/* the section wins, missing and empty numbers fall back, then the Default given */
+			Assert::AreEqual( 9090, server.getInt32( CFG_KEY( "port" ), 0 ) );
+			Assert::AreEqual( 2.5, server.getDouble( CFG_KEY( "timeout" ), 0.0 ) );
+			Assert::AreEqual( (INT64) 128, server.getInt64( CFG_KEY( "backlog" ), 0 ) );
+			Assert::AreEqual( (INT16) 7, server.getInt16( CFG_KEY( "missing" ), 7 ) );
+			Assert::AreEqual( TSTRING( TEXT( "2.5" ) ), server.getString( CFG_KEY( "timeout" ), TSTRING() ) );
+
+			/* parsers created on reload keep the fallback */
+			std::unique_ptr<ParserBase> reloaded( server.Create() );
+			Assert::IsTrue( static_cast<DefaultParser*>( reloaded.get() )->Fallback() == server.Fallback() );
+		}
+	};
+
+	TEST_CLASS( Reload_Test )
+	{
+	public:
+		TEST_METHOD( Reload_DiffSections )
+		{
+			FILE* file = fopen( "diff_test.ini", "wb" );
+			Assert::IsTrue( file != nullptr );
+			fputs( "[Server]\nthreads = 4\nname = primary\n[Client]\nretries = 3\n[Cache]\nsize = 64\n", file );
+			fclose( file );
+
+			CONFIGHANDLE config = OPEN_CONFIG( TEXT( "diff_test.ini" ), TEXT( "" ), CONFIG_RELOAD );
+			DefaultParser* server = new DefaultParser( TEXT( "Server" ) );
+			DefaultParser* client = new DefaultParser( TEXT( "Client" ) );
+			DefaultParser* cache = new DefaultParser( TEXT( "Cache" ) );
+			Assert::IsTrue( config->AddSection( server ) );
+			Assert::IsTrue( config->AddSection( client ) );
+			Assert::IsTrue( config->AddSection( cache ) );
+
+			/* changes are delivered on the watcher thread */
+			std::mutex seen_lock;
+			std::vector<SectionChange> seen;
+			config->Subscribe( [&]( const std::vector<SectionChange>& changes )
+			{
+				std::lock_guard<std::mutex> lock( seen_lock );
+				seen = changes;
+			} );
+
+			/* the file is written in place, only the edited section is reparsed */
+			file = fopen( "diff_test.ini", "wb" );
+			Assert::IsTrue( file != nullptr );
+			fputs( "[Server]\nthreads = 8\nport = 80\n[Client]\nretries = 3\n[Cache]\nsize = 64\n", file );
+			fclose( file );
+
+			std::vector<SectionChange> changes;
+			for ( int wait = 0; wait < 50 && changes.empty(); ++wait )
+			{
+				std::this_thread::sleep_for( std::chrono::milliseconds( 100 ) );
+				std::lock_guard<std::mutex> lock( seen_lock );
+				changes = seen;
+			}
+
+			{
+				ConfigLoader::ReadGuard guard;
+				Assert::IsTrue( config->GetSection( TEXT( "Client" ) ) == client );
+				Assert::IsTrue( config->GetSection( TEXT( "Cache" ) ) == cache );
+				DefaultParser* reparsed = static_cast<DefaultParser*>( config->GetSection( TEXT( "Server" ) ) );
+				Assert::IsTrue( reparsed != server );
+				Assert::AreEqual( 8, reparsed->getInt32( CFG_KEY( "threads" ), 0 ) );
+				Assert::AreEqual( 3, client->getInt32( CFG_KEY( "retries" ), 0 ) );
+			}
+
+			/* keys are reported in key order */
+			Assert::AreEqual( (size_t) 1, changes.size() );
+			Assert::AreEqual( TSTRING( TEXT( "SERVER" ) ), changes[0].section );
+			Assert::IsTrue( changes[0].type == CHANGE_MODIFIED );
+			Assert::IsTrue( changes[0].reparsed );
+			Assert::AreEqual( (size_t) 3, changes[0].keys.size() );
+			Assert::AreEqual( TSTRING( TEXT( "name" ) ), changes[0].keys[0].key );
+			Assert::IsTrue( changes[0].keys[0].type == CHANGE_REMOVED );
+			Assert::AreEqual( TSTRING( TEXT( "primary" ) ), changes[0].keys[0].old_value );
+			Assert::AreEqual( TSTRING( TEXT( "port" ) ), changes[0].keys[1].key );
+			Assert::IsTrue( changes[0].keys[1].type == CHANGE_ADDED );
+			Assert::AreEqual( TSTRING( TEXT( "80" ) ), changes[0].keys[1].new_value );
+			Assert::AreEqual( TSTRING( TEXT( "threads" ) ), changes[0].keys[2].key );
+			Assert::IsTrue( changes[0].keys[2].type == CHANGE_MODIFIED );
+			Assert::AreEqual( TSTRING( TEXT( "4" ) ), changes[0].keys[2].old_value );
+			Assert::AreEqual( TSTRING( TEXT( "8" ) ), changes[0].keys[2].new_value );
+
+			/* reloading an unchanged file reports nothing */
+			{
+				std::lock_guard<std::mutex> lock( seen_lock );
+				seen.clear();
+			}
+			Assert::IsTrue( config->Reload() );
+			{
+				std::lock_guard<std::mutex> lock( seen_lock );
+				Assert::AreEqual( (size_t) 0, seen.size() );
+			}
+
+			config.reset();
+			remove( "diff_test.ini" );
+		}
+
+		TEST_METHOD( Reload_MappedFile )
+		{
+			FILE* file = fopen( "mapped_diff_test.ini", "wb" );
+			Assert::IsTrue( file != nullptr );
+			fputs( "[Server]\nthreads = 4\n[Client]\nretries = 3\n", file );
+			fclose( file );
+
+			CONFIGHANDLE config = OPEN_CONFIG( TEXT( "mapped_diff_test.ini" ), TEXT( "" ), CONFIG_MAPPED );
+			DefaultParser* client = new DefaultParser( TEXT( "Client" ) );
+			Assert::IsTrue( config->AddSection( new DefaultParser( TEXT( "Server" ) ) ) );
+			Assert::IsTrue( config->AddSection( client ) );
+			std::vector<SectionChange> seen;
+			config->Subscribe( [&]( const std::vector<SectionChange>& changes ) { seen = changes; } );
+
+			/* every section is parsed so the file can be written, but the mapping can not be compared
+			 * with the new file so the first reload reparses every section */
+			file = fopen( "mapped_diff_test.ini", "wb" );
+			Assert::IsTrue( file != nullptr );
+			fputs( "[Server]\nthreads = 8\n[Client]\nretries = 3\n", file );
+			fclose( file );
+			Assert::IsTrue( config->Reload() );
+			Assert::AreEqual( (size_t) 3, seen.size() );
+			Assert::AreEqual( TSTRING( TEXT( "CLIENT" ) ), seen[0].section );
+			Assert::AreEqual( TSTRING( TEXT( "DEFAULT" ) ), seen[1].section );
+			Assert::IsTrue( seen[0].reparsed && seen[2].reparsed );
+			Assert::AreEqual( (size_t) 0, seen[2].keys.size() );
+
+			/* later loads are read into a buffer and compared */
+			{
+				ConfigLoader::ReadGuard guard;
+				client = static_cast<DefaultParser*>( config->GetSection( TEXT( "Client" ) ) );
+			}
+			file = fopen( "mapped_diff_test.ini", "wb" );
+			Assert::IsTrue( file != nullptr );
+			fputs( "[Server]\nthreads = 16\n[Client]\nretries = 3\n", file );
+			fclose( file );
+			Assert::IsTrue( config->Reload() );
+			Assert::AreEqual( (size_t) 1, seen.size() );
+			Assert::AreEqual( TSTRING( TEXT( "SERVER" ) ), seen[0].section );
+			Assert::AreEqual( (size_t) 1, seen[0].keys.size() );
+			Assert::IsTrue( config->GetSection( TEXT( "Client" ) ) == client );
+
+			config.reset();
+			remove( "mapped_diff_test.ini" );
+		}
+	};
+
+	TEST_CLASS( KeyHandle_Test )
+	{
+	public:
+		TEST_METHOD( KeyHandle_FollowsReload )
+		{
+			FILE* file = fopen( "handle_test.ini", "wb" );
+			Assert::IsTrue( file != nullptr );
+			fputs( "[Server]\nthreads = 4\nname = primary\n", file );
+			fclose( file );
+
+			CONFIGHANDLE config = OPEN_CONFIG( TEXT( "handle_test.ini" ), TEXT( "" ) );
+			FlatDefaultParser* server = new FlatDefaultParser( TEXT( "Server" ) );
+			Assert::IsTrue( config->AddSection( server ) );
+
+			KeyHandle<INT32> threads = server->Resolve<INT32>( CFG_KEY( "threads" ), 1 );
+			KeyHandle<double> ratio = server->Resolve<double>( CFG_KEY( "ratio" ), 0.5 );
+			KeyHandle<TSTRING> name = server->Resolve( CFG_KEY( "name" ) );
+			Assert::AreEqual( 4, threads.Get() );
+			Assert::AreEqual( 0.5, ratio.Get() );
+			Assert::AreEqual( TSTRING( TEXT( "primary" ) ), name.Get() );
+
+			/* the reload replaces the parser, the handles find the new one by section name */
+			file = fopen( "handle_test.ini", "wb" );
+			Assert::IsTrue( file != nullptr );
+			fputs( "[Server]\nthreads = 16\nratio = 0.75\n", file );
+			fclose( file );
+			Assert::IsTrue( config->Reload() );
+			Assert::AreEqual( 16, threads.Get() );
+			Assert::AreEqual( 0.75, ratio.Get() );
+			Assert::AreEqual( TSTRING(), name.Get() );
+
+			/* parsers not added to a ConfigLoader are read once */
+			DefaultParser loose( TEXT( "Loose" ) );
+			loose.Parse( TSTRING( TEXT( "port" ) ), TSTRING( TEXT( "80" ) ) );
+			KeyHandle<INT64> port = loose.Resolve<INT64>( CFG_KEY( "port" ), 0 );
+			Assert::AreEqual( (INT64) 80, port.Get() );
+
+			config.reset();
+			remove( "handle_test.ini" );
+		}
+	};
+
+	TEST_CLASS( ConfigImage_Test )
+	{
+	public:
+		TEST_METHOD( ConfigImage_RoundTrip )
+		{
+			FILE* file = fopen( "image_test.ini", "wb" );
+			Assert::IsTrue( file != nullptr );
+			fputs( "top = 1\n[Server]\nthreads = 4\nname = primary\nbare\n[Client]\nretries = 3\n", file );
+			fclose( file );
+
+			const TSTRING source = TEXT( "image_test.ini" );
+#ifdef _UNICODE
+			/* images are only supported by narrow charactor builds */
+			Assert::IsFalse( ConfigImage::Compile( source, ConfigImage::ImagePath( source ) ) );
+#else
+			Assert::IsTrue( ConfigImage::Compile( source, ConfigImage::ImagePath( source ) ) );
+
+			ConfigImage image;
+			Assert::IsTrue( image.Open( ConfigImage::ImagePath( source ), source, true ) );
+			Assert::AreEqual( (size_t) 3, image.SectionCount() );
+			const ConfigImage::SectionRecord* server = image.FindSection( CFG_KEY( "server" ) );
+			Assert::IsTrue( server != nullptr );
+			Assert::AreEqual( (UINT32) 3, server->entry_count );
+			const ConfigImage::EntryRecord* name = image.FindEntry( *server, CFG_KEY( "name" ) );
+			Assert::IsTrue( name != nullptr );
+			Assert::IsTrue( image.Value( *name ) == StringView( TEXT( "primary" ) ) );
+			Assert::IsTrue( ( image.Entries( *server )[2].flags & ConfigImage::ENTRY_HAS_VALUE ) == 0 );
+			Assert::IsTrue( image.FindEntry( *server, CFG_KEY( "missing" ) ) == nullptr );
+			Assert::IsTrue( image.FindSection( CFG_KEY( "missing" ) ) == nullptr );
+			image.Close();
+
+			/* opened configs read the image without scanning the text */
+			CONFIGHANDLE config = OPEN_CONFIG( source, TEXT( "" ) );
+			DefaultParser* parser = new DefaultParser( TEXT( "Server" ) );
+			Assert::IsTrue( config->AddSection( parser ) );
+			Assert::AreEqual( (UINT64) 0, config->Statistics().counters[LOAD_LINES] );
+			Assert::AreEqual( 4, parser->getInt32( CFG_KEY( "threads" ), 0 ) );
+			Assert::AreEqual( TSTRING( TEXT( "bare" ) ), parser->getString( CFG_KEY( "1" ), TSTRING() ) );
+			config.reset();
+#endif
+			remove( "image_test.ini.bin" );
+			remove( "image_test.ini" );
+		}
+
+		TEST_METHOD( ConfigImage_StaleFallback )
+		{
+			FILE* file = fopen( "stale_test.ini", "wb" );
+			Assert::IsTrue( file != nullptr );
+			fputs( "[Server]\nthreads = 4\n", file );
+			fclose( file );
+
+			const TSTRING source = TEXT( "stale_test.ini" );
+#ifndef _UNICODE
+			Assert::IsTrue( ConfigImage::Compile( source, ConfigImage::ImagePath( source ) ) );
+
+			/* the same size file written again is newer than the image */
+			file = fopen( "stale_test.ini", "wb" );
+			Assert::IsTrue( file != nullptr );
+			fputs( "[Server]\nthreads = 8\n", file );
+			fclose( file );
+
+			ConfigImage image;
+			Assert::IsFalse( image.Open( ConfigImage::ImagePath( source ), source ) );
 
+			CONFIGHANDLE config = OPEN_CONFIG( source, TEXT( "" ) );
+			DefaultParser* parser = new DefaultParser( TEXT( "Server" ) );
+			Assert::IsTrue( config->AddSection( parser ) );
+			Assert::IsTrue( config->Statistics().counters[LOAD_LINES] > 0 );
+			Assert::AreEqual( 8, parser->getInt32( CFG_KEY( "threads" ), 0 ) );
+			config.reset();
+#endif
+			remove( "stale_test.ini.bin" );
+			remove( "stale_test.ini" );
+		}
+
+		TEST_METHOD( ConfigImage_RejectsDamaged )
+		{
+			FILE* file = fopen( "damaged_test.ini", "wb" );
+			Assert::IsTrue( file != nullptr );
+			fputs( "[Server]\nthreads = 4\nname = primary\n", file );
+			fclose( file );
+
+			const TSTRING source = TEXT( "damaged_test.ini" );
+#ifndef _UNICODE
+			std::vector<char> bytes;
+			Assert::IsTrue( ConfigImage::Build( source, bytes ) );
+			Assert::IsTrue( bytes.size() > sizeof( ConfigImage::Header ) );
+
+			/* a changed charactor is only found by the checksum */
+			bytes.back() ^= 0x01;
+			file = fopen( "damaged_test.ini.bin", "wb" );
+			Assert::IsTrue( file != nullptr );
+			fwrite( bytes.data(), 1, bytes.size(), file );
+			fclose( file );
+
+			ConfigImage image;
+			Assert::IsTrue( image.Open( ConfigImage::ImagePath( source ), source, false ) );
+			Assert::IsFalse( image.Open( ConfigImage::ImagePath( source ), source, true ) );
+
+			CONFIGHANDLE config = OPEN_CONFIG( source, TEXT( "" ), CONFIG_VERIFY_IMAGE );
+			DefaultParser* parser = new DefaultParser( TEXT( "Server" ) );
+			Assert::IsTrue( config->AddSection( parser ) );
+			Assert::IsTrue( config->Statistics().counters[LOAD_LINES] > 0 );
+			Assert::AreEqual( TSTRING( TEXT( "primary" ) ), parser->getString( CFG_KEY( "name" ), TSTRING() ) );
+			config.reset();
+
+			/* truncated images are rejected whether or not the checksum is checked */
+			bytes.back() ^= 0x01;
+			file = fopen( "damaged_test.ini.bin", "wb" );
+			Assert::IsTrue( file != nullptr );
+			fwrite( bytes.data(), 1, bytes.size() / 2, file );
+			fclose( file );
+			Assert::IsFalse( image.Open( ConfigImage::ImagePath( source ), source, false ) );
+			Assert::IsFalse( image.Open( ConfigImage::ImagePath( source ), source, true ) );
+#endif
+			remove( "damaged_test.ini.bin" );
+			remove( "damaged_test.ini" );
+		}
+	};
+
+	TEST_CLASS( SharedImage_Test )
+	{
+	public:
+		TEST_METHOD( SharedImage_PublishAndAdopt )
+		{
+			FILE* file = fopen( "shared_test.ini", "wb" );
+			Assert::IsTrue( file != nullptr );
+			fputs( "[Server]\nthreads = 4\nname = primary\n", file );
+			fclose( file );
+
+			const TSTRING source = TEXT( "shared_test.ini" );
+			const TSTRING name = ConfigImage::SharedName( source );
+			ImagePublisher publisher;
+#ifdef _UNICODE
+			/* images are only supported by narrow charactor builds */
+			Assert::IsFalse( publisher.Publish( source, name ) );
+#else
+			Assert::IsTrue( publisher.Publish( source, name ) );
+			Assert::AreEqual( (UINT64) 1, publisher.Generation() );
+
+			/* attached configs read the published image rather than the file */
+			CONFIGHANDLE config = OPEN_CONFIG( source, TEXT( "" ), CONFIG_SHARED );
+			DefaultParser* server = new DefaultParser( TEXT( "Server" ) );
+			Assert::IsTrue( config->AddSection( server ) );
+			KeyHandle<INT32> threads = server->Resolve<INT32>( CFG_KEY( "threads" ), 1 );
+			Assert::AreEqual( 4, threads.Get() );
+			Assert::AreEqual( (UINT64) 0, config->Statistics().counters[LOAD_LINES] );
+
+			/* nothing is done until a newer image is published */
+			int reloads = 0;
+			std::vector<SectionChange> seen;
+			config->Subscribe( [&]( const std::vector<SectionChange>& changes ) { ++reloads; seen = changes; } );
+			Assert::IsTrue( config->Reload() );
+			Assert::AreEqual( 0, reloads );
+
+			file = fopen( "shared_test.ini", "wb" );
+			Assert::IsTrue( file != nullptr );
+			fputs( "[Server]\nthreads = 16\nname = primary\n[Client]\nretries = 3\n", file );
+			fclose( file );
+			Assert::IsTrue( publisher.Publish( source, name ) );
+			Assert::AreEqual( (UINT64) 2, publisher.Generation() );
+
+			Assert::IsTrue( config->Reload() );
+			Assert::AreEqual( 1, reloads );
+			Assert::AreEqual( (size_t) 2, seen.size() );
+			Assert::AreEqual( TSTRING( TEXT( "CLIENT" ) ), seen[0].section );
+			Assert::IsTrue( seen[0].type == CHANGE_ADDED );
+			Assert::AreEqual( TSTRING( TEXT( "SERVER" ) ), seen[1].section );
+			Assert::IsTrue( seen[1].reparsed );
+			Assert::AreEqual( (size_t) 1, seen[1].keys.size() );
+			Assert::AreEqual( TSTRING( TEXT( "16" ) ), seen[1].keys[0].new_value );
+			Assert::AreEqual( 16, threads.Get() );
+
+			/* the reparsed section is a new parser, the one added is no longer used */
+			{
+				ConfigLoader::ReadGuard guard;
+				DefaultParser* reparsed = static_cast<DefaultParser*>( config->GetSection( CFG_KEY( "Server" ) ) );
+				Assert::IsTrue( reparsed != nullptr );
+				Assert::AreEqual( 16, reparsed->getInt32( CFG_KEY( "threads" ), 1 ) );
+			}
+			Assert::IsTrue( config->Reload() );
+			Assert::AreEqual( 1, reloads );
+
+			/* once the publisher closes, new processes load the file themselves */
+			publisher.Close();
+			ConfigImage image;
+			Assert::IsFalse( image.Attach( name, source ) );
+			config.reset();
+#endif
+			remove( "shared_test.ini" );
+		}
+
+		TEST_METHOD( SharedImage_FollowsLatePublish )
+		{
+			FILE* file = fopen( "late_test.ini", "wb" );
+			Assert::IsTrue( file != nullptr );
+			fputs( "[Server]\nthreads = 4\n", file );
+			fclose( file );
+
+			const TSTRING source = TEXT( "late_test.ini" );
+			const TSTRING name = ConfigImage::SharedName( source );
+#ifndef _UNICODE
+			ImagePublisher publisher;
+			Assert::IsTrue( publisher.Publish( source, name ) );
+			CONFIGHANDLE config = OPEN_CONFIG( source, TEXT( "" ), CONFIG_SHARED | CONFIG_RELOAD );
+			DefaultParser* server = new DefaultParser( TEXT( "Server" ) );
+			Assert::IsTrue( config->AddSection( server ) );
+			KeyHandle<INT32> threads = server->Resolve<INT32>( CFG_KEY( "threads" ), 1 );
+			Assert::AreEqual( 4, threads.Get() );
+
+			/* the watcher sees the write well before the publisher gets to it */
+			file = fopen( "late_test.ini", "wb" );
+			Assert::IsTrue( file != nullptr );
+			fputs( "[Server]\nthreads = 16\n", file );
+			fclose( file );
+			std::this_thread::sleep_for( std::chrono::milliseconds( 500 ) );
+			Assert::AreEqual( 4, threads.Get() );
+
+			/* the raised generation is noticed without the file changing again */
+			Assert::IsTrue( publisher.Publish( source, name ) );
+			for ( int wait = 0; wait < 50 && threads.Get() != 16; ++wait )
+			{
+				std::this_thread::sleep_for( std::chrono::milliseconds( 100 ) );
+			}
+			Assert::AreEqual( 16, threads.Get() );
+
+			config.reset();
+			publisher.Close();
+#endif
+			remove( "late_test.ini" );
 		}
 	};
 
@@ -68,6 +1609,236 @@ namespace SimpleConfig_Tests
 			Assert::AreEqual( TSTRING( TEXT( "7" ) ), testParser.getString( TEXT( "TestKey7" ), TEXT( "" ) ) );
 		}
 
+		TEST_METHOD( DefaultParser_FlatStorage )
+		{
+			FlatDefaultParser testParser( TEXT( "TestSection" ) );
+
+			testParser.Parse( TEXT( "b" ), TEXT( "1" ) );
+			testParser.Parse( TEXT( "a" ), TEXT( "2" ) );
+			testParser.Parse( TEXT( "c" ), TEXT( "3" ) );
+
+			/* duplicates are still reported */
+			testParser.Parse( TEXT( "a" ), TEXT( "4" ) );
+			Assert::AreEqual( TSTRING( TEXT( "Duplicate Configuration Key: a" ) ), testParser.CheckMessage() );
+
+			/* flat storage keeps the entries in the order they were parsed */
+			Assert::AreEqual( TSTRING( TEXT( "b" ) ), testParser.GetAt( 0 ) );
+			Assert::AreEqual( TSTRING( TEXT( "a" ) ), testParser.GetAt( 1 ) );
+			Assert::AreEqual( TSTRING( TEXT( "c" ) ), testParser.GetAt( 2 ) );
+			Assert::AreEqual( TSTRING( TEXT( "" ) ), testParser.GetAt( 3 ) );
+
+			Assert::AreEqual( TSTRING( TEXT( "2" ) ), testParser.getString( TEXT( "a" ), TEXT( "" ) ) );
+			Assert::AreEqual( TSTRING( TEXT( "NULL" ) ), testParser.getString( TEXT( "d" ), TEXT( "NULL" ) ) );
+
+			/* keys can not be changed through an iterator, as they would be left in the wrong slot, values can */
+			typedef FlatMap<TSTRING, int> Map;
+			static_assert( std::is_const<std::remove_reference<decltype( ( std::declval<Map&>().begin()->first ) )>::type>::value, "keys are read only" );
+			Map map;
+			map[TEXT( "first" )] = 1;
+			map.insert( std::make_pair( TSTRING( TEXT( "second" ) ), 2 ) );
+			Map::iterator it = map.find( StringView( TEXT( "second" ) ) );
+			map.mapped_at( it ) = 3;
+			Assert::AreEqual( 3, map[TEXT( "second" )] );
+			for ( int i = 0; i < 100; ++i )
+			{
+				map[util::Int64ToString( i )] = i;
+			}
+			Assert::AreEqual( 1, map.find( StringView( TEXT( "first" ) ) )->second );
+			Assert::AreEqual( 3, map.find( StringView( TEXT( "second" ) ) )->second );
+			Assert::AreEqual( 42, map.find( StringView( TEXT( "42" ) ) )->second );
+		}
+
+		TEST_METHOD( DefaultParser_LookupAllocations )
+		{
+			FlatDefaultParser flatParser( TEXT( "TestSection" ) );
+			DefaultParser treeParser( TEXT( "TestSection" ) );
+
+			/* keys and values too long for small string storage */
+			flatParser.Parse( TEXT( "maximum_connection_count" ), TEXT( "12345" ) );
+			flatParser.Parse( TEXT( "description" ), TEXT( "a value that is too long for small string storage" ) );
+			treeParser.Parse( TEXT( "maximum_connection_count" ), TEXT( "12345" ) );
+
+			size_t before = allocations.load();
+			INT32 count = flatParser.getInt32( TEXT( "maximum_connection_count" ), 0 );
+			INT64 missing = flatParser.getInt64( TEXT( "a_missing_key_that_is_quite_long" ), -1 );
+			StringView description = flatParser.getStringView( TEXT( "description" ) );
+			Assert::AreEqual( before, allocations.load() );
+
+			Assert::AreEqual( 12345, count );
+			Assert::AreEqual( (INT64) -1, missing );
+			Assert::AreEqual( TSTRING( TEXT( "a value that is too long for small string storage" ) ), description.str() );
+
+			/* tree storage searches by view as every supported build has transparent comparators */
+			before = allocations.load();
+			count = treeParser.getInt32( TEXT( "maximum_connection_count" ), 0 );
+			Assert::AreEqual( before, allocations.load() );
+			Assert::AreEqual( 12345, count );
+		}
+
+		TEST_METHOD( DefaultParser_ParseAllocations )
+		{
+			FlatDefaultParser testParser( TEXT( "TestSection" ) );
+			std::vector<TSTRING> lines;
+			for ( int i = 0; i < 64; ++i )
+			{
+				lines.push_back( TEXT( "a_key_long_enough_to_be_allocated_" ) + util::Int64ToString( i ) );
+			}
+
+			/* each view is copied once and moved into the dictionary, only the table and entries grow besides */
+			size_t before = allocations.load();
+			for ( size_t i = 0; i < lines.size(); ++i )
+			{
+				testParser.Parse( StringView( lines[i] ), StringView( lines[i] ) );
+			}
+			Assert::IsTrue( allocations.load() - before <= lines.size() * 2 + 16 );
+			Assert::AreEqual( lines[63], testParser.getString( lines[63], TSTRING() ) );
+
+			testParser.Parse( StringView( lines[0] ), StringView( lines[1] ) );
+			Assert::AreEqual( TEXT( "Duplicate Configuration Key: " ) + lines[0], testParser.CheckMessage() );
+			Assert::AreEqual( lines[0], testParser.getString( lines[0], TSTRING() ) );
+		}
+
+		TEST_METHOD( DefaultParser_OverriddenParse )
+		{
+			/* custom parsers override the const version of Parse, loading must still call it */
+			class UpperParser : public DefaultParser
+			{
+			public:
+				UpperParser() : DefaultParser( TEXT( "Custom" ) ), calls( 0 ) {}
+				using DefaultParser::Parse;
+				void Parse( const TSTRING& key, const TSTRING& value )
+				{
+					++calls;
+					DefaultParser::Parse( key, util::FoldedString( value ) );
+				}
+				int calls;
+			};
+
+			class CountingParser : public Parser<TSTRING>
+			{
+			public:
+				CountingParser() : Parser<TSTRING>( TEXT( "Custom" ) ), calls( 0 ) {}
+				using Parser<TSTRING>::Parse;
+				void Parse( const TSTRING& key, const TSTRING& value )
+				{
+					++calls;
+					Parser<TSTRING>::Parse( key, value + TEXT( "!" ) );
+				}
+				int calls;
+			};
+
+			FILE* file = fopen( "override_test.ini", "wb" );
+			Assert::IsTrue( file != nullptr );
+			fputs( "[Custom]\nname = primary\nbare\n", file );
+			fclose( file );
+
+			UpperParser upper;
+			CountingParser counting;
+			CONFIGHANDLE config = OPEN_CONFIG( TEXT( "override_test.ini" ), TEXT( "" ) );
+			UpperParser* added = new UpperParser();
+			Assert::IsTrue( config->AddSection( added ) );
+			Assert::AreEqual( 2, added->calls );
+			Assert::AreEqual( TSTRING( TEXT( "PRIMARY" ) ), added->getString( CFG_KEY( "name" ), TSTRING() ) );
+			Assert::AreEqual( TSTRING( TEXT( "BARE" ) ), added->getString( CFG_KEY( "1" ), TSTRING() ) );
+
+			/* parsers not added to a loader take the same path from views */
+			counting.Parse( StringView( TEXT( "name" ) ), StringView( TEXT( "primary" ) ) );
+			counting.Parse( TSTRING( TEXT( "other" ) ), TSTRING( TEXT( "value" ) ) );
+			Assert::AreEqual( 2, counting.calls );
+			Assert::AreEqual( TSTRING( TEXT( "primary!" ) ), counting.GetItem( CFG_KEY( "name" ), TSTRING() ) );
+			upper.Parse( StringView( TEXT( "name" ) ), StringView( TEXT( "low" ) ) );
+			Assert::AreEqual( 1, upper.calls );
+			Assert::AreEqual( TSTRING( TEXT( "LOW" ) ), upper.getString( CFG_KEY( "name" ), TSTRING() ) );
+
+			config.reset();
+			remove( "override_test.ini" );
+		}
+
+		TEST_METHOD( DefaultParser_CompileTimeKeys )
+		{
+			static constexpr KeyView MaxConnections = CFG_KEY( "max_connections" );
+			static_assert( util::HashLiteral( TEXT( "key" ), 3 ) != util::HashLiteralFolded( TEXT( "key" ), 3 ), "folded hash ignores case" );
+
+			/* compile time hashes must match the ones used by the dictionaries */
+			Assert::AreEqual( util::HashString( TEXT( "max_connections" ), 15 ), MaxConnections.Hash() );
+			Assert::AreEqual( util::HashStringFolded( TEXT( "MAX_CONNECTIONS" ), 15 ), MaxConnections.FoldedHash() );
+			Assert::AreEqual( KeyView( TEXT( "max_connections" ) ).Hash(), MaxConnections.Hash() );
+
+			FlatDefaultParser flatParser( TEXT( "TestSection" ) );
+			DefaultParser treeParser( TEXT( "TestSection" ) );
+			flatParser.Parse( TEXT( "max_connections" ), TEXT( "64" ) );
+			treeParser.Parse( TEXT( "max_connections" ), TEXT( "64" ) );
+			Assert::AreEqual( 64, flatParser.getInt32( MaxConnections, 0 ) );
+			Assert::AreEqual( 64, treeParser.getInt32( MaxConnections, 0 ) );
+			Assert::AreEqual( 0, flatParser.getInt32( CFG_KEY( "MAX_CONNECTIONS" ), 0 ) );
+
+			/* section names are found ignoring case */
+			FlatMap<TSTRING, int, FoldedHash, FoldedEqual> sections;
+			sections[TEXT( "DATABASE" )] = 1;
+			KeyView section = CFG_KEY( "Database" );
+			Assert::IsTrue( sections.find( section.View(), section.FoldedHash() ) != sections.end() );
+			Assert::IsTrue( sections.find( StringView( TEXT( "database" ) ) ) != sections.end() );
+
+			/* names known at run time can be hashed once and kept */
+			TSTRING name( TEXT( "dataBASE" ) );
+			const KeyView prehashed = KeyView( name ).Prehash();
+			Assert::AreEqual( section.FoldedHash(), prehashed.FoldedHash() );
+			size_t before = allocations.load();
+			Assert::IsTrue( sections.find( prehashed.View(), prehashed.FoldedHash() ) != sections.end() );
+			Assert::AreEqual( before, allocations.load() );
+		}
+
+		TEST_METHOD( DefaultParser_Create )
+		{
+			FlatDefaultParser testParser( TEXT( "TestSection" ) );
+			testParser.Parse( TEXT( "TestKey" ), TEXT( "1" ) );
+
+			/* reloads parse into an empty parser of the same type and section */
+			std::unique_ptr<ParserBase> fresh( testParser.Create() );
+			FlatDefaultParser* created = dynamic_cast<FlatDefaultParser*>( fresh.get() );
+			Assert::IsNotNull( created );
+			Assert::AreEqual( testParser.section_name, created->section_name );
+			Assert::AreEqual( TSTRING( TEXT( "" ) ), created->getString( TEXT( "TestKey" ), TEXT( "" ) ) );
+		}
+
+		TEST_METHOD( DefaultParser_CreateDerived )
+		{
+			/* derived parsers that do not override Create keep their entries over a reload */
+			class PrefixParser : public DefaultParser
+			{
+			public:
+				PrefixParser() : DefaultParser( TEXT( "Custom" ) ) {}
+			};
+
+			PrefixParser loose;
+			Assert::IsNull( loose.Create() );
+
+			FILE* file = fopen( "create_test.ini", "wb" );
+			Assert::IsTrue( file != nullptr );
+			fputs( "[Custom]\nname = primary\n", file );
+			fclose( file );
+
+			CONFIGHANDLE config = OPEN_CONFIG( TEXT( "create_test.ini" ), TEXT( "" ) );
+			PrefixParser* added = new PrefixParser();
+			Assert::IsTrue( config->AddSection( added ) );
+
+			file = fopen( "create_test.ini", "wb" );
+			Assert::IsTrue( file != nullptr );
+			fputs( "[Custom]\nname = secondary\n", file );
+			fclose( file );
+			Assert::IsTrue( config->Reload() );
+
+			std::vector<Diagnostic> records;
+			config->DrainMessages( records );
+			Assert::IsTrue( config->GetSection( TEXT( "Custom" ) ) == added );
+			Assert::AreEqual( TSTRING( TEXT( "primary" ) ), added->getString( CFG_KEY( "name" ), TSTRING() ) );
+			Assert::IsTrue( std::any_of( records.begin(), records.end(),
+										 []( const Diagnostic& record ) { return record.code == DIAG_RELOAD_UNSUPPORTED; } ) );
+
+			config.reset();
+			remove( "create_test.ini" );
+		}
+
 		TEST_METHOD( DefaultParser_getString )
 		{
 			DefaultParser testParser( TEXT( "TestSection" ) );
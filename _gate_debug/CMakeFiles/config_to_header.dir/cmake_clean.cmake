@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/config_to_header.dir/Tools/config_to_header.cpp.o"
+  "CMakeFiles/config_to_header.dir/Tools/config_to_header.cpp.o.d"
+  "bin/config_to_header"
+  "bin/config_to_header.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/config_to_header.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
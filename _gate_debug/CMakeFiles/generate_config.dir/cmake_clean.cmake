@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/generate_config.dir/Benchmarks/generate_config.cpp.o"
+  "CMakeFiles/generate_config.dir/Benchmarks/generate_config.cpp.o.d"
+  "bin/generate_config"
+  "bin/generate_config.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/generate_config.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
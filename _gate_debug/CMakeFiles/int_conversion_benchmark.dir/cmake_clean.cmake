@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/int_conversion_benchmark.dir/Benchmarks/int_conversion.cpp.o"
+  "CMakeFiles/int_conversion_benchmark.dir/Benchmarks/int_conversion.cpp.o.d"
+  "bin/int_conversion_benchmark"
+  "bin/int_conversion_benchmark.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/int_conversion_benchmark.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
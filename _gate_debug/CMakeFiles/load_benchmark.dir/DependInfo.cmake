@@ -0,0 +1,22 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/Benchmarks/allocation_counter.cpp" "CMakeFiles/load_benchmark.dir/Benchmarks/allocation_counter.cpp.o" "gcc" "CMakeFiles/load_benchmark.dir/Benchmarks/allocation_counter.cpp.o.d"
+  "/root/repo/Benchmarks/load_benchmark.cpp" "CMakeFiles/load_benchmark.dir/Benchmarks/load_benchmark.cpp.o" "gcc" "CMakeFiles/load_benchmark.dir/Benchmarks/load_benchmark.cpp.o.d"
+  )
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  "/root/repo/_gate_debug/CMakeFiles/simple_config.dir/DependInfo.cmake"
+  "/root/repo/_gate_debug/CMakeFiles/synthetic_config.dir/DependInfo.cmake"
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
@@ -0,0 +1,13 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/load_benchmark.dir/Benchmarks/allocation_counter.cpp.o"
+  "CMakeFiles/load_benchmark.dir/Benchmarks/allocation_counter.cpp.o.d"
+  "CMakeFiles/load_benchmark.dir/Benchmarks/load_benchmark.cpp.o"
+  "CMakeFiles/load_benchmark.dir/Benchmarks/load_benchmark.cpp.o.d"
+  "bin/load_benchmark"
+  "bin/load_benchmark.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/load_benchmark.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
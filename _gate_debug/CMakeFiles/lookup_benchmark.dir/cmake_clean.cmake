@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/lookup_benchmark.dir/Benchmarks/lookup_benchmark.cpp.o"
+  "CMakeFiles/lookup_benchmark.dir/Benchmarks/lookup_benchmark.cpp.o.d"
+  "bin/lookup_benchmark"
+  "bin/lookup_benchmark.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/lookup_benchmark.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,31 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/Linux_G++/arena.cpp" "CMakeFiles/simple_config.dir/Linux_G++/arena.cpp.o" "gcc" "CMakeFiles/simple_config.dir/Linux_G++/arena.cpp.o.d"
+  "/root/repo/Linux_G++/config_header.cpp" "CMakeFiles/simple_config.dir/Linux_G++/config_header.cpp.o" "gcc" "CMakeFiles/simple_config.dir/Linux_G++/config_header.cpp.o.d"
+  "/root/repo/Linux_G++/config_image.cpp" "CMakeFiles/simple_config.dir/Linux_G++/config_image.cpp.o" "gcc" "CMakeFiles/simple_config.dir/Linux_G++/config_image.cpp.o.d"
+  "/root/repo/Linux_G++/config_loader.cpp" "CMakeFiles/simple_config.dir/Linux_G++/config_loader.cpp.o" "gcc" "CMakeFiles/simple_config.dir/Linux_G++/config_loader.cpp.o.d"
+  "/root/repo/Linux_G++/config_registry.cpp" "CMakeFiles/simple_config.dir/Linux_G++/config_registry.cpp.o" "gcc" "CMakeFiles/simple_config.dir/Linux_G++/config_registry.cpp.o.d"
+  "/root/repo/Linux_G++/config_stats.cpp" "CMakeFiles/simple_config.dir/Linux_G++/config_stats.cpp.o" "gcc" "CMakeFiles/simple_config.dir/Linux_G++/config_stats.cpp.o.d"
+  "/root/repo/Linux_G++/diagnostics.cpp" "CMakeFiles/simple_config.dir/Linux_G++/diagnostics.cpp.o" "gcc" "CMakeFiles/simple_config.dir/Linux_G++/diagnostics.cpp.o.d"
+  "/root/repo/Linux_G++/file_watcher.cpp" "CMakeFiles/simple_config.dir/Linux_G++/file_watcher.cpp.o" "gcc" "CMakeFiles/simple_config.dir/Linux_G++/file_watcher.cpp.o.d"
+  "/root/repo/Linux_G++/key_profile.cpp" "CMakeFiles/simple_config.dir/Linux_G++/key_profile.cpp.o" "gcc" "CMakeFiles/simple_config.dir/Linux_G++/key_profile.cpp.o.d"
+  "/root/repo/Linux_G++/line_scanner.cpp" "CMakeFiles/simple_config.dir/Linux_G++/line_scanner.cpp.o" "gcc" "CMakeFiles/simple_config.dir/Linux_G++/line_scanner.cpp.o.d"
+  "/root/repo/Linux_G++/mapped_file.cpp" "CMakeFiles/simple_config.dir/Linux_G++/mapped_file.cpp.o" "gcc" "CMakeFiles/simple_config.dir/Linux_G++/mapped_file.cpp.o.d"
+  "/root/repo/Linux_G++/shared_segment.cpp" "CMakeFiles/simple_config.dir/Linux_G++/shared_segment.cpp.o" "gcc" "CMakeFiles/simple_config.dir/Linux_G++/shared_segment.cpp.o.d"
+  "/root/repo/Linux_G++/utility.cpp" "CMakeFiles/simple_config.dir/Linux_G++/utility.cpp.o" "gcc" "CMakeFiles/simple_config.dir/Linux_G++/utility.cpp.o.d"
+  )
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
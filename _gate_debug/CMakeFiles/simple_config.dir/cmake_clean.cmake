@@ -0,0 +1,35 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/simple_config.dir/Linux_G++/arena.cpp.o"
+  "CMakeFiles/simple_config.dir/Linux_G++/arena.cpp.o.d"
+  "CMakeFiles/simple_config.dir/Linux_G++/config_header.cpp.o"
+  "CMakeFiles/simple_config.dir/Linux_G++/config_header.cpp.o.d"
+  "CMakeFiles/simple_config.dir/Linux_G++/config_image.cpp.o"
+  "CMakeFiles/simple_config.dir/Linux_G++/config_image.cpp.o.d"
+  "CMakeFiles/simple_config.dir/Linux_G++/config_loader.cpp.o"
+  "CMakeFiles/simple_config.dir/Linux_G++/config_loader.cpp.o.d"
+  "CMakeFiles/simple_config.dir/Linux_G++/config_registry.cpp.o"
+  "CMakeFiles/simple_config.dir/Linux_G++/config_registry.cpp.o.d"
+  "CMakeFiles/simple_config.dir/Linux_G++/config_stats.cpp.o"
+  "CMakeFiles/simple_config.dir/Linux_G++/config_stats.cpp.o.d"
+  "CMakeFiles/simple_config.dir/Linux_G++/diagnostics.cpp.o"
+  "CMakeFiles/simple_config.dir/Linux_G++/diagnostics.cpp.o.d"
+  "CMakeFiles/simple_config.dir/Linux_G++/file_watcher.cpp.o"
+  "CMakeFiles/simple_config.dir/Linux_G++/file_watcher.cpp.o.d"
+  "CMakeFiles/simple_config.dir/Linux_G++/key_profile.cpp.o"
+  "CMakeFiles/simple_config.dir/Linux_G++/key_profile.cpp.o.d"
+  "CMakeFiles/simple_config.dir/Linux_G++/line_scanner.cpp.o"
+  "CMakeFiles/simple_config.dir/Linux_G++/line_scanner.cpp.o.d"
+  "CMakeFiles/simple_config.dir/Linux_G++/mapped_file.cpp.o"
+  "CMakeFiles/simple_config.dir/Linux_G++/mapped_file.cpp.o.d"
+  "CMakeFiles/simple_config.dir/Linux_G++/shared_segment.cpp.o"
+  "CMakeFiles/simple_config.dir/Linux_G++/shared_segment.cpp.o.d"
+  "CMakeFiles/simple_config.dir/Linux_G++/utility.cpp.o"
+  "CMakeFiles/simple_config.dir/Linux_G++/utility.cpp.o.d"
+  "lib/libsimple_config.a"
+  "lib/libsimple_config.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/simple_config.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/simple_config_example.dir/Linux_G++/main.cpp.o"
+  "CMakeFiles/simple_config_example.dir/Linux_G++/main.cpp.o.d"
+  "bin/simple_config_example"
+  "bin/simple_config_example.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/simple_config_example.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
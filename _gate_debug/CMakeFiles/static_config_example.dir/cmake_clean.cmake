@@ -0,0 +1,12 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/static_config_example.dir/Tools/static_config_example.cpp.o"
+  "CMakeFiles/static_config_example.dir/Tools/static_config_example.cpp.o.d"
+  "bin/static_config_example"
+  "bin/static_config_example.pdb"
+  "generated/example_config.h"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/static_config_example.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
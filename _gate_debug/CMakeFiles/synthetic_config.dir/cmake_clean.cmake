@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/synthetic_config.dir/Benchmarks/synthetic_config.cpp.o"
+  "CMakeFiles/synthetic_config.dir/Benchmarks/synthetic_config.cpp.o.d"
+  "lib/libsynthetic_config.a"
+  "lib/libsynthetic_config.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/synthetic_config.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,65 @@
+
+/* Generated by ConfigHeader, do not edit. */
+
+#ifndef _EXAMPLE_CONFIG_H_
+#define _EXAMPLE_CONFIG_H_
+
+#include "static_config.h"
+
+namespace example_config
+{
+	namespace DEFAULT
+	{
+		namespace keys
+		{
+			constexpr StringView name = StringView( TEXT("example"), 7 );
+		}
+		constexpr StaticEntry entries[] = {
+			{ StringView( TEXT("name"), 4 ), StringView( TEXT("example"), 7 ) },
+		};
+		constexpr StaticParser parser( entries, 1 );
+	}
+
+	namespace PATHS
+	{
+		namespace keys
+		{
+			constexpr StringView _1 = StringView( TEXT("C:\\Program Files\\Example"), 24 );
+			constexpr StringView _2 = StringView( TEXT("/usr/share/example"), 18 );
+		}
+		constexpr StaticEntry entries[] = {
+			{ StringView( TEXT("1"), 1 ), StringView( TEXT("C:\\Program Files\\Example"), 24 ) },
+			{ StringView( TEXT("2"), 1 ), StringView( TEXT("/usr/share/example"), 18 ) },
+		};
+		constexpr StaticParser parser( entries, 2 );
+	}
+
+	namespace SERVER
+	{
+		namespace keys
+		{
+			constexpr INT64 backlog = 128LL;
+			constexpr StringView host = StringView( TEXT("localhost"), 9 );
+			constexpr INT64 max_ = 64LL;
+			constexpr INT64 port = 8080LL;
+			constexpr double timeout = 2.5;
+		}
+		constexpr StaticEntry entries[] = {
+			{ StringView( TEXT("backlog"), 7 ), StringView( TEXT("0x80"), 4 ) },
+			{ StringView( TEXT("host"), 4 ), StringView( TEXT("localhost"), 9 ) },
+			{ StringView( TEXT("max"), 3 ), StringView( TEXT("64"), 2 ) },
+			{ StringView( TEXT("port"), 4 ), StringView( TEXT("8080"), 4 ) },
+			{ StringView( TEXT("timeout"), 7 ), StringView( TEXT("2.5"), 3 ) },
+		};
+		constexpr StaticParser parser( entries, 5 );
+	}
+
+	constexpr StaticSection sections[] = {
+		{ StringView( TEXT("DEFAULT"), 7 ), DEFAULT::parser },
+		{ StringView( TEXT("PATHS"), 5 ), PATHS::parser },
+		{ StringView( TEXT("SERVER"), 6 ), SERVER::parser },
+	};
+	constexpr StaticConfig config( sections, 3 );
+}
+
+#endif